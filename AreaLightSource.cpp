@@ -0,0 +1,95 @@
+/* $Rev: 250 $ */
+#include "AreaLightSource.h"
+
+#include "utility.h"
+
+#include <algorithm>
+#include <cmath>
+
+AreaLightSource::AreaLightSource() : LightSource(), samples(4) {
+
+}
+
+AreaLightSource::AreaLightSource(const AreaLightSource& lightSource) : LightSource(lightSource),
+samples(lightSource.samples) {
+
+}
+
+AreaLightSource::~AreaLightSource() {
+
+}
+
+const AreaLightSource& AreaLightSource::operator=(const AreaLightSource& lightSource) {
+	if (this != &lightSource) {
+		LightSource::operator=(lightSource);
+		samples = lightSource.samples;
+	}
+	return *this;
+}
+
+double AreaLightSource::getIntensityAt(const Point& point) const {
+	double distance = (location - point).norm();
+	if (distance < epsilon) distance = epsilon;
+	return 1 / (distance*distance);
+}
+
+double AreaLightSource::influenceRadius(double threshold) const {
+	if (threshold <= 0) {
+		return infinity;
+	}
+	double brightest = std::max(colour.red, std::max(colour.green, colour.blue));
+	return std::sqrt(std::max(brightest, 0.0)/threshold) + extent();
+}
+
+unsigned int AreaLightSource::sampleGrid() const {
+	return std::max(samples, 1u);
+}
+
+LightSample AreaLightSource::sampleAt(const Point& point, double u, double v) const {
+	LightSample result;
+	Vector toLight = pointOn(point, u, v) - point;
+	result.distance = std::max(toLight.norm(), epsilon);
+	result.direction = Direction(toLight/result.distance);
+	result.intensity = colour*(facing(-result.direction)/(result.distance*result.distance));
+	return result;
+}
+
+Colour AreaLightSource::emit(const Point& centre, double radius, double u, double v, double s, double t, Ray& ray) const {
+	double solidAngle = towards(pointOn(centre, u, v), centre, radius, s, t, ray);
+	return solidAngle*facing(ray.direction)*colour;
+}
+
+double AreaLightSource::facing(const Vector&) const {
+	return 1;
+}
+
+void AreaLightSource::concentricDisc(double u, double v, double& x, double& y) {
+	double a = 2*u - 1;
+	double b = 2*v - 1;
+	if (a == 0 && b == 0) {
+		x = 0;
+		y = 0;
+		return;
+	}
+	double radius, angle;
+	if (std::abs(a) > std::abs(b)) {
+		radius = a;
+		angle = 0.25*M_PI*(b/a);
+	} else {
+		radius = b;
+		angle = 0.5*M_PI - 0.25*M_PI*(a/b);
+	}
+	x = radius*std::cos(angle);
+	y = radius*std::sin(angle);
+}
+
+void AreaLightSource::perpendicularAxes(const Vector& normal, Vector& a, Vector& b) {
+	// Start from whichever axis is furthest from the normal
+	Direction axis(1, 0, 0);
+	if (std::abs(normal(0)) > std::abs(normal(1))) {
+		axis = Direction(0, 1, 0);
+	}
+	a = normal.cross(axis);
+	a /= a.norm();
+	b = normal.cross(a);
+}
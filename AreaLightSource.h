@@ -0,0 +1,167 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef AREA_LIGHT_SOURCE_H_INCLUDED
+#define AREA_LIGHT_SOURCE_H_INCLUDED
+
+#include "LightSource.h"
+#include "Vector.h"
+
+/**
+ * \file
+ * \brief AreaLightSource class header file.
+ */
+
+/**
+ * \brief Abstract base class for LightSources with a size and shape.
+ *
+ * A PointLightSource casts hard shadows, since a Point is either in view of
+ * it or not. Real lights have some size, and Points which can see only part
+ * of the light are in a soft-edged penumbra. An AreaLightSource is treated
+ * as many point lights spread over its shape, sharing its colour between
+ * them, and the Scene shades with a grid of these (see sampleGrid()).
+ *
+ * The light reaching a Point from each part of the shape falls off as
+ * \f$1/d^2\f$, as for a PointLightSource, and is scaled by how much that part
+ * gives off towards the Point (see facing()). Flat shapes only light the
+ * side they face, as \f$\cos\theta\f$ of the angle from their normal, so the
+ * colour is how bright they are straight ahead.
+ *
+ * As an abstract base class, you cannot create an AreaLightSource directly.
+ * Instead one of its concrete subclasses must be created, which says how
+ * points are spread over the shape (see pointOn()).
+ */
+class AreaLightSource : public LightSource {
+
+public:
+
+	unsigned int samples; //!< Number of samples along each side of the sample grid, so samples*samples in all.
+
+	/** \brief Determine how much light reaches a Point.
+	 *
+	 * This treats the AreaLightSource as if it were a point at its location,
+	 * so the light is scaled by \f$1/d^2\f$, where \f$d\f$ is the distance from
+	 * the location to the Point.
+	 *
+	 * \param point The Point at which light is measured.
+	 * \return The proportion of the base illumination that reaches the Point.
+	 */
+	double getIntensityAt(const Point& point) const;
+
+	/** \brief How far the light from this AreaLightSource reaches.
+	 *
+	 * This is the distance for a PointLightSource of the same colour, plus
+	 * the distance from the location to the furthest part of the shape.
+	 *
+	 * \param threshold The smallest amount of light that matters.
+	 * \return The distance at which the light falls below \c threshold, or \c infinity if the threshold is not positive.
+	 */
+	double influenceRadius(double threshold) const;
+
+	/** \brief The size of the sample grid.
+	 *
+	 * \return The samples property.
+	 */
+	unsigned int sampleGrid() const;
+
+	/** \brief Determine the light arriving at a Point from one part of the shape.
+	 *
+	 * \param point The Point at which light is measured.
+	 * \param u The first co-ordinate of the part of the shape, in [0,1).
+	 * \param v The second co-ordinate of the part of the shape, in [0,1).
+	 * \return The Direction, distance, and amount of light arriving at the Point from pointOn().
+	 */
+	virtual LightSample sampleAt(const Point& point, double u, double v) const;
+
+	/** \brief Send out a photon from the AreaLightSource.
+	 *
+	 * Each part of the shape sends light in each Direction as facing() says,
+	 * as the samples from sampleAt() do. The photon starts at pointOn(), seen
+	 * from the middle of the sphere, and heads towards the sphere.
+	 *
+	 * \param centre The middle of the sphere to send photons towards.
+	 * \param radius The radius of the sphere to send photons towards.
+	 * \param u The first co-ordinate of the part of the shape.
+	 * \param v The second co-ordinate of the part of the shape.
+	 * \param s The first co-ordinate of the Direction of the photon.
+	 * \param t The second co-ordinate of the Direction of the photon.
+	 * \param ray Set to where the photon starts, and its unit Direction.
+	 * \return The power of the photon.
+	 */
+	Colour emit(const Point& centre, double radius, double u, double v, double s, double t, Ray& ray) const;
+
+	/** \brief Find a point on the shape of the AreaLightSource.
+	 *
+	 * This maps the unit square onto the shape, so that equal areas of the
+	 * square give equal areas of the shape, and nearby co-ordinates give
+	 * nearby points. A grid over the square then spreads samples evenly.
+	 *
+	 * \param point The Point being lit, for shapes which look different from different places.
+	 * \param u The first co-ordinate, in [0,1).
+	 * \param v The second co-ordinate, in [0,1).
+	 * \return The point on the shape.
+	 */
+	virtual Point pointOn(const Point& point, double u, double v) const = 0;
+
+	/** \brief The size of the shape.
+	 *
+	 * \return The largest distance from the location to any point on the shape.
+	 */
+	virtual double extent() const = 0;
+
+	/** \brief How much light a part of the shape gives off in a Direction.
+	 *
+	 * By default light is given off equally in all Directions.
+	 *
+	 * \param direction The unit Direction the light leaves in.
+	 * \return The proportion of the colour given off in that Direction.
+	 */
+	virtual double facing(const Vector& direction) const;
+
+protected:
+
+	/** \brief AreaLightSource default constructor.
+	 *
+	 * By default an AreaLightSource is shaded with a 4x4 grid of samples.
+	 */
+	AreaLightSource();
+
+	/** \brief AreaLightSource copy constructor.
+	 *
+	 * \param lightSource The AreaLightSource to copy.
+	 */
+	AreaLightSource(const AreaLightSource& lightSource);
+
+	/** \brief AreaLightSource destructor. */
+	virtual ~AreaLightSource();
+
+	/** \brief AreaLightSource assignment operator.
+	 *
+	 * \param lightSource The AreaLightSource to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	const AreaLightSource& operator=(const AreaLightSource& lightSource);
+
+	/** \brief Map the unit square onto the unit disc.
+	 *
+	 * This is the concentric mapping, which takes squares about the centre to
+	 * circles, so a grid over the square stays evenly spread over the disc.
+	 *
+	 * \param u The first co-ordinate, in [0,1).
+	 * \param v The second co-ordinate, in [0,1).
+	 * \param x Set to the x co-ordinate on the unit disc.
+	 * \param y Set to the y co-ordinate on the unit disc.
+	 */
+	static void concentricDisc(double u, double v, double& x, double& y);
+
+	/** \brief Find two axes at right angles to a Direction.
+	 *
+	 * \param normal A unit Vector.
+	 * \param a Set to a unit Vector at right angles to \c normal.
+	 * \param b Set to a unit Vector at right angles to both \c normal and \c a.
+	 */
+	static void perpendicularAxes(const Vector& normal, Vector& a, Vector& b);
+
+};
+
+#endif // AREA_LIGHT_SOURCE_H_INCLUDED
@@ -0,0 +1,230 @@
+/* $Rev: 250 $ */
+#include "BVH.h"
+
+#include "utility.h"
+
+#include <algorithm>
+
+BVH::BVH() : objects_(), objectBounds_(), nodes_(), order_(), unbounded_() {
+
+}
+
+BVH::BVH(const BVH& bvh) : objects_(bvh.objects_), objectBounds_(bvh.objectBounds_), 
+nodes_(bvh.nodes_), order_(bvh.order_), unbounded_(bvh.unbounded_) {
+
+}
+
+BVH::~BVH() {
+
+}
+
+BVH& BVH::operator=(const BVH& bvh) {
+	if (this != &bvh) {
+		objects_ = bvh.objects_;
+		objectBounds_ = bvh.objectBounds_;
+		nodes_ = bvh.nodes_;
+		order_ = bvh.order_;
+		unbounded_ = bvh.unbounded_;
+	}
+	return *this;
+}
+
+void BVH::build(const std::vector<std::shared_ptr<Object>>& objects) {
+	objects_ = objects;
+	objectBounds_.clear();
+	nodes_.clear();
+	order_.clear();
+	unbounded_.clear();
+	for (size_t i = 0; i < objects_.size(); ++i) {
+		objectBounds_.push_back(objects_[i]->getBounds());
+		if (objectBounds_.back().isInfinite()) {
+			unbounded_.push_back(i);
+		} else if (!objectBounds_.back().isEmpty()) {
+			order_.push_back(i);
+		}
+	}
+	if (order_.empty()) {
+		return;
+	}
+	nodes_.reserve(2*order_.size());
+	nodes_.push_back(Node());
+	build(0, 0, order_.size());
+}
+
+void BVH::build(size_t node, size_t first, size_t count) {
+	BoundingBox bounds;
+	BoundingBox centres;
+	for (size_t i = first; i < first + count; ++i) {
+		const BoundingBox& box = objectBounds_[order_[i]];
+		bounds.include(box);
+		centres.include(Point(0.5*(box.minPoint + box.maxPoint)));
+	}
+	nodes_[node].bounds = bounds;
+
+	// Split along the axis where the centres are most spread out
+	int axis = 0;
+	double widest = -1;
+	for (int i = 0; i < 3; ++i) {
+		double width = centres.maxPoint(i) - centres.minPoint(i);
+		if (width > widest) {
+			widest = width;
+			axis = i;
+		}
+	}
+	if (count <= maxLeafSize || widest <= 0) {
+		nodes_[node].first = first;
+		nodes_[node].count = count;
+		return;
+	}
+
+	size_t middle = first + count/2;
+	const std::vector<BoundingBox>& objectBounds = objectBounds_;
+	std::nth_element(order_.begin() + first, order_.begin() + middle, order_.begin() + first + count,
+		[&objectBounds, axis](size_t a, size_t b) {
+			return objectBounds[a].minPoint(axis) + objectBounds[a].maxPoint(axis) <
+			       objectBounds[b].minPoint(axis) + objectBounds[b].maxPoint(axis);
+		});
+
+	size_t firstChild = nodes_.size();
+	nodes_[node].first = firstChild;
+	nodes_[node].count = 0;
+	nodes_.push_back(Node());
+	nodes_.push_back(Node());
+	build(firstChild, first, middle - first);
+	build(firstChild + 1, middle, first + count - middle);
+}
+
+BoundingBox BVH::getBounds() const {
+	if (!unbounded_.empty()) {
+		return BoundingBox::infinite();
+	}
+	if (nodes_.empty()) {
+		return BoundingBox();
+	}
+	return nodes_[0].bounds;
+}
+
+BoundingBox BVH::getFiniteBounds() const {
+	if (nodes_.empty()) {
+		return BoundingBox();
+	}
+	return nodes_[0].bounds;
+}
+
+size_t BVH::numUnbounded() const {
+	return unbounded_.size();
+}
+
+bool BVH::intersect(size_t object, const Ray& ray, double minDistance, RayIntersection& nearest) const {
+	bool found = false;
+	RayIntersectionList hits = objects_[object]->intersect(ray);
+	for (auto& hit : hits) {
+		if (hit.distance > minDistance && hit.distance < nearest.distance) {
+			nearest = hit;
+			found = true;
+		}
+	}
+	return found;
+}
+
+bool BVH::intersect(const Ray& ray, double minDistance, RayIntersection& nearest) const {
+	nearest.distance = infinity;
+	bool found = false;
+
+	for (size_t object : unbounded_) {
+		found = intersect(object, ray, minDistance, nearest) || found;
+	}
+
+	if (nodes_.empty()) {
+		return found;
+	}
+
+	// Box distances are in units of the Ray's direction vector
+	double length = ray.direction.norm();
+
+	// Nodes still to visit, with the distance at which the Ray enters them
+	struct Entry {
+		size_t node;
+		double tNear;
+	} stack[64];
+	size_t stackSize = 0;
+	double tNear, tFar;
+	if (nodes_[0].bounds.intersect(ray, tNear, tFar)) {
+		stack[stackSize++] = Entry{0, tNear};
+	}
+	while (stackSize > 0) {
+		Entry entry = stack[--stackSize];
+		// Skip nodes which are entirely beyond the nearest hit so far
+		if (entry.tNear*length > nearest.distance) {
+			continue;
+		}
+		const Node& node = nodes_[entry.node];
+		if (node.count > 0) {
+			for (size_t i = node.first; i < node.first + node.count; ++i) {
+				found = intersect(order_[i], ray, minDistance, nearest) || found;
+			}
+			continue;
+		}
+		// Visit the nearer child first by pushing it last
+		double nearA, nearB;
+		bool hitA = nodes_[node.first].bounds.intersect(ray, nearA, tFar);
+		bool hitB = nodes_[node.first+1].bounds.intersect(ray, nearB, tFar);
+		if (hitA && hitB && nearA < nearB) {
+			stack[stackSize++] = Entry{node.first + 1, nearB};
+			stack[stackSize++] = Entry{node.first, nearA};
+		} else {
+			if (hitA) stack[stackSize++] = Entry{node.first, nearA};
+			if (hitB) stack[stackSize++] = Entry{node.first + 1, nearB};
+		}
+	}
+	return found;
+}
+
+bool BVH::occluded(size_t object, const Ray& ray, double minDistance, double maxDistance) const {
+	RayIntersectionList hits = objects_[object]->intersect(ray);
+	for (auto& hit : hits) {
+		if (hit.distance > minDistance && hit.distance < maxDistance) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool BVH::occluded(const Ray& ray, double minDistance, double maxDistance) const {
+	for (size_t object : unbounded_) {
+		if (occluded(object, ray, minDistance, maxDistance)) {
+			return true;
+		}
+	}
+
+	if (nodes_.empty()) {
+		return false;
+	}
+
+	// Box distances are in units of the Ray's direction vector
+	double length = ray.direction.norm();
+
+	size_t stack[64];
+	size_t stackSize = 0;
+	double tNear, tFar;
+	if (nodes_[0].bounds.intersect(ray, tNear, tFar) && tNear*length < maxDistance) {
+		stack[stackSize++] = 0;
+	}
+	while (stackSize > 0) {
+		const Node& node = nodes_[stack[--stackSize]];
+		if (node.count > 0) {
+			for (size_t i = node.first; i < node.first + node.count; ++i) {
+				if (occluded(order_[i], ray, minDistance, maxDistance)) {
+					return true;
+				}
+			}
+			continue;
+		}
+		for (size_t child = node.first; child < node.first + 2; ++child) {
+			if (nodes_[child].bounds.intersect(ray, tNear, tFar) && tNear*length < maxDistance) {
+				stack[stackSize++] = child;
+			}
+		}
+	}
+	return false;
+}
@@ -0,0 +1,164 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef BVH_H_INCLUDED
+#define BVH_H_INCLUDED
+
+#include "BoundingBox.h"
+#include "Object.h"
+
+#include <memory>
+#include <vector>
+
+/** 
+ * \file
+ * \brief BVH class header file.
+ */
+
+/**
+ * \brief A bounding volume hierarchy over a collection of Objects.
+ *
+ * A BVH is a binary tree of BoundingBoxes, with a few Objects at each 
+ * leaf. A Ray only has to be traced through the Objects whose boxes it 
+ * passes through, and boxes further away than the nearest hit so far are
+ * skipped, so finding the nearest hit usually costs much less than 
+ * tracing the Ray through every Object.
+ *
+ * Objects with infinite bounds (such as a Plane) would make every box 
+ * above them infinite too, so they are kept out of the tree in a separate
+ * list, which is always traced.
+ *
+ * The tree is built by build(), which must be called again after the 
+ * Objects (or their transforms) change.
+ */
+class BVH {
+
+public:
+
+	/** \brief BVH default constructor.
+	 *
+	 * A newly constructed BVH contains no Objects.
+	 */
+	BVH();
+
+	/** \brief BVH copy constructor.
+	 *
+	 * \param bvh The BVH to copy.
+	 */
+	BVH(const BVH& bvh);
+
+	/** \brief BVH destructor. */
+	~BVH();
+
+	/** \brief BVH assignment operator.
+	 *
+	 * \param bvh The BVH to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	BVH& operator=(const BVH& bvh);
+
+	/** \brief Build the BVH over a collection of Objects.
+	 *
+	 * The Objects are split recursively at the median of their centres,
+	 * along the longest axis of the box containing those centres.
+	 *
+	 * \param objects The Objects to put in the BVH.
+	 */
+	void build(const std::vector<std::shared_ptr<Object>>& objects);
+
+	/** \brief Find the nearest hit on any Object.
+	 *
+	 * The tree is traversed nearest boxes first. Hits which are no further 
+	 * along the Ray than \c minDistance are ignored, so that Rays starting
+	 * on a surface do not hit it again.
+	 *
+	 * \param ray The Ray to trace.
+	 * \param minDistance The smallest distance along the Ray to accept a hit at.
+	 * \param nearest Set to the nearest hit, if there is one.
+	 * \return true if any Object is hit, false otherwise.
+	 */
+	bool intersect(const Ray& ray, double minDistance, RayIntersection& nearest) const;
+
+	/** \brief Check whether any Object blocks a stretch of a Ray.
+	 *
+	 * This is the query needed for shadow Rays. Since any hit will do, the
+	 * search stops at the first one found, rather than looking for the nearest.
+	 *
+	 * \param ray The Ray to trace.
+	 * \param minDistance The smallest distance along the Ray to accept a hit at.
+	 * \param maxDistance The largest distance along the Ray to accept a hit at.
+	 * \return true if any Object is hit between the two distances, false otherwise.
+	 */
+	bool occluded(const Ray& ray, double minDistance, double maxDistance) const;
+
+	/** \brief Bounds of the Objects in the BVH.
+	 *
+	 * \return A BoundingBox containing all of the Objects, which is infinite if any of them are unbounded.
+	 */
+	BoundingBox getBounds() const;
+
+	/** \brief Bounds of the Objects in the tree.
+	 *
+	 * \return A BoundingBox containing all of the Objects which have bounds, ignoring those which do not.
+	 */
+	BoundingBox getFiniteBounds() const;
+
+	/** \brief The number of Objects kept outside of the tree.
+	 *
+	 * \return The number of Objects with infinite bounds.
+	 */
+	size_t numUnbounded() const;
+
+private:
+
+	/** \brief A node in the BVH. 
+	 *
+	 * Leaf nodes list \c count Objects, starting at \c first in \c order_.
+	 * Interior nodes have \c count set to zero, and their two children are 
+	 * at \c first and \c first+1 in \c nodes_.
+	 */
+	struct Node {
+		BoundingBox bounds; //!< Bounds of everything below this node.
+		size_t first;       //!< First Object (leaf) or child node (interior).
+		size_t count;       //!< Number of Objects, or 0 for interior nodes.
+	};
+
+	/** \brief Build the BVH below a node.
+	 *
+	 * \param node Index of the node in \c nodes_.
+	 * \param first The first entry of \c order_ that the node covers.
+	 * \param count The number of entries of \c order_ that the node covers.
+	 */
+	void build(size_t node, size_t first, size_t count);
+
+	/** \brief Trace a Ray through one Object, keeping the nearest hit.
+	 *
+	 * \param object Index of the Object in \c objects_.
+	 * \param ray The Ray to trace.
+	 * \param minDistance The smallest distance along the Ray to accept a hit at.
+	 * \param nearest The nearest hit so far, which is updated if a nearer one is found.
+	 * \return true if a nearer hit was found, false otherwise.
+	 */
+	bool intersect(size_t object, const Ray& ray, double minDistance, RayIntersection& nearest) const;
+
+	/** \brief Check whether one Object blocks a stretch of a Ray.
+	 *
+	 * \param object Index of the Object in \c objects_.
+	 * \param ray The Ray to trace.
+	 * \param minDistance The smallest distance along the Ray to accept a hit at.
+	 * \param maxDistance The largest distance along the Ray to accept a hit at.
+	 * \return true if the Object is hit between the two distances, false otherwise.
+	 */
+	bool occluded(size_t object, const Ray& ray, double minDistance, double maxDistance) const;
+
+	std::vector<std::shared_ptr<Object>> objects_; //!< The Objects in the BVH.
+	std::vector<BoundingBox> objectBounds_;        //!< Bounds of each Object.
+	std::vector<Node> nodes_;                      //!< The tree, with the root at index 0.
+	std::vector<size_t> order_;                    //!< Indices of bounded Objects, in leaf order.
+	std::vector<size_t> unbounded_;                //!< Indices of Objects with infinite bounds.
+
+	static const size_t maxLeafSize = 4; //!< Largest number of Objects at a leaf.
+
+};
+
+#endif // BVH_H_INCLUDED
@@ -0,0 +1,105 @@
+/* $Rev: 250 $ */
+#include "BoundingBox.h"
+
+#include "utility.h"
+
+#include <algorithm>
+
+BoundingBox::BoundingBox() :
+minPoint(infinity, infinity, infinity), maxPoint(-infinity, -infinity, -infinity) {
+
+}
+
+BoundingBox::BoundingBox(const Point& minPoint, const Point& maxPoint) :
+minPoint(minPoint), maxPoint(maxPoint) {
+
+}
+
+BoundingBox::BoundingBox(const BoundingBox& box) :
+minPoint(box.minPoint), maxPoint(box.maxPoint) {
+
+}
+
+BoundingBox::~BoundingBox() {
+
+}
+
+BoundingBox& BoundingBox::operator=(const BoundingBox& box) {
+	if (this != &box) {
+		minPoint = box.minPoint;
+		maxPoint = box.maxPoint;
+	}
+	return *this;
+}
+
+BoundingBox BoundingBox::infinite() {
+	return BoundingBox(Point(-infinity, -infinity, -infinity), Point(infinity, infinity, infinity));
+}
+
+bool BoundingBox::isEmpty() const {
+	return minPoint(0) > maxPoint(0) || minPoint(1) > maxPoint(1) || minPoint(2) > maxPoint(2);
+}
+
+bool BoundingBox::isInfinite() const {
+	if (isEmpty()) return false;
+	for (int i = 0; i < 3; ++i) {
+		if (minPoint(i) <= -infinity || maxPoint(i) >= infinity) return true;
+	}
+	return false;
+}
+
+void BoundingBox::include(const Point& point) {
+	for (int i = 0; i < 3; ++i) {
+		minPoint(i) = std::min(minPoint(i), point(i));
+		maxPoint(i) = std::max(maxPoint(i), point(i));
+	}
+}
+
+void BoundingBox::include(const BoundingBox& box) {
+	if (box.isEmpty()) return;
+	include(box.minPoint);
+	include(box.maxPoint);
+}
+
+void BoundingBox::clip(const BoundingBox& box) {
+	for (int i = 0; i < 3; ++i) {
+		minPoint(i) = std::max(minPoint(i), box.minPoint(i));
+		maxPoint(i) = std::min(maxPoint(i), box.maxPoint(i));
+	}
+}
+
+BoundingBox BoundingBox::transformed(const Transform& transform) const {
+	if (isEmpty() || isInfinite()) {
+		return *this;
+	}
+	BoundingBox result;
+	for (int corner = 0; corner < 8; ++corner) {
+		Point p((corner & 1) ? maxPoint(0) : minPoint(0),
+		        (corner & 2) ? maxPoint(1) : minPoint(1),
+		        (corner & 4) ? maxPoint(2) : minPoint(2));
+		result.include(transform.apply(p));
+	}
+	return result;
+}
+
+bool BoundingBox::intersect(const Ray& ray, double& tNear, double& tFar) const {
+	tNear = 0;
+	tFar = infinity;
+	if (isEmpty()) return false;
+	for (int i = 0; i < 3; ++i) {
+		double origin = ray.point(i);
+		double dir = ray.direction(i);
+		if (std::abs(dir) < epsilon*epsilon) {
+			// Parallel to this slab, so must start inside it
+			if (origin < minPoint(i) || origin > maxPoint(i)) return false;
+			continue;
+		}
+		double t0 = (minPoint(i) - origin)/dir;
+		double t1 = (maxPoint(i) - origin)/dir;
+		if (t0 > t1) std::swap(t0, t1);
+		if (t0 > tNear) tNear = t0;
+		if (t1 < tFar) tFar = t1;
+		if (tNear > tFar) return false;
+	}
+	return true;
+}
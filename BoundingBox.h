@@ -0,0 +1,131 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef BOUNDING_BOX_H_INCLUDED
+#define BOUNDING_BOX_H_INCLUDED
+
+#include "Point.h"
+#include "Ray.h"
+#include "Transform.h"
+
+/** 
+ * \file
+ * \brief BoundingBox class header file.
+ */
+
+/**
+ * \brief Axis-aligned bounding boxes.
+ *
+ * A BoundingBox is the region between a minimum and a maximum Point, with
+ * faces aligned to the co-ordinate axes. They are used to quickly decide
+ * that a Ray cannot hit an Object, without doing the (usually more
+ * expensive) exact intersection test.
+ *
+ * A BoundingBox may be empty (it contains nothing, so no Ray hits it), or
+ * infinite (it contains everything, so every Ray hits it). Infinite boxes
+ * are used for Objects which do not have a finite extent, or where the 
+ * extent is not known.
+ */
+class BoundingBox {
+
+public:
+
+	/** \brief BoundingBox default constructor.
+	 *
+	 * A newly constructed BoundingBox is empty.
+	 */
+	BoundingBox();
+
+	/** \brief BoundingBox constructor from two corners.
+	 *
+	 * \param minPoint The corner of the box with the smallest co-ordinates.
+	 * \param maxPoint The corner of the box with the largest co-ordinates.
+	 */
+	BoundingBox(const Point& minPoint, const Point& maxPoint);
+
+	/** \brief BoundingBox copy constructor.
+	 *
+	 * \param box The BoundingBox to copy.
+	 */
+	BoundingBox(const BoundingBox& box);
+
+	/** \brief BoundingBox destructor. */
+	~BoundingBox();
+
+	/** \brief BoundingBox assignment operator.
+	 *
+	 * \param box The BoundingBox to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	BoundingBox& operator=(const BoundingBox& box);
+
+	/** \brief Factory method for infinite BoundingBoxes.
+	 *
+	 * \return A BoundingBox which contains all of space.
+	 */
+	static BoundingBox infinite();
+
+	/** \brief Check if the BoundingBox is empty.
+	 *
+	 * \return true if the box contains no points, false otherwise.
+	 */
+	bool isEmpty() const;
+
+	/** \brief Check if the BoundingBox is infinite.
+	 *
+	 * \return true if the box is unbounded along any axis, false otherwise.
+	 */
+	bool isInfinite() const;
+
+	/** \brief Grow the BoundingBox to include a Point.
+	 *
+	 * \param point The Point to include.
+	 */
+	void include(const Point& point);
+
+	/** \brief Grow the BoundingBox to include another BoundingBox.
+	 *
+	 * \param box The BoundingBox to include.
+	 */
+	void include(const BoundingBox& box);
+
+	/** \brief Shrink the BoundingBox to its overlap with another BoundingBox.
+	 *
+	 * If the two boxes do not overlap, the result is empty.
+	 *
+	 * \param box The BoundingBox to intersect with.
+	 */
+	void clip(const BoundingBox& box);
+
+	/** \brief Bound a transformed BoundingBox.
+	 *
+	 * The eight corners of the box are transformed, and a new axis-aligned
+	 * box which contains them all is returned. Empty and infinite boxes 
+	 * stay empty and infinite.
+	 *
+	 * \param transform The Transform to apply.
+	 * \return A BoundingBox containing the transformed box.
+	 */
+	BoundingBox transformed(const Transform& transform) const;
+
+	/** \brief Intersect a Ray with the BoundingBox.
+	 *
+	 * This uses the 'slab' method: the Ray is clipped against the pair of
+	 * planes bounding the box along each axis in turn. Only the part of the 
+	 * Ray in front of its start point is considered, and if the Ray passes 
+	 * through the box the range of distances (in units of the Ray's direction
+	 * vector) for which it is inside the box is returned.
+	 *
+	 * \param ray The Ray to intersect with the box.
+	 * \param tNear Set to the distance at which the Ray enters the box.
+	 * \param tFar Set to the distance at which the Ray leaves the box.
+	 * \return true if the Ray passes through the box, false otherwise.
+	 */
+	bool intersect(const Ray& ray, double& tNear, double& tFar) const;
+
+	Point minPoint; //!< The corner of the box with the smallest co-ordinates.
+	Point maxPoint; //!< The corner of the box with the largest co-ordinates.
+
+};
+
+#endif // BOUNDING_BOX_H_INCLUDED
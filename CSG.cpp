@@ -1,15 +1,45 @@
 /* $Rev: 250 $ */
 #include "CSG.h"
 
+#include "CSGProgram.h"
 #include "utility.h"
 
-CSG::CSG() : Object() {
+#include <algorithm>
+#include <vector>
+
+const size_t CSG::bufferSize;
+
+// csg_tables[operation][leftState][rightState] gives the state of the
+// CSG object when the left and right children are in the given states.
+static const csg_state csg_tables[3][3][3] = {
+	// CSG_UNION
+	{
+		{OUTSIDE, BORDER, INSIDE},  // left OUTSIDE
+		{BORDER,  BORDER, INSIDE},  // left BORDER
+		{INSIDE,  INSIDE, INSIDE}   // left INSIDE
+	},
+	// CSG_INTERSECTION
+	{
+		{OUTSIDE, OUTSIDE, OUTSIDE},
+		{OUTSIDE, OUTSIDE, BORDER},
+		{OUTSIDE, BORDER,  INSIDE}
+	},
+	// CSG_DIFFERENCE
+	{
+		{OUTSIDE, OUTSIDE, OUTSIDE},
+		{BORDER,  OUTSIDE, OUTSIDE},
+		{INSIDE,  BORDER,  OUTSIDE}
+	}
+};
+
+CSG::CSG() : Object(), csgOperation(CSG_UNION), leftBounds(), rightBounds(), program_() {
 	left = std::shared_ptr<Sphere>(new Sphere());
 	right = std::shared_ptr<Sphere>(new Sphere());
 	right->transform.translate(-1,0,0);
+	updateBounds();
 }
 
-CSG::CSG(const CSG& csg) : Object(csg) {
+CSG::CSG(const CSG& csg) : Object(csg), csgOperation(csg.csgOperation), leftBounds(csg.leftBounds), rightBounds(csg.rightBounds), program_(), left(csg.left), right(csg.right) {
 
 }
 
@@ -20,104 +50,196 @@ CSG::~CSG() {
 const CSG& CSG::operator=(const CSG& csg) {
 	if (this != &csg) {
 		Object::operator=(csg);
+		csgOperation = csg.csgOperation;
+		leftBounds = csg.leftBounds;
+		rightBounds = csg.rightBounds;
+		program_.reset();
+		left = csg.left;
+		right = csg.right;
 	}
 	return *this;
 }
 
-bool nearer(RayIntersection a, RayIntersection b) { return (a<b); }
+bool nearer(const RayIntersection& a, const RayIntersection& b) { return (a<b); }
+
+void sortHits(RayIntersection* hits, size_t numHits) {
+	if (!std::is_sorted(hits, hits + numHits, nearer)) {
+		std::sort(hits, hits + numHits, nearer);
+	}
+}
 
 void CSG::setupCSG(std::string type){
-	csgType = type;
-}
-
-std::vector<RayIntersection> CSG::intersect(const Ray& ray) const {
-	csg_state csg_table[3][3] = {
-		{OUTSIDE,OUTSIDE,OUTSIDE},
-		{OUTSIDE,OUTSIDE,OUTSIDE},
-		{OUTSIDE,OUTSIDE,OUTSIDE}
-	};
-
-	if (csgType == "INTERSECTION") {
-		// make the csg_table appropriate for intersection
-		csg_table[INSIDE][BORDER] = BORDER;
-		csg_table[INSIDE][INSIDE] = INSIDE;
-		csg_table[BORDER][INSIDE] = BORDER;
-	} else if (csgType == "DIFFERENCE") {
-		csg_table[INSIDE][OUTSIDE] = INSIDE;
-		csg_table[BORDER][OUTSIDE] = BORDER;    
-		csg_table[INSIDE][BORDER] = BORDER;
-	} else if (csgType == "UNION"){
-		csg_table[INSIDE][OUTSIDE] = INSIDE;
-		csg_table[BORDER][OUTSIDE] = BORDER;    
-		csg_table[INSIDE][INSIDE] = INSIDE;
-		csg_table[OUTSIDE][INSIDE] = INSIDE;
-		csg_table[BORDER][INSIDE] = INSIDE;
-		csg_table[INSIDE][BORDER] = INSIDE;
-		csg_table[OUTSIDE][BORDER] = BORDER;
-		csg_table[BORDER][BORDER] = BORDER;
-	}
-    
-	std::vector<RayIntersection> result;
+	if (type == "UNION") {
+		csgOperation = CSG_UNION;
+	} else if (type == "INTERSECTION") {
+		csgOperation = CSG_INTERSECTION;
+	} else if (type == "DIFFERENCE") {
+		csgOperation = CSG_DIFFERENCE;
+	} else {
+		std::cerr << "Unimplemented CSG operation '" << type << "'" << std::endl;
+		exit(-1);
+	}
+	updateBounds();
+}
+
+csg_operation CSG::operation() const {
+	return csgOperation;
+}
+
+const csg_state (&CSG::table() const)[3][3] {
+	return csg_tables[csgOperation];
+}
+
+void CSG::updateBounds() {
+	leftBounds = left->getBounds();
+	rightBounds = right->getBounds();
+}
+
+BoundingBox CSG::getBounds() const {
+	BoundingBox bounds(leftBounds);
+	switch (csgOperation) {
+	case CSG_UNION:
+		bounds.include(rightBounds);
+		break;
+	case CSG_INTERSECTION:
+		bounds.clip(rightBounds);
+		break;
+	case CSG_DIFFERENCE:
+		break;
+	}
+	return bounds.transformed(transform);
+}
+
+void CSG::compile() {
+	program_.reset(new CSGProgram(this));
+}
+
+csg_children CSG::childrenNeeded(const Ray& inverseRay) const {
+	// Find where the ray passes through each child's bounds, and
+	// whether those two stretches of the ray overlap
+	double leftNear, leftFar, rightNear, rightFar;
+	bool hitsLeft = leftBounds.intersect(inverseRay, leftNear, leftFar);
+	bool hitsRight = rightBounds.intersect(inverseRay, rightNear, rightFar);
+	bool overlap = hitsLeft && hitsRight &&
+		leftNear <= rightFar + epsilon && rightNear <= leftFar + epsilon;
+
+	// If the children cannot both be involved, the node is either
+	// missed or looks exactly like one of its children
+	switch (csgOperation) {
+	case CSG_UNION:
+		if (!hitsLeft && !hitsRight) return CSG_NEITHER;
+		if (!hitsRight) return CSG_LEFT_ONLY;
+		if (!hitsLeft) return CSG_RIGHT_ONLY;
+		break;
+	case CSG_INTERSECTION:
+		if (!overlap) return CSG_NEITHER;
+		break;
+	case CSG_DIFFERENCE:
+		if (!hitsLeft) return CSG_NEITHER;
+		if (!overlap) return CSG_LEFT_ONLY;
+		break;
+	}
+	return CSG_BOTH;
+}
+
+void CSG::mapToRay(RayIntersection* hits, size_t numHits, const Ray& ray) const {
+	if (numHits == 0) {
+		return;
+	}
+	double localScale = transform.applyInverse(ray.direction).norm()/ray.direction.norm();
+	for (size_t i = 0; i < numHits; ++i) {
+		RayIntersection& hit = hits[i];
+		hit.point = transform.apply(hit.point);
+		hit.normal = transform.apply(hit.normal);
+		if (hit.normal.dot(ray.direction) > 0) {
+			hit.normal = -hit.normal;
+		}
+		hit.distance = (hit.point - ray.point).norm();
+		hit.textureScale *= localScale;
+	}
+}
+
+// Run a CSG evaluation in this thread's hit buffer (or a buffer of its own,
+// if an enclosing evaluation is already using it), growing the buffer until
+// the hits fit, and copy them into a list
+template<typename Evaluate>
+static RayIntersectionList collectHits(Evaluate evaluate) {
+	static thread_local std::vector<RayIntersection> threadBuffer;
+	static thread_local bool inUse = false;
+	std::vector<RayIntersection> ownBuffer;
+	std::vector<RayIntersection>& buffer = inUse ? ownBuffer : threadBuffer;
+	bool wasInUse = inUse;
+	inUse = true;
+	if (buffer.size() < CSG::bufferSize) {
+		buffer.resize(CSG::bufferSize);
+	}
+	size_t numHits;
+	while ((numHits = evaluate(buffer.data(), buffer.size())) > buffer.size()) {
+		buffer.resize(2*buffer.size());
+	}
+	inUse = wasInUse;
+	return RayIntersectionList(buffer.begin(), buffer.begin() + numHits);
+}
+
+RayIntersectionList CSG::intersect(const Ray& ray) const {
+	return collectHits([this, &ray](RayIntersection* hits, size_t maxHits) {
+		return intersectInto(ray, hits, maxHits);
+	});
+}
+
+size_t CSG::intersectInto(const Ray& ray, RayIntersection* hits, size_t maxHits) const {
+	if (program_) {
+		return program_->evaluate(ray, hits, maxHits);
+	}
+	return intersectTree(ray, hits, maxHits);
+}
+
+RayIntersectionList CSG::intersectTree(const Ray& ray) const {
+	return collectHits([this, &ray](RayIntersection* hits, size_t maxHits) {
+		return intersectTree(ray, hits, maxHits);
+	});
+}
+
+size_t CSG::intersectTree(const Ray& ray, RayIntersection* hits, size_t maxHits) const {
 	Ray inverseRay = transform.applyInverse(ray);
 
-	std::vector<RayIntersection> leftIntersections;
-	std::vector<RayIntersection> rightIntersections;
-
-	leftIntersections = left->intersect(inverseRay);
-	rightIntersections = right->intersect(inverseRay);
-
-	// sort intersections
-	std::sort(leftIntersections.begin(), leftIntersections.end(), nearer);
-	std::sort(rightIntersections.begin(), rightIntersections.end(), nearer);
-
-	int numLeftIs = leftIntersections.size();
-	int numRightIs = rightIntersections.size();
-	
-	// We will assume that an odd number of intersections
-	// indicates being inside an object. This is not correct for
-	// glancing intersections. These artefacts could be fixed, up
-	// to a point, by tracing a ray in the reverse direction and
-	// looking for object intersections, however for this ray
-	// tracer, we will just live with the (rare) glitches.
-	csg_state leftState = OUTSIDE;
-	csg_state rightState = OUTSIDE;
-       	if (numLeftIs % 2 == 1) leftState = INSIDE;
-	if (numRightIs % 2 == 1) rightState = INSIDE;
-	
-	// We also need to keep track of the previous state.
-	// This allows us to update correctly as we transition across a border
-	// So if previousLeftState is inside, and we cross a border we end up outside
-	csg_state previousLeftState = leftState;
-	csg_state previousRightState = rightState;
-  
-	// iterate through both child objects' ray intersections
-	int lIi = 0;
-	int rIi = 0;
-
-	RayIntersection possibleIntersection;
-
-	while( lIi < numLeftIs || rIi < numRightIs ){
-		// there's still work to do
-		if( rIi==numRightIs ||
-		    ( lIi<numLeftIs && leftIntersections[lIi] < rightIntersections[rIi] )
-		    ) {
-			// TODO: process leftIntersections[lIi]
-			lIi++;
-		}else{
-			// TODO: process rightIntersections[lIi]		  
-			rIi++;
+	csg_children children = childrenNeeded(inverseRay);
+	if (children == CSG_NEITHER) {
+		return 0;
+	}
+	if (children != CSG_BOTH) {
+		const Object* onlyChild = (children == CSG_LEFT_ONLY) ? left.get() : right.get();
+		size_t numHits = onlyChild->intersectInto(inverseRay, hits, maxHits);
+		if (numHits > maxHits) {
+			return numHits;
 		}
+		sortHits(hits, numHits);
+		mapToRay(hits, numHits, ray);
+		return numHits;
+	}
 
-		// TODO: Check the possible intersection against the
-		// csg_table to see if it is actually a hitpoint of
-		// the overall CSG object.  If it is a hitpoint, add
-		// it to the result.
-		
-		// TODO: Update the left and/or the right tree to
-		// ensure that they advance beyond their BORDER state,
-		// as the tracing ray resumes its progression through
-		// the scene.
-
-	}  
-	return result;
+	size_t numLeft = left->intersectInto(inverseRay, hits, maxHits);
+	if (numLeft > maxHits) {
+		return numLeft;
+	}
+	RayIntersection* rightHits = hits + numLeft;
+	size_t numRight = right->intersectInto(inverseRay, rightHits, maxHits - numLeft);
+	if (numRight > maxHits - numLeft) {
+		return numLeft + numRight;
+	}
+
+	// The merge needs room after both children's hits for all of them
+	size_t out = numLeft + numRight;
+	if (out + numLeft + numRight > maxHits) {
+		return out + numLeft + numRight;
+	}
+	sortHits(hits, numLeft);
+	sortHits(rightHits, numRight);
+	size_t numHits = merge(hits, numLeft, rightHits, numRight, hits + out);
+	std::copy(hits + out, hits + out + numHits, hits);
+
+	// The children were traced in this node's co-ordinate frame,
+	// so map the surviving hits back to the frame of the ray.
+	mapToRay(hits, numHits, ray);
+	return numHits;
 }
@@ -7,6 +7,10 @@
 #include "Object.h"
 #include "Sphere.h"
 
+#include <algorithm>
+
+class CSGProgram;
+
 /** 
  * \file
  * \brief CSG class header file.
@@ -14,16 +18,91 @@
 
 enum csg_state {OUTSIDE, BORDER, INSIDE};
 
+/**
+ * \brief The boolean operation performed by a CSG node.
+ *
+ * The operation is resolved from its name once, when the node is set up,
+ * so that tracing a Ray never needs to compare strings.
+ */
+enum csg_operation {CSG_UNION, CSG_INTERSECTION, CSG_DIFFERENCE};
+
+/**
+ * \brief Which children of a CSG node need to be traced for a given Ray.
+ *
+ * \sa CSG::childrenNeeded()
+ */
+enum csg_children {CSG_NEITHER, CSG_LEFT_ONLY, CSG_RIGHT_ONLY, CSG_BOTH};
+
 /**
  * \brief Class for CSG objects.
  * 
  * This class provides an Object which is a CSG tree with two children
  * and a type of CSG operation to perform (union, intersection, etc.).
  * 
+ * A CSG tree can be traced recursively, with each node calling
+ * intersect() on its children, or compiled into a flat CSGProgram.
+ * Both give exactly the same intersections, and share the
+ * building blocks (childrenNeeded(), merge(), and mapToRay()) which
+ * are declared here.
  */
 class CSG : public Object {
 
-	std::string csgType;
+	friend class CSGProgram;
+
+	csg_operation csgOperation; //!< The operation this node performs.
+
+	BoundingBox leftBounds;  //!< Cached bounds of the left child, in this node's co-ordinate frame.
+	BoundingBox rightBounds; //!< Cached bounds of the right child, in this node's co-ordinate frame.
+
+	std::shared_ptr<const CSGProgram> program_; //!< Flattened form of this tree, if it has been compiled.
+
+	/** \brief Decide which children a Ray needs to be traced through.
+	 *
+	 * The Ray is tested against the cached bounds of the children.
+	 * Depending on the operation, missing one child's bounds (or
+	 * passing through the two boxes over separate stretches of the
+	 * Ray) means that the answer is known without tracing one or
+	 * both children. For example, a Ray which misses the left child
+	 * of a difference misses the whole node, and one which misses
+	 * the right child just sees the left child.
+	 *
+	 * \param inverseRay The Ray, in this node's co-ordinate frame.
+	 * \return Which of the children need to be traced.
+	 */
+	csg_children childrenNeeded(const Ray& inverseRay) const;
+
+	/** \brief Merge the sorted hits from the two children.
+	 *
+	 * Each hit is classified against the csg_state table for this
+	 * node's operation, and those which lie on the border of the
+	 * overall CSG object are written to \c out in order.
+	 *
+	 * \tparam OutputIterator Where surviving hits are written, such as a raw pointer or a \c std::back_insert_iterator.
+	 * \param leftHits The hits on the left child, nearest first.
+	 * \param numLeftIs The number of left hits.
+	 * \param rightHits The hits on the right child, nearest first.
+	 * \param numRightIs The number of right hits.
+	 * \param out Where to write the hits on the CSG object.
+	 * \return The number of hits written.
+	 */
+	template<typename OutputIterator>
+	size_t merge(const RayIntersection* leftHits, size_t numLeftIs,
+	             const RayIntersection* rightHits, size_t numRightIs, 
+	             OutputIterator out) const;
+
+	/** \brief Map hits on the children back to the frame of a Ray.
+	 *
+	 * \param hits The hits, in this node's co-ordinate frame, to update in place.
+	 * \param numHits The number of hits.
+	 * \param ray The Ray (not inverse transformed) that was traced.
+	 */
+	void mapToRay(RayIntersection* hits, size_t numHits, const Ray& ray) const;
+
+	/** \brief The csg_state table for this node's operation.
+	 *
+	 * \return The table, indexed as [leftState][rightState].
+	 */
+	const csg_state (&table() const)[3][3];
   
  public:
 
@@ -37,6 +116,10 @@ class CSG : public Object {
 	CSG();
 
 	/** \brief CSG copy constructor.      
+	 *
+	 * The children are shared with the original, but any compiled
+	 * CSGProgram is not copied, since it refers to the original node.
+	 *
 	 * \param csg The CSG to copy.
 	 */
 	CSG(const CSG& csg);
@@ -52,15 +135,34 @@ class CSG : public Object {
 	const CSG& operator=(const CSG& csg);
 	
 	/** \brief CSG-Ray csg computation.
-	 *
-	 * \todo This method does not have an valid implementation for
-	 * the CSG operations. It needs to be completed. There are
-	 * four TODO marks in CSG.cpp where you will need to add code.
 	 *
 	 * CSG combines two objects into one, using some boolean
 	 * operation, such as union, intersection, or
 	 * difference. (Note that either or both of these child
 	 * objects may itself be a CSG node.)
+	 *
+	 * The hits are found by intersectInto(), in a buffer kept by
+	 * each thread, and only the final hits are copied into a list.
+	 *
+	 * \param ray The Ray to intersect with this (CSG) CSG.
+	 * \return A list of intersections, which may be empty.
+	 *
+	 */
+	RayIntersectionList intersect(const Ray& ray) const;
+
+	/** \brief CSG-Ray csg computation, into storage given by the caller.
+	 *
+	 * If the tree has been compiled this runs the CSGProgram,
+	 * otherwise it is the same as intersectTree().
+	 *
+	 * \param ray The Ray to intersect with this (CSG) CSG.
+	 * \param hits Where to write the intersections, which is also used as working space.
+	 * \param maxHits The number of RayIntersections in \c hits.
+	 * \return The number of intersections, or more than \c maxHits if there was not enough room.
+	 */
+	size_t intersectInto(const Ray& ray, RayIntersection* hits, size_t maxHits) const;
+
+	/** \brief Recursive CSG-Ray csg computation.
 	 *
 	 * This CSG implementation traces the given ray through each
 	 * of its child objects in turn. Every intersection will
@@ -71,17 +173,140 @@ class CSG : public Object {
 	 * determined which intersections represent an actual hitpoint
 	 * on the overall CSG object.
 	 *
+	 * No lists are made: the left child writes its hits to the start
+	 * of \c hits, the right child writes its hits after them, and the
+	 * merge writes the surviving hits after both, from where they are
+	 * copied back down to the start. The hits from the children are
+	 * only sorted if they are not already in order (primitives return
+	 * their hits nearest first, as does this method).
+	 *
+	 * Before tracing the children, childrenNeeded() checks the ray
+	 * against their cached bounds, so children which cannot affect
+	 * the result are skipped.
+	 *
 	 * \param ray The Ray to intersect with this (CSG) CSG.
-	 * \return A list (std::vector) of intersections, which may be empty.
+	 * \param hits Where to write the intersections, which is also used as working space.
+	 * \param maxHits The number of RayIntersections in \c hits.
+	 * \return The number of intersections, or more than \c maxHits if there was not enough room.
+	 */
+	size_t intersectTree(const Ray& ray, RayIntersection* hits, size_t maxHits) const;
+
+	/** \brief Recursive CSG-Ray csg computation, into a new list.
+	 *
+	 * This gives the same hits as intersectTree(), even if the tree has
+	 * been compiled, so the two ways of evaluating a tree can be compared.
 	 *
+	 * \param ray The Ray to intersect with this (CSG) CSG.
+	 * \return A list of intersections, which may be empty.
 	 */
-	std::vector<RayIntersection> intersect(const Ray& ray) const;
+	RayIntersectionList intersectTree(const Ray& ray) const;
 
 	/** \brief Configure CSG table
+	 *
+	 * The name of the operation is looked up once here, and the
+	 * matching constant csg_state table is used by every subsequent
+	 * call to intersect(). An unknown operation name terminates the
+	 * program.
+	 *
+	 * This also calls updateBounds(), so the children should be in
+	 * place, with their transforms set, before setupCSG() is called.
 	 *
 	 * \param csgType A string name of the CSG node type ("UNION", etc.)
 	 */	
 	void setupCSG(std::string csgType);
+
+	/** \brief The operation performed by this CSG node.
+	 *
+	 * \return The csg_operation set by setupCSG().
+	 */
+	csg_operation operation() const;
+
+	/** \brief Recompute the cached bounds of the children.
+	 *
+	 * This must be called if left or right (or their transforms)
+	 * are changed after setupCSG().
+	 */
+	void updateBounds();
+
+	/** \brief Bounds of the CSG.
+	 *
+	 * The bounds depend on the operation: a union is bounded by both
+	 * children, an intersection by their overlap, and a difference by 
+	 * the left child alone.
+	 *
+	 * \return A BoundingBox containing the CSG.
+	 */
+	BoundingBox getBounds() const;
+
+	/** \brief Flatten this CSG tree into a CSGProgram.
+	 *
+	 * After this, intersect() evaluates the tree with a CSGProgram rather
+	 * than by recursion. Transforms and materials may still be changed, 
+	 * but if the shape of the tree changes (children are replaced) it must
+	 * be compiled again.
+	 *
+	 * Only the root of a tree needs to be compiled.
+	 */
+	void compile();
+
+	static const size_t bufferSize = 1024; //!< Number of hits each thread's buffer for intersect() starts with.
+
 };
 
+template<typename OutputIterator>
+size_t CSG::merge(const RayIntersection* leftHits, size_t numLeftIs,
+                  const RayIntersection* rightHits, size_t numRightIs, 
+                  OutputIterator out) const {
+	const csg_state (&csg_table)[3][3] = table();
+
+	// We will assume that an odd number of intersections
+	// indicates being inside an object. This is not correct for
+	// glancing intersections. These artefacts could be fixed, up
+	// to a point, by tracing a ray in the reverse direction and
+	// looking for object intersections, however for this ray
+	// tracer, we will just live with the (rare) glitches.
+	csg_state leftState = OUTSIDE;
+	csg_state rightState = OUTSIDE;
+	if (numLeftIs % 2 == 1) leftState = INSIDE;
+	if (numRightIs % 2 == 1) rightState = INSIDE;
+	
+	// iterate through both child objects' ray intersections
+	size_t lIi = 0;
+	size_t rIi = 0;
+	size_t numHits = 0;
+
+	while( lIi < numLeftIs || rIi < numRightIs ){
+		// there's still work to do
+		if( rIi==numRightIs ||
+		    ( lIi<numLeftIs && leftHits[lIi] < rightHits[rIi] )
+		    ) {
+			// The ray is on the border of the left child, and
+			// will be on the other side of it afterwards
+			if (csg_table[BORDER][rightState] == BORDER) {
+				*out++ = leftHits[lIi];
+				++numHits;
+			}
+			leftState = (leftState == INSIDE) ? OUTSIDE : INSIDE;
+			lIi++;
+		}else{
+			if (csg_table[leftState][BORDER] == BORDER) {
+				*out++ = rightHits[rIi];
+				++numHits;
+			}
+			rightState = (rightState == INSIDE) ? OUTSIDE : INSIDE;
+			rIi++;
+		}
+	}
+	return numHits;
+}
+
+/** \brief Sort a range of hits, nearest first.
+ *
+ * Children normally return their hits in order, so this only sorts if needed.
+ *
+ * \param hits The first hit in the range.
+ * \param numHits The number of hits in the range.
+ */
+void sortHits(RayIntersection* hits, size_t numHits);
+
 #endif // CSG_H_INCLUDED
@@ -0,0 +1,239 @@
+/* $Rev: 250 $ */
+#include "CSGProgram.h"
+
+#include <algorithm>
+#include <cmath>
+
+/** \brief A CSG node which is being evaluated, and the Ray in its co-ordinate frame. */
+struct CSGFrame {
+	Ray ray;               //!< The Ray, in the node's co-ordinate frame.
+	csg_children children; //!< Which of the node's children are being traced.
+	size_t begin;          //!< The node's \c BEGIN instruction.
+};
+
+/** \brief A run of hits in the storage given to CSGProgram::evaluate(). */
+struct CSGSpan {
+	size_t first; //!< Index of the first hit.
+	size_t count; //!< Number of hits.
+};
+
+/** \brief Per-thread working storage for CSGProgram::evaluate().
+ *
+ * The stacks are fixed in size, and the Rays in the frames are written 
+ * element by element, so evaluation never allocates memory for them, and
+ * a reference to a frame stays valid while a leaf evaluates a CSGProgram 
+ * of its own above it.
+ */
+struct CSGScratch {
+	static const size_t maxFrames = 64; //!< Depth of the frame stack.
+	static const size_t maxSpans = 2*maxFrames; //!< Depth of the span stack.
+
+	CSGScratch() : numFrames(0), numSpans(0) {}
+
+	CSGFrame frames[maxFrames]; //!< Stack of CSG nodes being evaluated.
+	size_t numFrames;           //!< Number of frames in use.
+	CSGSpan spans[maxSpans];    //!< Stack of spans of hits.
+	size_t numSpans;            //!< Number of spans in use.
+
+	void pushSpan(size_t first, size_t count) {
+		spans[numSpans].first = first;
+		spans[numSpans].count = count;
+		++numSpans;
+	}
+
+	CSGSpan popSpan() {
+		return spans[--numSpans];
+	}
+};
+
+const size_t CSGScratch::maxFrames;
+const size_t CSGScratch::maxSpans;
+
+static thread_local CSGScratch scratch;
+
+// Multiply (x, y, z, w) by a matrix whose bottom row is (0, 0, 0, 1), in place.
+// This is the same arithmetic, in the same order, as Transform::apply(), so
+// the results are identical.
+static void applyRows(const double m[3][4], Vector& v, double w) {
+	double x = v(0);
+	double y = v(1);
+	double z = v(2);
+	for (size_t r = 0; r < 3; ++r) {
+		double sum = 0;
+		sum += m[r][0]*x;
+		sum += m[r][1]*y;
+		sum += m[r][2]*z;
+		sum += m[r][3]*w;
+		v(r) = sum;
+	}
+}
+
+CSGProgram::CSGProgram(const CSG* root) : root_(root), program_(), depth_(0) {
+	depth_ = compile(root);
+}
+
+CSGProgram::~CSGProgram() {
+
+}
+
+size_t CSGProgram::size() const {
+	return program_.size();
+}
+
+size_t CSGProgram::compile(const Object* object) {
+	Instruction instruction;
+	instruction.node = dynamic_cast<const CSG*>(object);
+	instruction.leaf = object;
+	instruction.rightStart = 0;
+	instruction.end = 0;
+	if (!instruction.node) {
+		instruction.opcode = CSG_LEAF;
+		program_.push_back(instruction);
+		return 0;
+	}
+
+	instruction.node->transform.rows(instruction.forward, instruction.inverse);
+	for (size_t r = 0; r < 3; ++r) {
+		for (size_t c = 0; c < 3; ++c) {
+			instruction.normal[r][c] = instruction.inverse[c][r];
+		}
+		instruction.normal[r][3] = 0;
+	}
+
+	size_t begin = program_.size();
+	instruction.opcode = CSG_BEGIN;
+	program_.push_back(instruction);
+	size_t leftDepth = compile(instruction.node->left.get());
+	program_[begin].rightStart = program_.size();
+	size_t rightDepth = compile(instruction.node->right.get());
+	program_[begin].end = program_.size();
+	instruction.opcode = CSG_END;
+	program_.push_back(instruction);
+	return 1 + std::max(leftDepth, rightDepth);
+}
+
+size_t CSGProgram::evaluate(const Ray& ray, RayIntersection* hits, size_t maxHits) const {
+	// A leaf may itself evaluate a CSGProgram, so only use the 
+	// stacks above what is already in use on this thread
+	CSGScratch& s = scratch;
+	size_t frameBase = s.numFrames;
+	size_t spanBase = s.numSpans;
+	if (frameBase + depth_ + 1 > CSGScratch::maxFrames || spanBase + depth_ + 2 > CSGScratch::maxSpans) {
+		return root_->intersectTree(ray, hits, maxHits);
+	}
+	size_t numHits = 0;
+
+	bool overflow = false;
+	CSGFrame& rootFrame = s.frames[s.numFrames++];
+	rootFrame.ray = ray;
+	rootFrame.children = CSG_BOTH;
+	rootFrame.begin = program_.size();
+	size_t pc = 0;
+	while (pc < program_.size() && !overflow) {
+		// Skip the right subtree of a node which only needs its left child
+		const CSGFrame& top = s.frames[s.numFrames-1];
+		if (top.children == CSG_LEFT_ONLY && pc == program_[top.begin].rightStart) {
+			pc = program_[top.begin].end;
+		}
+
+		const Instruction& instruction = program_[pc];
+		switch (instruction.opcode) {
+		case CSG_BEGIN: {
+			// Move the ray into the node's frame, in the next frame on the stack
+			CSGFrame& frame = s.frames[s.numFrames];
+			frame.ray = s.frames[s.numFrames-1].ray;
+			applyRows(instruction.inverse, frame.ray.point, 1);
+			applyRows(instruction.inverse, frame.ray.direction, 0);
+			csg_children children = instruction.node->childrenNeeded(frame.ray);
+			if (children == CSG_NEITHER) {
+				s.pushSpan(numHits, 0);
+				pc = instruction.end + 1;
+			} else {
+				frame.children = children;
+				frame.begin = pc;
+				++s.numFrames;
+				pc = (children == CSG_RIGHT_ONLY) ? instruction.rightStart : pc + 1;
+			}
+			break;
+		}
+		case CSG_LEAF: {
+			const Ray& leafRay = s.frames[s.numFrames-1].ray;
+			size_t count = instruction.leaf->intersectInto(leafRay, hits + numHits, maxHits - numHits);
+			if (count > maxHits - numHits) {
+				overflow = true;
+				numHits += count;
+				break;
+			}
+			s.pushSpan(numHits, count);
+			numHits += count;
+			++pc;
+			break;
+		}
+		case CSG_END: {
+			const CSG* node = instruction.node;
+			CSGSpan span;
+			if (s.frames[s.numFrames-1].children == CSG_BOTH) {
+				CSGSpan rightSpan = s.popSpan();
+				CSGSpan leftSpan = s.popSpan();
+				RayIntersection* leftHits = hits + leftSpan.first;
+				RayIntersection* rightHits = hits + rightSpan.first;
+				sortHits(leftHits, leftSpan.count);
+				sortHits(rightHits, rightSpan.count);
+
+				// Merge into the free space above the two spans, 
+				// then move the result down to replace them
+				size_t out = rightSpan.first + rightSpan.count;
+				if (out + leftSpan.count + rightSpan.count > maxHits) {
+					overflow = true;
+					numHits = out + leftSpan.count + rightSpan.count;
+					break;
+				}
+				span.first = leftSpan.first;
+				span.count = node->merge(leftHits, leftSpan.count, rightHits, rightSpan.count, hits + out);
+				std::copy(hits + out, hits + out + span.count, hits + span.first);
+			} else {
+				span = s.popSpan();
+				sortHits(hits + span.first, span.count);
+			}
+
+			// Map the hits back out of the node's frame, as CSG::mapToRay() does
+			if (span.count > 0) {
+				const Ray& localRay = s.frames[s.numFrames-1].ray;
+				const Ray& outerRay = s.frames[s.numFrames-2].ray;
+				double localScale = localRay.direction.norm()/outerRay.direction.norm();
+				for (size_t i = span.first; i < span.first + span.count; ++i) {
+					RayIntersection& hit = hits[i];
+					applyRows(instruction.forward, hit.point, 1);
+					applyRows(instruction.normal, hit.normal, 0);
+					if (hit.normal.dot(outerRay.direction) > 0) {
+						for (size_t a = 0; a < 3; ++a) {
+							hit.normal(a) = -hit.normal(a);
+						}
+					}
+					double squaredDistance = 0;
+					for (size_t a = 0; a < 3; ++a) {
+						double offset = hit.point(a) - outerRay.point(a);
+						squaredDistance += offset*offset;
+					}
+					hit.distance = std::sqrt(squaredDistance);
+					hit.textureScale *= localScale;
+				}
+			}
+			s.pushSpan(span.first, span.count);
+			numHits = span.first + span.count;
+			--s.numFrames;
+			++pc;
+			break;
+		}
+		}
+	}
+
+	s.numFrames = frameBase;
+	s.numSpans = spanBase;
+
+	// The caller tries again with more room
+	if (overflow) {
+		return std::max(numHits, maxHits + 1);
+	}
+	return numHits;
+}
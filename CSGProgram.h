@@ -0,0 +1,110 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef CSG_PROGRAM_H_INCLUDED
+#define CSG_PROGRAM_H_INCLUDED
+
+#include "CSG.h"
+
+#include <vector>
+
+/** 
+ * \file
+ * \brief CSGProgram class header file.
+ */
+
+/**
+ * \brief A CSG tree compiled into a flat list of instructions.
+ *
+ * Deep CSG trees are expensive to trace recursively: each node is a 
+ * virtual call, and builds its own \c std::vector of hits. A CSGProgram
+ * walks the tree once, when it is compiled, and records it as a list of 
+ * instructions. Each CSG node becomes a \c BEGIN instruction, followed by 
+ * the instructions for its left and right subtrees, followed by an \c END 
+ * instruction. Any other Object in the tree becomes a \c LEAF instruction.
+ *
+ * evaluate() then runs through the instructions with a stack of spans of
+ * hits, held in storage given by the caller:
+ * - \c BEGIN moves the ray into the node's co-ordinate frame, and uses 
+ *   CSG::childrenNeeded() to skip over subtrees which cannot affect the 
+ *   result.
+ * - \c LEAF traces the ray through an Object with Object::intersectInto(),
+ *   which writes its hits straight into the free space after the spans
+ *   already pushed, and pushes them as a new span.
+ * - \c END pops the children's hits, merges them with CSG::merge(), maps 
+ *   them back out of the node's co-ordinate frame, and pushes the result.
+ *
+ * No lists of hits are made at any level. Each node's transform is copied
+ * into its instructions as plain arrays when the tree is compiled, and
+ * applied to the ray and hits in place, and the stacks of nodes and spans
+ * are fixed-size arrays belonging to the calling thread, so evaluation only
+ * allocates what the leaves themselves do. A tree too deep for the stacks
+ * is traced with CSG::intersectTree() instead.
+ *
+ * This does exactly the same arithmetic, in the same order, as
+ * CSG::intersectTree(), so the results are identical (csgBenchmark checks
+ * this, and times the two).
+ */
+class CSGProgram {
+
+public:
+
+	/** \brief Compile a CSG tree.
+	 *
+	 * The CSGProgram refers to the nodes of the tree (for their bounds and 
+	 * operations), so they must outlive it. Their transforms are copied, so
+	 * the tree must be compiled again if they change.
+	 *
+	 * \param root The root of the tree to compile.
+	 */
+	CSGProgram(const CSG* root);
+
+	/** \brief CSGProgram destructor. */
+	~CSGProgram();
+
+	/** \brief Intersect a Ray with the compiled CSG tree.
+	 *
+	 * \param ray The Ray to intersect with the tree.
+	 * \param hits Where to write the intersections, which is also used as working space.
+	 * \param maxHits The number of RayIntersections in \c hits.
+	 * \return The number of intersections, or more than \c maxHits if there was not enough room.
+	 */
+	size_t evaluate(const Ray& ray, RayIntersection* hits, size_t maxHits) const;
+
+	/** \brief The number of instructions in the program.
+	 *
+	 * \return The length of the program.
+	 */
+	size_t size() const;
+
+private:
+
+	/** \brief The kinds of CSGProgram instruction. */
+	enum csg_opcode {CSG_BEGIN, CSG_LEAF, CSG_END};
+
+	/** \brief A single instruction. */
+	struct Instruction {
+		csg_opcode opcode;   //!< What to do.
+		const CSG* node;     //!< The CSG node, for \c BEGIN and \c END.
+		const Object* leaf;  //!< The Object to trace, for \c LEAF.
+		size_t rightStart;   //!< For \c BEGIN, the first instruction of the right subtree.
+		size_t end;          //!< For \c BEGIN, the matching \c END instruction.
+		double forward[3][4]; //!< For \c BEGIN and \c END, the node's transformation matrix (see Transform::rows()).
+		double inverse[3][4]; //!< For \c BEGIN and \c END, the inverse of \c forward.
+		double normal[3][4];  //!< For \c BEGIN and \c END, the transpose of \c inverse, which transforms Normals.
+	};
+
+	/** \brief Append the instructions for a subtree.
+	 *
+	 * \param object The root of the subtree.
+	 * \return The depth of the subtree, counting only CSG nodes.
+	 */
+	size_t compile(const Object* object);
+
+	const CSG* root_;                   //!< The root of the compiled tree.
+	std::vector<Instruction> program_;  //!< The instructions, in order.
+	size_t depth_;                      //!< The depth of the tree, counting only CSG nodes.
+
+};
+
+#endif // CSG_PROGRAM_H_INCLUDED
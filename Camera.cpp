@@ -20,3 +20,17 @@ const Camera& Camera::operator=(const Camera& camera) {
 
 	return *this;
 }
+
+Ray Camera::castRay(double x, double y, double pixelSize) const {
+	Ray ray = castRay(x, y);
+	Ray across = castRay(x + pixelSize, y);
+	Ray down = castRay(x, y + pixelSize);
+	for (int i = 0; i < 3; ++i) {
+		ray.differential.dPdx[i] = across.point(i) - ray.point(i);
+		ray.differential.dPdy[i] = down.point(i) - ray.point(i);
+		ray.differential.dDdx[i] = across.direction(i) - ray.direction(i);
+		ray.differential.dDdy[i] = down.direction(i) - ray.direction(i);
+	}
+	ray.hasDifferential = true;
+	return ray;
+}
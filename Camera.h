@@ -48,6 +48,20 @@ public:
 	 */
 	virtual Ray castRay(double x, double y) const = 0;
 
+	/** \brief Generate a ray with differentials for a given image plane co-ordinate
+	 *
+	 * This is the same as castRay(double, double) const, but the Ray also has
+	 * a RayDifferential for pixels of the given size. By default these are 
+	 * found by casting Rays one pixel across and one pixel down, and taking
+	 * the differences.
+	 *
+	 * \param x the horizontal location
+	 * \param y the vertical location
+	 * \param pixelSize the width and height of a pixel, in image plane co-ordinates
+	 * \return The Ray that passes from the Camera through (x,y) in the image plane, with differentials.
+	 */
+	virtual Ray castRay(double x, double y, double pixelSize) const;
+
 	Transform transform; //!< Transformation to apply to the Camera.
 
 protected:
@@ -94,6 +94,10 @@ Colour& Colour::operator/=(double s) {
 	return *this;
 }
 
+bool Colour::operator==(const Colour& colour) const {
+	return red == colour.red && green == colour.green && blue == colour.blue;
+}
+
 void Colour::clip() {
 	if (red < 0) red = 0;
 	if (red > 1) red = 1;
@@ -176,6 +176,15 @@ public:
 	 */
 	Colour& operator/=(double s);
 
+	/** \brief Colour equality.
+	 *
+	 * Two Colours are equal if all of their components are equal.
+	 *
+	 * \param colour The Colour to compare to \c this.
+	 * \return true if the Colours are the same, false otherwise.
+	 */
+	bool operator==(const Colour& colour) const;
+
 	/** \brief Enforce bounds on Colour components.
 	 *
 	 * Colour component values should lie in the range [0,1], but during computation
@@ -22,9 +22,13 @@ const Cone& Cone::operator=(const Cone& cone) {
 	return *this;
 }
 
-std::vector<RayIntersection> Cone::intersect(const Ray& ray) const {
+BoundingBox Cone::getBounds() const {
+	return BoundingBox(Point(-1,-1,0), Point(1,1,1)).transformed(transform);
+}
+
+RayIntersectionList Cone::intersect(const Ray& ray) const {
 
-	std::vector<RayIntersection> result;
+	RayIntersectionList result;
 
 	Ray inverseRay = transform.applyInverse(ray);
 
@@ -81,7 +81,15 @@ public:
 	 * \param ray The Ray to intersect with this Cone.
 	 * \return A list (std::vector) of intersections, which may be empty.
 	 */
-	std::vector<RayIntersection> intersect(const Ray& ray) const;
+	RayIntersectionList intersect(const Ray& ray) const;
+
+	/** \brief Bounds of the Cone.
+	 *
+	 * The box from the tip of the Cone to its base, transformed by the Cone's transform.
+	 *
+	 * \return A BoundingBox containing the Cone.
+	 */
+	BoundingBox getBounds() const;
 
 };
 
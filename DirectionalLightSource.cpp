@@ -0,0 +1,55 @@
+/* $Rev: 250 $ */
+#include "DirectionalLightSource.h"
+
+#include "utility.h"
+
+#include <cmath>
+
+DirectionalLightSource::DirectionalLightSource() : LightSource(), direction(0,1,0) {
+
+}
+
+DirectionalLightSource::DirectionalLightSource(const DirectionalLightSource& lightSource) : LightSource(lightSource),
+direction(lightSource.direction) {
+
+}
+
+DirectionalLightSource::~DirectionalLightSource() {
+
+}
+
+const DirectionalLightSource& DirectionalLightSource::operator=(const DirectionalLightSource& lightSource) {
+	if (this != &lightSource) {
+		LightSource::operator=(lightSource);
+		direction = lightSource.direction;
+	}
+	return *this;
+}
+
+double DirectionalLightSource::getIntensityAt(const Point&) const {
+	return 1;
+}
+
+LightSample DirectionalLightSource::sample(const Point&) const {
+	LightSample result;
+	result.direction = Direction(-direction/direction.norm());
+	result.distance = infinity;
+	result.intensity = colour;
+	return result;
+}
+
+bool DirectionalLightSource::distant() const {
+	return true;
+}
+
+Colour DirectionalLightSource::emit(const Point& centre, double radius, double u, double v, double, double, Ray& ray) const {
+	Vector along = direction/direction.norm();
+	Vector a = along.cross(std::abs(along(0)) > 0.5 ? Direction(0,1,0) : Direction(1,0,0));
+	a = a/a.norm();
+	Vector b = along.cross(a);
+	double r = radius*std::sqrt(u);
+	double turn = 2*M_PI*v;
+	ray.point = centre + r*std::cos(turn)*a + r*std::sin(turn)*b - 1000*radius*along;
+	ray.direction = Direction(along);
+	return M_PI*radius*radius*colour;
+}
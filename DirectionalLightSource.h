@@ -0,0 +1,91 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef DIRECTIONAL_LIGHT_SOURCE_H_INCLUDED
+#define DIRECTIONAL_LIGHT_SOURCE_H_INCLUDED
+
+#include "Direction.h"
+#include "LightSource.h"
+
+/**
+ * \file
+ * \brief DirectionalLightSource class header file.
+ */
+
+/**
+ * \brief Light arriving from a single Direction, like sunlight.
+ *
+ * A DirectionalLightSource is infinitely far away, so its light arrives at
+ * every Point from the same Direction, and with the same brightness. Its
+ * location is not used. Shadow Rays go on forever, and any Object along 
+ * them blocks the light.
+ */
+class DirectionalLightSource : public LightSource {
+
+public:
+
+	/** \brief DirectionalLightSource default constructor.
+	 *
+	 * This creates a white light shining straight along +y.
+	 */
+	DirectionalLightSource();
+
+	/** \brief DirectionalLightSource copy constructor.
+	 *
+	 * \param lightSource The DirectionalLightSource to copy to \c this.
+	 */
+	DirectionalLightSource(const DirectionalLightSource& lightSource);
+
+	/** \brief DirectionalLightSource destructor */
+	~DirectionalLightSource();
+
+	/** \brief DirectionalLightSource assignment operator.
+	 *
+	 * \param lightSource The DirectionalLightSource to copy to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	const DirectionalLightSource& operator=(const DirectionalLightSource& lightSource);
+
+	/** \brief Determine how much light reaches a Point.
+	 *
+	 * The light does not fade with distance, so this is always 1.
+	 *
+	 * \param point The Point at which light is measured.
+	 * \return The proportion of the base illumination that reaches the Point.
+	 */
+	double getIntensityAt(const Point& point) const;
+
+	/** \brief Determine the light arriving at a Point.
+	 *
+	 * \param point The Point at which light is measured.
+	 * \return Light arriving against the direction, from an \c infinity distance.
+	 */
+	LightSample sample(const Point& point) const;
+
+	/** \brief Whether the DirectionalLightSource is infinitely far away.
+	 *
+	 * \return true, as its location is not used.
+	 */
+	bool distant() const;
+
+	/** \brief Send out a photon from the DirectionalLightSource.
+	 *
+	 * The photons travel along the direction, through a disc as wide as the
+	 * sphere.
+	 *
+	 * \param centre The middle of the sphere to send photons towards.
+	 * \param radius The radius of the sphere to send photons towards.
+	 * \param u The first co-ordinate of where on the disc the photon passes.
+	 * \param v The second co-ordinate of where on the disc the photon passes.
+	 * \param s Not used, as the light only travels in one Direction.
+	 * \param t Not used, as the light only travels in one Direction.
+	 * \param ray Set to where the photon starts, and its unit Direction.
+	 * \return The power of the photon.
+	 */
+	Colour emit(const Point& centre, double radius, double u, double v, double s, double t, Ray& ray) const;
+
+	Direction direction; //!< The Direction the light travels in. It need not be a unit Vector.
+
+};
+
+#endif // DIRECTIONAL_LIGHT_SOURCE_H_INCLUDED
@@ -0,0 +1,69 @@
+/* $Rev: 250 $ */
+#include "Disc.h"
+
+#include "utility.h"
+
+Disc::Disc() : Object() {
+
+}
+
+Disc::Disc(const Disc& disc) : Object(disc) {
+
+}
+
+Disc::~Disc() {
+
+}
+
+const Disc& Disc::operator=(const Disc& disc) {
+	if (this != &disc) {
+		Object::operator=(disc);
+	}
+	return *this;
+}
+
+BoundingBox Disc::getBounds() const {
+	// Padded slightly in y, so that Rays do not slip through a box of zero thickness
+	return BoundingBox(Point(-1,-epsilon,-1), Point(1,epsilon,1)).transformed(transform);
+}
+
+RayIntersectionList Disc::intersect(const Ray& ray) const {
+	RayIntersectionList result(1);
+	result.resize(intersectInto(ray, result.data(), result.size()));
+	return result;
+}
+
+size_t Disc::intersectInto(const Ray& ray, RayIntersection* hits, size_t maxHits) const {
+
+	Ray inverseRay = transform.applyInverse(ray);
+
+	double dy = inverseRay.direction(1);
+	if (std::abs(dy) < epsilon*epsilon) {
+		// Parallel to the plane of the Disc
+		return 0;
+	}
+
+	double d = -inverseRay.point(1)/dy;
+	Point local(inverseRay.point + d*inverseRay.direction);
+	if (d > 0 && local(0)*local(0) + local(2)*local(2) <= 1) {
+		// Intersection is in front of the ray's start point, and inside the Disc
+		if (maxHits == 0) {
+			return 1;
+		}
+		RayIntersection& hit = hits[0];
+		hit.material = material;
+		hit.point = transform.apply(local);
+		hit.normal = transform.apply(Normal(0,1,0));
+		hit.u = 0.5*(local(0) + 1);
+		hit.v = 0.5*(local(2) + 1);
+		hit.textureScale = 0.5*inverseRay.direction.norm()/ray.direction.norm();
+		hit.spherical = false;
+		if (hit.normal.dot(ray.direction) > 0) {
+			hit.normal = -hit.normal;
+		}
+		hit.distance = (hit.point - ray.point).norm();
+		return 1;
+	}
+
+	return 0;
+}
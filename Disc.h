@@ -0,0 +1,85 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef DISC_H_INCLUDED
+#define DISC_H_INCLUDED
+
+#include "Object.h"
+
+/** 
+ * \file
+ * \brief Disc class header file.
+ */
+
+/**
+ * \brief Class for Disc objects.
+ * 
+ * This class provides an Object which is a disc of radius 1 centred at the origin,
+ * lying in the plane \f$y = 0\f$ with normal \f$(0,1,0)\f$. A Texture is
+ * stretched over the square around the disc.
+ *
+ * A Disc has no inside, so the Ray crosses its surface only once. This
+ * means that it should not be used as a child of a CSG node.
+ */
+class Disc : public Object {
+
+public:
+
+	/** \brief Disc default constructor.
+	 * 
+	 * A newly constructed Disc is centred at the origin in the plane \f$y = 0\f$, and 
+	 * has a radius of 1. It may be moved, rotated, and scaled through its transform member.
+	 */
+	Disc();
+
+	/** \brief Disc copy constructor.
+	 *
+	 * \param disc The Disc to copy.
+	 */
+	Disc(const Disc& disc);
+	
+	/** \brief Disc destructor. */
+	~Disc();
+	
+	/** \brief Disc assignment operator.
+	 *
+	 * \param disc The Disc to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	const Disc& operator=(const Disc& disc);
+	
+	/** \brief Disc-Ray intersection computation.
+	 *
+	 * In the Disc's co-ordinate frame the Ray meets the plane \f$y = 0\f$ at
+	 * \f$t = -o_y/d_y\f$, where \f$\mathbf{o}\f$ and \f$\mathbf{d}\f$ are
+	 * the Ray's start point and direction. The Ray hits the Disc if that point
+	 * is within 1 of the origin. A Ray parallel to the Disc misses it.
+	 *
+	 * \param ray The Ray to intersect with this Disc.
+	 * \return A list of intersections, which may be empty.
+	 */
+	RayIntersectionList intersect(const Ray& ray) const;
+
+	/** \brief Disc-Ray intersection computation, into storage given by the caller.
+	 *
+	 * This is the same as intersect(), but writes the hits over \c hits, so
+	 * that a Disc in a CSG tree does not make a list (see Object::intersectInto()).
+	 *
+	 * \param ray The Ray to intersect with this Disc.
+	 * \param hits Where to write the intersections.
+	 * \param maxHits The number of RayIntersections in \c hits.
+	 * \return The number of intersections, or more than \c maxHits if they do not fit.
+	 */
+	size_t intersectInto(const Ray& ray, RayIntersection* hits, size_t maxHits) const;
+
+	/** \brief Bounds of the Disc.
+	 *
+	 * A flat square around the unit disc, transformed by the Disc's transform.
+	 *
+	 * \return A BoundingBox containing the Disc.
+	 */
+	BoundingBox getBounds() const;
+
+};
+
+#endif // DISC_H_INCLUDED
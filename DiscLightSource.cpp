@@ -0,0 +1,42 @@
+/* $Rev: 250 $ */
+#include "DiscLightSource.h"
+
+#include <algorithm>
+
+DiscLightSource::DiscLightSource() : AreaLightSource(), normal(0,1,0), radius(1) {
+
+}
+
+DiscLightSource::DiscLightSource(const DiscLightSource& lightSource) : AreaLightSource(lightSource),
+normal(lightSource.normal), radius(lightSource.radius) {
+
+}
+
+DiscLightSource::~DiscLightSource() {
+
+}
+
+const DiscLightSource& DiscLightSource::operator=(const DiscLightSource& lightSource) {
+	if (this != &lightSource) {
+		AreaLightSource::operator=(lightSource);
+		normal = lightSource.normal;
+		radius = lightSource.radius;
+	}
+	return *this;
+}
+
+Point DiscLightSource::pointOn(const Point&, double u, double v) const {
+	Vector a, b;
+	perpendicularAxes(normal/normal.norm(), a, b);
+	double x, y;
+	concentricDisc(u, v, x, y);
+	return location + radius*(x*a + y*b);
+}
+
+double DiscLightSource::extent() const {
+	return radius;
+}
+
+double DiscLightSource::facing(const Vector& direction) const {
+	return std::max(0.0, normal.dot(direction)/normal.norm());
+}
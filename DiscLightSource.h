@@ -0,0 +1,75 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef DISC_LIGHT_SOURCE_H_INCLUDED
+#define DISC_LIGHT_SOURCE_H_INCLUDED
+
+#include "AreaLightSource.h"
+#include "Direction.h"
+
+/**
+ * \file
+ * \brief DiscLightSource class header file.
+ */
+
+/**
+ * \brief Light given off by a flat, round disc.
+ *
+ * The disc is centred on the location, at right angles to its normal. By
+ * default it has radius 1 and lies flat in the X-Z plane. Light is only
+ * given off on the side the normal points to, which by default is +y.
+ */
+class DiscLightSource : public AreaLightSource {
+
+public:
+
+	/** \brief DiscLightSource default constructor.
+	 *
+	 * This creates a white light at the origin, of radius 1 in the X-Z plane.
+	 */
+	DiscLightSource();
+
+	/** \brief DiscLightSource copy constructor.
+	 *
+	 * \param lightSource The DiscLightSource to copy to \c this.
+	 */
+	DiscLightSource(const DiscLightSource& lightSource);
+
+	/** \brief DiscLightSource destructor. */
+	~DiscLightSource();
+
+	/** \brief DiscLightSource assignment operator.
+	 *
+	 * \param lightSource The DiscLightSource to copy to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	const DiscLightSource& operator=(const DiscLightSource& lightSource);
+
+	/** \brief Find a point on the disc.
+	 *
+	 * \param point The Point being lit (not used).
+	 * \param u The first co-ordinate, in [0,1).
+	 * \param v The second co-ordinate, in [0,1).
+	 * \return The point on the disc.
+	 */
+	Point pointOn(const Point& point, double u, double v) const;
+
+	/** \brief The size of the disc.
+	 *
+	 * \return The radius.
+	 */
+	double extent() const;
+
+	/** \brief How much light the disc gives off in a Direction.
+	 *
+	 * \param direction The unit Direction the light leaves in.
+	 * \return The cosine of the angle between \c direction and the normal, or 0 behind the disc.
+	 */
+	double facing(const Vector& direction) const;
+
+	Direction normal; //!< Direction at right angles to the disc. It need not be a unit Vector.
+	double radius;    //!< Radius of the disc.
+
+};
+
+#endif // DISC_LIGHT_SOURCE_H_INCLUDED
@@ -0,0 +1,153 @@
+/* $Rev: 250 $ */
+#include "DistanceField.h"
+
+#include "utility.h"
+
+#include <algorithm>
+
+DistanceField::DistanceField() : Object(), 
+function(new SphereDistance(Point(0, 0, 0), 1)), maxSteps(256), tolerance(1e-4), allHits(false) {
+
+}
+
+DistanceField::DistanceField(const DistanceField& field) : Object(field), 
+function(field.function), maxSteps(field.maxSteps), tolerance(field.tolerance), allHits(field.allHits) {
+
+}
+
+DistanceField::~DistanceField() {
+
+}
+
+const DistanceField& DistanceField::operator=(const DistanceField& field) {
+	if (this != &field) {
+		Object::operator=(field);
+		function = field.function;
+		maxSteps = field.maxSteps;
+		tolerance = field.tolerance;
+		allHits = field.allHits;
+	}
+	return *this;
+}
+
+BoundingBox DistanceField::getBounds() const {
+	return function->bounds().transformed(transform);
+}
+
+RayIntersectionList DistanceField::intersect(const Ray& ray) const {
+	RayIntersectionList result(2);
+	size_t numHits = intersectInto(ray, result.data(), result.size());
+	if (numHits > result.size()) {
+		result.resize(numHits);
+		numHits = intersectInto(ray, result.data(), result.size());
+	}
+	result.resize(numHits);
+	return result;
+}
+
+size_t DistanceField::intersectInto(const Ray& ray, RayIntersection* hits, size_t maxHits) const {
+	Ray inverseRay = transform.applyInverse(ray);
+	double tNear, tFar;
+	if (!function->bounds().intersect(inverseRay, tNear, tFar)) {
+		return 0;
+	}
+
+	// The Ray is marched in the field's co-ordinate frame, as an origin,
+	// a unit direction, and a distance along it (s) up to the end of the bounds
+	double length = inverseRay.direction.norm();
+	double ox = inverseRay.point(0);
+	double oy = inverseRay.point(1);
+	double oz = inverseRay.point(2);
+	double ux = inverseRay.direction(0)/length;
+	double uy = inverseRay.direction(1)/length;
+	double uz = inverseRay.direction(2)/length;
+	double s = tNear*length;
+	double sEnd = tFar*length;
+	double localScale = length/ray.direction.norm();
+	double stepScale = 1/function->lipschitz();
+
+	size_t numHits = 0;
+	auto crossing = [&](double hitS) {
+		if (numHits < maxHits) {
+			surfaceHit(ray, Point(ox + hitS*ux, oy + hitS*uy, oz + hitS*uz), localScale, hits[numHits]);
+		}
+		++numHits;
+	};
+
+	// With allHits, marching carries on through the surface after each hit,
+	// stepping by the distance to the surface from whichever side the Ray is
+	// on, so that the distances where it enters and leaves the field are all found
+	bool inside = false;
+	bool leaving = (tNear <= 0);
+	bool starting = leaving;
+	for (unsigned int step = 0; step < maxSteps && s <= sEnd; ++step) {
+		double px = ox + s*ux;
+		double py = oy + s*uy;
+		double pz = oz + s*uz;
+		double d;
+		function->distance(&px, &py, &pz, &d, 1);
+
+		double clearance = inside ? -d : d;
+		if (clearance <= -tolerance) {
+			// Steps never overshoot the surface, so the Ray is only found
+			// on the other side of it if it started there, or if it 
+			// grazed the surface while getting clear of it
+			if (!starting) {
+				crossing(s);
+			}
+			inside = !inside;
+			clearance = -clearance;
+		}
+		if (clearance < tolerance) {
+			if (!leaving) {
+				crossing(s);
+				inside = !inside;
+				leaving = true;
+			}
+			// A Ray which is on the surface, such as a shadow Ray or one
+			// which has just hit it, must get clear of it before it can 
+			// hit it again
+			s += std::max(std::abs(d)*stepScale, 2*tolerance);
+		} else {
+			leaving = false;
+			starting = false;
+			s += clearance*stepScale;
+		}
+		if (numHits > 0 && !allHits) {
+			return numHits;
+		}
+	}
+
+	// A CSG node counts the hits to tell whether the Ray starts inside, so
+	// one which is still inside when the steps run out (usually one grazing
+	// the surface) leaves where marching stopped
+	if (allHits && inside) {
+		crossing(std::min(s, sEnd));
+	}
+	return numHits;
+}
+
+void DistanceField::surfaceHit(const Ray& ray, const Point& local, double localScale, RayIntersection& hit) const {
+	double h = tolerance;
+	double gx[6], gy[6], gz[6], g[6];
+	for (int j = 0; j < 6; ++j) {
+		gx[j] = local(0);
+		gy[j] = local(1);
+		gz[j] = local(2);
+	}
+	gx[0] += h; gx[1] -= h;
+	gy[2] += h; gy[3] -= h;
+	gz[4] += h; gz[5] -= h;
+	function->distance(gx, gy, gz, g, 6);
+
+	Normal localNormal(g[0] - g[1], g[2] - g[3], g[4] - g[5]);
+	hit.material = material;
+	hit.point = transform.apply(local);
+	hit.normal = transform.apply(localNormal);
+	boxTextureCoordinates(local, localNormal, hit);
+	hit.textureScale = localScale;
+	if (hit.normal.dot(ray.direction) > 0) {
+		hit.normal = -hit.normal;
+	}
+	hit.distance = (hit.point - ray.point).norm();
+}
@@ -0,0 +1,112 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef DISTANCE_FIELD_H_INCLUDED
+#define DISTANCE_FIELD_H_INCLUDED
+
+#include "DistanceFunction.h"
+#include "Object.h"
+
+/** 
+ * \file
+ * \brief DistanceField class header file.
+ */
+
+/**
+ * \brief Class for Objects defined by a signed distance function.
+ *
+ * A DistanceField is the region where a DistanceFunction is negative.
+ * Since distance functions can be smoothly blended together, this gives
+ * an easy way to make rounded, organic shapes which would need very deep
+ * CSG trees (or could not be made at all) with other Objects.
+ *
+ * Rays are traced by <em>sphere tracing</em>. The distance function, 
+ * divided by its Lipschitz constant, gives the radius of a sphere around 
+ * a point which does not touch the surface, so the Ray can safely advance
+ * by that much. This is repeated until the distance is below a small 
+ * tolerance (a hit), the Ray leaves the function's bounds (a miss), or
+ * maxSteps steps have been taken (also treated as a miss). Marching starts
+ * where the Ray enters the function's bounds, rather than at its start point,
+ * and stops at the first hit, which is all that the Scene needs.
+ *
+ * A child of a CSG node needs every point where the Ray enters or leaves,
+ * so if allHits is set, marching carries on inside the field after a hit,
+ * stepping by the distance to the surface from within, until the Ray leaves
+ * it again, and so on to the end of the bounds. A Ray which starts inside
+ * the field gets a hit where it first leaves. If maxSteps runs out while the
+ * Ray is inside, it is taken to leave where marching stopped, so that the
+ * hits still pair up.
+ */
+class DistanceField : public Object {
+
+public:
+
+	/** \brief DistanceField default constructor.
+	 *
+	 * A newly constructed DistanceField is a sphere centred at the origin, with radius 1.
+	 */
+	DistanceField();
+
+	/** \brief DistanceField copy constructor.
+	 *
+	 * \param field The DistanceField to copy.
+	 */
+	DistanceField(const DistanceField& field);
+
+	/** \brief DistanceField destructor. */
+	~DistanceField();
+
+	/** \brief DistanceField assignment operator.
+	 *
+	 * \param field The DistanceField to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	const DistanceField& operator=(const DistanceField& field);
+
+	/** \brief DistanceField-Ray intersection computation.
+	 *
+	 * \param ray The Ray to intersect with this DistanceField.
+	 * \return A list (std::vector) of the first point where the Ray crosses the surface, or of every point if allHits is set, nearest first.
+	 */
+	RayIntersectionList intersect(const Ray& ray) const;
+
+	/** \brief DistanceField-Ray intersection computation, into storage given by the caller.
+	 *
+	 * \param ray The Ray to intersect with this DistanceField.
+	 * \param hits Where to write the intersections.
+	 * \param maxHits The number of RayIntersections in \c hits.
+	 * \return The number of intersections, or more than \c maxHits if they do not fit.
+	 */
+	size_t intersectInto(const Ray& ray, RayIntersection* hits, size_t maxHits) const;
+
+	/** \brief Bounds of the DistanceField.
+	 *
+	 * \return The bounds of the distance function, transformed by the DistanceField's transform.
+	 */
+	BoundingBox getBounds() const;
+
+	std::shared_ptr<const DistanceFunction> function; //!< The distance function defining the shape.
+
+	unsigned int maxSteps; //!< The most sphere tracing steps to take along a Ray.
+
+	double tolerance; //!< How close to the surface counts as a hit.
+
+	bool allHits; //!< Whether to find every point where a Ray enters or leaves, as a child of a CSG node needs, rather than just the first.
+
+private:
+
+	/** \brief Fill in a hit on the surface.
+	 *
+	 * The normal comes from the gradient of the distance function, found
+	 * by central differences evaluated as one batch.
+	 *
+	 * \param ray The Ray which was traced.
+	 * \param local The hit, in the field's co-ordinate frame.
+	 * \param localScale Distance in the field's frame per unit distance in the Ray's frame.
+	 * \param hit Set to the intersection.
+	 */
+	void surfaceHit(const Ray& ray, const Point& local, double localScale, RayIntersection& hit) const;
+
+};
+
+#endif // DISTANCE_FIELD_H_INCLUDED
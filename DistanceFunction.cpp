@@ -0,0 +1,153 @@
+/* $Rev: 250 $ */
+#include "DistanceFunction.h"
+
+#include <algorithm>
+#include <cmath>
+
+const size_t DistanceFunction::maxBatch;
+
+DistanceFunction::DistanceFunction() {
+
+}
+
+DistanceFunction::~DistanceFunction() {
+
+}
+
+void DistanceFunction::distance(const double* x, const double* y, const double* z, double* d, size_t n) const {
+	for (size_t i = 0; i < n; ++i) {
+		d[i] = distance(x[i], y[i], z[i]);
+	}
+}
+
+double DistanceFunction::lipschitz() const {
+	return 1;
+}
+
+SphereDistance::SphereDistance(const Point& centre, double radius) : 
+DistanceFunction(), cx_(centre(0)), cy_(centre(1)), cz_(centre(2)), radius_(radius) {
+
+}
+
+double SphereDistance::distance(double x, double y, double z) const {
+	x -= cx_;
+	y -= cy_;
+	z -= cz_;
+	return std::sqrt(x*x + y*y + z*z) - radius_;
+}
+
+void SphereDistance::distance(const double* x, const double* y, const double* z, double* d, size_t n) const {
+	for (size_t i = 0; i < n; ++i) {
+		double dx = x[i] - cx_;
+		double dy = y[i] - cy_;
+		double dz = z[i] - cz_;
+		d[i] = std::sqrt(dx*dx + dy*dy + dz*dz) - radius_;
+	}
+}
+
+BoundingBox SphereDistance::bounds() const {
+	return BoundingBox(Point(cx_ - radius_, cy_ - radius_, cz_ - radius_), Point(cx_ + radius_, cy_ + radius_, cz_ + radius_));
+}
+
+BoxDistance::BoxDistance(const Point& centre, const Vector& halfSize) :
+DistanceFunction(), cx_(centre(0)), cy_(centre(1)), cz_(centre(2)), hx_(halfSize(0)), hy_(halfSize(1)), hz_(halfSize(2)) {
+
+}
+
+double BoxDistance::distance(double x, double y, double z) const {
+	double qx = std::abs(x - cx_) - hx_;
+	double qy = std::abs(y - cy_) - hy_;
+	double qz = std::abs(z - cz_) - hz_;
+	double ox = std::max(qx, 0.0);
+	double oy = std::max(qy, 0.0);
+	double oz = std::max(qz, 0.0);
+	return std::sqrt(ox*ox + oy*oy + oz*oz) + std::min(std::max(qx, std::max(qy, qz)), 0.0);
+}
+
+BoundingBox BoxDistance::bounds() const {
+	return BoundingBox(Point(cx_ - hx_, cy_ - hy_, cz_ - hz_), Point(cx_ + hx_, cy_ + hy_, cz_ + hz_));
+}
+
+TorusDistance::TorusDistance(const Point& centre, double majorRadius, double minorRadius) :
+DistanceFunction(), cx_(centre(0)), cy_(centre(1)), cz_(centre(2)), majorRadius_(majorRadius), minorRadius_(minorRadius) {
+
+}
+
+double TorusDistance::distance(double x, double y, double z) const {
+	x -= cx_;
+	y -= cy_;
+	z -= cz_;
+	double ring = std::sqrt(x*x + z*z) - majorRadius_;
+	return std::sqrt(ring*ring + y*y) - minorRadius_;
+}
+
+BoundingBox TorusDistance::bounds() const {
+	double r = majorRadius_ + minorRadius_;
+	return BoundingBox(Point(cx_ - r, cy_ - minorRadius_, cz_ - r), Point(cx_ + r, cy_ + minorRadius_, cz_ + r));
+}
+
+BlendDistance::BlendDistance(std::shared_ptr<const DistanceFunction> a, std::shared_ptr<const DistanceFunction> b, 
+                             blend_operation operation, double radius) :
+DistanceFunction(), a_(a), b_(b), operation_(operation), radius_(radius) {
+
+}
+
+// Polynomial smooth minimum, which is within radius/4 of min(a,b)
+static double smoothMin(double a, double b, double radius) {
+	if (radius <= 0) {
+		return std::min(a, b);
+	}
+	double h = std::max(radius - std::abs(a - b), 0.0)/radius;
+	return std::min(a, b) - 0.25*h*h*radius;
+}
+
+double BlendDistance::combine(double da, double db) const {
+	switch (operation_) {
+	case BLEND_UNION:
+		return smoothMin(da, db, radius_);
+	case BLEND_INTERSECTION:
+		return -smoothMin(-da, -db, radius_);
+	case BLEND_DIFFERENCE:
+		return -smoothMin(-da, db, radius_);
+	}
+	return da;
+}
+
+double BlendDistance::distance(double x, double y, double z) const {
+	return combine(a_->distance(x, y, z), b_->distance(x, y, z));
+}
+
+void BlendDistance::distance(const double* x, const double* y, const double* z, double* d, size_t n) const {
+	double db[maxBatch];
+	a_->distance(x, y, z, d, n);
+	b_->distance(x, y, z, db, n);
+	for (size_t i = 0; i < n; ++i) {
+		d[i] = combine(d[i], db[i]);
+	}
+}
+
+BoundingBox BlendDistance::bounds() const {
+	BoundingBox box = a_->bounds();
+	switch (operation_) {
+	case BLEND_UNION:
+		box.include(b_->bounds());
+		break;
+	case BLEND_INTERSECTION:
+		box.clip(b_->bounds());
+		break;
+	case BLEND_DIFFERENCE:
+		break;
+	}
+	// Blending can push the surface out by up to a quarter of the radius
+	if (radius_ > 0 && !box.isEmpty()) {
+		for (int i = 0; i < 3; ++i) {
+			box.minPoint(i) -= 0.25*radius_;
+			box.maxPoint(i) += 0.25*radius_;
+		}
+	}
+	return box;
+}
+
+double BlendDistance::lipschitz() const {
+	return std::max(a_->lipschitz(), b_->lipschitz());
+}
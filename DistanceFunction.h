@@ -0,0 +1,218 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef DISTANCE_FUNCTION_H_INCLUDED
+#define DISTANCE_FUNCTION_H_INCLUDED
+
+#include "BoundingBox.h"
+
+#include <memory>
+
+/** 
+ * \file
+ * \brief DistanceFunction class header file.
+ */
+
+/**
+ * \brief Abstract base class for signed distance functions.
+ *
+ * A signed distance function gives, for any point in space, the distance
+ * to the nearest point on the surface of a shape. It is negative inside 
+ * the shape and positive outside. Simple shapes (spheres, boxes, tori) have
+ * exact distance functions, and these can be combined into more complex 
+ * shapes by taking minima, maxima, or smooth blends of their distances.
+ *
+ * Blends do not always give the true distance, but they do give a lower 
+ * bound on it, after dividing by the function's Lipschitz constant (the 
+ * largest rate at which it can change with position). This is all that is 
+ * needed to trace rays through the shape, as DistanceField does.
+ *
+ * Distances can be evaluated one point at a time, or in batches of up to 
+ * maxBatch points. The batch form works on separate arrays of X-, Y-, and
+ * Z-co-ordinates, so that the loops over the points can be vectorised 
+ * by the compiler.
+ */
+class DistanceFunction {
+
+public:
+
+	/** \brief DistanceFunction destructor. */
+	virtual ~DistanceFunction();
+
+	/** \brief Signed distance to the surface.
+	 *
+	 * \param x The X-co-ordinate of the point.
+	 * \param y The Y-co-ordinate of the point.
+	 * \param z The Z-co-ordinate of the point.
+	 * \return The signed distance from (x,y,z) to the surface.
+	 */
+	virtual double distance(double x, double y, double z) const = 0;
+
+	/** \brief Signed distances for a batch of points.
+	 *
+	 * The default implementation calls distance() for each point.
+	 *
+	 * \param x The X-co-ordinates of the points.
+	 * \param y The Y-co-ordinates of the points.
+	 * \param z The Z-co-ordinates of the points.
+	 * \param d Set to the signed distances of each point.
+	 * \param n The number of points, which must be at most maxBatch.
+	 */
+	virtual void distance(const double* x, const double* y, const double* z, double* d, size_t n) const;
+
+	/** \brief Bounds of the shape.
+	 *
+	 * \return A BoundingBox containing the shape (the region where the distance is negative).
+	 */
+	virtual BoundingBox bounds() const = 0;
+
+	/** \brief Lipschitz constant of the function.
+	 *
+	 * The distance changes by at most this much per unit step in any
+	 * direction. Exact distance functions have a Lipschitz constant of 1.
+	 *
+	 * \return The Lipschitz constant.
+	 */
+	virtual double lipschitz() const;
+
+	static const size_t maxBatch = 8; //!< The largest batch of points that can be evaluated at once.
+
+protected:
+
+	/** \brief DistanceFunction default constructor. */
+	DistanceFunction();
+
+};
+
+/**
+ * \brief Distance to a sphere.
+ */
+class SphereDistance : public DistanceFunction {
+
+public:
+
+	/** \brief SphereDistance constructor.
+	 *
+	 * \param centre The centre of the sphere.
+	 * \param radius The radius of the sphere.
+	 */
+	SphereDistance(const Point& centre, double radius);
+
+	double distance(double x, double y, double z) const;
+	void distance(const double* x, const double* y, const double* z, double* d, size_t n) const;
+	BoundingBox bounds() const;
+
+private:
+
+	double cx_, cy_, cz_; //!< The centre of the sphere.
+	double radius_;       //!< The radius of the sphere.
+
+};
+
+/**
+ * \brief Distance to an axis-aligned box.
+ */
+class BoxDistance : public DistanceFunction {
+
+public:
+
+	/** \brief BoxDistance constructor.
+	 *
+	 * \param centre The centre of the box.
+	 * \param halfSize Half of the width, height, and depth of the box.
+	 */
+	BoxDistance(const Point& centre, const Vector& halfSize);
+
+	double distance(double x, double y, double z) const;
+	BoundingBox bounds() const;
+
+private:
+
+	double cx_, cy_, cz_; //!< The centre of the box.
+	double hx_, hy_, hz_; //!< Half the size of the box along each axis.
+
+};
+
+/**
+ * \brief Distance to a torus.
+ *
+ * The torus lies in the plane through its centre perpendicular to the Y-axis.
+ */
+class TorusDistance : public DistanceFunction {
+
+public:
+
+	/** \brief TorusDistance constructor.
+	 *
+	 * \param centre The centre of the torus.
+	 * \param majorRadius The distance from the centre to the middle of the tube.
+	 * \param minorRadius The radius of the tube.
+	 */
+	TorusDistance(const Point& centre, double majorRadius, double minorRadius);
+
+	double distance(double x, double y, double z) const;
+	BoundingBox bounds() const;
+
+private:
+
+	double cx_, cy_, cz_;  //!< The centre of the torus.
+	double majorRadius_;   //!< The distance from the centre to the middle of the tube.
+	double minorRadius_;   //!< The radius of the tube.
+
+};
+
+/**
+ * \brief The ways that BlendDistance can combine two shapes.
+ */
+enum blend_operation {BLEND_UNION, BLEND_INTERSECTION, BLEND_DIFFERENCE};
+
+/**
+ * \brief A combination of two distance functions.
+ *
+ * Two shapes can be combined by union (the minimum of their distances), 
+ * intersection (the maximum), or difference (the maximum of the first 
+ * and the negated second). With a blend radius of zero these give sharp 
+ * creases where the surfaces meet, just like a CSG object. A positive blend
+ * radius replaces the minimum or maximum by a smooth polynomial blend 
+ * which rounds off the creases over about that distance.
+ *
+ * The blended function is still a lower bound on the distance, and its 
+ * Lipschitz constant is no more than the larger of the two inputs'.
+ */
+class BlendDistance : public DistanceFunction {
+
+public:
+
+	/** \brief BlendDistance constructor.
+	 *
+	 * \param a The first shape.
+	 * \param b The second shape.
+	 * \param operation How to combine the shapes.
+	 * \param radius The blend radius (0 for a sharp combination).
+	 */
+	BlendDistance(std::shared_ptr<const DistanceFunction> a, std::shared_ptr<const DistanceFunction> b, 
+	              blend_operation operation = BLEND_UNION, double radius = 0);
+
+	double distance(double x, double y, double z) const;
+	void distance(const double* x, const double* y, const double* z, double* d, size_t n) const;
+	BoundingBox bounds() const;
+	double lipschitz() const;
+
+private:
+
+	/** \brief Combine two distances.
+	 *
+	 * \param da The distance to the first shape.
+	 * \param db The distance to the second shape.
+	 * \return The distance to the combination.
+	 */
+	double combine(double da, double db) const;
+
+	std::shared_ptr<const DistanceFunction> a_; //!< The first shape.
+	std::shared_ptr<const DistanceFunction> b_; //!< The second shape.
+	blend_operation operation_;                 //!< How to combine the shapes.
+	double radius_;                             //!< The blend radius.
+
+};
+
+#endif // DISTANCE_FUNCTION_H_INCLUDED
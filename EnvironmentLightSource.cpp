@@ -0,0 +1,214 @@
+/* $Rev: 250 $ */
+#include "EnvironmentLightSource.h"
+
+#include "utility.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+EnvironmentLightSource::EnvironmentLightSource() : LightSource(), samples(4), width_(0), height_(0),
+radiance_(), rowSums_(), columnSums_(), totalWeight_(0) {
+
+}
+
+EnvironmentLightSource::EnvironmentLightSource(const EnvironmentLightSource& lightSource) : LightSource(lightSource),
+samples(lightSource.samples), width_(lightSource.width_), height_(lightSource.height_), radiance_(lightSource.radiance_),
+rowSums_(lightSource.rowSums_), columnSums_(lightSource.columnSums_), totalWeight_(lightSource.totalWeight_) {
+
+}
+
+EnvironmentLightSource::~EnvironmentLightSource() {
+
+}
+
+const EnvironmentLightSource& EnvironmentLightSource::operator=(const EnvironmentLightSource& lightSource) {
+	if (this != &lightSource) {
+		LightSource::operator=(lightSource);
+		samples = lightSource.samples;
+		width_ = lightSource.width_;
+		height_ = lightSource.height_;
+		radiance_ = lightSource.radiance_;
+		rowSums_ = lightSource.rowSums_;
+		columnSums_ = lightSource.columnSums_;
+		totalWeight_ = lightSource.totalWeight_;
+	}
+	return *this;
+}
+
+void EnvironmentLightSource::load(const std::string& filename, size_t width, size_t height) {
+	if (width == 0 || height == 0) {
+		std::cerr << "Environment map '" << filename << "' has no pixels" << std::endl;
+		exit(-1);
+	}
+	std::ifstream fin(filename, std::ios::binary);
+	if (!fin) {
+		std::cerr << "Cannot open environment map file '" << filename << "'" << std::endl;
+		exit(-1);
+	}
+	radiance_.resize(width*height*3);
+	fin.read(reinterpret_cast<char*>(radiance_.data()), radiance_.size()*sizeof(float));
+	if (!fin) {
+		std::cerr << "Environment map file '" << filename << "' is too short for " << width << "x" << height << " pixels" << std::endl;
+		exit(-1);
+	}
+	width_ = width;
+	height_ = height;
+
+	// Each pixel is weighted by its brightness, and by the solid angle it
+	// covers, which shrinks towards the top and bottom of the image. The
+	// background is filtered between neighbouring pixels, so the brightest of
+	// those is used, so that every Direction with any light has some chance
+	// of being sampled.
+	std::vector<double> brightness(width_*height_);
+	for (size_t y = 0; y < height_; ++y) {
+		for (size_t x = 0; x < width_; ++x) {
+			const float* value = &radiance_[(y*width_ + x)*3];
+			brightness[y*width_ + x] = std::max(0.0f, std::max(value[0], std::max(value[1], value[2])));
+		}
+	}
+	rowSums_.assign(height_ + 1, 0);
+	columnSums_.assign(height_*(width_ + 1), 0);
+	for (size_t y = 0; y < height_; ++y) {
+		double solidAngle = std::sin(M_PI*(y + 0.5)/height_);
+		double* row = &columnSums_[y*(width_ + 1)];
+		for (size_t x = 0; x < width_; ++x) {
+			double weight = 0;
+			for (size_t j = (y > 0 ? y - 1 : y); j <= std::min(y + 1, height_ - 1); ++j) {
+				for (size_t i = x + width_ - 1; i <= x + width_ + 1; ++i) {
+					weight = std::max(weight, brightness[j*width_ + i % width_]);
+				}
+			}
+			row[x + 1] = row[x] + weight*solidAngle;
+		}
+		rowSums_[y + 1] = rowSums_[y] + row[width_];
+		if (row[width_] > 0) {
+			for (size_t x = 1; x < width_; ++x) {
+				row[x] /= row[width_];
+			}
+			row[width_] = 1;
+		}
+	}
+	totalWeight_ = rowSums_[height_];
+	if (totalWeight_ > 0) {
+		for (size_t y = 1; y < height_; ++y) {
+			rowSums_[y] /= totalWeight_;
+		}
+		rowSums_[height_] = 1;
+	}
+}
+
+double EnvironmentLightSource::getIntensityAt(const Point&) const {
+	return 1;
+}
+
+LightSample EnvironmentLightSource::sample(const Point& point) const {
+	return sampleAt(point, 0.5, 0.5);
+}
+
+unsigned int EnvironmentLightSource::sampleGrid() const {
+	return samples;
+}
+
+bool EnvironmentLightSource::compact() const {
+	return false;
+}
+
+bool EnvironmentLightSource::distant() const {
+	return true;
+}
+
+// Find the interval of a table of cumulative sums which contains a value,
+// and how far along that interval the value is
+static size_t invert(const double* sums, size_t count, double value, double& offset) {
+	size_t i = size_t(std::upper_bound(sums, sums + count + 1, value) - sums);
+	i = std::min(std::max(i, size_t(1)), count) - 1;
+	double size = sums[i + 1] - sums[i];
+	offset = size > 0 ? std::min(std::max((value - sums[i])/size, 0.0), 1.0) : 0.5;
+	return i;
+}
+
+LightSample EnvironmentLightSource::sampleAt(const Point&, double u, double v) const {
+	LightSample result;
+	result.distance = infinity;
+	if (totalWeight_ <= 0) {
+		result.direction = Direction(0,-1,0);
+		result.intensity = Colour(0,0,0);
+		return result;
+	}
+
+	// Pick a row, then a pixel along it, in proportion to their weights
+	double offsetY, offsetX;
+	size_t y = invert(rowSums_.data(), height_, v, offsetY);
+	const double* row = &columnSums_[y*(width_ + 1)];
+	size_t x = invert(row, width_, u, offsetX);
+
+	double theta = M_PI*(y + offsetY)/height_;
+	double phi = 2*M_PI*((x + offsetX)/width_ - 0.5);
+	double sinTheta = std::sin(theta);
+	result.direction = Direction(sinTheta*std::cos(phi), -std::cos(theta), sinTheta*std::sin(phi));
+
+	// The density over the image, then over the sphere of Directions, which is
+	// stretched by 2 pi across and pi down, and squeezed by sin(theta) along the rows
+	double density = (rowSums_[y + 1] - rowSums_[y])*(row[x + 1] - row[x])*width_*height_;
+	double sphereDensity = density/(2*M_PI*M_PI*std::max(sinTheta, epsilon));
+	result.intensity = background(result.direction)/(M_PI*sphereDensity);
+	return result;
+}
+
+Colour EnvironmentLightSource::emit(const Point& centre, double radius, double u, double v, double s, double t, Ray& ray) const {
+	LightSample sample = sampleAt(centre, s, t);
+	Vector back = sample.direction;
+	Vector a = back.cross(std::abs(back(0)) > 0.5 ? Direction(0,1,0) : Direction(1,0,0));
+	a = a/a.norm();
+	Vector b = back.cross(a);
+	double r = radius*std::sqrt(u);
+	double turn = 2*M_PI*v;
+	ray.point = centre + r*std::cos(turn)*a + r*std::sin(turn)*b + 1000*radius*back;
+	ray.direction = Direction(-back);
+	return M_PI*radius*radius*sample.intensity;
+}
+
+double EnvironmentLightSource::density(const Direction& direction) const {
+	if (totalWeight_ <= 0) {
+		return 0;
+	}
+	double u = 0.5 + std::atan2(direction(2), direction(0))/(2*M_PI);
+	double theta = std::acos(std::max(-1.0, std::min(1.0, -direction(1)/direction.norm())));
+	size_t x = std::min(size_t(std::max(0.0, u*width_)), width_ - 1);
+	size_t y = std::min(size_t(theta/M_PI*height_), height_ - 1);
+	const double* row = &columnSums_[y*(width_ + 1)];
+	double density = (rowSums_[y + 1] - rowSums_[y])*(row[x + 1] - row[x])*width_*height_;
+	return density/(2*M_PI*M_PI*std::max(std::sin(theta), epsilon));
+}
+
+Colour EnvironmentLightSource::background(const Direction& direction) const {
+	if (radiance_.empty()) {
+		return Colour(0,0,0);
+	}
+	double length = direction.norm();
+	double u = 0.5 + std::atan2(direction(2), direction(0))/(2*M_PI);
+	double v = std::acos(std::max(-1.0, std::min(1.0, -direction(1)/length)))/M_PI;
+
+	// Pixel centres are at half-integer positions
+	double fx = u*width_ - 0.5;
+	double fy = v*height_ - 0.5;
+	double x0 = std::floor(fx);
+	double y0 = std::floor(fy);
+	double ax = fx - x0;
+	double ay = fy - y0;
+	long long x = (long long)x0;
+	long long y = (long long)y0;
+	Colour top = (1 - ax)*pixel(x, y) + ax*pixel(x + 1, y);
+	Colour bottom = (1 - ax)*pixel(x, y + 1) + ax*pixel(x + 1, y + 1);
+	return colour*((1 - ay)*top + ay*bottom);
+}
+
+Colour EnvironmentLightSource::pixel(long long x, long long y) const {
+	long long width = (long long)width_;
+	x = ((x % width) + width) % width;
+	y = std::max(0LL, std::min((long long)height_ - 1, y));
+	const float* value = &radiance_[(y*width_ + x)*3];
+	return Colour(value[0], value[1], value[2]);
+}
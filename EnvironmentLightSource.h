@@ -0,0 +1,190 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef ENVIRONMENT_LIGHT_SOURCE_H_INCLUDED
+#define ENVIRONMENT_LIGHT_SOURCE_H_INCLUDED
+
+#include "Direction.h"
+#include "LightSource.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * \file
+ * \brief EnvironmentLightSource class header file.
+ */
+
+/**
+ * \brief Light arriving from all around the Scene, given by an image of the sky.
+ *
+ * An EnvironmentLightSource surrounds the Scene at an infinite distance. Its
+ * image is the background seen by Rays which miss every Object, and it also
+ * lights the Objects, from every Direction at once, as an AreaLightSource
+ * does over its shape.
+ *
+ * The image is an equirectangular (latitude and longitude) map of high
+ * dynamic range radiance, stored as raw 32-bit floating point RGB values,
+ * a row at a time. Its top row is straight up (-y) and its bottom row straight
+ * down (+y), and it is laid out as for a textured Sphere, so \f$u = 0.5\f$
+ * faces along +x.
+ *
+ * Most of the light in such an image usually comes from a few small, bright
+ * areas, such as the sun or a window, which uniform samples would rarely
+ * find. Instead, the Directions of the samples are spread in proportion to
+ * the brightness of the image, using a table of cumulative sums built when
+ * it is loaded: one over the rows, and one along each row. The brightest
+ * parts then get most of the samples, and each sample is weighted by how
+ * likely it was to be chosen, so the lighting converges with few samples.
+ * Because the tables are inverted, rather than sampled at random, the
+ * samples keep the stratification of the sample grid.
+ *
+ * The location is not used. Shadow Rays go on forever, and any Object along
+ * them blocks the light.
+ */
+class EnvironmentLightSource : public LightSource {
+
+public:
+
+	/** \brief EnvironmentLightSource default constructor.
+	 *
+	 * A newly constructed EnvironmentLightSource has no image, and is black.
+	 */
+	EnvironmentLightSource();
+
+	/** \brief EnvironmentLightSource copy constructor.
+	 *
+	 * \param lightSource The EnvironmentLightSource to copy to \c this.
+	 */
+	EnvironmentLightSource(const EnvironmentLightSource& lightSource);
+
+	/** \brief EnvironmentLightSource destructor */
+	~EnvironmentLightSource();
+
+	/** \brief EnvironmentLightSource assignment operator.
+	 *
+	 * \param lightSource The EnvironmentLightSource to copy to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	const EnvironmentLightSource& operator=(const EnvironmentLightSource& lightSource);
+
+	/** \brief Read the image, and build the tables for sampling it.
+	 *
+	 * \param filename The name of the file of floating point RGB values.
+	 * \param width The number of pixels in each row.
+	 * \param height The number of rows.
+	 */
+	void load(const std::string& filename, size_t width, size_t height);
+
+	/** \brief Determine how much light reaches a Point.
+	 *
+	 * The light does not fade with distance, so this is always 1.
+	 *
+	 * \param point The Point at which light is measured.
+	 * \return The proportion of the base illumination that reaches the Point.
+	 */
+	double getIntensityAt(const Point& point) const;
+
+	/** \brief Determine the light arriving at a Point.
+	 *
+	 * This is a single sample from the middle of the sampling tables, and is
+	 * only used if \c samples is 1.
+	 *
+	 * \param point The Point at which light is measured.
+	 * \return The Direction, distance, and amount of light arriving at the Point.
+	 */
+	LightSample sample(const Point& point) const;
+
+	/** \brief The size of the sample grid.
+	 *
+	 * \return The samples property.
+	 */
+	unsigned int sampleGrid() const;
+
+	/** \brief Determine the light arriving at a Point from one part of the sky.
+	 *
+	 * The co-ordinates are mapped to a Direction through the sampling tables,
+	 * so that bright parts of the image are chosen more often. The intensity is
+	 * the radiance from that Direction divided by \f$\pi\f$ times the probability
+	 * density of choosing it, so that averaging the diffuse light from many
+	 * samples gives the same result as a PointLightSource would for the same
+	 * light. A sky of constant radiance \f$L\f$ lights an upward-facing surface
+	 * with intensity \f$L\f$.
+	 *
+	 * \param point The Point at which light is measured.
+	 * \param u The first co-ordinate of the sample, in [0,1).
+	 * \param v The second co-ordinate of the sample, in [0,1).
+	 * \return Light arriving from the chosen Direction, from an \c infinity distance.
+	 */
+	LightSample sampleAt(const Point& point, double u, double v) const;
+
+	/** \brief Whether the EnvironmentLightSource looks small from the Points it lights.
+	 *
+	 * \return false, as the light comes from all around, so every Point is shaded with the full sample grid.
+	 */
+	bool compact() const;
+
+	/** \brief Whether the EnvironmentLightSource is infinitely far away.
+	 *
+	 * \return true, as the sky surrounds the whole Scene.
+	 */
+	bool distant() const;
+
+	/** \brief Send out a photon from the sky.
+	 *
+	 * The Direction is chosen through the sampling tables, as for sampleAt(),
+	 * and the photon passes through a disc as wide as the sphere, facing that Direction.
+	 *
+	 * \param centre The middle of the sphere to send photons towards.
+	 * \param radius The radius of the sphere to send photons towards.
+	 * \param u The first co-ordinate of where on the disc the photon passes.
+	 * \param v The second co-ordinate of where on the disc the photon passes.
+	 * \param s The first co-ordinate of the part of the sky the photon comes from.
+	 * \param t The second co-ordinate of the part of the sky the photon comes from.
+	 * \param ray Set to where the photon starts, and its unit Direction.
+	 * \return The power of the photon.
+	 */
+	Colour emit(const Point& centre, double radius, double u, double v, double s, double t, Ray& ray) const;
+
+	/** \brief How likely sampleAt() is to choose a Direction.
+	 *
+	 * This is needed to weigh light found by sampling the EnvironmentLightSource
+	 * against light found by following Rays which miss everything (see Scene::tracePath()).
+	 *
+	 * \param direction The Direction. It need not be a unit Vector.
+	 * \return The probability density of sampleAt() choosing the Direction, per unit solid angle.
+	 */
+	double density(const Direction& direction) const;
+
+	/** \brief The Colour seen in a Direction.
+	 *
+	 * This is used for Rays which miss everything in the Scene, and is bilinearly
+	 * filtered between the pixels of the image.
+	 *
+	 * \param direction The Direction to look in. It need not be a unit Vector.
+	 * \return The radiance of the image in that Direction, scaled by \c colour.
+	 */
+	Colour background(const Direction& direction) const;
+
+	unsigned int samples; //!< Number of samples along each side of the sample grid, so samples*samples in all.
+
+private:
+
+	/** \brief One pixel of the image.
+	 *
+	 * \param x The column of the pixel, wrapping around.
+	 * \param y The row of the pixel, clamped to the image.
+	 * \return The radiance of the pixel.
+	 */
+	Colour pixel(long long x, long long y) const;
+
+	size_t width_;                 //!< Number of pixels in each row of the image.
+	size_t height_;                //!< Number of rows in the image.
+	std::vector<float> radiance_;  //!< The image, three values per pixel.
+	std::vector<double> rowSums_;  //!< Cumulative sums of the row weights, from 0 up to 1, with height_ + 1 entries.
+	std::vector<double> columnSums_; //!< Cumulative sums along each row, from 0 up to 1, with width_ + 1 entries per row.
+	double totalWeight_;           //!< The sum of the weights of all of the pixels.
+
+};
+
+#endif // ENVIRONMENT_LIGHT_SOURCE_H_INCLUDED
@@ -0,0 +1,59 @@
+/* $Rev: 250 $ */
+#include "Group.h"
+
+#include "utility.h"
+
+Group::Group() : Object(), children(), bvh_() {
+
+}
+
+Group::Group(const Group& group) : Object(group), children(group.children), bvh_(group.bvh_) {
+
+}
+
+Group::~Group() {
+
+}
+
+const Group& Group::operator=(const Group& group) {
+	if (this != &group) {
+		Object::operator=(group);
+		children = group.children;
+		bvh_ = group.bvh_;
+	}
+	return *this;
+}
+
+void Group::build() {
+	bvh_.build(children);
+}
+
+BoundingBox Group::getBounds() const {
+	BoundingBox bounds = bvh_.getBounds();
+	if (bounds.isInfinite()) {
+		return bounds;
+	}
+	return bounds.transformed(transform);
+}
+
+RayIntersectionList Group::intersect(const Ray& ray) const {
+	RayIntersectionList result;
+	Ray inverseRay = transform.applyInverse(ray);
+
+	// Distances of hits on the children are measured in the Group's
+	// co-ordinate frame, so epsilon is scaled to match
+	double scale = ray.direction.norm()/inverseRay.direction.norm();
+
+	RayIntersection nearest;
+	if (bvh_.intersect(inverseRay, epsilon/scale, nearest)) {
+		nearest.point = transform.apply(nearest.point);
+		nearest.normal = transform.apply(nearest.normal);
+		if (nearest.normal.dot(ray.direction) > 0) {
+			nearest.normal = -nearest.normal;
+		}
+		nearest.distance = (nearest.point - ray.point).norm();
+		nearest.textureScale /= scale;
+		result.push_back(nearest);
+	}
+	return result;
+}
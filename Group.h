@@ -0,0 +1,85 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef GROUP_H_INCLUDED
+#define GROUP_H_INCLUDED
+
+#include "BVH.h"
+#include "Object.h"
+
+/** 
+ * \file
+ * \brief Group class header file.
+ */
+
+/**
+ * \brief Class for Group objects.
+ *
+ * A Group collects any number of Objects together into one, so that they
+ * can be moved around as a unit through the Group's transform. Unlike a 
+ * CSG union, a Group does not work out which parts of its children are 
+ * inside each other. It just reports the nearest hit on any child, which
+ * is all that is needed to render an assembly of parts. 
+ *
+ * Since the Group only reports the nearest hit, it is not suitable as a 
+ * child of a CSG node, which needs to know every time a Ray crosses the 
+ * surface of its children.
+ *
+ * The children are organised in a BVH, which is built by build(). This
+ * must be called again after the children (or their transforms) change.
+ */
+class Group : public Object {
+
+public:
+
+	/** \brief Group default constructor.
+	 *
+	 * A newly constructed Group has no children.
+	 */
+	Group();
+
+	/** \brief Group copy constructor.
+	 *
+	 * \param group The Group to copy.
+	 */
+	Group(const Group& group);
+
+	/** \brief Group destructor. */
+	~Group();
+
+	/** \brief Group assignment operator.
+	 *
+	 * \param group The Group to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	const Group& operator=(const Group& group);
+
+	/** \brief Group-Ray intersection computation.
+	 *
+	 * The Ray is traced through the BVH, nearest boxes first, and the
+	 * nearest hit on any child is returned. Hits closer to the start of
+	 * the Ray than \c epsilon are ignored, as they are in Scene::intersect().
+	 *
+	 * \param ray The Ray to intersect with this Group.
+	 * \return A list (std::vector) containing the nearest intersection, or empty if there is none.
+	 */
+	RayIntersectionList intersect(const Ray& ray) const;
+
+	/** \brief Bounds of the Group.
+	 *
+	 * \return A BoundingBox containing all of the children.
+	 */
+	BoundingBox getBounds() const;
+
+	/** \brief Build the BVH over the children. */
+	void build();
+
+	std::vector<std::shared_ptr<Object>> children; //!< The Objects in the Group.
+
+private:
+
+	BVH bvh_; //!< The BVH over the children.
+
+};
+
+#endif // GROUP_H_INCLUDED
@@ -0,0 +1,391 @@
+/* $Rev: 250 $ */
+#include "Heightfield.h"
+
+#include "utility.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+const size_t Heightfield::blockSize;
+
+// Slab test of a Ray against a box, as in BoundingBox::intersect(), but
+// working on plain arrays so that nothing is allocated during traversal
+static bool intersectBox(const double origin[3], const double direction[3],
+                         const double lo[3], const double hi[3], double& tNear, double& tFar) {
+	tNear = 0;
+	tFar = infinity;
+	for (int i = 0; i < 3; ++i) {
+		if (std::abs(direction[i]) < epsilon*epsilon) {
+			// Parallel to this slab, so must start inside it
+			if (origin[i] < lo[i] || origin[i] > hi[i]) return false;
+			continue;
+		}
+		double t0 = (lo[i] - origin[i])/direction[i];
+		double t1 = (hi[i] - origin[i])/direction[i];
+		if (t0 > t1) std::swap(t0, t1);
+		if (t0 > tNear) tNear = t0;
+		if (t1 < tFar) tFar = t1;
+		if (tNear > tFar) return false;
+	}
+	return true;
+}
+
+// Moller-Trumbore Ray-triangle intersection, giving the distance along the
+// Ray and the barycentric co-ordinates (b1, b2) of the hit
+static bool intersectTriangle(const double origin[3], const double direction[3],
+                              const double p0[3], const double p1[3], const double p2[3],
+                              double& t, double& b1, double& b2) {
+	// Hits just outside the triangle are allowed, so that Rays cannot slip
+	// between neighbouring triangles because of rounding errors
+	const double tolerance = 1e-9;
+
+	double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+	double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+	double p[3] = {direction[1]*e2[2] - direction[2]*e2[1],
+	               direction[2]*e2[0] - direction[0]*e2[2],
+	               direction[0]*e2[1] - direction[1]*e2[0]};
+	double det = e1[0]*p[0] + e1[1]*p[1] + e1[2]*p[2];
+	if (det == 0) {
+		return false;
+	}
+	double inverseDet = 1/det;
+	double s[3] = {origin[0] - p0[0], origin[1] - p0[1], origin[2] - p0[2]};
+	b1 = (s[0]*p[0] + s[1]*p[1] + s[2]*p[2])*inverseDet;
+	if (b1 < -tolerance || b1 > 1 + tolerance) {
+		return false;
+	}
+	double q[3] = {s[1]*e1[2] - s[2]*e1[1],
+	               s[2]*e1[0] - s[0]*e1[2],
+	               s[0]*e1[1] - s[1]*e1[0]};
+	b2 = (direction[0]*q[0] + direction[1]*q[1] + direction[2]*q[2])*inverseDet;
+	if (b2 < -tolerance || b1 + b2 > 1 + tolerance) {
+		return false;
+	}
+	t = (e2[0]*q[0] + e2[1]*q[1] + e2[2]*q[2])*inverseDet;
+	return true;
+}
+
+Heightfield::Heightfield() : Object(), width_(0), depth_(0), heights_(),
+levels_(), levelWidth_(), levelDepth_() {
+
+}
+
+Heightfield::Heightfield(const Heightfield& heightfield) : Object(heightfield),
+width_(heightfield.width_), depth_(heightfield.depth_), heights_(heightfield.heights_),
+levels_(heightfield.levels_), levelWidth_(heightfield.levelWidth_), levelDepth_(heightfield.levelDepth_) {
+
+}
+
+Heightfield::~Heightfield() {
+
+}
+
+const Heightfield& Heightfield::operator=(const Heightfield& heightfield) {
+	if (this != &heightfield) {
+		Object::operator=(heightfield);
+		width_ = heightfield.width_;
+		depth_ = heightfield.depth_;
+		heights_ = heightfield.heights_;
+		levels_ = heightfield.levels_;
+		levelWidth_ = heightfield.levelWidth_;
+		levelDepth_ = heightfield.levelDepth_;
+	}
+	return *this;
+}
+
+void Heightfield::load(const std::string& filename, size_t width, size_t depth, heightfield_format format) {
+	if (width < 2 || depth < 2) {
+		std::cerr << "Heightfield '" << filename << "' needs at least 2x2 samples" << std::endl;
+		exit(-1);
+	}
+	std::ifstream fin(filename, std::ios::binary);
+	if (!fin) {
+		std::cerr << "Cannot open heightfield file '" << filename << "'" << std::endl;
+		exit(-1);
+	}
+
+	std::vector<float> heights(width*depth);
+	if (format == HEIGHTFIELD_FLOAT) {
+		fin.read(reinterpret_cast<char*>(heights.data()), heights.size()*sizeof(float));
+	} else {
+		// Converted a row at a time, so there is never a second copy of the whole grid
+		std::vector<uint16_t> row(width);
+		for (size_t j = 0; j < depth && fin; ++j) {
+			fin.read(reinterpret_cast<char*>(row.data()), width*sizeof(uint16_t));
+			for (size_t i = 0; i < width; ++i) {
+				heights[j*width + i] = row[i]/65535.0f;
+			}
+		}
+	}
+	if (!fin) {
+		std::cerr << "Heightfield file '" << filename << "' is too short for " << width << "x" << depth << " samples" << std::endl;
+		exit(-1);
+	}
+
+	width_ = width;
+	depth_ = depth;
+	heights_.swap(heights);
+	build();
+}
+
+void Heightfield::setHeights(size_t width, size_t depth, const std::vector<float>& heights) {
+	if (width < 2 || depth < 2 || heights.size() != width*depth) {
+		std::cerr << "Heightfield needs at least 2x2 samples, and width x depth of them" << std::endl;
+		exit(-1);
+	}
+	width_ = width;
+	depth_ = depth;
+	heights_ = heights;
+	build();
+}
+
+void Heightfield::build() {
+	levels_.clear();
+	levelWidth_.clear();
+	levelDepth_.clear();
+
+	// Ranges for each block of cells, including the samples on their far edges
+	size_t cellsX = width_ - 1;
+	size_t cellsZ = depth_ - 1;
+	size_t nx = (cellsX + blockSize - 1)/blockSize;
+	size_t nz = (cellsZ + blockSize - 1)/blockSize;
+	std::vector<Range> blocks(nx*nz);
+	for (size_t bj = 0; bj < nz; ++bj) {
+		for (size_t bi = 0; bi < nx; ++bi) {
+			Range& range = blocks[bj*nx + bi];
+			range.min = std::numeric_limits<float>::max();
+			range.max = -std::numeric_limits<float>::max();
+			for (size_t j = bj*blockSize; j <= std::min((bj + 1)*blockSize, cellsZ); ++j) {
+				for (size_t i = bi*blockSize; i <= std::min((bi + 1)*blockSize, cellsX); ++i) {
+					range.min = std::min(range.min, heights_[j*width_ + i]);
+					range.max = std::max(range.max, heights_[j*width_ + i]);
+				}
+			}
+		}
+	}
+	levels_.push_back(std::move(blocks));
+	levelWidth_.push_back(nx);
+	levelDepth_.push_back(nz);
+
+	// Each level above combines 2x2 nodes of the one below, up to a single root
+	while (nx > 1 || nz > 1) {
+		size_t px = (nx + 1)/2;
+		size_t pz = (nz + 1)/2;
+		std::vector<Range> parents(px*pz, Range{std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()});
+		const std::vector<Range>& children = levels_.back();
+		for (size_t j = 0; j < nz; ++j) {
+			for (size_t i = 0; i < nx; ++i) {
+				Range& parent = parents[(j/2)*px + i/2];
+				parent.min = std::min(parent.min, children[j*nx + i].min);
+				parent.max = std::max(parent.max, children[j*nx + i].max);
+			}
+		}
+		levels_.push_back(std::move(parents));
+		levelWidth_.push_back(px);
+		levelDepth_.push_back(pz);
+		nx = px;
+		nz = pz;
+	}
+}
+
+double Heightfield::height(size_t i, size_t j) const {
+	return heights_[j*width_ + i];
+}
+
+void Heightfield::sampleNormal(size_t i, size_t j, double normal[3]) const {
+	size_t i0 = i > 0 ? i - 1 : i;
+	size_t i1 = i + 1 < width_ ? i + 1 : i;
+	size_t j0 = j > 0 ? j - 1 : j;
+	size_t j1 = j + 1 < depth_ ? j + 1 : j;
+	normal[0] = -(height(i1, j) - height(i0, j))/(i1 - i0);
+	normal[1] = 1;
+	normal[2] = -(height(i, j1) - height(i, j0))/(j1 - j0);
+}
+
+BoundingBox Heightfield::getBounds() const {
+	if (levels_.empty()) {
+		return BoundingBox();
+	}
+	const Range& root = levels_.back()[0];
+	// Padded slightly in y, so that Rays do not slip through the box of a flat Heightfield
+	return BoundingBox(Point(0, root.min - epsilon, 0), Point(1, root.max + epsilon, 1)).transformed(transform);
+}
+
+bool Heightfield::intersectBlock(const double origin[3], const double direction[3], size_t bi, size_t bj,
+                                 double tNear, double tFar, double minT, double& t, double normal[3]) const {
+	// Cells covered by the block are [u0, u1) x [v0, v1)
+	size_t u0 = bi*blockSize;
+	size_t u1 = std::min(u0 + blockSize, width_ - 1);
+	size_t v0 = bj*blockSize;
+	size_t v1 = std::min(v0 + blockSize, depth_ - 1);
+
+	double u = origin[0] + tNear*direction[0];
+	double v = origin[2] + tNear*direction[2];
+	size_t ci = size_t(std::min(std::max(std::floor(u), double(u0)), double(u1 - 1)));
+	size_t cj = size_t(std::min(std::max(std::floor(v), double(v0)), double(v1 - 1)));
+
+	// Distances along the Ray to the next cell boundary, and between boundaries
+	double tMaxU = infinity;
+	double tDeltaU = infinity;
+	if (direction[0] != 0) {
+		double boundary = direction[0] > 0 ? ci + 1 : ci;
+		tMaxU = (boundary - origin[0])/direction[0];
+		tDeltaU = std::abs(1/direction[0]);
+	}
+	double tMaxV = infinity;
+	double tDeltaV = infinity;
+	if (direction[2] != 0) {
+		double boundary = direction[2] > 0 ? cj + 1 : cj;
+		tMaxV = (boundary - origin[2])/direction[2];
+		tDeltaV = std::abs(1/direction[2]);
+	}
+
+	while (true) {
+		// Each cell is split into triangles (a, b, c) and (a, c, d)
+		double a[3] = {double(ci), height(ci, cj), double(cj)};
+		double b[3] = {double(ci + 1), height(ci + 1, cj), double(cj)};
+		double c[3] = {double(ci + 1), height(ci + 1, cj + 1), double(cj + 1)};
+		double d[3] = {double(ci), height(ci, cj + 1), double(cj + 1)};
+
+		bool found = false;
+		double hitT, b1, b2;
+		double corners[3][2];
+		if (intersectTriangle(origin, direction, a, b, c, hitT, b1, b2) && hitT > minT) {
+			t = hitT;
+			found = true;
+			corners[1][0] = b[0]; corners[1][1] = b[2];
+			corners[2][0] = c[0]; corners[2][1] = c[2];
+		}
+		double b1Second, b2Second;
+		if (intersectTriangle(origin, direction, a, c, d, hitT, b1Second, b2Second) && hitT > minT && (!found || hitT < t)) {
+			t = hitT;
+			found = true;
+			b1 = b1Second;
+			b2 = b2Second;
+			corners[1][0] = c[0]; corners[1][1] = c[2];
+			corners[2][0] = d[0]; corners[2][1] = d[2];
+		}
+		if (found) {
+			// Interpolate the normals at the triangle's corners
+			double na[3], n1[3], n2[3];
+			sampleNormal(ci, cj, na);
+			sampleNormal(size_t(corners[1][0]), size_t(corners[1][1]), n1);
+			sampleNormal(size_t(corners[2][0]), size_t(corners[2][1]), n2);
+			for (int k = 0; k < 3; ++k) {
+				normal[k] = (1 - b1 - b2)*na[k] + b1*n1[k] + b2*n2[k];
+			}
+			return true;
+		}
+
+		// Step to the next cell, stopping at the edge of the block
+		if (tMaxU < tMaxV) {
+			if (tMaxU > tFar) break;
+			if (direction[0] > 0 ? ci + 1 >= u1 : ci == u0) break;
+			ci = direction[0] > 0 ? ci + 1 : ci - 1;
+			tMaxU += tDeltaU;
+		} else {
+			if (tMaxV > tFar) break;
+			if (direction[2] > 0 ? cj + 1 >= v1 : cj == v0) break;
+			cj = direction[2] > 0 ? cj + 1 : cj - 1;
+			tMaxV += tDeltaV;
+		}
+	}
+	return false;
+}
+
+RayIntersectionList Heightfield::intersect(const Ray& ray) const {
+	RayIntersectionList result;
+	if (levels_.empty()) {
+		return result;
+	}
+
+	Ray inverseRay = transform.applyInverse(ray);
+
+	// The Ray in grid units, where each cell is 1x1
+	double cellsX = double(width_ - 1);
+	double cellsZ = double(depth_ - 1);
+	double origin[3] = {inverseRay.point(0)*cellsX, inverseRay.point(1), inverseRay.point(2)*cellsZ};
+	double direction[3] = {inverseRay.direction(0)*cellsX, inverseRay.direction(1), inverseRay.direction(2)*cellsZ};
+
+	// Distances along the Ray are in units of its direction in every frame
+	double minT = epsilon/ray.direction.norm();
+
+	// Nodes still to visit, with the distances at which the Ray enters and leaves them
+	struct Entry {
+		size_t level;
+		size_t i;
+		size_t j;
+		double tNear;
+		double tFar;
+	};
+	auto enter = [&](size_t level, size_t i, size_t j, Entry& entry) {
+		const Range& range = levels_[level][j*levelWidth_[level] + i];
+		size_t size = blockSize << level;
+		double pad = epsilon*(1 + std::max(std::abs(range.min), std::abs(range.max)));
+		double lo[3] = {double(i*size), range.min - pad, double(j*size)};
+		double hi[3] = {std::min(double((i + 1)*size), cellsX), range.max + pad, std::min(double((j + 1)*size), cellsZ)};
+		entry = Entry{level, i, j, 0, 0};
+		return intersectBox(origin, direction, lo, hi, entry.tNear, entry.tFar);
+	};
+
+	// Nodes are visited nearest first, so the first hit found is the nearest.
+	// Each level leaves at most three siblings on the stack.
+	Entry stack[3*64 + 1];
+	size_t stackSize = 0;
+	if (enter(levels_.size() - 1, 0, 0, stack[0])) {
+		stackSize = 1;
+	}
+
+	double t;
+	double normal[3];
+	bool found = false;
+	while (stackSize > 0 && !found) {
+		Entry entry = stack[--stackSize];
+		if (entry.tFar <= minT) {
+			continue;
+		}
+		if (entry.level == 0) {
+			found = intersectBlock(origin, direction, entry.i, entry.j, entry.tNear, entry.tFar, minT, t, normal);
+			continue;
+		}
+		Entry children[4];
+		size_t count = 0;
+		size_t level = entry.level - 1;
+		for (size_t j = 2*entry.j; j < std::min(2*entry.j + 2, levelDepth_[level]); ++j) {
+			for (size_t i = 2*entry.i; i < std::min(2*entry.i + 2, levelWidth_[level]); ++i) {
+				if (enter(level, i, j, children[count])) {
+					++count;
+				}
+			}
+		}
+		// Push the nearest child last, so that it is visited first
+		for (size_t k = 1; k < count; ++k) {
+			for (size_t m = k; m > 0 && children[m].tNear > children[m-1].tNear; --m) {
+				std::swap(children[m], children[m-1]);
+			}
+		}
+		for (size_t k = 0; k < count; ++k) {
+			stack[stackSize++] = children[k];
+		}
+	}
+
+	if (found) {
+		RayIntersection hit;
+		hit.material = material;
+		Point local(inverseRay.point + t*inverseRay.direction);
+		hit.point = transform.apply(local);
+		hit.normal = transform.apply(Normal(normal[0]*cellsX, normal[1], normal[2]*cellsZ));
+		hit.u = local(0);
+		hit.v = local(2);
+		hit.textureScale = inverseRay.direction.norm()/ray.direction.norm();
+		hit.spherical = false;
+		if (hit.normal.dot(ray.direction) > 0) {
+			hit.normal = -hit.normal;
+		}
+		hit.distance = (hit.point - ray.point).norm();
+		result.push_back(hit);
+	}
+	return result;
+}
@@ -0,0 +1,173 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef HEIGHTFIELD_H_INCLUDED
+#define HEIGHTFIELD_H_INCLUDED
+
+#include "Object.h"
+
+#include <string>
+
+/**
+ * \file
+ * \brief Heightfield class header file.
+ */
+
+/**
+ * \brief Formats of height data which can be loaded into a Heightfield.
+ *
+ * Both formats are raw arrays of samples in the machine's byte order, with
+ * no header, stored a row at a time.
+ */
+enum heightfield_format {
+	HEIGHTFIELD_UINT16, //!< Unsigned 16 bit integers, scaled so that 65535 is a height of 1.
+	HEIGHTFIELD_FLOAT   //!< 32 bit floating point heights.
+};
+
+/**
+ * \brief Class for Heightfield objects.
+ *
+ * A Heightfield is a terrain surface given by a grid of height samples.
+ * The grid covers the unit square \f$0 \le x,z \le 1\f$, with the samples
+ * giving the height \f$y\f$ at each grid point. Each grid cell is made of
+ * two triangles, with normals interpolated across them so that the
+ * terrain looks smooth. As with other Objects, the Heightfield can be moved,
+ * rotated, and scaled through its transform member. A Texture is draped
+ * over the whole grid, with texture co-ordinates \f$(x, z)\f$.
+ *
+ * Only one height is stored for each sample, so very large grids can be
+ * rendered without building a mesh. To avoid testing a Ray against every
+ * cell it passes over, the cells are grouped into blocks, and a quadtree
+ * of blocks records the minimum and maximum height below each node. A Ray
+ * descends the quadtree nearest nodes first, skipping any node whose range
+ * of heights it passes above or below, and steps through the cells of each
+ * block it reaches with a 2D DDA (digital differential analyser).
+ *
+ * Like a Group, a Heightfield only reports the nearest hit, so it should
+ * not be used as a child of a CSG node.
+ */
+class Heightfield : public Object {
+
+public:
+
+	/** \brief Heightfield default constructor.
+	 *
+	 * A newly constructed Heightfield has no height data, and so cannot be
+	 * seen until some is provided by load() or setHeights().
+	 */
+	Heightfield();
+
+	/** \brief Heightfield copy constructor.
+	 *
+	 * \param heightfield The Heightfield to copy.
+	 */
+	Heightfield(const Heightfield& heightfield);
+
+	/** \brief Heightfield destructor. */
+	~Heightfield();
+
+	/** \brief Heightfield assignment operator.
+	 *
+	 * \param heightfield The Heightfield to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	const Heightfield& operator=(const Heightfield& heightfield);
+
+	/** \brief Load height data from a file.
+	 *
+	 * The file is a raw array of \c width x \c depth samples, with \c width
+	 * samples (along the x axis) in each row, and one row for each step
+	 * along the z axis. If the file cannot be read the program exits with
+	 * an error.
+	 *
+	 * \param filename The file to read.
+	 * \param width The number of samples along the x axis, at least 2.
+	 * \param depth The number of samples along the z axis, at least 2.
+	 * \param format The format of the samples.
+	 */
+	void load(const std::string& filename, size_t width, size_t depth, heightfield_format format);
+
+	/** \brief Set the height data directly.
+	 *
+	 * \param width The number of samples along the x axis, at least 2.
+	 * \param depth The number of samples along the z axis, at least 2.
+	 * \param heights The \c width x \c depth samples, stored a row at a time.
+	 */
+	void setHeights(size_t width, size_t depth, const std::vector<float>& heights);
+
+	/** \brief Heightfield-Ray intersection computation.
+	 *
+	 * The Ray is traced through the quadtree, and the nearest hit is
+	 * returned. Hits closer to the start of the Ray than \c epsilon are
+	 * ignored, as they are in Scene::intersect().
+	 *
+	 * \param ray The Ray to intersect with this Heightfield.
+	 * \return A list (std::vector) containing the nearest intersection, or empty if there is none.
+	 */
+	RayIntersectionList intersect(const Ray& ray) const;
+
+	/** \brief Bounds of the Heightfield.
+	 *
+	 * \return A BoundingBox containing the Heightfield.
+	 */
+	BoundingBox getBounds() const;
+
+private:
+
+	/** \brief The lowest and highest heights below a quadtree node. */
+	struct Range {
+		float min; //!< Lowest height.
+		float max; //!< Highest height.
+	};
+
+	/** \brief Build the quadtree from the height data. */
+	void build();
+
+	/** \brief Height of a grid sample.
+	 *
+	 * \param i Index of the sample along the x axis.
+	 * \param j Index of the sample along the z axis.
+	 * \return The height of the sample.
+	 */
+	double height(size_t i, size_t j) const;
+
+	/** \brief Surface normal at a grid sample, in grid units.
+	 *
+	 * \param i Index of the sample along the x axis.
+	 * \param j Index of the sample along the z axis.
+	 * \param normal Set to the (unnormalised) normal, estimated from the neighbouring samples.
+	 */
+	void sampleNormal(size_t i, size_t j, double normal[3]) const;
+
+	/** \brief Intersect a Ray with the cells of one block.
+	 *
+	 * The Ray is given in grid units, where cell \f$(i,j)\f$ covers
+	 * \f$i \le u \le i+1\f$ and \f$j \le v \le j+1\f$.
+	 *
+	 * \param origin Start point of the Ray.
+	 * \param direction Direction of the Ray.
+	 * \param bi Index of the block along the x axis.
+	 * \param bj Index of the block along the z axis.
+	 * \param tNear Distance along the Ray at which it enters the block.
+	 * \param tFar Distance along the Ray at which it leaves the block.
+	 * \param minT Hits at or before this distance along the Ray are ignored.
+	 * \param t Set to the distance along the Ray of the nearest hit in the block, if there is one.
+	 * \param normal Set to the (unnormalised) normal at the hit, in grid units.
+	 * \return true if the Ray hits the surface in this block, false otherwise.
+	 */
+	bool intersectBlock(const double origin[3], const double direction[3], size_t bi, size_t bj,
+	                    double tNear, double tFar, double minT, double& t, double normal[3]) const;
+
+	size_t width_;               //!< Number of samples along the x axis.
+	size_t depth_;               //!< Number of samples along the z axis.
+	std::vector<float> heights_; //!< The height samples, a row at a time.
+
+	std::vector<std::vector<Range>> levels_; //!< Quadtree levels, from blocks of cells (0) up to the root.
+	std::vector<size_t> levelWidth_;         //!< Number of nodes along the x axis at each level.
+	std::vector<size_t> levelDepth_;         //!< Number of nodes along the z axis at each level.
+
+	static const size_t blockSize = 4; //!< Number of cells along each side of a block.
+
+};
+
+#endif // HEIGHTFIELD_H_INCLUDED
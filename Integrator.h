@@ -0,0 +1,272 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef INTEGRATOR_H_INCLUDED
+#define INTEGRATOR_H_INCLUDED
+
+#include "Colour.h"
+#include "Ray.h"
+#include "RayDifferential.h"
+#include "RayIntersection.h"
+#include "Scene.h"
+#include "utility.h"
+
+#include <algorithm>
+
+/**
+ * \file
+ * \brief Integrator policy classes header file.
+ *
+ * Each class here works out the Colour of one sample of a pixel, given the
+ * Ray from the Camera and its first hit, in one of the ways listed by
+ * integrator_type. Scene::render() chooses one of them once, and the pixel
+ * loop is instantiated separately for each (see Scene::renderImage()), so
+ * that there are no virtual calls or checks of the integrator inside it.
+ *
+ * Every integrator provides:
+ * - \c textured, which says whether the first hits need their Textures and
+ *   Patterns applied, and so whether the Rays need differentials. The debug
+ *   integrators do not, so they run at the speed of the intersection tests.
+ * - \c samples(), the number of samples to take in each pixel. With more than
+ *   one, they are spread at random across the pixel.
+ * - \c colour(), the Colour of one sample. Its random numbers come from the
+ *   Scene, reseeded for each sample, so renders are repeatable.
+ */
+
+/**
+ * \brief Whitted ray tracing, with direct light, ambient light, and mirror reflections.
+ */
+class WhittedIntegrator {
+
+public:
+
+	/** \brief WhittedIntegrator constructor.
+	 *
+	 * \param scene The Scene being rendered.
+	 */
+	explicit WhittedIntegrator(const Scene& scene) : scene_(scene) {}
+
+	static const bool textured = true; //!< The first hits need their Textures applied.
+
+	/** \brief The number of samples in each pixel.
+	 *
+	 * \return 1, through the middle of the pixel.
+	 */
+	unsigned int samples() const {
+		return 1;
+	}
+
+	/** \brief The Colour of one sample (see Scene::computeColour()).
+	 *
+	 * \param ray The Ray from the Camera.
+	 * \param hitPoint The first hit of the Ray, with its Textures applied.
+	 * \param differential The Ray's differentials at the hit.
+	 * \return The Colour seen along the Ray.
+	 */
+	Colour colour(const Ray& ray, const RayIntersection& hitPoint, const RayDifferential& differential) const {
+		return scene_.computeColour(ray, hitPoint, differential, scene_.maxRayDepth);
+	}
+
+private:
+
+	const Scene& scene_; //!< The Scene being rendered.
+
+};
+
+/**
+ * \brief Path tracing, with light bouncing between surfaces.
+ */
+class PathIntegrator {
+
+public:
+
+	/** \brief PathIntegrator constructor.
+	 *
+	 * \param scene The Scene being rendered.
+	 */
+	explicit PathIntegrator(const Scene& scene) : scene_(scene) {}
+
+	static const bool textured = true; //!< The first hits need their Textures applied.
+
+	/** \brief The number of samples in each pixel.
+	 *
+	 * \return The Scene's pixelSamples, or 1 if that is 0.
+	 */
+	unsigned int samples() const {
+		return std::max(scene_.pixelSamples, 1u);
+	}
+
+	/** \brief The Colour of one sample (see Scene::tracePath()).
+	 *
+	 * \param ray The Ray from the Camera.
+	 * \param hitPoint The first hit of the Ray, with its Textures applied.
+	 * \param differential The Ray's differentials at the hit.
+	 * \return An estimate of the light arriving along the Ray.
+	 */
+	Colour colour(const Ray& ray, const RayIntersection& hitPoint, const RayDifferential& differential) const {
+		return scene_.tracePath(ray, hitPoint, differential);
+	}
+
+private:
+
+	const Scene& scene_; //!< The Scene being rendered.
+
+};
+
+/**
+ * \brief Direct light and mirror reflections, with bounced diffuse light from an IrradianceCache.
+ */
+class IrradianceIntegrator {
+
+public:
+
+	/** \brief IrradianceIntegrator constructor.
+	 *
+	 * \param scene The Scene being rendered.
+	 */
+	explicit IrradianceIntegrator(const Scene& scene) : scene_(scene) {}
+
+	static const bool textured = true; //!< The first hits need their Textures applied.
+
+	/** \brief The number of samples in each pixel.
+	 *
+	 * \return The Scene's pixelSamples, or 1 if that is 0.
+	 */
+	unsigned int samples() const {
+		return std::max(scene_.pixelSamples, 1u);
+	}
+
+	/** \brief The Colour of one sample (see Scene::traceCached()).
+	 *
+	 * \param ray The Ray from the Camera.
+	 * \param hitPoint The first hit of the Ray, with its Textures applied.
+	 * \param differential The Ray's differentials at the hit.
+	 * \return The Colour seen along the Ray.
+	 */
+	Colour colour(const Ray& ray, const RayIntersection& hitPoint, const RayDifferential& differential) const {
+		return scene_.traceCached(ray, hitPoint, differential);
+	}
+
+private:
+
+	const Scene& scene_; //!< The Scene being rendered.
+
+};
+
+/**
+ * \brief Ambient occlusion only: how much of the sky each visible Point can see.
+ */
+class OcclusionIntegrator {
+
+public:
+
+	/** \brief OcclusionIntegrator constructor.
+	 *
+	 * \param scene The Scene being rendered.
+	 */
+	explicit OcclusionIntegrator(const Scene& scene) : scene_(scene) {}
+
+	static const bool textured = false; //!< Materials are not used, so neither are Textures.
+
+	/** \brief The number of samples in each pixel.
+	 *
+	 * \return 1, through the middle of the pixel.
+	 */
+	unsigned int samples() const {
+		return 1;
+	}
+
+	/** \brief The Colour of one sample (see Scene::occlusion()).
+	 *
+	 * \param ray The Ray from the Camera.
+	 * \param hitPoint The first hit of the Ray.
+	 * \return A grey level from black, fully hidden, to white, fully open, or black for a miss.
+	 */
+	Colour colour(const Ray& ray, const RayIntersection& hitPoint, const RayDifferential&) const {
+		if (hitPoint.distance == infinity) {
+			return Colour(0,0,0);
+		}
+		return scene_.occlusion(ray, hitPoint);
+	}
+
+private:
+
+	const Scene& scene_; //!< The Scene being rendered.
+
+};
+
+/**
+ * \brief Debug view of the surface Normals.
+ */
+class NormalIntegrator {
+
+public:
+
+	/** \brief NormalIntegrator constructor. */
+	explicit NormalIntegrator(const Scene&) {}
+
+	static const bool textured = false; //!< Materials are not used, so neither are Textures.
+
+	/** \brief The number of samples in each pixel.
+	 *
+	 * \return 1, through the middle of the pixel.
+	 */
+	unsigned int samples() const {
+		return 1;
+	}
+
+	/** \brief The Colour of one sample.
+	 *
+	 * \param hitPoint The first hit of the Ray.
+	 * \return The unit Normal at the hit, with X, Y, and Z mapped from [-1,1] to red, green, and blue in [0,1], or black for a miss.
+	 */
+	Colour colour(const Ray&, const RayIntersection& hitPoint, const RayDifferential&) const {
+		if (hitPoint.distance == infinity) {
+			return Colour(0,0,0);
+		}
+		double length = hitPoint.normal.norm();
+		return Colour(0.5 + 0.5*hitPoint.normal(0)/length, 0.5 + 0.5*hitPoint.normal(1)/length, 0.5 + 0.5*hitPoint.normal(2)/length);
+	}
+
+};
+
+/**
+ * \brief Debug view of the distance to the first hit.
+ */
+class DepthIntegrator {
+
+public:
+
+	/** \brief DepthIntegrator constructor.
+	 *
+	 * \param scene The Scene being rendered.
+	 */
+	explicit DepthIntegrator(const Scene& scene) : range_(scene.depthRange) {}
+
+	static const bool textured = false; //!< Materials are not used, so neither are Textures.
+
+	/** \brief The number of samples in each pixel.
+	 *
+	 * \return 1, through the middle of the pixel.
+	 */
+	unsigned int samples() const {
+		return 1;
+	}
+
+	/** \brief The Colour of one sample.
+	 *
+	 * \param hitPoint The first hit of the Ray.
+	 * \return A grey level from white, at the Camera, to black, at the Scene's depthRange and beyond.
+	 */
+	Colour colour(const Ray&, const RayIntersection& hitPoint, const RayDifferential&) const {
+		double grey = 1 - std::min(hitPoint.distance/range_, 1.0);
+		return Colour(grey, grey, grey);
+	}
+
+private:
+
+	double range_; //!< The distance which is shown as black.
+
+};
+
+#endif // INTEGRATOR_H_INCLUDED
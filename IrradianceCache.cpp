@@ -0,0 +1,366 @@
+/* $Rev: 250 $ */
+#include "IrradianceCache.h"
+
+#include "utility.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+const unsigned int IrradianceCache::maxDepth;
+
+// Marks a saved cache, and the layout of its records
+static const char cacheMagic[8] = {'R', 'T', 'I', 'R', 'C', '0', '0', '1'};
+
+IrradianceCache::IrradianceCache() : mutex_(), error_(0.2), size_(0), records_(), nodes_(), entries_(), root_(nullptr) {
+
+}
+
+IrradianceCache::IrradianceCache(const IrradianceCache& cache) : mutex_(), error_(0.2), size_(0), records_(), nodes_(), entries_(), root_(nullptr) {
+	*this = cache;
+}
+
+IrradianceCache::~IrradianceCache() {
+
+}
+
+IrradianceCache& IrradianceCache::operator=(const IrradianceCache& cache) {
+	if (this != &cache) {
+		std::lock(mutex_, cache.mutex_);
+		std::lock_guard<std::mutex> lock(mutex_, std::adopt_lock);
+		std::lock_guard<std::mutex> otherLock(cache.mutex_, std::adopt_lock);
+		// The octree points into the records, so it is built afresh rather than copied
+		root_ = nullptr;
+		entries_.clear();
+		nodes_.clear();
+		records_.clear();
+		size_ = 0;
+		error_ = cache.error_.load();
+		for (const Record& record : cache.records_) {
+			insert(record);
+		}
+	}
+	return *this;
+}
+
+void IrradianceCache::clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	root_ = nullptr;
+	entries_.clear();
+	nodes_.clear();
+	records_.clear();
+	size_ = 0;
+}
+
+size_t IrradianceCache::size() const {
+	return size_;
+}
+
+void IrradianceCache::setError(double error) {
+	error_ = error;
+}
+
+bool IrradianceCache::lookup(const Point& point, const Vector& normal, Colour& irradiance) const {
+	double p[3] = {point(0), point(1), point(2)};
+	double n[3] = {normal(0), normal(1), normal(2)};
+	double total[3] = {0, 0, 0};
+	double totalWeight = 0;
+	const double maxError = error_.load(std::memory_order_relaxed);
+
+	// No lock is needed, as each part of the octree is filled in before it is linked in
+	const Node* cube = root_.load(std::memory_order_acquire);
+	while (cube) {
+		for (const Entry* entry = cube->first.load(std::memory_order_acquire); entry; entry = entry->next.load(std::memory_order_acquire)) {
+			const Record& record = *entry->record;
+			double offset[3] = {p[0] - record.point[0], p[1] - record.point[1], p[2] - record.point[2]};
+			double distance = std::sqrt(offset[0]*offset[0] + offset[1]*offset[1] + offset[2]*offset[2]);
+			double cosine = n[0]*record.normal[0] + n[1]*record.normal[1] + n[2]*record.normal[2];
+			double error = distance/record.radius + std::sqrt(std::max(0.0, 1 - cosine));
+			if (error >= maxError) {
+				continue;
+			}
+			// Records in front of the Point see surfaces which the Point may not
+			double front = 0;
+			for (int a = 0; a < 3; ++a) {
+				front += offset[a]*(n[a] + record.normal[a])/2;
+			}
+			if (front < -0.01*record.radius) {
+				continue;
+			}
+			// Falls smoothly to zero at the edge of the record's area of validity
+			double weight = 1/std::max(error, epsilon) - 1/maxError;
+			double turn[3] = {
+				record.normal[1]*n[2] - record.normal[2]*n[1],
+				record.normal[2]*n[0] - record.normal[0]*n[2],
+				record.normal[0]*n[1] - record.normal[1]*n[0]
+			};
+			for (int c = 0; c < 3; ++c) {
+				double value = record.irradiance[c];
+				for (int a = 0; a < 3; ++a) {
+					value += turn[a]*record.rotation[c][a] + offset[a]*record.translation[c][a];
+				}
+				total[c] += weight*std::max(value, 0.0);
+			}
+			totalWeight += weight;
+		}
+		// Only the child containing the Point can hold more records which reach it
+		size_t child = 0;
+		for (int a = 0; a < 3; ++a) {
+			if (p[a] > cube->centre[a]) {
+				child |= size_t(1) << a;
+			}
+		}
+		cube = cube->children[child].load(std::memory_order_acquire);
+	}
+
+	if (totalWeight <= 0) {
+		return false;
+	}
+	irradiance = Colour(total[0]/totalWeight, total[1]/totalWeight, total[2]/totalWeight);
+	return true;
+}
+
+Vector IrradianceCache::direction(const Vector& normal, const Vector& tangent, const Vector& bitangent,
+	unsigned int row, unsigned int column, unsigned int rows, unsigned int columns, double u, double v) {
+	double sinTheta = std::sqrt((row + u)/rows);
+	double cosTheta = std::sqrt(std::max(0.0, 1 - sinTheta*sinTheta));
+	double phi = 2*M_PI*(column + v)/columns;
+	return sinTheta*std::cos(phi)*tangent + sinTheta*std::sin(phi)*bitangent + cosTheta*normal;
+}
+
+Colour IrradianceCache::add(const Point& point, const Vector& normal, const Vector& tangent, const Vector& bitangent,
+	unsigned int rows, unsigned int columns, const std::vector<Colour>& radiance, const std::vector<double>& distance,
+	double minRadius, double maxRadius) {
+	const unsigned int M = rows;
+	const unsigned int N = columns;
+	auto L = [&](unsigned int j, unsigned int k) -> const Colour& {
+		return radiance[j*N + (k % N)];
+	};
+	auto R = [&](unsigned int j, unsigned int k) -> double {
+		return distance[j*N + (k % N)];
+	};
+
+	Record record;
+	for (int a = 0; a < 3; ++a) {
+		record.point[a] = point(a);
+		record.normal[a] = normal(a);
+	}
+
+	// Each cell has the same weight, so the irradiance is their mean, and the
+	// mean distance is the harmonic mean, dominated by the nearest surfaces
+	Colour irradiance(0,0,0);
+	double inverseDistance = 0;
+	for (size_t i = 0; i < size_t(M)*N; ++i) {
+		irradiance += radiance[i];
+		if (distance[i] < infinity) {
+			inverseDistance += 1/distance[i];
+		}
+	}
+	irradiance = irradiance/(M*N);
+	double radius = inverseDistance > 0 ? M*N/inverseDistance : infinity;
+	record.irradiance[0] = irradiance.red;
+	record.irradiance[1] = irradiance.green;
+	record.irradiance[2] = irradiance.blue;
+
+	// Gradients from the differences between neighbouring cells (Ward and
+	// Heckbert, 1992), divided by pi as the irradiance is here
+	double rotation[3][3] = {{0}};
+	double translation[3][3] = {{0}};
+	for (unsigned int k = 0; k < N; ++k) {
+		double phi = 2*M_PI*(k + 0.5)/N;
+		double phiEdge = 2*M_PI*k/N;
+		// In the base plane: towards the middle of the column, at right angles to that, and at right angles to the column's edge.
+		// Turning the Normal towards u is a turn about v, so bright cells along u make the rotation gradient point along v.
+		Vector u = std::cos(phi)*tangent + std::sin(phi)*bitangent;
+		Vector v = -std::sin(phi)*tangent + std::cos(phi)*bitangent;
+		Vector vEdge = -std::sin(phiEdge)*tangent + std::cos(phiEdge)*bitangent;
+
+		Colour turn(0,0,0);
+		Colour along(0,0,0);
+		Colour around(0,0,0);
+		for (unsigned int j = 0; j < M; ++j) {
+			double sinMiddle = std::sqrt((j + 0.5)/M);
+			double tanMiddle = sinMiddle/std::sqrt(1 - (j + 0.5)/M);
+			turn += tanMiddle*L(j, k);
+
+			double sinLow = std::sqrt(double(j)/M);
+			double sinHigh = std::sqrt((j + 1.0)/M);
+			if (j > 0) {
+				// Across the edge between this row and the one nearer the Normal
+				double cosSquared = 1 - double(j)/M;
+				double nearest = std::min(R(j, k), R(j - 1, k));
+				if (nearest < infinity) {
+					along += (2*M_PI/N)*sinLow*cosSquared/nearest*(L(j, k) - L(j - 1, k));
+				}
+			}
+			// Across the edge between this column and the one before
+			double nearest = std::min(R(j, k), R(j, k + N - 1));
+			if (nearest < infinity) {
+				around += (sinHigh - sinLow)/nearest*(L(j, k) - L(j, k + N - 1));
+			}
+		}
+		double channels[3][3] = {
+			{turn.red, along.red, around.red}, {turn.green, along.green, around.green}, {turn.blue, along.blue, around.blue}
+		};
+		for (int c = 0; c < 3; ++c) {
+			for (int a = 0; a < 3; ++a) {
+				rotation[c][a] += v(a)*channels[c][0]/(M*N);
+				translation[c][a] += (u(a)*channels[c][1] + vEdge(a)*channels[c][2])/M_PI;
+			}
+		}
+	}
+	std::memcpy(record.rotation, rotation, sizeof(rotation));
+	std::memcpy(record.translation, translation, sizeof(translation));
+
+	// Where the light changes quickly, the record should not be used far
+	// enough away for the change to be more than the light itself
+	for (int c = 0; c < 3; ++c) {
+		double slope = std::sqrt(translation[c][0]*translation[c][0] + translation[c][1]*translation[c][1] +
+			translation[c][2]*translation[c][2]);
+		if (slope > 0 && record.irradiance[c] > 0) {
+			radius = std::min(radius, record.irradiance[c]/slope);
+		}
+	}
+	record.radius = std::max(minRadius, std::min(radius, std::min(maxRadius, 1/epsilon)));
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	insert(record);
+	return irradiance;
+}
+
+void IrradianceCache::insert(const Record& newRecord) {
+	records_.push_back(newRecord);
+	const Record& record = records_.back();
+	double reach = error_*record.radius;
+
+	Node* root = root_.load(std::memory_order_relaxed);
+	if (!root) {
+		root = newNode(record.point[0], record.point[1], record.point[2], std::max(2*reach, epsilon));
+	}
+	// Double the octree, keeping the old root as one of the eighths, until it holds the record's area
+	while (true) {
+		bool inside = true;
+		for (int a = 0; a < 3; ++a) {
+			inside = inside && std::abs(record.point[a] - root->centre[a]) + reach <= root->halfSize;
+		}
+		if (inside) {
+			break;
+		}
+		double centre[3];
+		size_t child = 0;
+		for (int a = 0; a < 3; ++a) {
+			if (record.point[a] < root->centre[a]) {
+				centre[a] = root->centre[a] - root->halfSize;
+				child |= size_t(1) << a;
+			} else {
+				centre[a] = root->centre[a] + root->halfSize;
+			}
+		}
+		Node* oldRoot = root;
+		root = newNode(centre[0], centre[1], centre[2], 2*oldRoot->halfSize);
+		root->children[child].store(oldRoot, std::memory_order_relaxed);
+	}
+	// Lookups which already have the old root carry on without the new one
+	root_.store(root, std::memory_order_release);
+
+	insert(root, &record, reach, 0);
+	++size_;
+}
+
+void IrradianceCache::insert(Node* node, const Record* record, double reach, unsigned int depth) {
+	if (node->halfSize <= 2*reach || depth == maxDepth) {
+		entries_.emplace_back();
+		Entry* entry = &entries_.back();
+		entry->record = record;
+		entry->next.store(nullptr, std::memory_order_relaxed);
+		if (node->last) {
+			node->last->next.store(entry, std::memory_order_release);
+		} else {
+			node->first.store(entry, std::memory_order_release);
+		}
+		node->last = entry;
+		return;
+	}
+	for (size_t child = 0; child < 8; ++child) {
+		double centre[3];
+		bool overlaps = true;
+		double quarter = node->halfSize/2;
+		for (int a = 0; a < 3; ++a) {
+			centre[a] = node->centre[a] + ((child >> a) & 1 ? quarter : -quarter);
+			overlaps = overlaps && std::abs(record->point[a] - centre[a]) <= quarter + reach;
+		}
+		if (!overlaps) {
+			continue;
+		}
+		Node* next = node->children[child].load(std::memory_order_relaxed);
+		if (!next) {
+			next = newNode(centre[0], centre[1], centre[2], quarter);
+			node->children[child].store(next, std::memory_order_release);
+		}
+		insert(next, record, reach, depth + 1);
+	}
+}
+
+IrradianceCache::Node* IrradianceCache::newNode(double x, double y, double z, double halfSize) {
+	nodes_.emplace_back();
+	Node* node = &nodes_.back();
+	node->centre[0] = x;
+	node->centre[1] = y;
+	node->centre[2] = z;
+	node->halfSize = halfSize;
+	for (std::atomic<Node*>& child : node->children) {
+		child.store(nullptr, std::memory_order_relaxed);
+	}
+	node->first.store(nullptr, std::memory_order_relaxed);
+	node->last = nullptr;
+	return node;
+}
+
+bool IrradianceCache::load(const std::string& filename) {
+	std::ifstream fin(filename, std::ios::binary);
+	if (!fin) {
+		return false;
+	}
+	char magic[8];
+	uint64_t count = 0;
+	fin.read(magic, 8);
+	fin.read(reinterpret_cast<char*>(&count), sizeof(count));
+	if (!fin || std::memcmp(magic, cacheMagic, 8) != 0) {
+		std::cerr << "File '" << filename << "' is not an irradiance cache" << std::endl;
+		exit(-1);
+	}
+	std::vector<Record> records(count);
+	fin.read(reinterpret_cast<char*>(records.data()), count*sizeof(Record));
+	if (!fin) {
+		std::cerr << "Irradiance cache file '" << filename << "' is too short" << std::endl;
+		exit(-1);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (const Record& record : records) {
+		insert(record);
+	}
+	return true;
+}
+
+void IrradianceCache::save(const std::string& filename) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	// Written under another name, so that an interrupted save does not spoil the last one
+	std::string tempFile = filename + ".tmp";
+	std::ofstream fout(tempFile, std::ios::binary | std::ios::trunc);
+	uint64_t count = records_.size();
+	fout.write(cacheMagic, 8);
+	fout.write(reinterpret_cast<const char*>(&count), sizeof(count));
+	for (const Record& record : records_) {
+		fout.write(reinterpret_cast<const char*>(&record), sizeof(Record));
+	}
+	fout.close();
+	if (!fout || std::rename(tempFile.c_str(), filename.c_str()) != 0) {
+		std::cerr << "Could not write irradiance cache file '" << filename << "'" << std::endl;
+		exit(-1);
+	}
+}
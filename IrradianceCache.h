@@ -0,0 +1,252 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef IRRADIANCE_CACHE_H_INCLUDED
+#define IRRADIANCE_CACHE_H_INCLUDED
+
+#include "Colour.h"
+#include "Point.h"
+#include "Vector.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * \file
+ * \brief IrradianceCache class header file.
+ */
+
+/**
+ * \brief A store of indirect diffuse light, sampled sparsely and reused between nearby Points.
+ *
+ * Light which has bounced off other surfaces changes slowly across a diffuse
+ * surface, except near other Objects, so there is no need to gather it afresh
+ * at every Point. This is Ward's irradiance cache. Each record holds the
+ * irradiance gathered at one Point, found by sampling the hemisphere above it
+ * in a grid of cells, along with:
+ * - the harmonic mean of the distances to the surfaces seen from the Point,
+ *   which says how far away the irradiance can be trusted (cut down where
+ *   the irradiance changes quickly), and
+ * - gradients of the irradiance with respect to moving and turning the
+ *   surface, estimated from the same samples (Ward and Heckbert, 1992).
+ *
+ * The irradiance at a Point is interpolated from the records whose error
+ * estimate there is below a bound,
+ * \f[ \epsilon_i = \frac{\|\mathbf{p} - \mathbf{p}_i\|}{R_i} + \sqrt{1 - \hat{\mathbf{n}}\cdot\hat{\mathbf{n}}_i} < a, \f]
+ * where \f$R_i\f$ is the mean distance and \f$a\f$ is the \c error property,
+ * and each record is extrapolated along its gradients. If there are none,
+ * a new record must be gathered. Smaller errors give more records and
+ * more accurate light.
+ *
+ * Records are found through an octree, which grows to fit them, so the
+ * Scene need not be bounded. Each record is stored in every node which its
+ * area of validity overlaps, at a depth where the nodes are about as large
+ * as that area, so only the nodes containing a Point need to be searched.
+ *
+ * The IrradianceCache may be used from several threads at once. Lookups are
+ * far more common than new records, so they take no lock. Records, nodes,
+ * and each node's list of records are only ever added to, and are kept where
+ * they are once made, so a lookup can follow the octree while a record is
+ * added. Each new part is filled in before it is linked in, so a lookup sees
+ * a new record in all, some, or none of its nodes, which is no worse than if
+ * the lookup had come a little earlier. Only threads adding records take the
+ * lock, one at a time. Records can be saved to a file and loaded again, so
+ * the cache can be carried from one frame of an animation to the next, as
+ * long as the Objects do not move.
+ */
+class IrradianceCache {
+
+public:
+
+	/** \brief IrradianceCache default constructor.
+	 *
+	 * A newly constructed IrradianceCache is empty, with an \c error of 0.2.
+	 */
+	IrradianceCache();
+
+	/** \brief IrradianceCache copy constructor.
+	 *
+	 * The records are copied, and put into a new octree.
+	 *
+	 * \param cache The IrradianceCache to copy.
+	 */
+	IrradianceCache(const IrradianceCache& cache);
+
+	/** \brief IrradianceCache destructor. */
+	~IrradianceCache();
+
+	/** \brief IrradianceCache assignment operator.
+	 *
+	 * The records are copied, and put into a new octree. This, like clear(),
+	 * must not be called while \c this is being used by other threads.
+	 *
+	 * \param cache The IrradianceCache to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	IrradianceCache& operator=(const IrradianceCache& cache);
+
+	/** \brief Remove all of the records.
+	 *
+	 * This must not be called while other threads are using the IrradianceCache.
+	 */
+	void clear();
+
+	/** \brief The number of records held.
+	 *
+	 * \return The number of records.
+	 */
+	size_t size() const;
+
+	/** \brief Set the largest error allowed when reusing a record.
+	 *
+	 * This only affects records added afterwards, and lookups.
+	 *
+	 * \param error The bound on the error estimate, \f$a\f$ above.
+	 */
+	void setError(double error);
+
+	/** \brief Interpolate the irradiance at a Point from the records near it.
+	 *
+	 * This takes no lock, and may be called by any number of threads while
+	 * others add records.
+	 *
+	 * \param point The Point.
+	 * \param normal The unit Normal of the surface at the Point.
+	 * \param irradiance Set to the irradiance, if any records can be used.
+	 * \return true if any records can be used, false if a new record is needed.
+	 */
+	bool lookup(const Point& point, const Vector& normal, Colour& irradiance) const;
+
+	/** \brief Add a record from a grid of samples of the hemisphere above a Point.
+	 *
+	 * The hemisphere is cut into \c rows cells by angle from the Normal, and
+	 * \c columns cells around it. Row \f$j\f$ runs from \f$\sin^2\theta = j/\mathrm{rows}\f$
+	 * to \f$\sin^2\theta = (j+1)/\mathrm{rows}\f$, so that each cell covers an
+	 * equal share of the cosine-weighted hemisphere, and column \f$k\f$ runs from
+	 * \f$\phi = 2\pi k/\mathrm{columns}\f$ to \f$\phi = 2\pi(k+1)/\mathrm{columns}\f$, measured
+	 * from the tangent towards the bitangent. One sample is taken in each cell
+	 * (see direction()).
+	 *
+	 * \param point The Point.
+	 * \param normal The unit Normal of the surface at the Point.
+	 * \param tangent A unit Vector at right angles to the Normal.
+	 * \param bitangent The cross product of the Normal and tangent.
+	 * \param rows The number of rows of cells.
+	 * \param columns The number of columns of cells.
+	 * \param radiance The light seen in each cell, a row at a time.
+	 * \param distance The distance to the surface seen in each cell, or \c infinity if there is none.
+	 * \param minRadius The smallest mean distance to allow, so that records are not too closely packed.
+	 * \param maxRadius The largest mean distance to allow, so that records are not too sparse.
+	 * \return The irradiance at the Point, scaled so that a diffuse surface reflects it times its diffuseColour.
+	 */
+	Colour add(const Point& point, const Vector& normal, const Vector& tangent, const Vector& bitangent,
+		unsigned int rows, unsigned int columns, const std::vector<Colour>& radiance, const std::vector<double>& distance,
+		double minRadius, double maxRadius);
+
+	/** \brief The Direction of the sample in a cell of the hemisphere.
+	 *
+	 * \param normal The unit Normal of the surface.
+	 * \param tangent A unit Vector at right angles to the Normal.
+	 * \param bitangent The cross product of the Normal and tangent.
+	 * \param row The row of the cell.
+	 * \param column The column of the cell.
+	 * \param rows The number of rows of cells.
+	 * \param columns The number of columns of cells.
+	 * \param u Where in the cell to sample, from 0 to 1 across the row.
+	 * \param v Where in the cell to sample, from 0 to 1 across the column.
+	 * \return A unit Vector in the cell.
+	 */
+	static Vector direction(const Vector& normal, const Vector& tangent, const Vector& bitangent,
+		unsigned int row, unsigned int column, unsigned int rows, unsigned int columns, double u, double v);
+
+	/** \brief Read records from a file written by save().
+	 *
+	 * The records are added to any already held. A missing file is taken
+	 * to be empty.
+	 *
+	 * \param filename The name of the file.
+	 * \return true if the file was read, false if there is no such file.
+	 */
+	bool load(const std::string& filename);
+
+	/** \brief Write all of the records to a file.
+	 *
+	 * \param filename The name of the file.
+	 */
+	void save(const std::string& filename) const;
+
+private:
+
+	/** \brief The irradiance gathered at one Point. */
+	struct Record {
+		double point[3];       //!< Where the irradiance was gathered.
+		double normal[3];      //!< The unit Normal there.
+		double irradiance[3];  //!< The red, green, and blue irradiance.
+		double radius;         //!< Harmonic mean distance to the surfaces seen from the Point.
+		double rotation[3][3]; //!< Rate of change of each component with turning the Normal, as a Vector.
+		double translation[3][3]; //!< Rate of change of each component with moving the Point, as a Vector.
+	};
+
+	/** \brief A link in a node's list of records. */
+	struct Entry {
+		const Record* record;       //!< The record.
+		std::atomic<Entry*> next;   //!< The next link, or null at the end of the list.
+	};
+
+	/** \brief A cube of space in the octree. */
+	struct Node {
+		double centre[3];               //!< The middle of the cube.
+		double halfSize;                //!< Half the length of the cube's sides.
+		std::atomic<Node*> children[8]; //!< The eighths of the cube, or null; child \c i is on the positive side along axis \c a if bit \c a of \c i is set.
+		std::atomic<Entry*> first;      //!< The first of the records whose areas of validity overlap the cube, or null if there are none.
+		Entry* last;                    //!< The last of the records, which only threads holding the lock may use.
+	};
+
+	/** \brief Put a new record into the octree.
+	 *
+	 * The octree is grown first, if the record's area of validity sticks out of it.
+	 * The cache must be locked.
+	 *
+	 * \param record The record, which is copied.
+	 */
+	void insert(const Record& record);
+
+	/** \brief Put a record into a node of the octree, and those below it.
+	 *
+	 * The cache must be locked.
+	 *
+	 * \param node The node.
+	 * \param record The record, as stored in \c records_.
+	 * \param reach The distance from the record within which it may be used.
+	 * \param depth The depth of the node below the root.
+	 */
+	void insert(Node* node, const Record* record, double reach, unsigned int depth);
+
+	/** \brief Make a new node of the octree, with no children or records.
+	 *
+	 * The cache must be locked.
+	 *
+	 * \param x The X-co-ordinate of the middle of the cube.
+	 * \param y The Y-co-ordinate of the middle of the cube.
+	 * \param z The Z-co-ordinate of the middle of the cube.
+	 * \param halfSize Half the length of the cube's sides.
+	 * \return The node.
+	 */
+	Node* newNode(double x, double y, double z, double halfSize);
+
+	static const unsigned int maxDepth = 20; //!< Deepest nodes of the octree below the root.
+
+	mutable std::mutex mutex_;     //!< Lock for adding records, taken by one thread at a time.
+	std::atomic<double> error_;    //!< The largest error estimate allowed when reusing a record.
+	std::atomic<size_t> size_;     //!< The number of records.
+	std::deque<Record> records_;   //!< The records, which stay where they are as more are added.
+	std::deque<Node> nodes_;       //!< The nodes of the octree, which stay where they are as more are added.
+	std::deque<Entry> entries_;    //!< The links of the nodes' lists of records.
+	std::atomic<Node*> root_;      //!< The root of the octree, or null if there are no records.
+
+};
+
+#endif // IRRADIANCE_CACHE_H_INCLUDED
@@ -0,0 +1,134 @@
+/* $Rev: 250 $ */
+#include "LightIndex.h"
+
+#include "utility.h"
+
+#include <algorithm>
+
+const size_t LightIndex::maxCells;
+
+LightIndex::LightIndex() : lights_(), radii_(), unbounded_(), bounds_(), cellStart_(), cellLights_() {
+	std::fill(cells_, cells_ + 3, 0);
+	std::fill(cellSize_, cellSize_ + 3, 0.0);
+}
+
+LightIndex::LightIndex(const LightIndex& index) : lights_(index.lights_), radii_(index.radii_),
+unbounded_(index.unbounded_), bounds_(index.bounds_), cellStart_(index.cellStart_), cellLights_(index.cellLights_) {
+	std::copy(index.cells_, index.cells_ + 3, cells_);
+	std::copy(index.cellSize_, index.cellSize_ + 3, cellSize_);
+}
+
+LightIndex::~LightIndex() {
+
+}
+
+LightIndex& LightIndex::operator=(const LightIndex& index) {
+	if (this != &index) {
+		lights_ = index.lights_;
+		radii_ = index.radii_;
+		unbounded_ = index.unbounded_;
+		bounds_ = index.bounds_;
+		std::copy(index.cells_, index.cells_ + 3, cells_);
+		std::copy(index.cellSize_, index.cellSize_ + 3, cellSize_);
+		cellStart_ = index.cellStart_;
+		cellLights_ = index.cellLights_;
+	}
+	return *this;
+}
+
+void LightIndex::build(const std::vector<std::shared_ptr<LightSource>>& lights, double threshold) {
+	lights_ = lights;
+	radii_.clear();
+	unbounded_.clear();
+	bounds_ = BoundingBox();
+	cellStart_.clear();
+	cellLights_.clear();
+
+	double totalRadius = 0;
+	size_t bounded = 0;
+	for (size_t i = 0; i < lights_.size(); ++i) {
+		double radius = lights_[i]->influenceRadius(threshold);
+		radii_.push_back(radius);
+		if (radius >= infinity) {
+			unbounded_.push_back(i);
+			continue;
+		}
+		const Point& location = lights_[i]->location;
+		bounds_.include(Point(location(0) - radius, location(1) - radius, location(2) - radius));
+		bounds_.include(Point(location(0) + radius, location(1) + radius, location(2) + radius));
+		totalRadius += radius;
+		++bounded;
+	}
+	if (bounded == 0) {
+		return;
+	}
+
+	// Cells about the size of a typical sphere of influence
+	double averageRadius = totalRadius/bounded;
+	size_t cellCount = 1;
+	for (int a = 0; a < 3; ++a) {
+		double extent = bounds_.maxPoint(a) - bounds_.minPoint(a);
+		double cells = averageRadius > 0 ? std::ceil(extent/averageRadius) : 1;
+		cells_[a] = size_t(std::min(double(maxCells), std::max(1.0, cells)));
+		cellSize_[a] = extent > 0 ? extent/cells_[a] : 1;
+		cellCount *= cells_[a];
+	}
+
+	// Range of cells overlapped by a light's sphere along one axis
+	auto cellRange = [this](double centre, double radius, int a, size_t& lo, size_t& hi) {
+		double first = std::floor((centre - radius - bounds_.minPoint(a))/cellSize_[a]);
+		double last = std::floor((centre + radius - bounds_.minPoint(a))/cellSize_[a]);
+		lo = size_t(std::min(std::max(first, 0.0), double(cells_[a] - 1)));
+		hi = size_t(std::min(std::max(last, 0.0), double(cells_[a] - 1)));
+	};
+
+	// Count the entries for each cell, then fill them in
+	cellStart_.assign(cellCount + 1, 0);
+	for (int pass = 0; pass < 2; ++pass) {
+		std::vector<size_t> next;
+		if (pass == 1) {
+			for (size_t cell = 0; cell < cellCount; ++cell) {
+				cellStart_[cell + 1] += cellStart_[cell];
+			}
+			cellLights_.resize(cellStart_[cellCount]);
+			next.assign(cellStart_.begin(), cellStart_.end() - 1);
+		}
+		for (size_t i = 0; i < lights_.size(); ++i) {
+			if (radii_[i] >= infinity) {
+				continue;
+			}
+			size_t lo[3], hi[3];
+			for (int a = 0; a < 3; ++a) {
+				cellRange(lights_[i]->location(a), radii_[i], a, lo[a], hi[a]);
+			}
+			for (size_t z = lo[2]; z <= hi[2]; ++z) {
+				for (size_t y = lo[1]; y <= hi[1]; ++y) {
+					for (size_t x = lo[0]; x <= hi[0]; ++x) {
+						size_t cell = (z*cells_[1] + y)*cells_[0] + x;
+						if (pass == 0) {
+							++cellStart_[cell + 1];
+						} else {
+							cellLights_[next[cell]++] = i;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+bool LightIndex::findCell(const Point& point, size_t& cell) const {
+	if (cellStart_.empty()) {
+		return false;
+	}
+	size_t index[3];
+	for (int a = 0; a < 3; ++a) {
+		double offset = point(a) - bounds_.minPoint(a);
+		if (offset < 0 || point(a) > bounds_.maxPoint(a)) {
+			return false;
+		}
+		index[a] = std::min(size_t(offset/cellSize_[a]), cells_[a] - 1);
+	}
+	cell = (index[2]*cells_[1] + index[1])*cells_[0] + index[0];
+	return true;
+}
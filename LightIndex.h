@@ -0,0 +1,116 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef LIGHT_INDEX_H_INCLUDED
+#define LIGHT_INDEX_H_INCLUDED
+
+#include "BoundingBox.h"
+#include "LightSource.h"
+
+#include <memory>
+#include <vector>
+
+/**
+ * \file
+ * \brief LightIndex class header file.
+ */
+
+/**
+ * \brief A spatial index over LightSources, for finding those which light a Point.
+ *
+ * Light from a LightSource fades with distance, and once it falls below a
+ * threshold it makes no visible difference. Each LightSource therefore has
+ * a sphere of influence (see LightSource::influenceRadius()), and only the
+ * LightSources whose spheres contain a Point need to be considered when
+ * shading it. In a Scene with thousands of lights, this is usually only a
+ * handful.
+ *
+ * The spheres are stored in a uniform grid. Each grid cell lists the
+ * LightSources whose spheres overlap it, so finding the LightSources for a
+ * Point only needs a look at one cell. LightSources with an infinite
+ * radius (including all of them when the threshold is zero) are kept in a
+ * separate list, which applies to every Point.
+ *
+ * The index is built by build(), which must be called again after the
+ * LightSources change.
+ */
+class LightIndex {
+
+public:
+
+	/** \brief LightIndex default constructor.
+	 *
+	 * A newly constructed LightIndex contains no LightSources.
+	 */
+	LightIndex();
+
+	/** \brief LightIndex copy constructor.
+	 *
+	 * \param index The LightIndex to copy.
+	 */
+	LightIndex(const LightIndex& index);
+
+	/** \brief LightIndex destructor. */
+	~LightIndex();
+
+	/** \brief LightIndex assignment operator.
+	 *
+	 * \param index The LightIndex to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	LightIndex& operator=(const LightIndex& index);
+
+	/** \brief Build the index over a collection of LightSources.
+	 *
+	 * \param lights The LightSources to put in the index.
+	 * \param threshold The smallest amount of light that matters, or zero to keep every LightSource everywhere.
+	 */
+	void build(const std::vector<std::shared_ptr<LightSource>>& lights, double threshold);
+
+	/** \brief Call a function for each LightSource which lights a Point.
+	 *
+	 * \param point The Point being lit.
+	 * \param function A function taking a <tt>const LightSource&</tt>, which is called once for each LightSource whose sphere of influence contains \c point.
+	 */
+	template<typename Function>
+	void forEachLight(const Point& point, Function function) const {
+		for (size_t light : unbounded_) {
+			function(*lights_[light]);
+		}
+		size_t cell;
+		if (!findCell(point, cell)) {
+			return;
+		}
+		for (size_t i = cellStart_[cell]; i < cellStart_[cell + 1]; ++i) {
+			size_t light = cellLights_[i];
+			if ((lights_[light]->location - point).squaredNorm() <= radii_[light]*radii_[light]) {
+				function(*lights_[light]);
+			}
+		}
+	}
+
+private:
+
+	/** \brief Find the grid cell containing a Point.
+	 *
+	 * \param point The Point to find.
+	 * \param cell Set to the index of the cell containing \c point.
+	 * \return true if \c point is inside the grid, false otherwise.
+	 */
+	bool findCell(const Point& point, size_t& cell) const;
+
+	std::vector<std::shared_ptr<LightSource>> lights_; //!< The LightSources in the index.
+	std::vector<double> radii_;                        //!< Influence radius of each LightSource.
+	std::vector<size_t> unbounded_;                    //!< Indices of LightSources with infinite radius.
+
+	BoundingBox bounds_;             //!< Region covered by the grid.
+	size_t cells_[3];                //!< Number of grid cells along each axis.
+	double cellSize_[3];             //!< Size of the grid cells along each axis.
+	std::vector<size_t> cellStart_;  //!< Start of each cell's entries in \c cellLights_, plus one past the end.
+	std::vector<size_t> cellLights_; //!< Indices of the LightSources overlapping each cell, a cell at a time.
+
+	static const size_t maxCells = 64; //!< Largest number of grid cells along each axis.
+
+};
+
+#endif // LIGHT_INDEX_H_INCLUDED
@@ -0,0 +1,33 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef LIGHT_SAMPLE_H_INCLUDED
+#define LIGHT_SAMPLE_H_INCLUDED
+
+#include "Colour.h"
+#include "Direction.h"
+
+/**
+ * \file
+ * \brief LightSample class header file.
+ */
+
+/**
+ * \brief Class to store the light arriving at a Point from a LightSource.
+ *
+ * Shading a Point needs the Direction towards each LightSource, how far
+ * away it is (to limit the shadow Ray), and how much light arrives. A
+ * LightSample gathers these together, so that each is worked out once per
+ * LightSource at each Point, however many lighting terms use it.
+ */
+class LightSample {
+
+public:
+
+	Direction direction; //!< Unit Direction from the Point towards the LightSource.
+	double distance;     //!< Distance from the Point to the LightSource.
+	Colour intensity;    //!< Colour and amount of light arriving at the Point, ignoring shadows.
+
+};
+
+#endif // LIGHT_SAMPLE_H_INCLUDED
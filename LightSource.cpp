@@ -1,6 +1,11 @@
 /* $Rev: 250 $ */
 #include "LightSource.h"
 
+#include "utility.h"
+
+#include <algorithm>
+#include <cmath>
+
 LightSource::LightSource() :
 colour(1,1,1), location(0, 0, 0) {
 
@@ -23,3 +28,60 @@ const LightSource& LightSource::operator=(const LightSource& lightSource) {
 	return *this;
 
 }
+
+LightSample LightSource::sample(const Point& point) const {
+	LightSample result;
+	Vector toLight = location - point;
+	result.distance = toLight.norm();
+	result.direction = Direction(toLight/result.distance);
+	result.intensity = colour*getIntensityAt(point);
+	return result;
+}
+
+double LightSource::influenceRadius(double) const {
+	return infinity;
+}
+
+unsigned int LightSource::sampleGrid() const {
+	return 1;
+}
+
+LightSample LightSource::sampleAt(const Point& point, double, double) const {
+	return sample(point);
+}
+
+bool LightSource::compact() const {
+	return true;
+}
+
+bool LightSource::distant() const {
+	return false;
+}
+
+Colour LightSource::emit(const Point& centre, double radius, double, double, double s, double t, Ray& ray) const {
+	double solidAngle = towards(location, centre, radius, s, t, ray);
+	return solidAngle*colour*getIntensityAt(location + ray.direction);
+}
+
+Vector LightSource::coneDirection(const Vector& axis, double cosine, double s, double t) {
+	double z = 1 - s*(1 - cosine);
+	double r = std::sqrt(std::max(0.0, 1 - z*z));
+	double angle = 2*M_PI*t;
+	Vector a = axis.cross(std::abs(axis(0)) > 0.5 ? Direction(0,1,0) : Direction(1,0,0));
+	a = a/a.norm();
+	Vector b = axis.cross(a);
+	return z*axis + r*std::cos(angle)*a + r*std::sin(angle)*b;
+}
+
+double LightSource::towards(const Point& from, const Point& centre, double radius, double s, double t, Ray& ray) {
+	Vector toCentre = centre - from;
+	double distance = toCentre.norm();
+	ray.point = from;
+	if (distance <= radius) {
+		ray.direction = Direction(coneDirection(Direction(0,0,1), -1, s, t));
+		return 4*M_PI;
+	}
+	double cosine = std::sqrt(std::max(0.0, 1 - radius*radius/(distance*distance)));
+	ray.direction = Direction(coneDirection(toCentre/distance, cosine, s, t));
+	return 2*M_PI*(1 - cosine);
+}
@@ -5,7 +5,9 @@
 #define LIGTH_SOURCE_H_INCLUDED
 
 #include "Colour.h"
+#include "LightSample.h"
 #include "Point.h"
+#include "Ray.h"
 
 /**
  * \file 
@@ -38,6 +40,99 @@ public:
 	 * \return The proportion of the base illumination that reaches the Point.
 	 */
 	virtual double getIntensityAt(const Point& point) const = 0;
+
+	/** \brief Determine the light arriving at a Point.
+	 *
+	 * By default the light arrives from the LightSource's location, with 
+	 * its colour scaled by getIntensityAt().
+	 *
+	 * \param point The Point at which light is measured.
+	 * \return The Direction, distance, and amount of light arriving at the Point.
+	 */
+	virtual LightSample sample(const Point& point) const;
+
+	/** \brief How far the light from this LightSource reaches.
+	 *
+	 * Beyond this distance from its location, no component of the light
+	 * arriving from the LightSource is brighter than \c threshold. The 
+	 * default implementation cannot tell, and returns \c infinity.
+	 *
+	 * \param threshold The smallest amount of light that matters.
+	 * \return The distance at which the light falls below \c threshold.
+	 */
+	virtual double influenceRadius(double threshold) const;
+
+	/** \brief The number of samples needed along each side of the LightSource.
+	 *
+	 * A LightSource with a size (see AreaLightSource) is shaded with a grid of
+	 * samples over its shape, and this is the size of that grid. The default 
+	 * is 1, for a LightSource which is a single point.
+	 *
+	 * \return The number of samples along each side of the sample grid.
+	 */
+	virtual unsigned int sampleGrid() const;
+
+	/** \brief Determine the light arriving at a Point from one part of the LightSource.
+	 *
+	 * The co-ordinates say which part of the LightSource the light comes from.
+	 * By default the LightSource is a single point, and this is the same as sample().
+	 *
+	 * \param point The Point at which light is measured.
+	 * \param u The first co-ordinate of the part of the LightSource, in [0,1).
+	 * \param v The second co-ordinate of the part of the LightSource, in [0,1).
+	 * \return The Direction, distance, and amount of light arriving at the Point.
+	 */
+	virtual LightSample sampleAt(const Point& point, double u, double v) const;
+
+	/** \brief Whether the LightSource looks small from the Points it lights.
+	 *
+	 * The light from a small LightSource is much the same from all of its parts,
+	 * so a few samples are enough to tell whether a Point sees all of it, none
+	 * of it, or only some of it (and so needs the full sample grid). This is
+	 * not true of light from all around, and the default is true.
+	 *
+	 * \return true if a few samples can stand in for the whole LightSource.
+	 */
+	virtual bool compact() const;
+
+	/** \brief Whether the LightSource is infinitely far away.
+	 *
+	 * The light from a distant LightSource arrives at every Point from the
+	 * same Direction or Directions, with the same brightness, so its location
+	 * means nothing. The default is false.
+	 *
+	 * \return true if the LightSource has no position in the Scene.
+	 */
+	virtual bool distant() const;
+
+	/** \brief Send out a photon from the LightSource.
+	 *
+	 * Photons are traced out from the LightSources to build a PhotonMap. Each
+	 * starts somewhere on the LightSource and sets off in some Direction, both
+	 * chosen from the four co-ordinates, which should be spread evenly over
+	 * [0,1). Its power is the light it carries, scaled so that averaging the
+	 * power of many photons gives the total light given out towards a sphere
+	 * around the Objects, and the photons landing on each unit of area of a
+	 * surface add up to the intensity of a LightSample shining straight onto it.
+	 *
+	 * Photons are only sent towards the sphere, as those which miss it have
+	 * nothing to reflect off. LightSources at an infinite distance start them
+	 * a long way outside it, so that Objects without bounds, such as Planes,
+	 * can still block them. By default, the LightSource is a single point at
+	 * its location, sending light equally in all Directions, scaled by
+	 * getIntensityAt() one unit away, and photons are spread evenly over the
+	 * cone of Directions which meet the sphere.
+	 *
+	 * \param centre The middle of the sphere to send photons towards.
+	 * \param radius The radius of the sphere to send photons towards.
+	 * \param u The first co-ordinate of where on the LightSource the photon starts.
+	 * \param v The second co-ordinate of where on the LightSource the photon starts.
+	 * \param s The first co-ordinate of the Direction of the photon.
+	 * \param t The second co-ordinate of the Direction of the photon.
+	 * \param ray Set to where the photon starts, and its unit Direction.
+	 * \return The power of the photon.
+	 */
+	virtual Colour emit(const Point& centre, double radius, double u, double v, double s, double t, Ray& ray) const;
 	
 	Point location; //!< The location of this LightSource.
 
@@ -65,6 +160,28 @@ protected:
 	 */
 	const LightSource& operator=(const LightSource& lightSource);
 
+	/** \brief Pick a Direction in a cone, evenly over its solid angle.
+	 *
+	 * \param axis The unit Direction along the middle of the cone.
+	 * \param cosine The cosine of the angle between the axis and the edge of the cone.
+	 * \param s The first co-ordinate, from the axis to the edge.
+	 * \param t The second co-ordinate, around the axis.
+	 * \return A unit Vector in the cone.
+	 */
+	static Vector coneDirection(const Vector& axis, double cosine, double s, double t);
+
+	/** \brief Send out a photon from a Point towards a sphere.
+	 *
+	 * \param from Where the photon starts.
+	 * \param centre The middle of the sphere.
+	 * \param radius The radius of the sphere.
+	 * \param s The first co-ordinate of the Direction of the photon.
+	 * \param t The second co-ordinate of the Direction of the photon.
+	 * \param ray Set to where the photon starts, and its unit Direction.
+	 * \return The solid angle of the Directions the photon could have been sent in: the cone around the sphere, or all Directions if the Point is inside it.
+	 */
+	static double towards(const Point& from, const Point& centre, double radius, double s, double t, Ray& ray);
+
 
 };
 
@@ -0,0 +1,165 @@
+/* $Rev: 250 $ */
+#include "LightTree.h"
+
+#include "utility.h"
+
+#include <algorithm>
+
+LightTree::LightTree() : lights_(), powers_(), nodes_(), order_(), distant_(), distantPower_(0) {
+
+}
+
+LightTree::LightTree(const LightTree& tree) : lights_(tree.lights_), powers_(tree.powers_),
+nodes_(tree.nodes_), order_(tree.order_), distant_(tree.distant_), distantPower_(tree.distantPower_) {
+
+}
+
+LightTree::~LightTree() {
+
+}
+
+LightTree& LightTree::operator=(const LightTree& tree) {
+	if (this != &tree) {
+		lights_ = tree.lights_;
+		powers_ = tree.powers_;
+		nodes_ = tree.nodes_;
+		order_ = tree.order_;
+		distant_ = tree.distant_;
+		distantPower_ = tree.distantPower_;
+	}
+	return *this;
+}
+
+void LightTree::build(const std::vector<std::shared_ptr<LightSource>>& lights) {
+	lights_ = lights;
+	powers_.clear();
+	nodes_.clear();
+	order_.clear();
+	distant_.clear();
+	distantPower_ = 0;
+	for (size_t i = 0; i < lights_.size(); ++i) {
+		const Colour& colour = lights_[i]->colour;
+		powers_.push_back(std::max(0.0, std::max(colour.red, std::max(colour.green, colour.blue))));
+		if (lights_[i]->distant()) {
+			distant_.push_back(i);
+			distantPower_ += powers_[i];
+		} else {
+			order_.push_back(i);
+		}
+	}
+	if (order_.empty()) {
+		return;
+	}
+	nodes_.reserve(2*order_.size());
+	nodes_.push_back(Node());
+	build(0, 0, order_.size());
+}
+
+void LightTree::build(size_t node, size_t first, size_t count) {
+	BoundingBox bounds;
+	double power = 0;
+	for (size_t i = first; i < first + count; ++i) {
+		bounds.include(lights_[order_[i]]->location);
+		power += powers_[order_[i]];
+	}
+	nodes_[node].bounds = bounds;
+	nodes_[node].power = power;
+
+	if (count == 1) {
+		nodes_[node].first = order_[first];
+		nodes_[node].leaf = true;
+		return;
+	}
+
+	// Split along the axis where the lights are most spread out
+	int axis = 0;
+	for (int i = 1; i < 3; ++i) {
+		if (bounds.maxPoint(i) - bounds.minPoint(i) > bounds.maxPoint(axis) - bounds.minPoint(axis)) {
+			axis = i;
+		}
+	}
+	size_t middle = first + count/2;
+	const std::vector<std::shared_ptr<LightSource>>& lights = lights_;
+	std::nth_element(order_.begin() + first, order_.begin() + middle, order_.begin() + first + count,
+		[&lights, axis](size_t a, size_t b) {
+			return lights[a]->location(axis) < lights[b]->location(axis);
+		});
+
+	size_t firstChild = nodes_.size();
+	nodes_[node].first = firstChild;
+	nodes_[node].leaf = false;
+	nodes_.push_back(Node());
+	nodes_.push_back(Node());
+	build(firstChild, first, middle - first);
+	build(firstChild + 1, middle, first + count - middle);
+}
+
+double LightTree::importance(const Node& node, const Point& point) const {
+	// Squared distance to the nearest point of the bounds. For a Point inside
+	// the bounds, the squared half-size is used instead, so that the cluster
+	// is not rated as infinitely important
+	double distance2 = 0;
+	double size2 = 0;
+	for (int a = 0; a < 3; ++a) {
+		double below = node.bounds.minPoint(a) - point(a);
+		double above = point(a) - node.bounds.maxPoint(a);
+		double gap = std::max(0.0, std::max(below, above));
+		distance2 += gap*gap;
+		double size = node.bounds.maxPoint(a) - node.bounds.minPoint(a);
+		size2 += 0.25*size*size;
+	}
+	if (distance2 == 0) {
+		distance2 = size2;
+	}
+	return node.power/std::max(distance2, epsilon);
+}
+
+bool LightTree::sample(const Point& point, double u, const LightSource*& light, double& probability) const {
+	// Choose between the distant lights and the tree, as if the distant lights were a unit distance away
+	double treeImportance = (nodes_.empty() || nodes_[0].power <= 0) ? 0 : importance(nodes_[0], point);
+	double total = distantPower_ + treeImportance;
+	if (total <= 0) {
+		return false;
+	}
+	double pDistant = distantPower_/total;
+	if (u < pDistant) {
+		// Pick a distant light in proportion to its power
+		u = u/pDistant;
+		size_t picked = distant_.back();
+		for (size_t i : distant_) {
+			double p = powers_[i]/distantPower_;
+			if (u < p) {
+				picked = i;
+				break;
+			}
+			u -= p;
+		}
+		light = lights_[picked].get();
+		probability = pDistant*powers_[picked]/distantPower_;
+		return probability > 0;
+	}
+	u = std::min((u - pDistant)/(1 - pDistant), 1 - 1e-12);
+	probability = 1 - pDistant;
+	const Node* node = &nodes_[0];
+	while (!node->leaf) {
+		const Node& left = nodes_[node->first];
+		const Node& right = nodes_[node->first + 1];
+		double importanceLeft = importance(left, point);
+		double importanceRight = importance(right, point);
+		double total = importanceLeft + importanceRight;
+		double pLeft = total > 0 ? importanceLeft/total : 0.5;
+		// The random number is rescaled at each level, so that one is enough for the whole walk
+		if (u < pLeft) {
+			u = u/pLeft;
+			probability *= pLeft;
+			node = &left;
+		} else {
+			u = (u - pLeft)/(1 - pLeft);
+			probability *= 1 - pLeft;
+			node = &right;
+		}
+		u = std::min(u, 1 - 1e-12);
+	}
+	light = lights_[node->first].get();
+	return probability > 0;
+}
@@ -0,0 +1,131 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef LIGHT_TREE_H_INCLUDED
+#define LIGHT_TREE_H_INCLUDED
+
+#include "BoundingBox.h"
+#include "LightSource.h"
+
+#include <memory>
+#include <vector>
+
+/**
+ * \file
+ * \brief LightTree class header file.
+ */
+
+/**
+ * \brief A hierarchy of LightSources, for picking lights at random in proportion to their importance.
+ *
+ * With many LightSources, shading a Point with every one of them is too
+ * slow. Instead a few can be picked at random, and their contributions
+ * divided by the probability of picking them. On average this gives the
+ * same answer (it is unbiased), and the noise is lowest when lights are
+ * picked in proportion to how much they contribute.
+ *
+ * The LightTree is a binary tree over the LightSources' locations, with a
+ * single LightSource at each leaf. Each node records the bounds of the
+ * lights below it, and their total power (the brightest component of their
+ * colour). A light is picked by walking down from the root, choosing each
+ * child with probability proportional to its power divided by its squared
+ * distance from the Point. This costs time proportional to the depth of
+ * the tree, rather than the number of lights.
+ *
+ * Distant LightSources (see LightSource::distant()), such as sunlight or the
+ * sky, have no location to cluster by, and are as bright at every Point. They
+ * are kept out of the tree, in a list of their own. The list as a whole is
+ * rated as if its lights were a unit distance away, and picked against the
+ * root of the tree on that basis, and a light is then picked from it in
+ * proportion to its power.
+ *
+ * The tree is built by build(), which must be called again after the
+ * LightSources change.
+ */
+class LightTree {
+
+public:
+
+	/** \brief LightTree default constructor.
+	 *
+	 * A newly constructed LightTree contains no LightSources.
+	 */
+	LightTree();
+
+	/** \brief LightTree copy constructor.
+	 *
+	 * \param tree The LightTree to copy.
+	 */
+	LightTree(const LightTree& tree);
+
+	/** \brief LightTree destructor. */
+	~LightTree();
+
+	/** \brief LightTree assignment operator.
+	 *
+	 * \param tree The LightTree to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	LightTree& operator=(const LightTree& tree);
+
+	/** \brief Build the tree over a collection of LightSources.
+	 *
+	 * The LightSources are split recursively at the median of their
+	 * locations, along the axis where they are most spread out. Distant
+	 * LightSources are set aside in a list of their own.
+	 *
+	 * \param lights The LightSources to put in the tree.
+	 */
+	void build(const std::vector<std::shared_ptr<LightSource>>& lights);
+
+	/** \brief Pick a LightSource at random to light a Point.
+	 *
+	 * \param point The Point being lit.
+	 * \param u A random number in [0,1), which decides the LightSource picked.
+	 * \param light Set to the LightSource picked.
+	 * \param probability Set to the probability of picking that LightSource.
+	 * \return true if a LightSource was picked, false if there are none with any power.
+	 */
+	bool sample(const Point& point, double u, const LightSource*& light, double& probability) const;
+
+private:
+
+	/** \brief A node in the tree.
+	 *
+	 * Leaf nodes have \c first set to the index of their LightSource, and
+	 * \c leaf set to true. Interior nodes have their two children at \c first
+	 * and \c first+1 in \c nodes_.
+	 */
+	struct Node {
+		BoundingBox bounds; //!< Bounds of the locations of the lights below this node.
+		double power;       //!< Total power of the lights below this node.
+		size_t first;       //!< The LightSource (leaf) or first child node (interior).
+		bool leaf;          //!< Whether this is a leaf node.
+	};
+
+	/** \brief Build the tree below a node.
+	 *
+	 * \param node Index of the node in \c nodes_.
+	 * \param first The first entry of \c order_ that the node covers.
+	 * \param count The number of entries of \c order_ that the node covers.
+	 */
+	void build(size_t node, size_t first, size_t count);
+
+	/** \brief Estimate how much the lights below a node contribute at a Point.
+	 *
+	 * \param node The node.
+	 * \param point The Point being lit.
+	 * \return The node's power, divided by its squared distance from \c point.
+	 */
+	double importance(const Node& node, const Point& point) const;
+
+	std::vector<std::shared_ptr<LightSource>> lights_; //!< The LightSources in the tree.
+	std::vector<double> powers_;                       //!< Power of each LightSource.
+	std::vector<Node> nodes_;                          //!< The tree, with the root at index 0.
+	std::vector<size_t> order_;                        //!< Indices of the LightSources in the tree, in leaf order.
+	std::vector<size_t> distant_;                      //!< Indices of the distant LightSources, which are not in the tree.
+	double distantPower_;                              //!< Total power of the distant LightSources.
+
+};
+
+#endif // LIGHT_TREE_H_INCLUDED
@@ -6,6 +6,9 @@
 
 #include "Colour.h"
 
+class Pattern;
+class Texture;
+
 /** 
  * \file
  * \brief Material class header file.
@@ -25,6 +28,14 @@
  *   - A specular component, which follows a Phong illumination model and uses the Material's specularColour and specularExponent.
  * - Some surfaces create mirror-reflections, which are influenced by the mirrorColour. For example, reflections in a gold surface should appear yellow.
  * Also, not all LightSource objects give white light, and the Colour of an object depends on the interaction between the light and surface colours.
+ *
+ * The diffuse, specular, and mirror Colours can each be varied across a surface by a Texture.
+ * The Colour from the Texture is multiplied by the Material's Colour, and the diffuse Texture
+ * also applies to the ambientColour. Procedural Patterns can be used in the same way,
+ * and are multiplied in as well as any Texture.
+ *
+ * A Material is copied into every RayIntersection, so it only points to its
+ * Textures and Patterns, which belong to the Scene.
  */
 class Material {
 
@@ -35,7 +46,8 @@ public:
 	 *
 	 * By default
 	 */
-	Material() : ambientColour(1,1,1), diffuseColour(1,1,1), specularColour(0,0,0), specularExponent(1), mirrorColour(0,0,0) {};
+	Material() : ambientColour(1,1,1), diffuseColour(1,1,1), specularColour(0,0,0), specularExponent(1), mirrorColour(0,0,0),
+		diffuseTexture(nullptr), specularTexture(nullptr), mirrorTexture(nullptr), diffusePattern(nullptr), specularPattern(nullptr), mirrorPattern(nullptr) {};
 
 	Colour ambientColour;     //!< Colour of Material under white ambient light. Usually, but not always, the same as diffuseColour.
 
@@ -45,6 +57,28 @@ public:
 	double specularExponent;  //!< 'Hardness' of Material's specular hightlights - high values give small, sharp highlights.
 
 	Colour mirrorColour;      //!< Colour of reflected rays under direct white light. If this is zero then there are no reflections.
+
+	const Texture* diffuseTexture;  //!< Texture for the ambientColour and diffuseColour, or null for none.
+	const Texture* specularTexture; //!< Texture for the specularColour, or null for none.
+	const Texture* mirrorTexture;   //!< Texture for the mirrorColour, or null for none.
+
+	const Pattern* diffusePattern;  //!< Pattern for the ambientColour and diffuseColour, or null for none.
+	const Pattern* specularPattern; //!< Pattern for the specularColour, or null for none.
+	const Pattern* mirrorPattern;   //!< Pattern for the mirrorColour, or null for none.
+
+	/** \brief Material equality.
+	 *
+	 * \param material The Material to compare to \c this.
+	 * \return true if all of the Material properties are the same, false otherwise.
+	 */
+	bool operator==(const Material& material) const {
+		return ambientColour == material.ambientColour && diffuseColour == material.diffuseColour &&
+			specularColour == material.specularColour && specularExponent == material.specularExponent &&
+			mirrorColour == material.mirrorColour && diffuseTexture == material.diffuseTexture &&
+			specularTexture == material.specularTexture && mirrorTexture == material.mirrorTexture &&
+			diffusePattern == material.diffusePattern && specularPattern == material.specularPattern &&
+			mirrorPattern == material.mirrorPattern;
+	}
 };
 
 #endif
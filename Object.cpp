@@ -1,6 +1,9 @@
 /* $Rev: 250 $ */
 #include "Object.h"
 
+#include <algorithm>
+#include <cmath>
+
 Object::Object() : transform() {
 
 }
@@ -19,3 +22,32 @@ const Object& Object::operator=(const Object& object) {
 	}
 	return *this;
 }
+
+size_t Object::intersectInto(const Ray& ray, RayIntersection* hits, size_t maxHits) const {
+	RayIntersectionList result = intersect(ray);
+	if (result.size() <= maxHits) {
+		std::copy(result.begin(), result.end(), hits);
+	}
+	return result.size();
+}
+
+BoundingBox Object::getBounds() const {
+	return BoundingBox::infinite();
+}
+
+void Object::boxTextureCoordinates(const Point& local, const Vector& normal, RayIntersection& hit) {
+	double nx = std::abs(normal(0));
+	double ny = std::abs(normal(1));
+	double nz = std::abs(normal(2));
+	if (nx >= ny && nx >= nz) {
+		hit.u = local(2);
+		hit.v = local(1);
+	} else if (ny >= nz) {
+		hit.u = local(0);
+		hit.v = local(2);
+	} else {
+		hit.u = local(0);
+		hit.v = local(1);
+	}
+	hit.spherical = false;
+}
@@ -4,6 +4,7 @@
 #ifndef OBJECT_H_INCLUDED
 #define OBJECT_H_INCLUDED
 
+#include "BoundingBox.h"
 #include "Material.h"
 #include "Ray.h"
 #include "RayIntersection.h"
@@ -39,16 +40,53 @@ public:
 	/** \brief Object-Ray intersection computation.
 	 *
 	 * Given a Ray in space, this finds the point(s) of intersection with the surface of the 
-	 * Object. Note that there may be 0, 1, or more intersection points, and so a std::vector
+	 * Object. Note that there may be 0, 1, or more intersection points, and so a list
 	 * of RayIntersections is returned.
 	 *
 	 * The details of this depend on the geometry of the particular Object, so this is a 
 	 * pure virtual method.
 	 *
+	 * Intersections should be returned in order of increasing distance along the Ray.
+	 * This is not required, but CSG has to sort the lists from its children when it
+	 * is not the case.
+	 *
 	 * \param ray The Ray to intersect with this Object.
-	 * \return A list (std::vector) of intersections, which may be empty.
+	 * \return A list of intersections, which may be empty.
 	 */
-	virtual std::vector<RayIntersection> intersect(const Ray& ray) const = 0;
+	virtual RayIntersectionList intersect(const Ray& ray) const = 0;
+
+	/** \brief Object-Ray intersection computation, into storage given by the caller.
+	 *
+	 * This finds the same intersections as intersect(), in the same order,
+	 * but writes them over the RayIntersections in \c hits rather than
+	 * making a new list, so that CSG can combine the hits of its children
+	 * without allocating a list for each of them.
+	 *
+	 * If there are more intersections than \c maxHits, the contents of
+	 * \c hits are undefined, and a number larger than \c maxHits is
+	 * returned, so the caller can try again with more room.
+	 *
+	 * The default implementation copies the list from intersect().
+	 *
+	 * \param ray The Ray to intersect with this Object.
+	 * \param hits Where to write the intersections.
+	 * \param maxHits The number of RayIntersections in \c hits.
+	 * \return The number of intersections, or more than \c maxHits if they do not fit.
+	 */
+	virtual size_t intersectInto(const Ray& ray, RayIntersection* hits, size_t maxHits) const;
+
+	/** \brief Bounds of the Object.
+	 *
+	 * This gives an axis-aligned BoundingBox which contains the whole Object,
+	 * after its transform has been applied. Any Ray which misses this box 
+	 * also misses the Object. 
+	 *
+	 * The default implementation returns an infinite box, which is always 
+	 * safe but gives no opportunity to skip work.
+	 *
+	 * \return A BoundingBox containing the Object.
+	 */
+	virtual BoundingBox getBounds() const;
 
 	Transform transform; //!< A 3D transformation to apply to this Object.
 	
@@ -75,6 +113,17 @@ protected:
 	 */
 	const Object& operator=(const Object& object);
 
+	/** \brief Texture co-ordinates for a shape with no natural mapping.
+	 *
+	 * The local Point of a hit is projected along whichever axis the Normal is
+	 * closest to, so the Texture is laid onto the shape from its six sides.
+	 *
+	 * \param local The Point of the hit, in the Object's own co-ordinates.
+	 * \param normal The Normal of the hit, in the Object's own co-ordinates.
+	 * \param hit Its \c u and \c v are set to the texture co-ordinates.
+	 */
+	static void boxTextureCoordinates(const Point& local, const Vector& normal, RayIntersection& hit);
+
 };
 
 #endif
@@ -0,0 +1,237 @@
+/* $Rev: 250 $ */
+#include "OcclusionCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+const unsigned int OcclusionCache::maxCells;
+
+// Marks a saved cache, and the layout of its header
+static const char cacheMagic[8] = {'R', 'T', 'A', 'O', 'C', '0', '0', '1'};
+
+OcclusionCache::OcclusionCache() : cellSize_(1), keys_(), values_() {
+	for (int a = 0; a < 3; ++a) {
+		origin_[a] = 0;
+		cells_[a] = 1;
+	}
+}
+
+OcclusionCache::OcclusionCache(const OcclusionCache& cache) : cellSize_(cache.cellSize_), keys_(cache.keys_), values_(cache.values_) {
+	for (int a = 0; a < 3; ++a) {
+		origin_[a] = cache.origin_[a];
+		cells_[a] = cache.cells_[a];
+	}
+}
+
+OcclusionCache::~OcclusionCache() {
+
+}
+
+OcclusionCache& OcclusionCache::operator=(const OcclusionCache& cache) {
+	if (this != &cache) {
+		for (int a = 0; a < 3; ++a) {
+			origin_[a] = cache.origin_[a];
+			cells_[a] = cache.cells_[a];
+		}
+		cellSize_ = cache.cellSize_;
+		keys_ = cache.keys_;
+		values_ = cache.values_;
+	}
+	return *this;
+}
+
+void OcclusionCache::clear() {
+	keys_.clear();
+	values_.clear();
+}
+
+size_t OcclusionCache::size() const {
+	return keys_.size();
+}
+
+void OcclusionCache::setGrid(const BoundingBox& bounds, double cellSize) {
+	clear();
+	double largest = 0;
+	for (int a = 0; a < 3; ++a) {
+		origin_[a] = bounds.minPoint(a);
+		largest = std::max(largest, bounds.maxPoint(a) - bounds.minPoint(a));
+	}
+	cellSize_ = std::max(cellSize, largest/(maxCells - 1));
+	for (int a = 0; a < 3; ++a) {
+		double extent = bounds.maxPoint(a) - bounds.minPoint(a);
+		cells_[a] = std::max(1u, (unsigned int)std::ceil(extent/cellSize_));
+	}
+}
+
+unsigned int OcclusionCache::cells(int axis) const {
+	return cells_[axis];
+}
+
+Point OcclusionCache::cellCentre(unsigned int i, unsigned int j, unsigned int k) const {
+	return Point(origin_[0] + (i + 0.5)*cellSize_, origin_[1] + (j + 0.5)*cellSize_, origin_[2] + (k + 0.5)*cellSize_);
+}
+
+bool OcclusionCache::key(const Point& point, const Vector& normal, uint64_t& key) const {
+	uint64_t index[3];
+	for (int a = 0; a < 3; ++a) {
+		double cell = std::floor((point(a) - origin_[a])/cellSize_);
+		if (cell < 0 || cell >= cells_[a]) {
+			return false;
+		}
+		index[a] = uint64_t(cell);
+	}
+	key = pack(index[0], index[1], index[2], side(normal));
+	return true;
+}
+
+void OcclusionCache::build(std::vector<std::pair<uint64_t, double>>& values) {
+	std::sort(values.begin(), values.end());
+	keys_.clear();
+	values_.clear();
+	keys_.reserve(values.size());
+	values_.reserve(values.size());
+	for (const std::pair<uint64_t, double>& value : values) {
+		if (!keys_.empty() && keys_.back() == value.first) {
+			continue;
+		}
+		keys_.push_back(value.first);
+		values_.push_back((unsigned char)std::lround(255*std::min(std::max(value.second, 0.0), 1.0)));
+	}
+	values.clear();
+}
+
+bool OcclusionCache::lookup(const Point& point, const Vector& normal, double& open) const {
+	if (keys_.empty()) {
+		return false;
+	}
+
+	// Blend the eight cells whose middles are around the Point
+	unsigned int facing = side(normal);
+	long long base[3];
+	double fraction[3];
+	for (int a = 0; a < 3; ++a) {
+		double cell = (point(a) - origin_[a])/cellSize_ - 0.5;
+		double low = std::floor(cell);
+		base[a] = (long long)low;
+		fraction[a] = cell - low;
+	}
+	double total = 0;
+	double totalWeight = 0;
+	for (int corner = 0; corner < 8; ++corner) {
+		double weight = 1;
+		uint64_t index[3];
+		bool inside = true;
+		for (int a = 0; a < 3; ++a) {
+			bool upper = (corner >> a) & 1;
+			long long cell = base[a] + (upper ? 1 : 0);
+			if (cell < 0 || cell >= (long long)cells_[a]) {
+				inside = false;
+				break;
+			}
+			index[a] = uint64_t(cell);
+			weight *= upper ? fraction[a] : 1 - fraction[a];
+		}
+		if (!inside || weight <= 0) {
+			continue;
+		}
+		uint64_t wanted = pack(index[0], index[1], index[2], facing);
+		std::vector<uint64_t>::const_iterator found = std::lower_bound(keys_.begin(), keys_.end(), wanted);
+		if (found != keys_.end() && *found == wanted) {
+			total += weight*values_[found - keys_.begin()];
+			totalWeight += weight;
+		}
+	}
+	if (totalWeight <= 0) {
+		return false;
+	}
+	open = total/(255*totalWeight);
+	return true;
+}
+
+bool OcclusionCache::load(const std::string& filename, unsigned int samples, double distance) {
+	std::ifstream fin(filename, std::ios::binary);
+	if (!fin) {
+		return false;
+	}
+	char magic[8];
+	uint32_t fileSamples = 0;
+	double fileDistance = 0;
+	double fileOrigin[3];
+	double fileCellSize = 0;
+	uint32_t fileCells[3];
+	uint64_t count = 0;
+	fin.read(magic, 8);
+	fin.read(reinterpret_cast<char*>(&fileSamples), sizeof(fileSamples));
+	fin.read(reinterpret_cast<char*>(&fileDistance), sizeof(fileDistance));
+	fin.read(reinterpret_cast<char*>(fileOrigin), sizeof(fileOrigin));
+	fin.read(reinterpret_cast<char*>(&fileCellSize), sizeof(fileCellSize));
+	fin.read(reinterpret_cast<char*>(fileCells), sizeof(fileCells));
+	fin.read(reinterpret_cast<char*>(&count), sizeof(count));
+	if (!fin || std::memcmp(magic, cacheMagic, 8) != 0) {
+		std::cerr << "File '" << filename << "' is not an occlusion cache" << std::endl;
+		exit(-1);
+	}
+
+	// A cache baked for other Objects or settings is out of date
+	if (fileSamples != samples || fileDistance != distance || fileCellSize != cellSize_) {
+		return false;
+	}
+	for (int a = 0; a < 3; ++a) {
+		if (fileOrigin[a] != origin_[a] || fileCells[a] != cells_[a]) {
+			return false;
+		}
+	}
+
+	std::vector<uint64_t> keys(count);
+	std::vector<unsigned char> values(count);
+	fin.read(reinterpret_cast<char*>(keys.data()), count*sizeof(uint64_t));
+	fin.read(reinterpret_cast<char*>(values.data()), count);
+	if (!fin) {
+		std::cerr << "Occlusion cache file '" << filename << "' is too short" << std::endl;
+		exit(-1);
+	}
+	keys_.swap(keys);
+	values_.swap(values);
+	return true;
+}
+
+void OcclusionCache::save(const std::string& filename, unsigned int samples, double distance) const {
+	// Written under another name, so that an interrupted save does not spoil the last one
+	std::string tempFile = filename + ".tmp";
+	std::ofstream fout(tempFile, std::ios::binary | std::ios::trunc);
+	uint32_t fileSamples = samples;
+	uint32_t fileCells[3] = {cells_[0], cells_[1], cells_[2]};
+	uint64_t count = keys_.size();
+	fout.write(cacheMagic, 8);
+	fout.write(reinterpret_cast<const char*>(&fileSamples), sizeof(fileSamples));
+	fout.write(reinterpret_cast<const char*>(&distance), sizeof(distance));
+	fout.write(reinterpret_cast<const char*>(origin_), sizeof(origin_));
+	fout.write(reinterpret_cast<const char*>(&cellSize_), sizeof(cellSize_));
+	fout.write(reinterpret_cast<const char*>(fileCells), sizeof(fileCells));
+	fout.write(reinterpret_cast<const char*>(&count), sizeof(count));
+	fout.write(reinterpret_cast<const char*>(keys_.data()), count*sizeof(uint64_t));
+	fout.write(reinterpret_cast<const char*>(values_.data()), count);
+	fout.close();
+	if (!fout || std::rename(tempFile.c_str(), filename.c_str()) != 0) {
+		std::cerr << "Could not write occlusion cache file '" << filename << "'" << std::endl;
+		exit(-1);
+	}
+}
+
+unsigned int OcclusionCache::side(const Vector& normal) {
+	unsigned int axis = 0;
+	for (unsigned int a = 1; a < 3; ++a) {
+		if (std::abs(normal(a)) > std::abs(normal(axis))) {
+			axis = a;
+		}
+	}
+	return 2*axis + (normal(axis) < 0 ? 1 : 0);
+}
+
+uint64_t OcclusionCache::pack(uint64_t i, uint64_t j, uint64_t k, unsigned int side) {
+	return i | (j << 20) | (k << 40) | (uint64_t(side) << 60);
+}
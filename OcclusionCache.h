@@ -0,0 +1,174 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef OCCLUSION_CACHE_H_INCLUDED
+#define OCCLUSION_CACHE_H_INCLUDED
+
+#include "BoundingBox.h"
+#include "Point.h"
+#include "Vector.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * \file
+ * \brief OcclusionCache class header file.
+ */
+
+/**
+ * \brief Ambient occlusion worked out ahead of time, on a grid of cells over the Scene.
+ *
+ * Ambient occlusion only depends on where a surface is, and which way it
+ * faces, not on the Camera, so for previews it can be worked out once (baked)
+ * and looked up in each frame instead of casting Rays. The Objects in this
+ * ray tracer are not made of vertices, and most have no texture co-ordinates
+ * that cover them, so the values are kept in space instead: the region
+ * around the Objects is cut into a grid of cubic cells, and each cell that
+ * some surface passes through holds the occlusion at one Point of that
+ * surface, once for each of the six axis Directions the surface can face.
+ * Only those cells are stored, as a sorted list of their keys with the
+ * occlusion of each as a single byte, so the cache stays small.
+ *
+ * Looking up a Point blends the cells around it, facing the same way, so
+ * the occlusion changes smoothly across a surface. The cache can be saved
+ * to a file along with the grid and the settings it was baked with, and
+ * only loaded again if those match.
+ */
+class OcclusionCache {
+
+public:
+
+	/** \brief OcclusionCache default constructor.
+	 *
+	 * A newly constructed OcclusionCache is empty, with a grid of one cell.
+	 */
+	OcclusionCache();
+
+	/** \brief OcclusionCache copy constructor.
+	 *
+	 * \param cache The OcclusionCache to copy.
+	 */
+	OcclusionCache(const OcclusionCache& cache);
+
+	/** \brief OcclusionCache destructor. */
+	~OcclusionCache();
+
+	/** \brief OcclusionCache assignment operator.
+	 *
+	 * \param cache The OcclusionCache to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	OcclusionCache& operator=(const OcclusionCache& cache);
+
+	/** \brief Remove all of the values. */
+	void clear();
+
+	/** \brief The number of cells with values.
+	 *
+	 * \return The number of values.
+	 */
+	size_t size() const;
+
+	/** \brief Set up the grid, and remove all of the values.
+	 *
+	 * The cells may be made larger than asked for, so that there are no more
+	 * than about a million along any side of the grid.
+	 *
+	 * \param bounds The region to cover.
+	 * \param cellSize The length of the sides of the cells.
+	 */
+	void setGrid(const BoundingBox& bounds, double cellSize);
+
+	/** \brief The number of cells along one side of the grid.
+	 *
+	 * \param axis The axis, 0 for X, 1 for Y, or 2 for Z.
+	 * \return The number of cells along the axis.
+	 */
+	unsigned int cells(int axis) const;
+
+	/** \brief The middle of a cell.
+	 *
+	 * \param i The index of the cell along the X-axis.
+	 * \param j The index of the cell along the Y-axis.
+	 * \param k The index of the cell along the Z-axis.
+	 * \return The Point in the middle of the cell.
+	 */
+	Point cellCentre(unsigned int i, unsigned int j, unsigned int k) const;
+
+	/** \brief Find the key of the cell containing a Point, for a surface facing some way.
+	 *
+	 * \param point The Point.
+	 * \param normal The Normal of the surface.
+	 * \param key Set to the key of the cell, if the Point is in the grid.
+	 * \return true if the Point is in the grid, false otherwise.
+	 */
+	bool key(const Point& point, const Vector& normal, uint64_t& key) const;
+
+	/** \brief Replace the values.
+	 *
+	 * \param values The key of each cell (see key()), and the fraction of the Rays from it which were not blocked, from 0 to 1. This is left empty.
+	 */
+	void build(std::vector<std::pair<uint64_t, double>>& values);
+
+	/** \brief Find the ambient occlusion at a Point.
+	 *
+	 * \param point The Point.
+	 * \param normal The Normal of the surface at the Point, facing the side which is seen.
+	 * \param open Set to the fraction of Rays from the Point which are not blocked, if there are any values around it.
+	 * \return true if there are values around the Point, false if it must be worked out some other way.
+	 */
+	bool lookup(const Point& point, const Vector& normal, double& open) const;
+
+	/** \brief Read the values from a file written by save().
+	 *
+	 * The file is only used if it was saved with the same grid, and the same
+	 * settings, as it is to be used with. Otherwise, the values would be wrong.
+	 *
+	 * \param filename The name of the file.
+	 * \param samples The number of Rays cast from each Point.
+	 * \param distance How far away an Object can be and still occlude a Point.
+	 * \return true if the file was read, false if there is no such file, or it does not match.
+	 */
+	bool load(const std::string& filename, unsigned int samples, double distance);
+
+	/** \brief Write the grid and values to a file.
+	 *
+	 * \param filename The name of the file.
+	 * \param samples The number of Rays cast from each Point.
+	 * \param distance How far away an Object can be and still occlude a Point.
+	 */
+	void save(const std::string& filename, unsigned int samples, double distance) const;
+
+private:
+
+	/** \brief The Direction a surface faces most nearly.
+	 *
+	 * \param normal The Normal of the surface.
+	 * \return Twice the axis along which the Normal is longest, plus 1 if it points the negative way along it.
+	 */
+	static unsigned int side(const Vector& normal);
+
+	/** \brief Put the indices of a cell, and the side, together into a key.
+	 *
+	 * \param i The index of the cell along the X-axis.
+	 * \param j The index of the cell along the Y-axis.
+	 * \param k The index of the cell along the Z-axis.
+	 * \param side The side the surface faces (see side()).
+	 * \return The key.
+	 */
+	static uint64_t pack(uint64_t i, uint64_t j, uint64_t k, unsigned int side);
+
+	static const unsigned int maxCells = 1u << 20; //!< Most cells along a side of the grid, so that the indices fit in a key.
+
+	double origin_[3];             //!< The corner of the grid with the smallest co-ordinates.
+	double cellSize_;              //!< The length of the sides of the cells.
+	unsigned int cells_[3];        //!< The number of cells along each side of the grid.
+	std::vector<uint64_t> keys_;   //!< The keys of the cells with values, in increasing order.
+	std::vector<unsigned char> values_; //!< The fraction of Rays not blocked in each of those cells, from 0 to 255.
+
+};
+
+#endif // OCCLUSION_CACHE_H_INCLUDED
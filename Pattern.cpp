@@ -0,0 +1,243 @@
+/* $Rev: 250 $ */
+#include "Pattern.h"
+
+#include "Random.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+const size_t Pattern::maxBatch;
+const unsigned int Pattern::octaves;
+
+// Perlin's hash of the lattice points: a shuffle of 0-255, repeated so that
+// the sums of two entries can be looked up without wrapping
+struct Permutation {
+	int p[512];
+	Permutation() {
+		Random shuffle(1);
+		for (int i = 0; i < 256; ++i) {
+			p[i] = i;
+		}
+		for (int i = 255; i > 0; --i) {
+			std::swap(p[i], p[shuffle.next() % (i + 1)]);
+		}
+		for (int i = 0; i < 256; ++i) {
+			p[256 + i] = p[i];
+		}
+	}
+};
+
+static const Permutation permutation;
+
+// The twelve gradients toward the edges of a cube, with four repeated to make sixteen
+static const double gradientX[16] = {1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0, 1, 0, -1, 0};
+static const double gradientY[16] = {1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1, 1, -1, 1, -1};
+static const double gradientZ[16] = {0, 0, 0, 0, 1, 1, -1, -1, 1, 1, -1, -1, 0, 1, 0, -1};
+
+// Dot product of the offset from a lattice corner with the gradient chosen by the corner's hash
+static double gradient(int hash, double x, double y, double z) {
+	return gradientX[hash]*x + gradientY[hash]*y + gradientZ[hash]*z;
+}
+
+// Smooth step with zero first and second derivatives at 0 and 1
+static double fade(double t) {
+	return t*t*t*(t*(t*6 - 15) + 10);
+}
+
+static double lerp(double t, double a, double b) {
+	return a + t*(b - a);
+}
+
+Pattern::Pattern(const Colour& colour0, const Colour& colour1, double scale) :
+colour0_(colour0), colour1_(colour1), scale_(scale) {
+
+}
+
+Pattern::~Pattern() {
+
+}
+
+double Pattern::value(double x, double y, double z, double width) const {
+	double v;
+	value(&x, &y, &z, &width, &v, 1);
+	return v;
+}
+
+void Pattern::colours(const double* x, const double* y, const double* z, const double* width, Colour* colours, size_t n) const {
+	double v[maxBatch];
+	value(x, y, z, width, v, n);
+	for (size_t i = 0; i < n; ++i) {
+		colours[i] = (1 - v[i])*colour0_ + v[i]*colour1_;
+	}
+}
+
+void Pattern::noise(const double* x, const double* y, const double* z, double* v, size_t n) {
+	// The hashes of the corners of each point's lattice cell are looked up
+	// first, in a pass of their own, so that the interpolation which follows
+	// is a plain loop of arithmetic
+	const int* p = permutation.p;
+	double px[maxBatch], py[maxBatch], pz[maxBatch];
+	int hash[8][maxBatch];
+	for (size_t i = 0; i < n; ++i) {
+		double fx = std::floor(x[i]);
+		double fy = std::floor(y[i]);
+		double fz = std::floor(z[i]);
+		px[i] = x[i] - fx;
+		py[i] = y[i] - fy;
+		pz[i] = z[i] - fz;
+		int X = int((long long)fx & 255);
+		int Y = int((long long)fy & 255);
+		int Z = int((long long)fz & 255);
+		int A = p[X] + Y;
+		int AA = p[A] + Z;
+		int AB = p[A + 1] + Z;
+		int B = p[X + 1] + Y;
+		int BA = p[B] + Z;
+		int BB = p[B + 1] + Z;
+		hash[0][i] = p[AA] & 15;
+		hash[1][i] = p[BA] & 15;
+		hash[2][i] = p[AB] & 15;
+		hash[3][i] = p[BB] & 15;
+		hash[4][i] = p[AA + 1] & 15;
+		hash[5][i] = p[BA + 1] & 15;
+		hash[6][i] = p[AB + 1] & 15;
+		hash[7][i] = p[BB + 1] & 15;
+	}
+	for (size_t i = 0; i < n; ++i) {
+		double x0 = px[i], y0 = py[i], z0 = pz[i];
+		double x1 = x0 - 1, y1 = y0 - 1, z1 = z0 - 1;
+		double u = fade(x0);
+		double w = fade(y0);
+		double s = fade(z0);
+		v[i] = lerp(s, lerp(w, lerp(u, gradient(hash[0][i], x0, y0, z0), gradient(hash[1][i], x1, y0, z0)),
+		                       lerp(u, gradient(hash[2][i], x0, y1, z0), gradient(hash[3][i], x1, y1, z0))),
+		               lerp(w, lerp(u, gradient(hash[4][i], x0, y0, z1), gradient(hash[5][i], x1, y0, z1)),
+		                       lerp(u, gradient(hash[6][i], x0, y1, z1), gradient(hash[7][i], x1, y1, z1))));
+	}
+}
+
+void Pattern::fractal(const double* x, const double* y, const double* z, const double* width, bool turbulent, double* v, size_t n) const {
+	double px[maxBatch], py[maxBatch], pz[maxBatch], octave[maxBatch], weight[maxBatch];
+	for (size_t i = 0; i < n; ++i) {
+		v[i] = 0;
+	}
+	double frequency = 1/scale_;
+	double amplitude = 1;
+	for (unsigned int o = 0; o < octaves; ++o) {
+		// Octaves too fine to be seen anywhere in the batch are not evaluated
+		bool visible = false;
+		for (size_t i = 0; i < n; ++i) {
+			weight[i] = amplitude*detail(1/frequency, width[i]);
+			visible = visible || weight[i] > 0;
+		}
+		if (!visible) {
+			break;
+		}
+		for (size_t i = 0; i < n; ++i) {
+			px[i] = x[i]*frequency;
+			py[i] = y[i]*frequency;
+			pz[i] = z[i]*frequency;
+		}
+		noise(px, py, pz, octave, n);
+		for (size_t i = 0; i < n; ++i) {
+			v[i] += weight[i]*(turbulent ? std::abs(octave[i]) : octave[i]);
+		}
+		frequency *= 2;
+		amplitude *= 0.5;
+	}
+	// Scale by the sum of the amplitudes, so the result stays between about -1 and 1
+	double norm = 1/(2*(1 - std::pow(0.5, octaves)));
+	for (size_t i = 0; i < n; ++i) {
+		v[i] *= norm;
+	}
+}
+
+double Pattern::detail(double size, double width) {
+	if (width <= 0) {
+		return 1;
+	}
+	return std::max(0.0, std::min(1.0, size/(2*width) - 1));
+}
+
+NoisePattern::NoisePattern(const Colour& colour0, const Colour& colour1, double scale) :
+Pattern(colour0, colour1, scale) {
+
+}
+
+void NoisePattern::value(const double* x, const double* y, const double* z, const double* width, double* v, size_t n) const {
+	// Zeroed, so that noise() is never handed uninitialised values even when n is 0
+	double px[maxBatch] = {}, py[maxBatch] = {}, pz[maxBatch] = {};
+	for (size_t i = 0; i < n; ++i) {
+		px[i] = x[i]/scale_;
+		py[i] = y[i]/scale_;
+		pz[i] = z[i]/scale_;
+	}
+	noise(px, py, pz, v, n);
+	for (size_t i = 0; i < n; ++i) {
+		v[i] = std::max(0.0, std::min(1.0, 0.5 + 0.5*detail(scale_, width[i])*v[i]));
+	}
+}
+
+FbmPattern::FbmPattern(const Colour& colour0, const Colour& colour1, double scale) :
+Pattern(colour0, colour1, scale) {
+
+}
+
+void FbmPattern::value(const double* x, const double* y, const double* z, const double* width, double* v, size_t n) const {
+	fractal(x, y, z, width, false, v, n);
+	for (size_t i = 0; i < n; ++i) {
+		v[i] = std::max(0.0, std::min(1.0, 0.5 + 0.5*v[i]));
+	}
+}
+
+CheckerPattern::CheckerPattern(const Colour& colour0, const Colour& colour1, double scale) :
+Pattern(colour0, colour1, scale) {
+
+}
+
+void CheckerPattern::value(const double* x, const double* y, const double* z, const double* width, double* v, size_t n) const {
+	for (size_t i = 0; i < n; ++i) {
+		// Nudged, so that surfaces lying along a cell boundary (such as the Plane y = 0) are not speckled
+		long long cell = (long long)std::floor(x[i]/scale_ + epsilon) + (long long)std::floor(y[i]/scale_ + epsilon) +
+			(long long)std::floor(z[i]/scale_ + epsilon);
+		double square = (cell & 1) ? 1 : 0;
+		// Checks too small to see fade to their average
+		v[i] = 0.5 + (square - 0.5)*detail(2*scale_, width[i]);
+	}
+}
+
+MarblePattern::MarblePattern(const Colour& colour0, const Colour& colour1, double scale) :
+Pattern(colour0, colour1, scale) {
+
+}
+
+void MarblePattern::value(const double* x, const double* y, const double* z, const double* width, double* v, size_t n) const {
+	fractal(x, y, z, width, true, v, n);
+	for (size_t i = 0; i < n; ++i) {
+		double band = std::sin(2*M_PI*(x[i]/scale_ + 2*v[i]));
+		v[i] = 0.5 + 0.5*detail(scale_, width[i])*band;
+	}
+}
+
+WoodPattern::WoodPattern(const Colour& colour0, const Colour& colour1, double scale) :
+Pattern(colour0, colour1, scale) {
+
+}
+
+void WoodPattern::value(const double* x, const double* y, const double* z, const double* width, double* v, size_t n) const {
+	// The grain is stretched along the Y-axis, like a tree trunk
+	// Zeroed, so that noise() is never handed uninitialised values even when n is 0
+	double px[maxBatch] = {}, py[maxBatch] = {}, pz[maxBatch] = {};
+	for (size_t i = 0; i < n; ++i) {
+		px[i] = x[i]/scale_;
+		py[i] = 0.25*y[i]/scale_;
+		pz[i] = z[i]/scale_;
+	}
+	noise(px, py, pz, v, n);
+	for (size_t i = 0; i < n; ++i) {
+		double ring = std::sqrt(px[i]*px[i] + pz[i]*pz[i]) + 0.5*v[i];
+		v[i] = 0.5 + 0.5*detail(scale_, width[i])*std::cos(2*M_PI*ring);
+	}
+}
@@ -0,0 +1,234 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef PATTERN_H_INCLUDED
+#define PATTERN_H_INCLUDED
+
+#include "Colour.h"
+
+#include <cstddef>
+
+/**
+ * \file
+ * \brief Pattern class header file.
+ */
+
+/**
+ * \brief Abstract base class for procedural patterns.
+ *
+ * A Pattern varies a Material's Colours across a surface, like a Texture,
+ * but it is computed from a formula rather than looked up in an image, so
+ * it has unlimited detail and uses almost no memory. Patterns are solid:
+ * they are defined throughout space, and are evaluated at the Point where
+ * a Ray hits a surface, so they run through Objects like the grain of wood
+ * or the veins of marble.
+ *
+ * Each Pattern gives a value between 0 and 1 at each point, which blends
+ * between two Colours. The size of the pattern's features is set by a scale,
+ * and detail much smaller than the width of a pixel is faded out, so that
+ * it does not alias.
+ *
+ * Many of the patterns are built from Perlin noise, which is slow to
+ * evaluate one point at a time. Values are therefore found for batches of
+ * up to maxBatch points at once, from separate arrays of X-, Y-, and
+ * Z-co-ordinates, so that the loops over the points can be vectorised by
+ * the compiler (as for DistanceFunction).
+ */
+class Pattern {
+
+public:
+
+	/** \brief Pattern destructor. */
+	virtual ~Pattern();
+
+	/** \brief Values of the Pattern for a batch of points.
+	 *
+	 * \param x The X-co-ordinates of the points.
+	 * \param y The Y-co-ordinates of the points.
+	 * \param z The Z-co-ordinates of the points.
+	 * \param width The width of the area seen by a pixel around each point, or 0 for full detail.
+	 * \param v Set to the value at each point, between 0 and 1.
+	 * \param n The number of points, which must be at most maxBatch.
+	 */
+	virtual void value(const double* x, const double* y, const double* z, const double* width, double* v, size_t n) const = 0;
+
+	/** \brief Value of the Pattern at a single point.
+	 *
+	 * \param x The X-co-ordinate of the point.
+	 * \param y The Y-co-ordinate of the point.
+	 * \param z The Z-co-ordinate of the point.
+	 * \param width The width of the area seen by a pixel around the point, or 0 for full detail.
+	 * \return The value at the point, between 0 and 1.
+	 */
+	double value(double x, double y, double z, double width = 0) const;
+
+	/** \brief Colours of the Pattern for a batch of points.
+	 *
+	 * \param x The X-co-ordinates of the points.
+	 * \param y The Y-co-ordinates of the points.
+	 * \param z The Z-co-ordinates of the points.
+	 * \param width The width of the area seen by a pixel around each point, or 0 for full detail.
+	 * \param colours Set to the Colour at each point.
+	 * \param n The number of points, which must be at most maxBatch.
+	 */
+	void colours(const double* x, const double* y, const double* z, const double* width, Colour* colours, size_t n) const;
+
+	static const size_t maxBatch = 8;       //!< The largest batch of points that can be evaluated at once.
+	static const unsigned int octaves = 6;  //!< The number of octaves of noise in fractal patterns.
+
+protected:
+
+	/** \brief Pattern constructor.
+	 *
+	 * \param colour0 The Colour where the value is 0.
+	 * \param colour1 The Colour where the value is 1.
+	 * \param scale The size of the Pattern's features.
+	 */
+	Pattern(const Colour& colour0, const Colour& colour1, double scale);
+
+	/** \brief Perlin noise for a batch of points.
+	 *
+	 * This is Ken Perlin's improved noise, which varies smoothly between about
+	 * -1 and 1, with features about one unit across, and is 0 at whole-number
+	 * co-ordinates.
+	 *
+	 * \param x The X-co-ordinates of the points.
+	 * \param y The Y-co-ordinates of the points.
+	 * \param z The Z-co-ordinates of the points.
+	 * \param v Set to the noise at each point.
+	 * \param n The number of points, which must be at most maxBatch.
+	 */
+	static void noise(const double* x, const double* y, const double* z, double* v, size_t n);
+
+	/** \brief Fractal sum of octaves of noise for a batch of points.
+	 *
+	 * Each octave has twice the frequency and half the amplitude of the one
+	 * before. The points are divided by \c scale first, so the largest
+	 * features are about \c scale across. The sum is between about -1 and 1,
+	 * or between 0 and 1 if \c turbulent is set.
+	 *
+	 * \param x The X-co-ordinates of the points.
+	 * \param y The Y-co-ordinates of the points.
+	 * \param z The Z-co-ordinates of the points.
+	 * \param width The width of the area seen by a pixel around each point.
+	 * \param turbulent If true, the absolute values of the octaves are summed, giving sharp creases.
+	 * \param v Set to the sum at each point.
+	 * \param n The number of points, which must be at most maxBatch.
+	 */
+	void fractal(const double* x, const double* y, const double* z, const double* width, bool turbulent, double* v, size_t n) const;
+
+	/** \brief How much of a feature of a given size can be seen.
+	 *
+	 * \param size The size of the feature.
+	 * \param width The width of the area seen by a pixel.
+	 * \return 1 for features at least four times the width, falling to 0 for features only twice the width.
+	 */
+	static double detail(double size, double width);
+
+	Colour colour0_; //!< The Colour where the value is 0.
+	Colour colour1_; //!< The Colour where the value is 1.
+	double scale_;   //!< The size of the Pattern's features.
+
+};
+
+/**
+ * \brief A single octave of Perlin noise.
+ */
+class NoisePattern : public Pattern {
+
+public:
+
+	/** \brief NoisePattern constructor.
+	 *
+	 * \param colour0 The Colour where the value is 0.
+	 * \param colour1 The Colour where the value is 1.
+	 * \param scale The size of the blobs of noise.
+	 */
+	NoisePattern(const Colour& colour0, const Colour& colour1, double scale);
+
+	using Pattern::value;
+	void value(const double* x, const double* y, const double* z, const double* width, double* v, size_t n) const;
+
+};
+
+/**
+ * \brief Fractal Brownian motion: several octaves of Perlin noise, giving detail at every scale.
+ */
+class FbmPattern : public Pattern {
+
+public:
+
+	/** \brief FbmPattern constructor.
+	 *
+	 * \param colour0 The Colour where the value is 0.
+	 * \param colour1 The Colour where the value is 1.
+	 * \param scale The size of the largest features.
+	 */
+	FbmPattern(const Colour& colour0, const Colour& colour1, double scale);
+
+	using Pattern::value;
+	void value(const double* x, const double* y, const double* z, const double* width, double* v, size_t n) const;
+
+};
+
+/**
+ * \brief A three-dimensional checkerboard of cubes.
+ */
+class CheckerPattern : public Pattern {
+
+public:
+
+	/** \brief CheckerPattern constructor.
+	 *
+	 * \param colour0 The Colour of half of the cubes.
+	 * \param colour1 The Colour of the other half.
+	 * \param scale The size of each cube.
+	 */
+	CheckerPattern(const Colour& colour0, const Colour& colour1, double scale);
+
+	using Pattern::value;
+	void value(const double* x, const double* y, const double* z, const double* width, double* v, size_t n) const;
+
+};
+
+/**
+ * \brief Marble: bands across the X-axis, distorted by turbulence.
+ */
+class MarblePattern : public Pattern {
+
+public:
+
+	/** \brief MarblePattern constructor.
+	 *
+	 * \param colour0 The Colour of the stone.
+	 * \param colour1 The Colour of the veins.
+	 * \param scale The spacing of the bands.
+	 */
+	MarblePattern(const Colour& colour0, const Colour& colour1, double scale);
+
+	using Pattern::value;
+	void value(const double* x, const double* y, const double* z, const double* width, double* v, size_t n) const;
+
+};
+
+/**
+ * \brief Wood: rings around the Y-axis, wobbled by noise.
+ */
+class WoodPattern : public Pattern {
+
+public:
+
+	/** \brief WoodPattern constructor.
+	 *
+	 * \param colour0 The Colour between the rings.
+	 * \param colour1 The Colour of the rings.
+	 * \param scale The spacing of the rings.
+	 */
+	WoodPattern(const Colour& colour0, const Colour& colour1, double scale);
+
+	using Pattern::value;
+	void value(const double* x, const double* y, const double* z, const double* width, double* v, size_t n) const;
+
+};
+
+#endif // PATTERN_H_INCLUDED
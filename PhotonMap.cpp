@@ -0,0 +1,155 @@
+/* $Rev: 250 $ */
+#include "PhotonMap.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <thread>
+
+const size_t PhotonMap::threadedSize;
+
+PhotonMap::PhotonMap() : photons_() {
+
+}
+
+PhotonMap::PhotonMap(const PhotonMap& map) : photons_(map.photons_) {
+
+}
+
+PhotonMap::~PhotonMap() {
+
+}
+
+PhotonMap& PhotonMap::operator=(const PhotonMap& map) {
+	if (this != &map) {
+		photons_ = map.photons_;
+	}
+	return *this;
+}
+
+void PhotonMap::clear() {
+	photons_.clear();
+}
+
+size_t PhotonMap::size() const {
+	return photons_.size();
+}
+
+void PhotonMap::build(std::vector<Photon>& photons, unsigned int threads) {
+	photons_.clear();
+	photons_.swap(photons);
+	balance(0, photons_.size(), std::max(threads, 1u));
+}
+
+void PhotonMap::balance(size_t first, size_t last, unsigned int threads) {
+	if (last <= first) {
+		return;
+	}
+
+	// Split along the axis on which the photons are most spread out
+	float low[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+	float high[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+	for (size_t i = first; i < last; ++i) {
+		for (int a = 0; a < 3; ++a) {
+			low[a] = std::min(low[a], photons_[i].point[a]);
+			high[a] = std::max(high[a], photons_[i].point[a]);
+		}
+	}
+	unsigned char axis = 0;
+	for (unsigned char a = 1; a < 3; ++a) {
+		if (high[a] - low[a] > high[axis] - low[axis]) {
+			axis = a;
+		}
+	}
+
+	size_t middle = first + (last - first)/2;
+	std::nth_element(photons_.begin() + first, photons_.begin() + middle, photons_.begin() + last,
+		[axis](const Photon& lhs, const Photon& rhs) { return lhs.point[axis] < rhs.point[axis]; });
+	photons_[middle].axis = axis;
+
+	if (threads > 1 && last - first >= threadedSize) {
+		std::thread below(&PhotonMap::balance, this, first, middle, threads/2);
+		balance(middle + 1, last, threads - threads/2);
+		below.join();
+	} else {
+		balance(first, middle, 1);
+		balance(middle + 1, last, 1);
+	}
+}
+
+Colour PhotonMap::irradiance(const Point& point, const Vector& normal, unsigned int neighbours, double maxRadius) const {
+	if (photons_.empty() || neighbours == 0) {
+		return Colour(0,0,0);
+	}
+	float p[3] = {float(point(0)), float(point(1)), float(point(2))};
+	Neighbours nearest;
+	nearest.reserve(neighbours);
+	float maxSquared = float(maxRadius*maxRadius);
+	gather(0, photons_.size(), p, neighbours, nearest, maxSquared);
+	if (nearest.empty()) {
+		return Colour(0,0,0);
+	}
+
+	// The cone filter takes the weight from 1 at the Point down to 0 at the
+	// edge of the disc, so it covers a third of the disc's area
+	double radius = std::sqrt(double(maxSquared));
+	double total[3] = {0, 0, 0};
+	for (const std::pair<float, size_t>& neighbour : nearest) {
+		const Photon& photon = photons_[neighbour.second];
+		double arriving = photon.direction[0]*normal(0) + photon.direction[1]*normal(1) + photon.direction[2]*normal(2);
+		if (arriving >= 0) {
+			continue;
+		}
+		double weight = 1 - std::sqrt(double(neighbour.first))/radius;
+		for (int c = 0; c < 3; ++c) {
+			total[c] += weight*photon.power[c];
+		}
+	}
+	double area = M_PI*radius*radius/3;
+	return Colour(total[0]/area, total[1]/area, total[2]/area);
+}
+
+void PhotonMap::gather(size_t first, size_t last, const float point[3], unsigned int neighbours, Neighbours& nearest, float& maxSquared) const {
+	if (last <= first) {
+		return;
+	}
+	size_t middle = first + (last - first)/2;
+	const Photon& photon = photons_[middle];
+
+	// Search the half containing the Point first, as it is likely to shrink the search
+	if (last - first > 1) {
+		float offset = point[photon.axis] - photon.point[photon.axis];
+		if (offset < 0) {
+			gather(first, middle, point, neighbours, nearest, maxSquared);
+			if (offset*offset < maxSquared) {
+				gather(middle + 1, last, point, neighbours, nearest, maxSquared);
+			}
+		} else {
+			gather(middle + 1, last, point, neighbours, nearest, maxSquared);
+			if (offset*offset < maxSquared) {
+				gather(first, middle, point, neighbours, nearest, maxSquared);
+			}
+		}
+	}
+
+	float dx = point[0] - photon.point[0];
+	float dy = point[1] - photon.point[1];
+	float dz = point[2] - photon.point[2];
+	float squared = dx*dx + dy*dy + dz*dz;
+	if (squared >= maxSquared) {
+		return;
+	}
+	if (nearest.size() < neighbours) {
+		nearest.push_back(std::make_pair(squared, middle));
+		std::push_heap(nearest.begin(), nearest.end());
+		if (nearest.size() < neighbours) {
+			return;
+		}
+	} else {
+		// Replace the furthest of the nearest photons
+		std::pop_heap(nearest.begin(), nearest.end());
+		nearest.back() = std::make_pair(squared, middle);
+		std::push_heap(nearest.begin(), nearest.end());
+	}
+	maxSquared = nearest.front().first;
+}
@@ -0,0 +1,140 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef PHOTON_MAP_H_INCLUDED
+#define PHOTON_MAP_H_INCLUDED
+
+#include "Colour.h"
+#include "Point.h"
+#include "Vector.h"
+
+#include <utility>
+#include <vector>
+
+/**
+ * \file
+ * \brief PhotonMap class header file.
+ */
+
+/**
+ * \brief A store of photons traced out from the LightSources, for finding the light they leave on surfaces.
+ *
+ * Light which reaches a diffuse surface after reflecting off mirrors forms
+ * caustics, such as the bright patch focused by a curved mirror. Tracing
+ * Rays back from the Camera cannot find these, as the only way back to the
+ * LightSource is through the mirror, in one exact Direction. Instead,
+ * photons are traced forward from the LightSources (see LightSource::emit()),
+ * and each one that lands on a diffuse surface is stored. The irradiance at
+ * a Point is then estimated from the density of the photons around it
+ * (Jensen, 1996).
+ *
+ * The photons are kept in a balanced kd-tree held in a single array. The
+ * photons in each range of the array are split at their median along the
+ * axis on which they are most spread out, and the median photon is stored
+ * in the middle of the range, with the two halves on either side, so no
+ * links between nodes are needed, and nearby photons are close together in
+ * memory. Photons are stored in single precision, which is plenty for
+ * estimating a density, to keep more of them in each cache line. The two
+ * halves of each range are independent, so the tree is built by several
+ * threads at once.
+ *
+ * Once built, a PhotonMap is only read, so it may be used from several
+ * threads at once.
+ */
+class PhotonMap {
+
+public:
+
+	/** \brief A photon which has landed on a surface. */
+	struct Photon {
+		float point[3];     //!< Where the photon landed.
+		float direction[3]; //!< The unit Direction the photon was travelling in.
+		float power[3];     //!< The red, green, and blue power of the photon (see LightSource::emit()).
+		unsigned char axis; //!< The axis along which the photon splits its range of the kd-tree.
+	};
+
+	/** \brief PhotonMap default constructor.
+	 *
+	 * A newly constructed PhotonMap holds no photons.
+	 */
+	PhotonMap();
+
+	/** \brief PhotonMap copy constructor.
+	 *
+	 * \param map The PhotonMap to copy.
+	 */
+	PhotonMap(const PhotonMap& map);
+
+	/** \brief PhotonMap destructor. */
+	~PhotonMap();
+
+	/** \brief PhotonMap assignment operator.
+	 *
+	 * \param map The PhotonMap to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	PhotonMap& operator=(const PhotonMap& map);
+
+	/** \brief Remove all of the photons. */
+	void clear();
+
+	/** \brief The number of photons held.
+	 *
+	 * \return The number of photons.
+	 */
+	size_t size() const;
+
+	/** \brief Replace the photons, and build the kd-tree over them.
+	 *
+	 * \param photons The photons, which are moved into the PhotonMap, leaving \c photons empty.
+	 * \param threads The number of threads to build the kd-tree with.
+	 */
+	void build(std::vector<Photon>& photons, unsigned int threads);
+
+	/** \brief Estimate the irradiance at a Point from the photons around it.
+	 *
+	 * The nearest photons to the Point, up to \c neighbours of them, and no
+	 * further than \c maxRadius away, are found. Only photons arriving at
+	 * the front of the surface are counted. Their power is shared over the
+	 * disc which they cover, with a cone filter which gives more weight to
+	 * those nearest the Point, so that the edges of caustics stay sharp.
+	 *
+	 * \param point The Point.
+	 * \param normal The unit Normal of the surface at the Point, facing the side where the light is wanted.
+	 * \param neighbours The most photons to use.
+	 * \param maxRadius The furthest from the Point to look for photons.
+	 * \return The irradiance, as the intensity of a LightSample shining straight onto the surface.
+	 */
+	Colour irradiance(const Point& point, const Vector& normal, unsigned int neighbours, double maxRadius) const;
+
+private:
+
+	/** \brief The squared distances and indices of the nearest photons found so far, as a max-heap. */
+	typedef std::vector<std::pair<float, size_t>> Neighbours;
+
+	/** \brief Arrange a range of the photons into a kd-tree.
+	 *
+	 * \param first The index of the first photon in the range.
+	 * \param last One past the index of the last photon in the range.
+	 * \param threads The number of threads to build with.
+	 */
+	void balance(size_t first, size_t last, unsigned int threads);
+
+	/** \brief Find the photons in a range of the kd-tree which are near a Point.
+	 *
+	 * \param first The index of the first photon in the range.
+	 * \param last One past the index of the last photon in the range.
+	 * \param point The Point.
+	 * \param neighbours The most photons to find.
+	 * \param nearest The nearest photons found so far, which is updated.
+	 * \param maxSquared The squared distance within which to look, which shrinks once \c neighbours photons are found.
+	 */
+	void gather(size_t first, size_t last, const float point[3], unsigned int neighbours, Neighbours& nearest, float& maxSquared) const;
+
+	static const size_t threadedSize = 16384; //!< Smallest range of photons worth handing to another thread when building.
+
+	std::vector<Photon> photons_; //!< The photons, as a kd-tree.
+
+};
+
+#endif // PHOTON_MAP_H_INCLUDED
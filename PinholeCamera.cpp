@@ -29,3 +29,24 @@ Ray PinholeCamera::castRay(double x, double y) const {
 	ray.direction(2) = focalLength;
 	return transform.apply(ray);
 }
+
+Ray PinholeCamera::castRay(double x, double y, double pixelSize) const {
+	Ray ray;
+	ray.point = Point::zero(3,1);
+	ray.direction(0) = x;
+	ray.direction(1) = y;
+	ray.direction(2) = focalLength;
+	ray = transform.apply(ray);
+	// The start Point is the same for every pixel, and a step across the
+	// image plane changes the Direction as the Camera's Transform says
+	Direction dDdx = transform.apply(Direction(pixelSize, 0, 0));
+	Direction dDdy = transform.apply(Direction(0, pixelSize, 0));
+	for (int i = 0; i < 3; ++i) {
+		ray.differential.dPdx[i] = 0;
+		ray.differential.dPdy[i] = 0;
+		ray.differential.dDdx[i] = dDdx(i);
+		ray.differential.dDdy[i] = dDdy(i);
+	}
+	ray.hasDifferential = true;
+	return ray;
+}
@@ -62,6 +62,19 @@ public:
 	 */
 	Ray castRay(double x, double y) const;
 
+	/** \brief Generate a ray with differentials for a given image plane co-ordinate
+	 *
+	 * All the Rays from a PinholeCamera start at the same Point, and their 
+	 * Directions change by one pixel in x or y, so the differentials are known 
+	 * without casting any more Rays.
+	 *
+	 * \param x the horizontal location
+	 * \param y the vertical location
+	 * \param pixelSize the width and height of a pixel, in image plane co-ordinates
+	 * \return The Ray that passes from the Camera through (x,y) in the image plane, with differentials.
+	 */
+	Ray castRay(double x, double y, double pixelSize) const;
+
 	double focalLength; //!< The distance from the camera centre to the image plane.
 
 private:
@@ -0,0 +1,67 @@
+/* $Rev: 250 $ */
+#include "Plane.h"
+
+#include "utility.h"
+
+Plane::Plane() : Object() {
+
+}
+
+Plane::Plane(const Plane& plane) : Object(plane) {
+
+}
+
+Plane::~Plane() {
+
+}
+
+const Plane& Plane::operator=(const Plane& plane) {
+	if (this != &plane) {
+		Object::operator=(plane);
+	}
+	return *this;
+}
+
+BoundingBox Plane::getBounds() const {
+	return BoundingBox::infinite();
+}
+
+RayIntersectionList Plane::intersect(const Ray& ray) const {
+	RayIntersectionList result(1);
+	result.resize(intersectInto(ray, result.data(), result.size()));
+	return result;
+}
+
+size_t Plane::intersectInto(const Ray& ray, RayIntersection* hits, size_t maxHits) const {
+
+	Ray inverseRay = transform.applyInverse(ray);
+
+	double dy = inverseRay.direction(1);
+	if (std::abs(dy) < epsilon*epsilon) {
+		// Parallel to the plane
+		return 0;
+	}
+
+	double d = -inverseRay.point(1)/dy;
+	if (d > 0) {
+		// Intersection is in front of the ray's start point
+		if (maxHits == 0) {
+			return 1;
+		}
+		RayIntersection& hit = hits[0];
+		hit.material = material;
+		hit.point = transform.apply(Point(inverseRay.point + d*inverseRay.direction));
+		hit.normal = transform.apply(Normal(0,1,0));
+		hit.u = inverseRay.point(0) + d*inverseRay.direction(0);
+		hit.v = inverseRay.point(2) + d*inverseRay.direction(2);
+		hit.textureScale = inverseRay.direction.norm()/ray.direction.norm();
+		hit.spherical = false;
+		if (hit.normal.dot(ray.direction) > 0) {
+			hit.normal = -hit.normal;
+		}
+		hit.distance = (hit.point - ray.point).norm();
+		return 1;
+	}
+
+	return 0;
+}
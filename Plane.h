@@ -0,0 +1,85 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef PLANE_H_INCLUDED
+#define PLANE_H_INCLUDED
+
+#include "Object.h"
+
+/** 
+ * \file
+ * \brief Plane class header file.
+ */
+
+/**
+ * \brief Class for Plane objects.
+ * 
+ * This class provides an Object which is the infinite plane \f$y = 0\f$, with
+ * normal \f$(0,1,0)\f$. It is mostly useful for floors, walls, and the like, 
+ * which would otherwise have to be made from very large Spheres. Its texture
+ * co-ordinates are its x and z co-ordinates, so Textures repeat every unit.
+ *
+ * A Plane has no inside, so the Ray crosses its surface only once. This
+ * means that it should not be used as a child of a CSG node.
+ */
+class Plane : public Object {
+
+public:
+
+	/** \brief Plane default constructor.
+	 * 
+	 * A newly constructed Plane is the plane \f$y = 0\f$.
+	 * It may be moved and rotated through its transform member.
+	 */
+	Plane();
+
+	/** \brief Plane copy constructor.
+	 *
+	 * \param plane The Plane to copy.
+	 */
+	Plane(const Plane& plane);
+	
+	/** \brief Plane destructor. */
+	~Plane();
+	
+	/** \brief Plane assignment operator.
+	 *
+	 * \param plane The Plane to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	const Plane& operator=(const Plane& plane);
+	
+	/** \brief Plane-Ray intersection computation.
+	 *
+	 * In the Plane's co-ordinate frame the Ray meets the plane \f$y = 0\f$ at
+	 * \f$t = -o_y/d_y\f$, where \f$\mathbf{o}\f$ and \f$\mathbf{d}\f$ are
+	 * the Ray's start point and direction. A Ray parallel to the plane misses it.
+	 *
+	 * \param ray The Ray to intersect with this Plane.
+	 * \return A list of intersections, which may be empty.
+	 */
+	RayIntersectionList intersect(const Ray& ray) const;
+
+	/** \brief Plane-Ray intersection computation, into storage given by the caller.
+	 *
+	 * This is the same as intersect(), but writes the hits over \c hits, so
+	 * that a Plane in a CSG tree does not make a list (see Object::intersectInto()).
+	 *
+	 * \param ray The Ray to intersect with this Plane.
+	 * \param hits Where to write the intersections.
+	 * \param maxHits The number of RayIntersections in \c hits.
+	 * \return The number of intersections, or more than \c maxHits if they do not fit.
+	 */
+	size_t intersectInto(const Ray& ray, RayIntersection* hits, size_t maxHits) const;
+
+	/** \brief Bounds of the Plane.
+	 *
+	 * A Plane is unbounded, so it is kept out of any BVH.
+	 *
+	 * \return An infinite BoundingBox.
+	 */
+	BoundingBox getBounds() const;
+
+};
+
+#endif // PLANE_H_INCLUDED
@@ -3,6 +3,8 @@
 
 #include "utility.h"
 
+#include <algorithm>
+
 PointLightSource::PointLightSource() : 
 LightSource() {
 
@@ -29,3 +31,11 @@ double PointLightSource::getIntensityAt(const Point& point) const {
 	if (distance < epsilon) distance = epsilon;
 	return 1 / (distance*distance);
 }
+
+double PointLightSource::influenceRadius(double threshold) const {
+	if (threshold <= 0) {
+		return infinity;
+	}
+	double brightest = std::max(colour.red, std::max(colour.green, colour.blue));
+	return std::sqrt(std::max(brightest, 0.0)/threshold);
+}
@@ -59,6 +59,16 @@ public:
 	 */
 	double getIntensityAt(const Point& point) const;
 
+	/** \brief How far the light from this PointLightSource reaches.
+	 *
+	 * The brightest component of the colour, \f$c\f$, falls to the threshold
+	 * \f$t\f$ at distance \f$\sqrt{c/t}\f$.
+	 *
+	 * \param threshold The smallest amount of light that matters.
+	 * \return The distance at which the light falls below \c threshold, or \c infinity if the threshold is not positive.
+	 */
+	double influenceRadius(double threshold) const;
+
 };
 
 #endif
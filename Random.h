@@ -0,0 +1,65 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef RANDOM_H_INCLUDED
+#define RANDOM_H_INCLUDED
+
+#include <cstdint>
+
+/**
+ * \file
+ * \brief Random class header file.
+ */
+
+/**
+ * \brief A small, fast source of pseudo-random numbers.
+ *
+ * Stochastic methods, such as sampling lights, need a lot of random numbers,
+ * and renders should come out the same every time. This uses the SplitMix64
+ * generator, which is tiny and quick, and gives well-mixed streams even from
+ * consecutive seeds, so each pixel can simply be seeded with its index.
+ */
+class Random {
+
+public:
+
+	/** \brief Random constructor.
+	 *
+	 * \param seed The starting point of the sequence.
+	 */
+	explicit Random(uint64_t seed = 0) : state_(seed) {}
+
+	/** \brief Restart the sequence.
+	 *
+	 * \param seed The new starting point of the sequence.
+	 */
+	void seed(uint64_t seed) {
+		state_ = seed;
+	}
+
+	/** \brief The next number in the sequence.
+	 *
+	 * \return A pseudo-random 64 bit integer.
+	 */
+	uint64_t next() {
+		uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	/** \brief A uniformly distributed number.
+	 *
+	 * \return A pseudo-random number in the range [0,1).
+	 */
+	double uniform() {
+		return (next() >> 11)*(1.0/9007199254740992.0);
+	}
+
+private:
+
+	uint64_t state_; //!< Current state of the generator.
+
+};
+
+#endif // RANDOM_H_INCLUDED
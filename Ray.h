@@ -6,6 +6,7 @@
 
 #include "Point.h"
 #include "Direction.h"
+#include "RayDifferential.h"
 
 /**
  * \file
@@ -17,11 +18,19 @@
  *
  * Unsurprisingly, a Ray is a fundamental concept in ray-tracing.
  * A Ray is defined by the Point at which it starts, and the Direction in which it goes.
+ *
+ * Rays from the Camera can also carry a RayDifferential, giving the size of
+ * the pixel they stand for. Most Rays, such as shadow Rays, have none.
  */
 class Ray {
 public:
+	/** \brief Ray default constructor, for a Ray without a RayDifferential. */
+	Ray() : point(), direction(), differential(), hasDifferential(false) {}
+
 	Point point; //!< The starting Point for the Ray.
 	Direction direction; //!< The Direction for the Ray.
+	RayDifferential differential; //!< How the Ray changes from pixel to pixel, if hasDifferential is set.
+	bool hasDifferential; //!< Whether the differential is tracked for this Ray.
 };
 
 #endif
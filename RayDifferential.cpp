@@ -0,0 +1,79 @@
+/* $Rev: 250 $ */
+#include "RayDifferential.h"
+
+#include "utility.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Dot product of a differential with a Vector, summed in the same order as Vector::dot()
+static double dot(const double a[3], const Vector& b) {
+	double sum = 0;
+	for (int i = 0; i < 3; ++i) {
+		sum += a[i] * b(i);
+	}
+	return sum;
+}
+
+// Length of a differential
+static double norm(const double a[3]) {
+	double sum = 0;
+	for (int i = 0; i < 3; ++i) {
+		sum += a[i] * a[i];
+	}
+	return std::sqrt(sum);
+}
+
+RayDifferential RayDifferential::transfer(const Direction& direction, double t, const Vector& normal) const {
+	RayDifferential result;
+	double along = direction.dot(normal);
+	if (std::abs(along) < epsilon) {
+		// A grazing hit, where the footprint is stretched without limit
+		along = along < 0 ? -epsilon : epsilon;
+	}
+	double px[3], py[3];
+	for (int i = 0; i < 3; ++i) {
+		px[i] = dPdx[i] + t*dDdx[i];
+		py[i] = dPdy[i] + t*dDdy[i];
+	}
+	double sx = dot(px, normal)/along;
+	double sy = dot(py, normal)/along;
+	for (int i = 0; i < 3; ++i) {
+		result.dPdx[i] = px[i] - sx*direction(i);
+		result.dPdy[i] = py[i] - sy*direction(i);
+		result.dDdx[i] = dDdx[i];
+		result.dDdy[i] = dDdy[i];
+	}
+	return result;
+}
+
+RayDifferential RayDifferential::reflect(const Direction& direction, const Vector& normal) const {
+	RayDifferential result;
+
+	// Differentials of the unit Direction, then of its reflection
+	double length2 = direction.squaredNorm();
+	double length = std::sqrt(length2);
+	double dx = 0, dy = 0;
+	for (int i = 0; i < 3; ++i) {
+		dx += direction(i) * dDdx[i];
+		dy += direction(i) * dDdy[i];
+	}
+	double ux[3], uy[3];
+	for (int i = 0; i < 3; ++i) {
+		ux[i] = (length2*dDdx[i] - dx*direction(i))/(length2*length);
+		uy[i] = (length2*dDdy[i] - dy*direction(i))/(length2*length);
+	}
+	double nx = 2*dot(ux, normal);
+	double ny = 2*dot(uy, normal);
+	for (int i = 0; i < 3; ++i) {
+		result.dPdx[i] = dPdx[i];
+		result.dPdy[i] = dPdy[i];
+		result.dDdx[i] = ux[i] - nx*normal(i);
+		result.dDdy[i] = uy[i] - ny*normal(i);
+	}
+	return result;
+}
+
+double RayDifferential::width() const {
+	return std::max(norm(dPdx), norm(dPdy));
+}
@@ -0,0 +1,74 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef RAY_DIFFERENTIAL_H_INCLUDED
+#define RAY_DIFFERENTIAL_H_INCLUDED
+
+#include "Direction.h"
+#include "Vector.h"
+
+/**
+ * \file
+ * \brief RayDifferential class header file.
+ */
+
+/**
+ * \brief Class to store how a Ray changes from one pixel to the next.
+ *
+ * A Ray from the Camera stands for a whole pixel, which covers a patch of
+ * whatever surface it hits. The size of that patch says how much detail
+ * can be seen, for example which mip level of a Texture to use. It is 
+ * tracked by the ray differentials: how far the Ray's start Point and
+ * Direction change for a step of one pixel across (x) or down (y) the
+ * image. These follow the Ray through mirror reflections.
+ *
+ * The differentials are linear in the Ray's parameter, so they are kept 
+ * for the Ray's Direction as it is, without normalising it.
+ *
+ * Every Ray from the Camera carries one, so they are kept as plain arrays,
+ * which can be copied along with the Ray without allocating any memory.
+ * They are only tracked in the world frame: the Objects' Transforms do not
+ * change them, since the footprint is only needed at the hit which is shaded.
+ */
+class RayDifferential {
+
+public:
+
+	double dPdx[3]; //!< Change in the start Point for a step of one pixel in x.
+	double dPdy[3]; //!< Change in the start Point for a step of one pixel in y.
+	double dDdx[3]; //!< Change in the Direction for a step of one pixel in x.
+	double dDdy[3]; //!< Change in the Direction for a step of one pixel in y.
+
+	/** \brief Move the differentials to where the Ray hits a surface.
+	 *
+	 * The neighbouring Rays are followed to the plane which touches the 
+	 * surface at the hit, so the changes in the start Point of the result
+	 * give the patch of surface covered by the pixel.
+	 *
+	 * \param direction The Direction of the Ray.
+	 * \param t The Ray parameter of the hit (its distance over the length of \c direction).
+	 * \param normal The unit Normal of the surface at the hit.
+	 * \return The differentials of a Ray starting at the hit, with the same Direction.
+	 */
+	RayDifferential transfer(const Direction& direction, double t, const Vector& normal) const;
+
+	/** \brief Reflect the differentials in a mirror.
+	 *
+	 * The mirror is treated as flat near the hit, so curved mirrors spread
+	 * the footprint less than they should.
+	 *
+	 * \param direction The Direction of the incoming Ray.
+	 * \param normal The unit Normal of the mirror.
+	 * \return The differentials of the reflected Ray, whose Direction is a unit Vector.
+	 */
+	RayDifferential reflect(const Direction& direction, const Vector& normal) const;
+
+	/** \brief The size of the patch covered by the Ray.
+	 *
+	 * \return The larger of the changes in the start Point for one pixel in x and in y.
+	 */
+	double width() const;
+
+};
+
+#endif // RAY_DIFFERENTIAL_H_INCLUDED
@@ -7,8 +7,10 @@
 #include "Point.h"
 #include "Material.h"
 #include "Normal.h"
+#include "ScratchArena.h"
 
 #include <memory>
+#include <vector>
 
 /**
  * \file
@@ -22,6 +24,7 @@
  * A RayIntersection stores the information about this intersection. As well as 
  * the Point at which the intersection occurs, the Normal to the object at that location,
  * the Material of the object, and the distance along the ray are all required.
+ * Objects also give texture co-ordinates, for looking up any Textures in the Material.
  *
  * RayInteresections can also be sorted on distance along the ray.
  */
@@ -33,6 +36,11 @@ public:
 	Normal normal; //!< The Normal at the Point of intersection.
 	Material material; //!< The Material of the Object that is hit.
 	double distance; //!< The distance along the Ray to the intersection Point.
+	double u; //!< The first texture co-ordinate at the intersection Point (see Texture).
+	double v; //!< The second texture co-ordinate at the intersection Point (see Texture).
+	double w; //!< The third co-ordinate of the Point hit on a Sphere, while its texture co-ordinates are deferred (see spherical).
+	double textureScale; //!< Roughly how fast the texture co-ordinates change with distance across the surface, near the intersection Point.
+	bool spherical; //!< If true, \c u, \c v, and \c w are still the Point hit on a unit Sphere in its own frame, and Sphere::textureCoordinates() must be called before they are used.
 
 	/** \brief Less-than comparison for RayIntersection.
 	 * 
@@ -44,10 +52,13 @@ public:
 	 * \param ri The RayIntersection to compare to \c this
 	 * \return true if \c this.distance is less than \c ri.distance, false otherwise.
 	 */
-	bool operator<(const RayIntersection& ri) {
+	bool operator<(const RayIntersection& ri) const {
 		return distance < ri.distance;
 	}
 
 };
 
+/** \brief A list of RayIntersections, kept in the ScratchArena of the thread which finds them until it is next reset. */
+typedef std::vector<RayIntersection, ScratchAllocator<RayIntersection>> RayIntersectionList;
+
 #endif // RAY_INTERSECTION_H_INCLUDED
@@ -0,0 +1,39 @@
+/* $Rev: 250 $ */
+#include "RectLightSource.h"
+
+#include <algorithm>
+
+RectLightSource::RectLightSource() : AreaLightSource(), edge1(1,0,0), edge2(0,0,1) {
+
+}
+
+RectLightSource::RectLightSource(const RectLightSource& lightSource) : AreaLightSource(lightSource),
+edge1(lightSource.edge1), edge2(lightSource.edge2) {
+
+}
+
+RectLightSource::~RectLightSource() {
+
+}
+
+const RectLightSource& RectLightSource::operator=(const RectLightSource& lightSource) {
+	if (this != &lightSource) {
+		AreaLightSource::operator=(lightSource);
+		edge1 = lightSource.edge1;
+		edge2 = lightSource.edge2;
+	}
+	return *this;
+}
+
+Point RectLightSource::pointOn(const Point&, double u, double v) const {
+	return location + (u - 0.5)*edge1 + (v - 0.5)*edge2;
+}
+
+double RectLightSource::extent() const {
+	return 0.5*std::max((edge1 + edge2).norm(), (edge1 - edge2).norm());
+}
+
+double RectLightSource::facing(const Vector& direction) const {
+	Vector normal = edge2.cross(edge1);
+	return std::max(0.0, normal.dot(direction)/normal.norm());
+}
@@ -0,0 +1,79 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef RECT_LIGHT_SOURCE_H_INCLUDED
+#define RECT_LIGHT_SOURCE_H_INCLUDED
+
+#include "AreaLightSource.h"
+#include "Direction.h"
+
+/**
+ * \file
+ * \brief RectLightSource class header file.
+ */
+
+/**
+ * \brief Light given off by a rectangle.
+ *
+ * The rectangle is centred on the location, with sides along edge1 and
+ * edge2. These need not be at right angles, so any parallelogram can be
+ * made. By default it is a unit square lying flat in the X-Z plane, like a
+ * panel in a ceiling.
+ *
+ * Light is only given off on the side towards edge2.cross(edge1), which by
+ * default is +y, down from the ceiling.
+ */
+class RectLightSource : public AreaLightSource {
+
+public:
+
+	/** \brief RectLightSource default constructor.
+	 *
+	 * This creates a white unit square light at the origin, in the X-Z plane.
+	 */
+	RectLightSource();
+
+	/** \brief RectLightSource copy constructor.
+	 *
+	 * \param lightSource The RectLightSource to copy to \c this.
+	 */
+	RectLightSource(const RectLightSource& lightSource);
+
+	/** \brief RectLightSource destructor. */
+	~RectLightSource();
+
+	/** \brief RectLightSource assignment operator.
+	 *
+	 * \param lightSource The RectLightSource to copy to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	const RectLightSource& operator=(const RectLightSource& lightSource);
+
+	/** \brief Find a point on the rectangle.
+	 *
+	 * \param point The Point being lit (not used).
+	 * \param u The position along edge1, in [0,1).
+	 * \param v The position along edge2, in [0,1).
+	 * \return The point on the rectangle.
+	 */
+	Point pointOn(const Point& point, double u, double v) const;
+
+	/** \brief The size of the rectangle.
+	 *
+	 * \return The distance from the centre to the furthest corner.
+	 */
+	double extent() const;
+
+	/** \brief How much light the rectangle gives off in a Direction.
+	 *
+	 * \param direction The unit Direction the light leaves in.
+	 * \return The cosine of the angle between \c direction and the lit side's normal, or 0 on the other side.
+	 */
+	double facing(const Vector& direction) const;
+
+	Direction edge1; //!< One side of the rectangle.
+	Direction edge2; //!< The other side of the rectangle.
+
+};
+
+#endif // RECT_LIGHT_SOURCE_H_INCLUDED
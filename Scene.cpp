@@ -3,9 +3,23 @@
 
 #include "Colour.h"
 #include "Display.h"
+#include "Integrator.h"
+#include "Pattern.h"
+#include "Random.h"
+#include "ScratchArena.h"
+#include "Sphere.h"
+#include "Texture.h"
+#include "TileScheduler.h"
 #include "utility.h"
 
-Scene::Scene() : backgroundColour(0,0,0), ambientLight(0,0,0), maxRayDepth(3), renderWidth(800), renderHeight(600), filename("render.png"), camera_(), objects_(), lights_() {
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+const unsigned int Scene::tileSize;
+
+Scene::Scene() : integrator(INTEGRATOR_WHITTED), pixelSamples(16), occlusionSamples(16), occlusionDistance(1), occlusionBake(0), occlusionFile(), depthRange(10), irradianceSamples(256), irradianceError(0.2), irradianceFile(), causticPhotons(0), causticNeighbours(64), causticRadius(0.1), backgroundColour(0,0,0), ambientLight(0,0,0), maxRayDepth(3), minThroughput(1.0/256), russianRoulette(false), lightThreshold(0), lightSamples(0), textureMemory(1024), renderThreads(0), statistics(false), renderWidth(800), renderHeight(600), filename("render.png"), camera_(), objects_(), lights_(), bvh_(), lightIndex_(), lightTree_(), textures_(), patterns_(), textureCache_(new TextureCache()), environment_(), irradianceCache_(new IrradianceCache()), causticMap_(new PhotonMap()), occlusionCache_(new OcclusionCache()) {
 
 }
 
@@ -13,103 +27,977 @@ Scene::~Scene() {
 
 }
 
-void Scene::render() const {
+// Random numbers for sampling, reseeded for each pixel so that renders are repeatable
+static thread_local Random randomNumbers;
+
+void Scene::render() {
 	Display display("Render", renderWidth, renderHeight, Colour(128,128,128));
 	
 	std::cout << "Rendering a scene with " << objects_.size() << " objects" << std::endl;
 
-	double halfPixel = 2.0/(2*renderWidth);
+	bvh_.build(objects_);
 
-	for (unsigned int y = 0; y < renderHeight; ++y) {
-		for (unsigned int x = 0; x < renderWidth; ++x) {
-			double cx = (x - 0.5*renderWidth)*2.0/renderWidth + halfPixel;
-			double cy = (y - 0.5*renderHeight)*2.0/renderWidth + halfPixel;
-			Ray ray = camera_->castRay(cx,cy);
-			display.set(x, y, computeColour(ray, maxRayDepth));
+	// Path tracing samples the EnvironmentLightSource on its own (see sampleLights())
+	bool separateEnvironment = integrator == INTEGRATOR_PATH || integrator == INTEGRATOR_IRRADIANCE;
+	std::vector<std::shared_ptr<LightSource>> lights;
+	for (const std::shared_ptr<LightSource>& light : lights_) {
+		if (!separateEnvironment || light != environment_) {
+			lights.push_back(light);
 		}
-		display.refresh();
 	}
+	if (lightSamples > 0) {
+		lightTree_.build(lights);
+	} else {
+		lightIndex_.build(lights, lightThreshold);
+	}
+
+	textureCache_->setCapacity(size_t(textureMemory*1024*1024));
+	ScratchArena::resetStatistics();
+
+	// The debug views have no use for caustics
+	causticMap_->clear();
+	if (integrator == INTEGRATOR_WHITTED || integrator == INTEGRATOR_PATH || integrator == INTEGRATOR_IRRADIANCE) {
+		emitPhotons(lights);
+	}
+
+	switch (integrator) {
+	case INTEGRATOR_WHITTED:
+		renderImage(display, WhittedIntegrator(*this));
+		break;
+	case INTEGRATOR_PATH:
+		renderImage(display, PathIntegrator(*this));
+		break;
+	case INTEGRATOR_OCCLUSION:
+		bakeOcclusion();
+		renderImage(display, OcclusionIntegrator(*this));
+		break;
+	case INTEGRATOR_NORMALS:
+		renderImage(display, NormalIntegrator(*this));
+		break;
+	case INTEGRATOR_DEPTH:
+		renderImage(display, DepthIntegrator(*this));
+		break;
+	case INTEGRATOR_IRRADIANCE:
+		irradianceCache_->clear();
+		irradianceCache_->setError(irradianceError);
+		if (!irradianceFile.empty() && irradianceCache_->load(irradianceFile)) {
+			std::cout << "Read " << irradianceCache_->size() << " irradiance records from " << irradianceFile << std::endl;
+		}
+		renderImage(display, IrradianceIntegrator(*this));
+		std::cout << "Irradiance cache holds " << irradianceCache_->size() << " records" << std::endl;
+		if (!irradianceFile.empty()) {
+			irradianceCache_->save(irradianceFile);
+		}
+		break;
+	}
+
+	if (statistics) {
+		std::cout << "Scratch memory peaked at " << ScratchArena::peak()/1024 << " KB in one thread, with " <<
+			ScratchArena::largeBlocks() << " lists too large for it" << std::endl;
+	}
+
 	display.save(filename);
 	display.pause(5);
 }
 
+template<typename Integrator>
+void Scene::renderImage(Display& display, const Integrator& policy) const {
+	unsigned int threads = threadCount();
+	uint32_t columns = (renderWidth + tileSize - 1)/tileSize;
+	uint32_t rows = (renderHeight + tileSize - 1)/tileSize;
+	TileScheduler scheduler(columns*rows, threads);
+	std::vector<Colour> image(size_t(renderWidth)*renderHeight);
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < threads; ++i) {
+		workers.push_back(std::thread(&Scene::renderTiles<Integrator>, this, std::ref(display), std::ref(image), std::cref(policy), std::ref(scheduler), i, nullptr));
+	}
+	// This thread owns the Display, so it shows its own tiles and the ones the others finish
+	uint32_t shown = 0;
+	renderTiles(display, image, policy, scheduler, 0, &shown);
+	while (shown < scheduler.tiles()) {
+		showProgress(display, image, scheduler, shown);
+		if (shown < scheduler.tiles()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	display.refresh();
+}
+
+template<typename Integrator>
+void Scene::renderTiles(Display& display, std::vector<Colour>& image, const Integrator& policy, TileScheduler& scheduler, unsigned int worker, uint32_t* shown) const {
+	const unsigned int samples = policy.samples();
+	const double pixelSize = 2.0/renderWidth;
+	const double sampleSize = pixelSize/std::sqrt(double(samples));
+
+	const size_t batch = Pattern::maxBatch;
+	Ray rays[batch];
+	RayIntersection hits[batch];
+	RayDifferential differentials[batch];
+	double footprints[batch];
+	Random streams[batch];
+	Colour colours[batch];
+
+	const uint32_t columns = (renderWidth + tileSize - 1)/tileSize;
+	uint32_t tile;
+	while (scheduler.next(worker, tile)) {
+		unsigned int left = (tile % columns)*tileSize;
+		unsigned int top = (tile/columns)*tileSize;
+		unsigned int right = std::min(left + tileSize, renderWidth);
+		unsigned int bottom = std::min(top + tileSize, renderHeight);
+		for (unsigned int y = top; y < bottom; ++y) {
+			for (unsigned int x0 = left; x0 < right; x0 += batch) {
+				size_t n = std::min(batch, size_t(right - x0));
+				for (size_t i = 0; i < n; ++i) {
+					colours[i] = Colour(0,0,0);
+				}
+				for (unsigned int s = 0; s < samples; ++s) {
+					for (size_t i = 0; i < n; ++i) {
+						unsigned int x = x0 + (unsigned int)i;
+						randomNumbers.seed((uint64_t(y)*renderWidth + x)*samples + s);
+						double jitterX = 0.5;
+						double jitterY = 0.5;
+						if (samples > 1) {
+							jitterX = randomNumbers.uniform();
+							jitterY = randomNumbers.uniform();
+						}
+						double cx = (x - 0.5*renderWidth)*2.0/renderWidth + jitterX*pixelSize;
+						double cy = (y - 0.5*renderHeight)*2.0/renderWidth + jitterY*pixelSize;
+						if (Integrator::textured) {
+							rays[i] = camera_->castRay(cx,cy,sampleSize);
+							hits[i] = intersect(rays[i]);
+							footprints[i] = footprint(rays[i], hits[i], differentials[i]);
+						} else {
+							rays[i] = camera_->castRay(cx,cy);
+							hits[i] = intersect(rays[i]);
+						}
+						streams[i] = randomNumbers;
+					}
+					if (Integrator::textured) {
+						applyTextures(hits, footprints, n);
+					}
+					for (size_t i = 0; i < n; ++i) {
+						randomNumbers = streams[i];
+						colours[i] += policy.colour(rays[i], hits[i], differentials[i]);
+					}
+				}
+				for (size_t i = 0; i < n; ++i) {
+					Colour colour = colours[i]/samples;
+					colour.clip();
+					image[size_t(y)*renderWidth + x0 + i] = colour;
+				}
+			}
+		}
+		// Nothing made while rendering the tile is still in use
+		ScratchArena::reset();
+		scheduler.finished(tile);
+		if (shown) {
+			showProgress(display, image, scheduler, *shown);
+		}
+	}
+}
+
+void Scene::showProgress(Display& display, const std::vector<Colour>& image, const TileScheduler& scheduler, uint32_t& shown) const {
+	// Copy the newly finished tiles, whose pixels no worker writes to again
+	const uint32_t columns = (renderWidth + tileSize - 1)/tileSize;
+	uint32_t before = shown;
+	uint32_t tile;
+	while (scheduler.finishedTile(shown, tile)) {
+		unsigned int left = (tile % columns)*tileSize;
+		unsigned int top = (tile/columns)*tileSize;
+		unsigned int right = std::min(left + tileSize, renderWidth);
+		unsigned int bottom = std::min(top + tileSize, renderHeight);
+		for (unsigned int y = top; y < bottom; ++y) {
+			for (unsigned int x = left; x < right; ++x) {
+				display.set(x, y, image[size_t(y)*renderWidth + x]);
+			}
+		}
+		++shown;
+	}
+	// Refreshing is slow, so wait for about a row of tiles between refreshes
+	if (shown/columns != before/columns) {
+		display.refresh();
+	}
+}
+
 RayIntersection Scene::intersect(const Ray& ray) const {
 	RayIntersection firstHit;
-	firstHit.distance = infinity;	
-	for (auto& obj : objects_) {
-		std::vector<RayIntersection> hits = obj->intersect(ray);
-		for (auto& hit : hits) {
-			if (hit.distance > epsilon && hit.distance < firstHit.distance) {
-				firstHit = hit;
+	bvh_.intersect(ray, epsilon, firstHit);
+	return firstHit;
+}
+
+bool Scene::occluded(const Ray& ray, double maxDistance) const {
+	return bvh_.occluded(ray, epsilon, maxDistance);
+}
+
+Colour Scene::reflectedLight(const LightSample& sample, const Material& material, const Vector& normal, const Vector& view) const {
+	// Nothing arrives here (for example, outside a SpotLightSource's cone)
+	if (sample.intensity == Colour(0,0,0)) {
+		return Colour(0,0,0);
+	}
+
+	// Lights behind the surface (as seen from the viewer) add nothing
+	double diffuse = normal.dot(sample.direction);
+	if (diffuse <= 0) {
+		return Colour(0,0,0);
+	}
+
+	// Phong highlight, from the reflection of the light direction in the surface
+	double specular = 0;
+	if (!(material.specularColour == Colour(0,0,0))) {
+		Vector r = 2*diffuse*normal - sample.direction;
+		double highlight = view.dot(r);
+		if (highlight > 0) {
+			specular = pow(highlight, material.specularExponent);
+		}
+	}
+	if (material.diffuseColour == Colour(0,0,0) && specular == 0) {
+		return Colour(0,0,0);
+	}
+
+	return sample.intensity * (diffuse*material.diffuseColour + specular*material.specularColour);
+}
+
+bool Scene::shadowed(const LightSample& sample, const Point& point) const {
+	Ray shadowRay;
+	shadowRay.point = point;
+	shadowRay.direction = sample.direction;
+	return occluded(shadowRay, sample.distance);
+}
+
+Colour Scene::directLight(const LightSource& light, const RayIntersection& hitPoint, const Vector& normal, const Vector& view) const {
+	const Colour black(0,0,0);
+	unsigned int grid = light.sampleGrid();
+	if (grid <= 1) {
+		LightSample sample = light.sample(hitPoint.point);
+		Colour colour = reflectedLight(sample, hitPoint.material, normal, view);
+		if (colour == black || shadowed(sample, hitPoint.point)) {
+			return black;
+		}
+		return colour;
+	}
+
+	// Probe each quarter of a compact LightSource. Samples which reflect no
+	// light need no shadow Ray, and say nothing about the shadow.
+	Colour total = black;
+	if (light.compact()) {
+		unsigned int tested = 0;
+		unsigned int visible = 0;
+		for (unsigned int j = 0; j < 2; ++j) {
+			for (unsigned int i = 0; i < 2; ++i) {
+				double u = (i + randomNumbers.uniform())/2;
+				double v = (j + randomNumbers.uniform())/2;
+				LightSample sample = light.sampleAt(hitPoint.point, u, v);
+				Colour colour = reflectedLight(sample, hitPoint.material, normal, view);
+				if (colour == black) {
+					continue;
+				}
+				++tested;
+				if (!shadowed(sample, hitPoint.point)) {
+					total += colour;
+					++visible;
+				}
 			}
 		}
+		if (visible == tested) {
+			// Fully lit (or nothing to light)
+			return total/4;
+		}
+		if (visible == 0) {
+			// Fully in shadow
+			return black;
+		}
 	}
-	for (auto& obj: objects_) {
-	  auto hits = obj->intersect(ray);
+
+	// In the penumbra, or lit from all around, so sample the whole grid
+	total = black;
+	for (unsigned int j = 0; j < grid; ++j) {
+		for (unsigned int i = 0; i < grid; ++i) {
+			double u = (i + randomNumbers.uniform())/grid;
+			double v = (j + randomNumbers.uniform())/grid;
+			LightSample sample = light.sampleAt(hitPoint.point, u, v);
+			Colour colour = reflectedLight(sample, hitPoint.material, normal, view);
+			if (!(colour == black) && !shadowed(sample, hitPoint.point)) {
+				total += colour;
+			}
+		}
+	}
+	return total/(grid*grid);
+}
+
+double Scene::footprint(const Ray& ray, const RayIntersection& hitPoint, RayDifferential& differential) const {
+	if (!ray.hasDifferential || hitPoint.distance == infinity) {
+		return 0;
+	}
+	Vector normal = hitPoint.normal/hitPoint.normal.norm();
+	differential = ray.differential.transfer(ray.direction, hitPoint.distance/ray.direction.norm(), normal);
+	return differential.width();
+}
+
+// The slots of a Material which can have a Pattern
+static const Pattern* Material::* const patternSlots[3] = {
+	&Material::diffusePattern, &Material::specularPattern, &Material::mirrorPattern
+};
+
+// Multiply the Colours of a Material which go with a slot (0 for diffuse, 1 for specular, 2 for mirror)
+static void scaleColours(Material& material, int slot, const Colour& colour) {
+	switch (slot) {
+	case 0:
+		material.ambientColour *= colour;
+		material.diffuseColour *= colour;
+		break;
+	case 1:
+		material.specularColour *= colour;
+		break;
+	case 2:
+		material.mirrorColour *= colour;
+		break;
+	}
+}
+
+void Scene::applyTextures(RayIntersection* hitPoints, const double* footprints, size_t n) const {
+	// Each Pattern is evaluated once for all of the hits which use it, and
+	// then removed from them, so it is not found again
+	double x[Pattern::maxBatch], y[Pattern::maxBatch], z[Pattern::maxBatch], width[Pattern::maxBatch];
+	Colour colours[Pattern::maxBatch];
+	size_t users[Pattern::maxBatch];
+	for (int slot = 0; slot < 3; ++slot) {
+		for (size_t i = 0; i < n; ++i) {
+			const Pattern* pattern = hitPoints[i].material.*patternSlots[slot];
+			if (!pattern || hitPoints[i].distance == infinity) {
+				continue;
+			}
+			size_t count = 0;
+			for (size_t j = i; j < n; ++j) {
+				if (hitPoints[j].material.*patternSlots[slot] == pattern && hitPoints[j].distance != infinity) {
+					x[count] = hitPoints[j].point(0);
+					y[count] = hitPoints[j].point(1);
+					z[count] = hitPoints[j].point(2);
+					width[count] = footprints[j];
+					users[count++] = j;
+				}
+			}
+			pattern->colours(x, y, z, width, colours, count);
+			for (size_t k = 0; k < count; ++k) {
+				scaleColours(hitPoints[users[k]].material, slot, colours[k]);
+				hitPoints[users[k]].material.*patternSlots[slot] = nullptr;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		if (hitPoints[i].distance == infinity) {
+			continue;
+		}
+		// Texture co-ordinates change at textureScale per unit of distance across the surface
+		Material& material = hitPoints[i].material;
+		if (!material.diffuseTexture && !material.specularTexture && !material.mirrorTexture) {
+			continue;
+		}
+		Sphere::textureCoordinates(hitPoints[i]);
+		double footprint = footprints[i]*hitPoints[i].textureScale;
+		if (material.diffuseTexture) {
+			scaleColours(material, 0, material.diffuseTexture->sample(hitPoints[i].u, hitPoints[i].v, footprint));
+			material.diffuseTexture = nullptr;
+		}
+		if (material.specularTexture) {
+			scaleColours(material, 1, material.specularTexture->sample(hitPoints[i].u, hitPoints[i].v, footprint));
+			material.specularTexture = nullptr;
+		}
+		if (material.mirrorTexture) {
+			scaleColours(material, 2, material.mirrorTexture->sample(hitPoints[i].u, hitPoints[i].v, footprint));
+			material.mirrorTexture = nullptr;
+		}
 	}
-	return firstHit;
 }
 
 Colour Scene::computeColour(const Ray& viewRay, unsigned int rayDepth) const {
 	RayIntersection hitPoint = intersect(viewRay);
-	if (hitPoint.distance == infinity) {
-		return backgroundColour;
-	}
-
-	Colour hitColour = ambientLight * hitPoint.material.ambientColour;
-		
-	Material& mat = hitPoint.material;
-	for (auto& light : lights_) {
-            // Check if we can see this light
-           
-            
-            //add in shadows for particular light source
-            //object in shadow if there is object between that point and the viewpoint
-            // p=ph+t(pl-ph) 
-
-            //shadows
-            Ray shadowRay;
-
-            Vector v = light->location - hitPoint.point;
-            Vector l = v/v.norm(); //normalise
-            
-            shadowRay.point = hitPoint.point;
-            shadowRay.direction = Direction(l); 
-            RayIntersection shadowIntersect = intersect(shadowRay);
-
-            //diffuse
-            Vector lightVector = light->location - hitPoint.point;
-            double norm = lightVector.norm();
-      
-            double dotProductDiff = hitPoint.normal.dot(lightVector/norm)/hitPoint.normal.norm();
-
-            //specular
-            Vector e = -viewRay.direction/viewRay.direction.norm(); // to make it a unit vector
-            
-            Vector normal = hitPoint.normal/hitPoint.normal.norm();
-            Vector r = 2*normal*(e.dot(normal))-e;
-            
-            double dotProductSpec = pow(e.dot(r), mat.specularExponent); // n value from phongs intensity output
-            
-            //mirror
-            
-            //if distance to shadow intersection == INFINITY
-            //I.E there is no intersection, then add in other lighting
-            //If distance to shadow intersection != INFINITY
-            //Then there is an intersection between the object and light source
-            //So we just leave it with the ambient light (shadow)
-            if(shadowIntersect.distance == infinity){
-                hitColour += light->colour * light->getIntensityAt(hitPoint.point) * mat.diffuseColour * dotProductDiff;
-                hitColour += light->colour * light->getIntensityAt(hitPoint.point) * mat.specularColour * dotProductSpec;
-                
-            }
-	}
-
-	hitColour.clip();
-
-	return hitColour;
+	RayDifferential differential;
+	double width = footprint(viewRay, hitPoint, differential);
+	applyTextures(&hitPoint, &width, 1);
+	return computeColour(viewRay, hitPoint, differential, rayDepth);
+}
+
+Colour Scene::computeColour(const Ray& viewRay, const RayIntersection& firstHit, const RayDifferential& firstDifferential, unsigned int rayDepth) const {
+	Colour colour(0,0,0);
+	Colour throughput(1,1,1);
+	Ray ray = viewRay;
+	RayIntersection hitPoint = firstHit;
+	RayDifferential differential = firstDifferential;
+
+	for (unsigned int depth = 0; ; ++depth) {
+		if (hitPoint.distance == infinity) {
+			colour += throughput * (environment_ ? environment_->background(ray.direction) : backgroundColour);
+			break;
+		}
+
+		Vector normal = hitPoint.normal/hitPoint.normal.norm();
+		Colour hitColour = ambientLight * hitPoint.material.ambientColour;
+
+		Vector view = -ray.direction/ray.direction.norm();
+		if (lightSamples > 0) {
+			for (unsigned int i = 0; i < lightSamples; ++i) {
+				const LightSource* light;
+				double probability;
+				if (lightTree_.sample(hitPoint.point, randomNumbers.uniform(), light, probability)) {
+					hitColour += directLight(*light, hitPoint, normal, view)/(probability*lightSamples);
+				}
+			}
+		} else {
+			lightIndex_.forEachLight(hitPoint.point, [&](const LightSource& light) {
+				hitColour += directLight(light, hitPoint, normal, view);
+			});
+		}
+		hitColour += caustics(hitPoint, normal, view);
+		colour += throughput * hitColour;
+
+		// Decide whether the reflection is worth following
+		const Colour& mirror = hitPoint.material.mirrorColour;
+		if (depth >= rayDepth || mirror == Colour(0,0,0)) {
+			break;
+		}
+		throughput *= mirror;
+		double strength = std::max(throughput.red, std::max(throughput.green, throughput.blue));
+		if (strength < minThroughput) {
+			if (!russianRoulette || strength <= 0) {
+				break;
+			}
+			double survival = strength/minThroughput;
+			if (randomNumbers.uniform() >= survival) {
+				break;
+			}
+			throughput /= survival;
+		}
+
+		if (ray.hasDifferential) {
+			ray.differential = differential.reflect(ray.direction, normal);
+		}
+		ray.point = hitPoint.point;
+		ray.direction = -view - 2*normal.dot(-view)*normal;
+
+		hitPoint = intersect(ray);
+		double width = footprint(ray, hitPoint, differential);
+		applyTextures(&hitPoint, &width, 1);
+	}
+
+	colour.clip();
+
+	return colour;
+}
+
+// The brightest component of a Colour
+static double strongest(const Colour& colour) {
+	return std::max(colour.red, std::max(colour.green, colour.blue));
+}
+
+// Veach's power heuristic, weighting a sample by how likely it was to be found one way rather than another
+static double powerHeuristic(double density, double otherDensity) {
+	double square = density*density;
+	double otherSquare = otherDensity*otherDensity;
+	return square > 0 ? square/(square + otherSquare) : 0;
+}
+
+Colour Scene::tracePath(const Ray& viewRay, const RayIntersection& firstHit, const RayDifferential& firstDifferential) const {
+	Colour colour(0,0,0);
+	Colour throughput(1,1,1);
+	Ray ray = viewRay;
+	RayIntersection hitPoint = firstHit;
+	RayDifferential differential = firstDifferential;
+
+	// How the current Ray was chosen: specular Rays find light that sampleLights() cannot
+	bool specularBounce = true;
+	double bounceDensity = 0;
+
+	for (unsigned int depth = 0; ; ++depth) {
+		if (hitPoint.distance == infinity) {
+			if (!environment_) {
+				colour += throughput * backgroundColour;
+			} else if (specularBounce) {
+				colour += throughput * environment_->background(ray.direction);
+			} else {
+				double weight = powerHeuristic(bounceDensity, environment_->density(ray.direction));
+				colour += weight * throughput * environment_->background(ray.direction);
+			}
+			break;
+		}
+
+		// Light is reflected from whichever side of the surface the Ray hits
+		Vector view = -ray.direction/ray.direction.norm();
+		Vector normal = hitPoint.normal/hitPoint.normal.norm();
+		if (normal.dot(view) < 0) {
+			normal = -normal;
+		}
+
+		const Material& material = hitPoint.material;
+		double diffuse = strongest(material.diffuseColour);
+		double mirror = strongest(material.mirrorColour);
+		double mirrorChance = mirror > 0 ? mirror/(mirror + std::max(diffuse, 0.0)) : 0;
+		bool bounces = depth < maxRayDepth && (diffuse > 0 || mirror > 0);
+
+		colour += throughput * sampleLights(hitPoint, normal, view, bounces ? 1 - mirrorChance : 0);
+		colour += throughput * caustics(hitPoint, normal, view);
+		if (!bounces) {
+			break;
+		}
+
+		ray.point = hitPoint.point;
+		if (randomNumbers.uniform() < mirrorChance) {
+			throughput *= material.mirrorColour/mirrorChance;
+			if (ray.hasDifferential) {
+				ray.differential = differential.reflect(ray.direction, normal);
+			}
+			ray.direction = -view - 2*normal.dot(-view)*normal;
+			specularBounce = true;
+		} else {
+			// The density of the Direction cancels the cosine and 1/pi of the
+			// diffuse reflection, leaving the diffuseColour
+			throughput *= material.diffuseColour/(1 - mirrorChance);
+			double cosine;
+			ray.direction = cosineDirection(normal, randomNumbers.uniform(), randomNumbers.uniform(), cosine);
+			// Neighbouring pixels' paths go off in unrelated Directions, so there is nothing to track
+			ray.hasDifferential = false;
+			specularBounce = false;
+			bounceDensity = (1 - mirrorChance)*cosine/M_PI;
+		}
+
+		if (depth >= 2) {
+			double survival = std::min(1.0, strongest(throughput));
+			if (survival <= 0 || randomNumbers.uniform() >= survival) {
+				break;
+			}
+			throughput = throughput/survival;
+		}
+
+		hitPoint = intersect(ray);
+		double width = footprint(ray, hitPoint, differential);
+		applyTextures(&hitPoint, &width, 1);
+	}
+
+	return colour;
+}
+
+Colour Scene::sampleLights(const RayIntersection& hitPoint, const Vector& normal, const Vector& view, double diffuseChance) const {
+	const Colour black(0,0,0);
+	Colour colour(0,0,0);
+
+	auto sampleLight = [&](const LightSource& light) -> Colour {
+		LightSample sample = light.sampleGrid() <= 1 ? light.sample(hitPoint.point) :
+			light.sampleAt(hitPoint.point, randomNumbers.uniform(), randomNumbers.uniform());
+		Colour reflected = reflectedLight(sample, hitPoint.material, normal, view);
+		if (reflected == black || shadowed(sample, hitPoint.point)) {
+			return black;
+		}
+		return reflected;
+	};
+
+	if (lightSamples > 0) {
+		for (unsigned int i = 0; i < lightSamples; ++i) {
+			const LightSource* light;
+			double probability;
+			if (lightTree_.sample(hitPoint.point, randomNumbers.uniform(), light, probability)) {
+				colour += sampleLight(*light)/(probability*lightSamples);
+			}
+		}
+	} else {
+		lightIndex_.forEachLight(hitPoint.point, [&](const LightSource& light) {
+			colour += sampleLight(light);
+		});
+	}
+
+	if (environment_) {
+		LightSample sample = environment_->sampleAt(hitPoint.point, randomNumbers.uniform(), randomNumbers.uniform());
+		double cosine = normal.dot(sample.direction);
+		if (cosine > 0 && !(sample.intensity == black) && !shadowed(sample, hitPoint.point)) {
+			// The diffuse light may also be found by bouncing, but the highlight only this way
+			Material diffuse = hitPoint.material;
+			diffuse.specularColour = black;
+			Material specular = hitPoint.material;
+			specular.diffuseColour = black;
+			double weight = powerHeuristic(environment_->density(sample.direction), diffuseChance*cosine/M_PI);
+			colour += weight*reflectedLight(sample, diffuse, normal, view) + reflectedLight(sample, specular, normal, view);
+		}
+	}
+
+	return colour;
+}
+
+Colour Scene::traceCached(const Ray& viewRay, const RayIntersection& firstHit, const RayDifferential& firstDifferential) const {
+	Colour colour(0,0,0);
+	Colour throughput(1,1,1);
+	Ray ray = viewRay;
+	RayIntersection hitPoint = firstHit;
+	RayDifferential differential = firstDifferential;
+
+	for (unsigned int depth = 0; ; ++depth) {
+		if (hitPoint.distance == infinity) {
+			colour += throughput * (environment_ ? environment_->background(ray.direction) : backgroundColour);
+			break;
+		}
+
+		Vector view = -ray.direction/ray.direction.norm();
+		Vector normal = hitPoint.normal/hitPoint.normal.norm();
+		if (normal.dot(view) < 0) {
+			normal = -normal;
+		}
+
+		colour += throughput * sampleLights(hitPoint, normal, view, 0);
+		colour += throughput * caustics(hitPoint, normal, view);
+		const Material& material = hitPoint.material;
+		if (!(material.diffuseColour == Colour(0,0,0))) {
+			// The differentials are for one of pixelSamples Rays across the pixel
+			double width = ray.hasDifferential ? differential.width()*std::sqrt(double(std::max(pixelSamples, 1u))) : 0;
+			colour += throughput * material.diffuseColour * indirectLight(hitPoint, normal, width);
+		}
+
+		if (depth >= maxRayDepth || material.mirrorColour == Colour(0,0,0)) {
+			break;
+		}
+		throughput *= material.mirrorColour;
+		if (ray.hasDifferential) {
+			ray.differential = differential.reflect(ray.direction, normal);
+		}
+		ray.point = hitPoint.point;
+		ray.direction = -view - 2*normal.dot(-view)*normal;
+
+		hitPoint = intersect(ray);
+		double width = footprint(ray, hitPoint, differential);
+		applyTextures(&hitPoint, &width, 1);
+	}
+
+	return colour;
+}
+
+Colour Scene::indirectLight(const RayIntersection& hitPoint, const Vector& normal, double width) const {
+	Colour irradiance;
+	if (irradianceCache_->lookup(hitPoint.point, normal, irradiance)) {
+		return irradiance;
+	}
+
+	// A grid of cells about pi times as wide as it is high has cells of roughly equal shape
+	unsigned int rows = std::max(1u, (unsigned int)std::lround(std::sqrt(irradianceSamples/M_PI)));
+	unsigned int columns = std::max(3u, (unsigned int)std::lround(double(irradianceSamples)/rows));
+	Vector tangent = normal.cross(std::abs(normal(0)) > 0.5 ? Direction(0,1,0) : Direction(1,0,0));
+	tangent = tangent/tangent.norm();
+	Vector bitangent = normal.cross(tangent);
+
+	std::vector<Colour> radiance(rows*columns);
+	std::vector<double> distance(rows*columns);
+	Ray ray;
+	ray.point = hitPoint.point;
+	for (unsigned int j = 0; j < rows; ++j) {
+		for (unsigned int k = 0; k < columns; ++k) {
+			ray.direction = IrradianceCache::direction(normal, tangent, bitangent, j, k, rows, columns,
+				randomNumbers.uniform(), randomNumbers.uniform());
+			RayIntersection hit = intersect(ray);
+			size_t cell = j*columns + k;
+			distance[cell] = hit.distance;
+			if (hit.distance == infinity) {
+				radiance[cell] = environment_ ? Colour(0,0,0) : backgroundColour;
+				continue;
+			}
+			double hitWidth = 0;
+			applyTextures(&hit, &hitWidth, 1);
+			radiance[cell] = tracePath(ray, hit, RayDifferential());
+		}
+	}
+
+	double minRadius = 1.5*width/irradianceError;
+	double maxRadius = width > 0 ? 20*width/irradianceError : infinity;
+	return irradianceCache_->add(hitPoint.point, normal, tangent, bitangent, rows, columns, radiance, distance, minRadius, maxRadius);
+}
+
+void Scene::emitPhotons(const std::vector<std::shared_ptr<LightSource>>& lights) {
+	if (causticPhotons == 0 || lights.empty()) {
+		return;
+	}
+
+	// Photons are sent towards the Objects with bounds, as Planes cannot focus light
+	BoundingBox bounds = bvh_.getFiniteBounds();
+	Point centre(0,0,0);
+	double radius = 0;
+	if (!bounds.isEmpty()) {
+		centre = Point(0.5*(bounds.minPoint(0) + bounds.maxPoint(0)), 0.5*(bounds.minPoint(1) + bounds.maxPoint(1)),
+			0.5*(bounds.minPoint(2) + bounds.maxPoint(2)));
+		radius = (bounds.maxPoint - centre).norm();
+	}
+
+	// Weigh the LightSources by the average power of a grid of their photons
+	const unsigned int grid = 4;
+	std::vector<double> weights(1, 0);
+	for (const std::shared_ptr<LightSource>& light : lights) {
+		double total = 0;
+		Ray ray;
+		for (unsigned int i = 0; i < grid*grid*grid*grid; ++i) {
+			double u = (i % grid + 0.5)/grid;
+			double v = (i/grid % grid + 0.5)/grid;
+			double s = (i/(grid*grid) % grid + 0.5)/grid;
+			double t = (i/(grid*grid*grid) + 0.5)/grid;
+			total += strongest(light->emit(centre, radius, u, v, s, t, ray));
+		}
+		weights.push_back(weights.back() + std::max(total, 0.0));
+	}
+	if (radius <= 0 || weights.back() <= 0) {
+		return;
+	}
+
+	unsigned int threads = threadCount();
+	std::vector<PhotonMap::Photon> stored;
+	uint64_t emitted = 0;
+	while (stored.size() < causticPhotons && emitted < 64*uint64_t(causticPhotons)) {
+		std::vector<std::vector<PhotonMap::Photon>> found(threads);
+		std::vector<std::thread> workers;
+		for (unsigned int i = 0; i < threads; ++i) {
+			uint64_t first = emitted + causticPhotons*uint64_t(i)/threads;
+			uint64_t last = emitted + causticPhotons*uint64_t(i + 1)/threads;
+			workers.push_back(std::thread(&Scene::tracePhotons, this, std::cref(lights), std::cref(weights),
+				std::cref(centre), radius, first, last, std::ref(found[i])));
+		}
+		for (unsigned int i = 0; i < threads; ++i) {
+			workers[i].join();
+			stored.insert(stored.end(), found[i].begin(), found[i].end());
+		}
+		emitted += causticPhotons;
+		if (stored.empty()) {
+			break;
+		}
+	}
+
+	// The light is shared between all of the photons sent out, stored or not
+	for (PhotonMap::Photon& photon : stored) {
+		for (int c = 0; c < 3; ++c) {
+			photon.power[c] = float(photon.power[c]/emitted);
+		}
+	}
+	causticMap_->build(stored, threads);
+	std::cout << "Stored " << causticMap_->size() << " caustic photons from " << emitted << " sent out" << std::endl;
+}
+
+void Scene::tracePhotons(const std::vector<std::shared_ptr<LightSource>>& lights, const std::vector<double>& weights,
+	const Point& centre, double radius, uint64_t first, uint64_t last, std::vector<PhotonMap::Photon>& photons) const {
+	const Colour black(0,0,0);
+	for (uint64_t i = first; i < last; ++i) {
+		randomNumbers.seed(i);
+
+		// Pick a LightSource in proportion to its weight
+		double pick = randomNumbers.uniform()*weights.back();
+		size_t light = size_t(std::upper_bound(weights.begin(), weights.end(), pick) - weights.begin());
+		light = std::min(std::max(light, size_t(1)), lights.size()) - 1;
+		double probability = (weights[light + 1] - weights[light])/weights.back();
+		if (probability <= 0) {
+			continue;
+		}
+		Ray ray;
+		double u = randomNumbers.uniform();
+		double v = randomNumbers.uniform();
+		double s = randomNumbers.uniform();
+		double t = randomNumbers.uniform();
+		Colour power = lights[light]->emit(centre, radius, u, v, s, t, ray)/probability;
+
+		for (unsigned int depth = 0; !(power == black); ++depth) {
+			RayIntersection hitPoint = intersect(ray);
+			if (hitPoint.distance == infinity) {
+				break;
+			}
+			double width = 0;
+			applyTextures(&hitPoint, &width, 1);
+
+			// Light arriving straight from the LightSource is direct light, not a caustic
+			const Material& material = hitPoint.material;
+			if (depth > 0 && !(material.diffuseColour == black)) {
+				Vector direction = ray.direction/ray.direction.norm();
+				PhotonMap::Photon photon;
+				for (int a = 0; a < 3; ++a) {
+					photon.point[a] = float(hitPoint.point(a));
+					photon.direction[a] = float(direction(a));
+				}
+				photon.power[0] = float(power.red);
+				photon.power[1] = float(power.green);
+				photon.power[2] = float(power.blue);
+				photon.axis = 0;
+				photons.push_back(photon);
+			}
+
+			double survival = std::min(1.0, strongest(material.mirrorColour));
+			if (depth >= maxRayDepth || survival <= 0 || randomNumbers.uniform() >= survival) {
+				break;
+			}
+			power = power*material.mirrorColour/survival;
+			Vector normal = hitPoint.normal/hitPoint.normal.norm();
+			ray.point = hitPoint.point;
+			ray.direction = ray.direction - 2*normal.dot(ray.direction)*normal;
+		}
+		ScratchArena::reset();
+	}
+}
+
+Colour Scene::caustics(const RayIntersection& hitPoint, const Vector& normal, const Vector& view) const {
+	if (causticMap_->size() == 0 || hitPoint.material.diffuseColour == Colour(0,0,0)) {
+		return Colour(0,0,0);
+	}
+	// The light is wanted on the side of the surface facing the viewer
+	Vector facing = normal.dot(view) < 0 ? -normal : normal;
+	return hitPoint.material.diffuseColour * causticMap_->irradiance(hitPoint.point, facing, causticNeighbours, causticRadius);
+}
+
+void Scene::bakeOcclusion() {
+	occlusionCache_->clear();
+	if (occlusionBake <= 0) {
+		return;
+	}
+	BoundingBox bounds = bvh_.getFiniteBounds();
+	if (bounds.isEmpty()) {
+		return;
+	}
+	// Surfaces near the Objects, such as a floor beneath them, are shaded by them too
+	for (int a = 0; a < 3; ++a) {
+		bounds.minPoint(a) -= occlusionDistance;
+		bounds.maxPoint(a) += occlusionDistance;
+	}
+	occlusionCache_->setGrid(bounds, occlusionBake);
+	if (!occlusionFile.empty() && occlusionCache_->load(occlusionFile, occlusionSamples, occlusionDistance)) {
+		std::cout << "Read " << occlusionCache_->size() << " baked occlusion values from " << occlusionFile << std::endl;
+		return;
+	}
+
+	// Find a Point of each surface in each cell, for each side it faces
+	std::vector<uint64_t> keys;
+	std::vector<Point> points;
+	std::vector<Vector> normals;
+	unsigned int cells[3] = {occlusionCache_->cells(0), occlusionCache_->cells(1), occlusionCache_->cells(2)};
+	for (int a = 0; a < 3; ++a) {
+		int b = (a + 1) % 3;
+		int c = (a + 2) % 3;
+		double length = bounds.maxPoint(a) - bounds.minPoint(a);
+		for (unsigned int i = 0; i < cells[b]; ++i) {
+			for (unsigned int j = 0; j < cells[c]; ++j) {
+				unsigned int index[3];
+				index[a] = 0;
+				index[b] = i;
+				index[c] = j;
+				Ray ray;
+				ray.point = occlusionCache_->cellCentre(index[0], index[1], index[2]);
+				ray.point(a) = bounds.minPoint(a);
+				ray.direction = Direction(0,0,0);
+				ray.direction(a) = 1;
+				double travelled = 0;
+				for (;;) {
+					RayIntersection hitPoint = intersect(ray);
+					travelled += hitPoint.distance;
+					if (hitPoint.distance == infinity || travelled > length) {
+						break;
+					}
+					Vector normal = hitPoint.normal/hitPoint.normal.norm();
+					for (int facing = 0; facing < 2; ++facing) {
+						uint64_t key;
+						if (occlusionCache_->key(hitPoint.point, normal, key)) {
+							keys.push_back(key);
+							points.push_back(hitPoint.point);
+							normals.push_back(normal);
+						}
+						normal = -normal;
+					}
+					ray.point = hitPoint.point;
+				}
+			}
+		}
+	}
+
+	// Keep the first Point found for each key
+	std::vector<size_t> order(keys.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&keys](size_t lhs, size_t rhs) { return keys[lhs] < keys[rhs]; });
+	std::vector<Point> sites;
+	std::vector<Vector> siteNormals;
+	std::vector<uint64_t> siteKeys;
+	for (size_t i = 0; i < order.size(); ++i) {
+		if (i == 0 || keys[order[i]] != keys[order[i - 1]]) {
+			siteKeys.push_back(keys[order[i]]);
+			sites.push_back(points[order[i]]);
+			siteNormals.push_back(normals[order[i]]);
+		}
+	}
+
+	unsigned int threads = threadCount();
+	std::vector<double> open(sites.size());
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < threads; ++i) {
+		size_t first = sites.size()*i/threads;
+		size_t last = sites.size()*(i + 1)/threads;
+		workers.push_back(std::thread(&Scene::bakePoints, this, std::cref(sites), std::cref(siteNormals), first, last, std::ref(open)));
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	std::vector<std::pair<uint64_t, double>> values(siteKeys.size());
+	for (size_t i = 0; i < values.size(); ++i) {
+		values[i] = std::make_pair(siteKeys[i], open[i]);
+	}
+	occlusionCache_->build(values);
+	std::cout << "Baked occlusion in " << occlusionCache_->size() << " cells" << std::endl;
+	if (!occlusionFile.empty()) {
+		occlusionCache_->save(occlusionFile, occlusionSamples, occlusionDistance);
+	}
+}
+
+void Scene::bakePoints(const std::vector<Point>& points, const std::vector<Vector>& normals, size_t first, size_t last, std::vector<double>& open) const {
+	for (size_t i = first; i < last; ++i) {
+		randomNumbers.seed(i);
+		open[i] = openness(points[i], normals[i]);
+		ScratchArena::reset();
+	}
+}
+
+double Scene::openness(const Point& point, const Vector& normal) const {
+	unsigned int open = 0;
+	Ray probe;
+	probe.point = point;
+	for (unsigned int i = 0; i < occlusionSamples; ++i) {
+		double cosine;
+		probe.direction = cosineDirection(normal, randomNumbers.uniform(), randomNumbers.uniform(), cosine);
+		if (!occluded(probe, occlusionDistance)) {
+			++open;
+		}
+	}
+	return occlusionSamples > 0 ? double(open)/occlusionSamples : 1;
+}
+
+Colour Scene::occlusion(const Ray& ray, const RayIntersection& hitPoint) const {
+	Vector view = -ray.direction/ray.direction.norm();
+	Vector normal = hitPoint.normal/hitPoint.normal.norm();
+	if (normal.dot(view) < 0) {
+		normal = -normal;
+	}
+	double grey;
+	if (!occlusionCache_->lookup(hitPoint.point, normal, grey)) {
+		grey = openness(hitPoint.point, normal);
+	}
+	return Colour(grey, grey, grey);
+}
+
+Vector Scene::cosineDirection(const Vector& normal, double u, double v, double& cosine) {
+	// Uniform on a disc, projected up onto the hemisphere
+	double radius = std::sqrt(u);
+	double angle = 2*M_PI*v;
+	cosine = std::sqrt(std::max(0.0, 1 - radius*radius));
+	Vector tangent = normal.cross(std::abs(normal(0)) > 0.5 ? Direction(0,1,0) : Direction(1,0,0));
+	tangent = tangent/tangent.norm();
+	Vector bitangent = normal.cross(tangent);
+	return radius*std::cos(angle)*tangent + radius*std::sin(angle)*bitangent + cosine*normal;
 }
 
 bool Scene::hasCamera() const {
 	return bool(camera_);
 }
+
+unsigned int Scene::threadCount() const {
+	if (renderThreads > 0) {
+		return renderThreads;
+	}
+	return std::max(1u, std::thread::hardware_concurrency());
+}
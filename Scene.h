@@ -4,20 +4,45 @@
 #ifndef SCENE_H_INCLUDED
 #define SCENE_H_INCLUDED
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "BVH.h"
 #include "Camera.h"
 #include "Colour.h"
+#include "EnvironmentLightSource.h"
+#include "IrradianceCache.h"
+#include "LightIndex.h"
 #include "LightSource.h"
+#include "LightTree.h"
+#include "TextureCache.h"
 #include "Material.h"
 #include "NonCopyable.h"
 #include "Object.h"
+#include "OcclusionCache.h"
+#include "PhotonMap.h"
 #include "Ray.h"
 #include "RayIntersection.h"
 
+class Display;
 class SceneReader;
+class TileScheduler;
+class WhittedIntegrator;
+class PathIntegrator;
+class OcclusionIntegrator;
+class IrradianceIntegrator;
+
+/** \brief The ways in which the Scene can work out the light seen by each pixel (see Integrator.h). */
+enum integrator_type {
+	INTEGRATOR_WHITTED,   //!< Direct light, ambient light, and mirror reflections, one Ray per pixel.
+	INTEGRATOR_PATH,      //!< Unbiased path tracing, with light bouncing between diffuse surfaces.
+	INTEGRATOR_OCCLUSION, //!< Ambient occlusion only, ignoring Materials and LightSources.
+	INTEGRATOR_NORMALS,   //!< Debug view of the surface Normals.
+	INTEGRATOR_DEPTH,     //!< Debug view of the distance to the first hit.
+	INTEGRATOR_IRRADIANCE //!< Direct light and mirror reflections, with bounced diffuse light from an IrradianceCache.
+};
 
 /** \file
  * \brief Scene class header file.
@@ -51,7 +76,8 @@ public:
 	/** \brief Default Scene constructor.
 	 * This creates an empty Scene, with a black background and no ambient light.
 	 * By default the images are rendered at 800x600 pixel resolution, saved
-	 * to \c render.png, and allow for up to 3 reflected rays.
+	 * to \c render.png, and allow for up to 3 reflected rays. The Whitted
+	 * integrator is used.
 	 */
 	Scene();
 
@@ -173,16 +199,209 @@ public:
 	 * the Scene's filename property. The format of the file is determined by its
 	 * extension. 
 	 *
+	 * Before rendering, a BVH is built over the Scene's Objects, and a LightIndex
+	 * or LightTree over its LightSources, so any changes to them after this point 
+	 * are not seen until the next call to render(). Random numbers are reseeded
+	 * for each pixel, so the same Scene always gives the same image.
+	 *
+	 * The image is computed by the chosen integrator (see Integrator.h).
+	 *
 	 * Attempts to render a Scene with no Camera will end badly.
 	 */
-	void render() const;
+	void render();
+
+	/** \brief How to work out the light seen by each pixel.
+	 *
+	 * The default, INTEGRATOR_WHITTED, traces one Ray per pixel, lights each
+	 * hit from the LightSources, and follows mirror reflections, with
+	 * ambientLight standing in for light bounced off other surfaces.
+	 * INTEGRATOR_PATH instead follows that bounced light, which gives
+	 * colour bleeding and soft indirect light, but needs many samples per
+	 * pixel (see pixelSamples) to converge. INTEGRATOR_IRRADIANCE finds the
+	 * same bounced light, but only at a few Points, and reuses it between them
+	 * (see irradianceSamples), which is much quicker where it changes slowly,
+	 * as it does across the walls of a room. The others are quick views for
+	 * checking geometry: ambient occlusion (see occlusionSamples), Normals,
+	 * and depth (see depthRange).
+	 */
+	integrator_type integrator;
+
+	/** \brief Number of paths to trace through each pixel when path tracing.
+	 *
+	 * The paths are spread at random across the pixel, which also smooths
+	 * the edges of Objects. The noise falls as the square root of this number.
+	 * It is not used by the Whitted integrator. The default is 16.
+	 */
+	unsigned int pixelSamples;
+
+	/** \brief Number of Rays cast from each Point by the ambient occlusion integrator.
+	 *
+	 * The Rays are spread over the hemisphere above the Point, more of them
+	 * towards the Normal, and the Point is shaded by the fraction which escape.
+	 * The default is 16.
+	 */
+	unsigned int occlusionSamples;
+
+	/** \brief How far away an Object can be and still occlude a Point.
+	 *
+	 * Only Objects within this distance darken a Point in the ambient occlusion
+	 * integrator, so that the open parts of enclosed Scenes are not black. The
+	 * default is 1.
+	 */
+	double occlusionDistance;
+
+	/** \brief Size of the cells to bake ambient occlusion into, or zero to cast Rays at every Point.
+	 *
+	 * If this is set, the ambient occlusion integrator works out the occlusion
+	 * once, on a grid of cells of this size over the surfaces around the
+	 * Objects, and looks it up from there (see OcclusionCache). This is much
+	 * quicker for previews, but blurs detail smaller than a cell. Points
+	 * outside the grid, such as far across a floor, still cast their own Rays.
+	 * The default is 0.
+	 */
+	double occlusionBake;
+
+	/** \brief A file to keep the baked ambient occlusion in from one render to the next.
+	 *
+	 * If this is set, and the file was baked with the same grid and settings,
+	 * the occlusion is read from it instead of being baked again. Otherwise the
+	 * occlusion is baked and written to it. The grid only depends on the
+	 * bounds of the Objects, so the file should be deleted if the Objects
+	 * change within them. SceneReader puts it next to the scene file.
+	 */
+	std::string occlusionFile;
+
+	/** \brief The distance shown as black by the depth integrator.
+	 *
+	 * Depth is shown as a grey level, from white at the Camera to black at this
+	 * distance and beyond. The default is 10.
+	 */
+	double depthRange;
+
+	/** \brief Number of Rays cast to gather each record of the IrradianceCache.
+	 *
+	 * Each Ray is followed as a path (see tracePath()), so the records include
+	 * light which has bounced any number of times. The default is 256.
+	 */
+	unsigned int irradianceSamples;
+
+	/** \brief The largest error allowed when reusing a record of the IrradianceCache.
+	 *
+	 * Smaller values give more records, which are more accurate, but take
+	 * longer to gather (see IrradianceCache). The default is 0.2.
+	 */
+	double irradianceError;
+
+	/** \brief A file to keep the IrradianceCache in from one render to the next.
+	 *
+	 * If this is set, records are read from the file (if there is one) before
+	 * rendering, and all of the records, old and new, are written back after,
+	 * so the frames of an animation can share their light. This is only right
+	 * if nothing but the Camera moves between frames. If it is empty (the
+	 * default), each render starts with an empty cache.
+	 */
+	std::string irradianceFile;
+
+	/** \brief Number of photons to store for caustics, or zero for none.
+	 *
+	 * Light focused onto diffuse surfaces by mirrors cannot be found by tracing
+	 * Rays back from the Camera. If this is set, photons are first traced out
+	 * from the LightSources, and those which land on a diffuse surface after
+	 * reflecting off a mirror are stored in a PhotonMap, until there are this
+	 * many (or far more have been sent out than land). The light they leave
+	 * is then added to each hit by the Whitted, path tracing, and irradiance
+	 * cache integrators. The default is 0.
+	 */
+	unsigned int causticPhotons;
 
-	Colour backgroundColour; //!< Colour for any Ray that does not hit an Object.
+	/** \brief Number of photons used to find the light of a caustic at each Point.
+	 *
+	 * More photons give smoother caustics, but blur their edges. The default is 64.
+	 */
+	unsigned int causticNeighbours;
+
+	/** \brief Furthest from a Point that photons are gathered for its caustics.
+	 *
+	 * This keeps the search short where there are few photons, away from
+	 * the caustics. The default is 0.1.
+	 */
+	double causticRadius;
+
+	Colour backgroundColour; //!< Colour for any Ray that does not hit an Object, unless there is an EnvironmentLightSource.
 
 	Colour ambientLight; //!< Ambient light level and Colour in the Scene.
 
 	unsigned int maxRayDepth; //!< Maximum number of reflected Rays to trace.
 
+	/** \brief Smallest throughput of a reflected Ray that is worth tracing.
+	 *
+	 * Each mirror reflection scales the light carried back along a Ray by the
+	 * mirrorColour, and the product of these is the Ray's throughput. Once the
+	 * brightest component of the throughput falls below this value, the Ray
+	 * can add little to the image, so reflection stops (or goes on to Russian
+	 * roulette, see russianRoulette). The default is 1/256, below the step
+	 * between levels in the output image.
+	 */
+	double minThroughput;
+
+	/** \brief Whether to use Russian roulette rather than a hard cutoff on reflections.
+	 *
+	 * When this is false (the default), reflection stops as soon as the
+	 * throughput falls below minThroughput, which loses a little light. When it
+	 * is true, such Rays are instead continued at random, with probability in
+	 * proportion to their throughput, and their throughput scaled up to make up
+	 * for the ones that stop. This is unbiased, but adds noise. Either way, no
+	 * more than maxRayDepth reflections are traced.
+	 */
+	bool russianRoulette;
+
+	/** \brief Smallest amount of light from a LightSource that is worth computing.
+	 *
+	 * When this is positive, each LightSource is ignored at Points where the 
+	 * light it gives is less than this (see LightIndex), so only the nearby 
+	 * lights are shaded and cast shadow Rays. When it is zero (the default) 
+	 * every LightSource is used everywhere.
+	 */
+	double lightThreshold;
+
+	/** \brief Number of LightSources to sample at each Point, or zero to use them all.
+	 *
+	 * When this is positive, each Point is lit by this many LightSources
+	 * picked at random from a LightTree, with their contributions weighted
+	 * so that the average is right. The cost no longer depends on the number
+	 * of LightSources, at the price of some noise. lightThreshold is not used
+	 * in this case.
+	 */
+	unsigned int lightSamples;
+
+	/** \brief Memory to allow for Textures, in megabytes.
+	 *
+	 * Textures are read from disk a tile at a time as they are needed, and
+	 * the tiles are kept until they take up this much memory, after which
+	 * the least recently used ones are dropped (see TextureCache).
+	 */
+	double textureMemory;
+
+	/** \brief Number of threads to render with, or zero for one per core.
+	 *
+	 * The image is cut into square tiles, which the threads share out
+	 * between them (see TileScheduler). The same threads also trace the
+	 * caustic photons and bake ambient occlusion. Random numbers are reseeded
+	 * for each pixel, so the image does not depend on the number of threads,
+	 * except with INTEGRATOR_IRRADIANCE, where the records are gathered in a
+	 * different order. The default is 0.
+	 */
+	unsigned int renderThreads;
+
+	/** \brief Whether to print statistics about the render once it is done.
+	 *
+	 * These are meant for tuning the ray tracer rather than for making
+	 * images, such as the most scratch memory (see ScratchArena) one thread
+	 * used for a tile. They are counted afresh for each render. The default is
+	 * false.
+	 */
+	bool statistics;
+
 	/** \brief Check if the Scene has a Camera.
 	 *
 	 * To render a scene, a Camera is required. It is possible (although
@@ -199,41 +418,141 @@ public:
 
 private:
 	friend class SceneReader;
+	friend class WhittedIntegrator;
+	friend class PathIntegrator;
+	friend class OcclusionIntegrator;
+	friend class IrradianceIntegrator;
 	std::shared_ptr<Camera> camera_;                     //!< Camera to render the image with.
 	std::vector<std::shared_ptr<Object>> objects_;       //!< Collection of Objects in the Scene.
 	std::vector<std::shared_ptr<LightSource>> lights_;   //!< Collection of LightSources in the Scene.
+	BVH bvh_;                                            //!< BVH over the Objects, built by render().
+	LightIndex lightIndex_;                              //!< Index over the LightSources, built by render().
+	LightTree lightTree_;                                //!< Hierarchy of the LightSources for sampling, built by render().
+	std::vector<std::shared_ptr<const Texture>> textures_; //!< The Textures which the Scene's Materials point to.
+	std::vector<std::shared_ptr<const Pattern>> patterns_; //!< The Patterns which the Scene's Materials point to.
+	std::shared_ptr<TextureCache> textureCache_;         //!< Tiles of the Textures used by the Scene's Materials.
+	std::shared_ptr<EnvironmentLightSource> environment_; //!< The sky seen by Rays which miss every Object, or null to use the backgroundColour.
+	std::shared_ptr<IrradianceCache> irradianceCache_;    //!< Bounced diffuse light, for INTEGRATOR_IRRADIANCE.
+	std::shared_ptr<PhotonMap> causticMap_;              //!< Photons reflected onto diffuse surfaces by mirrors, built by render().
+	std::shared_ptr<OcclusionCache> occlusionCache_;     //!< Baked ambient occlusion, for INTEGRATOR_OCCLUSION.
 
 	/** \brief Intersect a Ray with the Objects in a Scene
 	 *
 	 * This intersects the Ray with all of the Objects in the Scene and returns
 	 * the first hit. If there is no hit, then a RayIntersection with infinite distance
-	 * is returned.
+	 * is returned. The Objects are found through the BVH, so this may only be
+	 * called once render() has built it.
 	 *
 	 * \param ray The Ray to intersect with the Objects.
 	 * \return The first intersection of the Ray with the Scene.
 	 */
 	RayIntersection intersect(const Ray& ray) const;
 
+	/** \brief Check whether anything in the Scene blocks a stretch of a Ray.
+	 *
+	 * This is used for shadow Rays, where it only matters whether there is
+	 * any Object between a Point and a LightSource, not which one is nearest.
+	 * As with intersect(), hits closer to the start of the Ray than \c epsilon
+	 * are ignored.
+	 *
+	 * \param ray The Ray to check.
+	 * \param maxDistance How far along the Ray to check.
+	 * \return true if the Ray hits an Object before \c maxDistance, false otherwise.
+	 */
+	bool occluded(const Ray& ray, double maxDistance) const;
+
+	/** \brief Compute the light from one LightSample reflected at a hit Point.
+	 *
+	 * This gives the diffuse and specular terms for the light, ignoring 
+	 * shadows. It is black for light from behind the surface, or when 
+	 * neither term can contribute anything.
+	 *
+	 * \param sample The light arriving at the hit Point.
+	 * \param material The Material at the hit Point.
+	 * \param normal The unit Normal at the hit, facing the viewer.
+	 * \param view Unit Vector from the hit back towards the viewer.
+	 * \return The Colour of the light reflected towards the viewer.
+	 */
+	Colour reflectedLight(const LightSample& sample, const Material& material, const Vector& normal, const Vector& view) const;
+
+	/** \brief Check whether a LightSample is blocked by an Object.
+	 *
+	 * \param sample The light arriving at a Point.
+	 * \param point The Point.
+	 * \return true if there is an Object between \c point and where the light comes from.
+	 */
+	bool shadowed(const LightSample& sample, const Point& point) const;
+
+	/** \brief Compute the direct light from one LightSource at a hit Point.
+	 *
+	 * This gives the diffuse and specular terms for the LightSource, or 
+	 * black if the LightSource is in shadow (see reflectedLight()). No shadow
+	 * Ray is cast for LightSources behind the surface, or when neither term
+	 * can contribute anything.
+	 *
+	 * LightSources with a size (see LightSource::sampleGrid()) are sampled
+	 * with one jittered sample in each cell of their grid, which gives soft
+	 * shadows. To save work, one probe sample is first taken in each quarter
+	 * of the LightSource. If the probes all agree that the LightSource is in
+	 * view, or all agree that it is hidden, the hit Point is taken to be fully
+	 * lit or fully in shadow, and only in the penumbra, where they disagree, 
+	 * is the whole grid sampled. Very thin slivers of shadow or light can be
+	 * missed by the probes. Probes are only used for LightSources which are
+	 * LightSource::compact(), as light from all around varies too much across
+	 * the LightSource for a few samples to stand in for the rest.
+	 *
+	 * \param light The LightSource.
+	 * \param hitPoint Where the Ray hits an Object.
+	 * \param normal The unit Normal at the hit, facing the viewer.
+	 * \param view Unit Vector from the hit back towards the viewer.
+	 * \return The Colour of the light reflected towards the viewer.
+	 */
+	Colour directLight(const LightSource& light, const RayIntersection& hitPoint, const Vector& normal, const Vector& view) const;
+
+	/** \brief Find the area of surface seen by a pixel at a hit.
+	 *
+	 * \param ray The Ray which made the hit.
+	 * \param hitPoint Where the Ray hits an Object.
+	 * \param differential Set to the Ray's differentials moved to the hit, if it has any.
+	 * \return The width of the area seen by the pixel, or 0 if the Ray has no differentials or hit nothing.
+	 */
+	double footprint(const Ray& ray, const RayIntersection& hitPoint, RayDifferential& differential) const;
+
+	/** \brief Apply the Textures and Patterns in a batch of hits' Materials.
+	 *
+	 * The Colours of each Material are multiplied by the Colours of its
+	 * Textures at the hit's texture co-ordinates, and of its Patterns at the
+	 * hit Point, and the Textures and Patterns removed. Hits which share a
+	 * Pattern have it evaluated together, a batch at a time.
+	 *
+	 * \param hitPoints The hits, whose Materials are changed. Hits with infinite distance are skipped.
+	 * \param footprints The width of the area seen by a pixel at each hit (see footprint()).
+	 * \param n The number of hits, which must be at most Pattern::maxBatch.
+	 */
+	void applyTextures(RayIntersection* hitPoints, const double* footprints, size_t n) const;
+
 	/** \brief Compute the Colour seen by a Ray in the Scene.
 	 * 
 	 * The Colour seen by a Ray depends on the ligthing, the first Object that it
 	 * hits, and the Material properties of that Object. This method performs these
 	 * computations and comptues the observed Colour. For some Objects it may be necessary
-	 * to cast other Rays to deal with reflections. This can conceivably recurse forever,
+	 * to cast other Rays to deal with reflections. This can conceivably go on forever,
 	 * so a maximum number of reflections is set.
 	 *
 	 * If the Ray does not hit any Object, then the Scene's backgroundColour should be 
-	 * returned.
-	 *
-	 * \todo Currently this method only deals with ambient lighting and Material properties.
-	 *       It needs to be extended to account for the diffuse, specular, and mirror properties
-	 *       of the Material of the Object that is hit. Recall from lectures that the formula for
-	 *       a combination of ambient, diffuse, and specular lighting is
-	 *       \f[ I = I_ak_a + \sum_j{I_j\left( k_d(\hat{\mathbf{\ell}}_j\cdot\hat{\mathbf{n}}) + k_s(\hat{\mathbf{e}}\cdot\hat{\mathbf{r}}_j)^n \right)},\f]
-	 *       where the sum is over the LightSources in the Scene.
-	 *       You will also need to cast additional Rays to check for shadows and for reflections.
-	 *       The number of recursions made for reflections should be limited by the 
-	 *       rayDepth parameter passed to this method.
+	 * returned, or if the Scene has an EnvironmentLightSource, its Colour in the Ray's Direction.
+	 *
+	 * The lighting combines ambient, diffuse, and specular terms,
+	 * \f[ I = I_ak_a + \sum_j{I_j\left( k_d(\hat{\mathbf{\ell}}_j\cdot\hat{\mathbf{n}}) + k_s(\hat{\mathbf{e}}\cdot\hat{\mathbf{r}}_j)^n \right)},\f]
+	 * where the sum is over the LightSources which are not in shadow (see directLight()).
+	 * Only the LightSources bright enough to matter (see lightThreshold) are included,
+	 * or if lightSamples is set, the sum is estimated from a few LightSources chosen at random.
+	 *
+	 * Surfaces with a mirrorColour add the Colour seen along the reflected Ray, scaled
+	 * by the mirrorColour. Reflections are followed in a loop rather than by recursion,
+	 * keeping track of the product of the mirrorColours so far (the throughput). The
+	 * loop stops after \c rayDepth reflections, or once the throughput is too small to
+	 * matter (see minThroughput and russianRoulette).
 	 * 
 	 * \param viewRay The Ray to intersect with the Objects in the Scene.
 	 * \param rayDepth The maximum number of reflection Rays that can be cast.
@@ -241,6 +560,262 @@ private:
 	 */
 	Colour computeColour(const Ray& viewRay, unsigned int rayDepth = 0) const;
 
+	/** \brief Compute the Colour seen by a Ray whose first hit has already been found.
+	 *
+	 * This is the same as computeColour(const Ray&, unsigned int) const, but
+	 * starts from a hit which has been found, and had applyTextures() applied,
+	 * already. render() uses this to texture the first hits of several pixels
+	 * together.
+	 *
+	 * \param viewRay The Ray to follow.
+	 * \param firstHit The first intersection of the viewRay with the Scene, with its Textures applied.
+	 * \param firstDifferential The viewRay's differentials at the firstHit (see footprint()).
+	 * \param rayDepth The maximum number of reflection Rays that can be cast.
+	 * \return The Colour observed by the viewRay.
+	 */
+	Colour computeColour(const Ray& viewRay, const RayIntersection& firstHit, const RayDifferential& firstDifferential, unsigned int rayDepth) const;
+
+	/** \brief Estimate the light arriving along a Ray by following a random path.
+	 *
+	 * At each hit, the direct light is estimated with one sample of each LightSource
+	 * (or of lightSamples LightSources, if this is set; see sampleLights()),
+	 * and then the path goes on in a random Direction: either the mirror
+	 * reflection, or a diffuse bounce chosen in proportion to the cosine of its
+	 * angle to the Normal. The choice between the two is made in proportion to
+	 * the brightness of the mirrorColour and diffuseColour, and the throughput
+	 * is scaled to make up for it, so the average over many paths is right.
+	 *
+	 * Diffuse bounces which leave the Scene see the EnvironmentLightSource, which
+	 * was also sampled directly. The two estimates of the same light are combined
+	 * by multiple importance sampling with the power heuristic, so each is used
+	 * where it is less noisy: sampling the light finds small bright parts of
+	 * the sky, and bouncing finds light that arrives at grazing angles. The other
+	 * LightSources cannot be hit by a Ray, so they are only sampled directly,
+	 * as are Phong highlights. Without an EnvironmentLightSource, Rays which
+	 * leave the Scene see the backgroundColour, which then lights the Scene.
+	 *
+	 * Paths stop after maxRayDepth bounces. After the first two bounces they are
+	 * also ended at random by Russian roulette, with a chance of going on equal to
+	 * the brightest component of the throughput, which is then scaled up to make
+	 * up for the paths that stop. This is always on, whatever russianRoulette says,
+	 * and ambientLight is not used, as the bounced light replaces it.
+	 *
+	 * \param viewRay The Ray from the Camera.
+	 * \param firstHit The first intersection of the viewRay with the Scene, with its Textures applied.
+	 * \param firstDifferential The viewRay's differentials at the firstHit (see footprint()).
+	 * \return An estimate of the light arriving along the viewRay, which is not clipped.
+	 */
+	Colour tracePath(const Ray& viewRay, const RayIntersection& firstHit, const RayDifferential& firstDifferential) const;
+
+	/** \brief Estimate the direct light at a hit, as part of a path.
+	 *
+	 * Each LightSource is sampled once, at a random point of its sample grid,
+	 * and the EnvironmentLightSource, if there is one, is sampled separately
+	 * so that its diffuse light can be weighted against the light found by
+	 * bouncing (see tracePath()).
+	 *
+	 * \param hitPoint Where the path hits an Object.
+	 * \param normal The unit Normal at the hit, facing the viewer.
+	 * \param view Unit Vector from the hit back towards the viewer.
+	 * \param diffuseChance The chance that the path goes on with a diffuse bounce, or 0 if it stops here.
+	 * \return The Colour of the light reflected towards the viewer.
+	 */
+	Colour sampleLights(const RayIntersection& hitPoint, const Vector& normal, const Vector& view, double diffuseChance) const;
+
+	/** \brief Compute the Colour seen by a Ray, taking bounced diffuse light from the IrradianceCache.
+	 *
+	 * This follows the Ray through mirror reflections, as computeColour() does,
+	 * and lights each hit with direct light, as tracePath() does (see sampleLights()).
+	 * Instead of ambientLight, or following a diffuse bounce, the light arriving
+	 * from other surfaces is taken from the IrradianceCache (see indirectLight()).
+	 *
+	 * \param viewRay The Ray from the Camera.
+	 * \param firstHit The first intersection of the viewRay with the Scene, with its Textures applied.
+	 * \param firstDifferential The viewRay's differentials at the firstHit (see footprint()).
+	 * \return The Colour observed by the viewRay, which is not clipped.
+	 */
+	Colour traceCached(const Ray& viewRay, const RayIntersection& firstHit, const RayDifferential& firstDifferential) const;
+
+	/** \brief Find the light arriving at a hit from other surfaces.
+	 *
+	 * This is interpolated from the IrradianceCache if it can be. If not, a
+	 * new record is gathered, with irradianceSamples Rays spread over a grid of
+	 * cells of the hemisphere above the hit, and added to the cache. Rays which
+	 * miss everything see the backgroundColour, or nothing if there is an
+	 * EnvironmentLightSource, as that is sampled as direct light. The records
+	 * are kept between 1.5 and 20 pixels apart, using the width of a pixel
+	 * at the hit.
+	 *
+	 * \param hitPoint Where a Ray hits an Object.
+	 * \param normal The unit Normal at the hit, facing the viewer.
+	 * \param width The width of the area seen by a pixel at the hit, or 0 if this is not known.
+	 * \return The irradiance, scaled so that it is reflected times the diffuseColour.
+	 */
+	Colour indirectLight(const RayIntersection& hitPoint, const Vector& normal, double width) const;
+
+	/** \brief Trace photons out from the LightSources, and build the PhotonMap of caustics.
+	 *
+	 * Photons are only sent towards a sphere around the Objects which have
+	 * bounds, as Planes reflect light without focusing it, so light reflected
+	 * by mirrored Planes is not followed. Photons are shared between the LightSources in proportion to the light
+	 * they give out, estimated from a grid of photons from each. They are sent
+	 * out in rounds of causticPhotons, each split between several threads,
+	 * until causticPhotons have been stored, or 64 rounds have been sent out.
+	 * If none are stored in the first round, nothing in the Scene can make
+	 * caustics, and no more are sent. Each photon has its own stream of random
+	 * numbers, so the PhotonMap does not depend on the number of threads.
+	 *
+	 * \param lights The LightSources to send photons out from.
+	 */
+	void emitPhotons(const std::vector<std::shared_ptr<LightSource>>& lights);
+
+	/** \brief Trace a run of photons through the Scene.
+	 *
+	 * Each photon follows mirror reflections, ended at random by Russian
+	 * roulette with a chance of going on equal to the brightest component of
+	 * the mirrorColour, and is stored at each surface with a diffuseColour after
+	 * the first reflection. At most maxRayDepth reflections are followed.
+	 *
+	 * \param lights The LightSources to send photons out from.
+	 * \param weights Cumulative sums of the LightSources' weights, starting from 0.
+	 * \param centre The middle of a sphere around the Objects (see LightSource::emit()).
+	 * \param radius The radius of the sphere around the Objects.
+	 * \param first The number of the first photon to trace.
+	 * \param last One past the number of the last photon to trace.
+	 * \param photons The photons to add the stored photons to, with their power not yet divided by the number sent out.
+	 */
+	void tracePhotons(const std::vector<std::shared_ptr<LightSource>>& lights, const std::vector<double>& weights,
+		const Point& centre, double radius, uint64_t first, uint64_t last, std::vector<PhotonMap::Photon>& photons) const;
+
+	/** \brief Find the light of caustics at a hit.
+	 *
+	 * \param hitPoint Where a Ray hits an Object.
+	 * \param normal The unit Normal at the hit.
+	 * \param view Unit Vector from the hit back towards the viewer.
+	 * \return The light reflected towards the viewer from the photons around the hit.
+	 */
+	Colour caustics(const RayIntersection& hitPoint, const Vector& normal, const Vector& view) const;
+
+	/** \brief Fill the OcclusionCache, if ambient occlusion is to be baked.
+	 *
+	 * The grid covers the Objects which have bounds, and occlusionDistance
+	 * around them. The surfaces in each cell are found by casting Rays right
+	 * across the grid through the middles of the cells, along each axis in
+	 * turn, and following each through everything it hits. The first hit in
+	 * each cell, facing each way, is baked, with each side of the surface
+	 * baked separately. The Points are shared between several threads, and
+	 * each has its own stream of random numbers, so the results do not depend
+	 * on the number of threads. If there is an occlusionFile which matches,
+	 * it is read instead, and otherwise it is written after baking.
+	 */
+	void bakeOcclusion();
+
+	/** \brief Work out the ambient occlusion at a run of Points, for bakeOcclusion().
+	 *
+	 * \param points The Points.
+	 * \param normals The unit Normal of the surface at each Point, facing the side to bake.
+	 * \param first The index of the first Point to work on.
+	 * \param last One past the index of the last Point to work on.
+	 * \param open Set to the fraction of Rays not blocked at each Point, which must already have a place for each.
+	 */
+	void bakePoints(const std::vector<Point>& points, const std::vector<Vector>& normals, size_t first, size_t last, std::vector<double>& open) const;
+
+	/** \brief Find the fraction of Rays from a Point which are not blocked by nearby Objects.
+	 *
+	 * This casts occlusionSamples Rays over the hemisphere around the Normal,
+	 * chosen as for a diffuse bounce (see cosineDirection()), and counts how
+	 * many get further than occlusionDistance. Only the any-hit test is
+	 * needed, not the nearest hit.
+	 *
+	 * \param point The Point.
+	 * \param normal The unit Normal of the surface at the Point.
+	 * \return The fraction of the Rays which are not blocked.
+	 */
+	double openness(const Point& point, const Vector& normal) const;
+
+	/** \brief Find how much of the sky can be seen from a hit.
+	 *
+	 * This is looked up from the OcclusionCache if it can be. Otherwise it
+	 * is worked out with Rays over the hemisphere facing the viewer (see
+	 * openness()).
+	 *
+	 * \param ray The Ray which made the hit.
+	 * \param hitPoint Where the Ray hits an Object.
+	 * \return A grey level, from black if every Ray is blocked to white if none are.
+	 */
+	Colour occlusion(const Ray& ray, const RayIntersection& hitPoint) const;
+
+	/** \brief Pick a random Direction around a Normal for a diffuse bounce.
+	 *
+	 * Directions are chosen in proportion to the cosine of their angle to the
+	 * Normal, so the probability density is \f$\cos\theta/\pi\f$ per unit solid angle.
+	 *
+	 * \param normal The unit Normal.
+	 * \param u A random number in [0,1).
+	 * \param v Another random number in [0,1).
+	 * \param cosine Set to the cosine of the angle between the Direction and the Normal.
+	 * \return A unit Vector in the hemisphere around the Normal.
+	 */
+	static Vector cosineDirection(const Vector& normal, double u, double v, double& cosine);
+
+	/** \brief The number of threads to use.
+	 *
+	 * \return renderThreads, or the number of cores if that is zero.
+	 */
+	unsigned int threadCount() const;
+
+	/** \brief Render the image with a given integrator.
+	 *
+	 * The image is cut into tiles of tileSize pixels square, which are
+	 * rendered by threadCount() threads, this one included, handed out by a
+	 * TileScheduler. This is instantiated separately for each integrator, so
+	 * that choosing between them costs nothing per pixel. The tiles do not
+	 * overlap, so the threads write their pixels to a shared image without
+	 * locking. Only this thread touches the Display: between its own tiles,
+	 * and then while it waits for the other threads to finish, it copies the
+	 * tiles the TileScheduler has recorded as finished, which no thread 
+	 * writes to again, and refreshes the Display.
+	 *
+	 * \tparam Integrator One of the integrator classes in Integrator.h.
+	 * \param display The Display to draw the image on.
+	 * \param policy The integrator.
+	 */
+	template<typename Integrator>
+	void renderImage(Display& display, const Integrator& policy) const;
+
+	/** \brief Render tiles of the image until there are none left.
+	 *
+	 * This is the pixel loop run by each thread of renderImage(). The first
+	 * hits of a run of pixels are found, and if the integrator needs them,
+	 * textured, together, so that their Patterns can be evaluated in batches.
+	 * The Rays and hits of the run are kept on this thread's own stack. Each
+	 * sample has its own stream of random numbers, which is kept from when its
+	 * Ray is cast to when its Colour is found.
+	 *
+	 * \tparam Integrator One of the integrator classes in Integrator.h.
+	 * \param display The Display to show the image on.
+	 * \param image The image, a row at a time, which the pixels are written to.
+	 * \param policy The integrator.
+	 * \param scheduler Hands out the tiles.
+	 * \param worker The index of this thread, for the scheduler.
+	 * \param shown For the thread which owns the Display, the number of finished tiles it has shown, and otherwise \c nullptr.
+	 */
+	template<typename Integrator>
+	void renderTiles(Display& display, std::vector<Colour>& image, const Integrator& policy, TileScheduler& scheduler, unsigned int worker, uint32_t* shown) const;
+
+	/** \brief Copy newly finished tiles to the Display, and refresh it if enough have been copied since it was last refreshed.
+	 *
+	 * This must only be called by the thread which owns the Display.
+	 *
+	 * \param display The Display to show the image on.
+	 * \param image The image the tiles are rendered into.
+	 * \param scheduler Records the finished tiles.
+	 * \param shown The number of finished tiles already copied, updated as more are copied.
+	 */
+	void showProgress(Display& display, const std::vector<Colour>& image, const TileScheduler& scheduler, uint32_t& shown) const;
+
+	static const unsigned int tileSize = 16; //!< Width and height in pixels of the tiles the image is rendered in.
+
 };
 
 #endif
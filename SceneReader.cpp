@@ -6,11 +6,27 @@
 
 #include "LightSource.h"
 #include "PointLightSource.h"
+#include "SpotLightSource.h"
+#include "DirectionalLightSource.h"
+#include "EnvironmentLightSource.h"
+#include "AreaLightSource.h"
+#include "RectLightSource.h"
+#include "DiscLightSource.h"
+#include "SphereLightSource.h"
 
 #include "Object.h"
 #include "Sphere.h"
 #include "Cone.h"
+#include "Plane.h"
+#include "Disc.h"
 #include "CSG.h"
+#include "DistanceField.h"
+#include "Group.h"
+#include "Heightfield.h"
+#include "VoxelVolume.h"
+
+#include "Pattern.h"
+#include "Texture.h"
 
 #include <algorithm>
 #include <iostream>
@@ -20,7 +36,7 @@
 #include <sstream>
 
 SceneReader::SceneReader(Scene* scene) :
-scene_(scene), startLine_(0) {
+scene_(scene), startLine_(0), filename_(), spellings_() {
 
 }
 
@@ -37,6 +53,16 @@ void SceneReader::parseTokenBlock(std::queue<std::string>& tokenBlock) {
 		parseCameraBlock(tokenBlock);
 	} else if (blockType == "OBJECT") {
 		parseObjectBlock(tokenBlock);
+		// Top level CSG trees are flattened for faster tracing
+		std::shared_ptr<CSG> csg = std::dynamic_pointer_cast<CSG>(scene_->objects_.back());
+		if (csg) {
+			std::shared_ptr<Group> group = groupUnion(csg);
+			if (group) {
+				scene_->objects_.back() = group;
+			} else {
+				csg->compile();
+			}
+		}
 	} else if (blockType == "LIGHT") {
 		parseLightBlock(tokenBlock);
 	} else if (blockType == "MATERIAL") {
@@ -52,6 +78,7 @@ void SceneReader::read(const std::string& filename) {
 	std::cout << "Reading scene from " << filename << std::endl;
 
 	std::ifstream fin(filename);
+	filename_ = filename;
 
 	std::string line;
 	int lineNumber = 0;
@@ -60,10 +87,18 @@ void SceneReader::read(const std::string& filename) {
 	std::queue<std::string> tokenBlock;
 	while (std::getline(fin, line)) {
 		++lineNumber;
+		std::string original = line;
 		std::transform(line.begin(), line.end(), line.begin(), toupper);
 		std::stringstream strstream(line);
+		std::stringstream originalStream(original);
 		std::string token;
+		std::string spelling;
 		while (strstream >> token) {
+			// File names are looked up with the case they were written in
+			originalStream >> spelling;
+			if (spelling != token) {
+				spellings_[token] = spelling;
+			}
 			if (token[0] == '#') {
 				// A comment
 				break;
@@ -99,6 +134,26 @@ void SceneReader::read(const std::string& filename) {
 }
 
 
+integrator_type SceneReader::parseIntegrator(const std::string& name) {
+	std::string type = name;
+	std::transform(type.begin(), type.end(), type.begin(), toupper);
+	if (type == "WHITTED") {
+		return INTEGRATOR_WHITTED;
+	} else if (type == "PATH") {
+		return INTEGRATOR_PATH;
+	} else if (type == "OCCLUSION") {
+		return INTEGRATOR_OCCLUSION;
+	} else if (type == "NORMALS") {
+		return INTEGRATOR_NORMALS;
+	} else if (type == "DEPTH") {
+		return INTEGRATOR_DEPTH;
+	} else if (type == "IRRADIANCE") {
+		return INTEGRATOR_IRRADIANCE;
+	}
+	std::cerr << "Unknown integrator '" << name << "'" << std::endl;
+	exit(-1);
+}
+
 void SceneReader::parseSceneBlock(std::queue<std::string>& tokenBlock)  {
 	while (tokenBlock.size() > 0) {
 		std::string token = tokenBlock.front();
@@ -111,12 +166,59 @@ void SceneReader::parseSceneBlock(std::queue<std::string>& tokenBlock)  {
 			scene_->renderWidth = int(parseNumber(tokenBlock));
 			scene_->renderHeight = int(parseNumber(tokenBlock));
 		} else if (token == "FILENAME") {
-			scene_->filename = tokenBlock.front();
-			tokenBlock.pop();
-			std::string& fname = scene_->filename;
-			std::transform(fname.begin(), fname.end(), fname.begin(), tolower);
+			scene_->filename = parseFileName(tokenBlock);
 		} else if (token == "RAYDEPTH") {
 			scene_->maxRayDepth = int(parseNumber(tokenBlock));
+		} else if (token == "MINTHROUGHPUT") {
+			scene_->minThroughput = parseNumber(tokenBlock);
+		} else if (token == "RUSSIANROULETTE") {
+			scene_->russianRoulette = parseNumber(tokenBlock) != 0;
+		} else if (token == "LIGHTTHRESHOLD") {
+			scene_->lightThreshold = parseNumber(tokenBlock);
+		} else if (token == "LIGHTSAMPLES") {
+			scene_->lightSamples = int(parseNumber(tokenBlock));
+		} else if (token == "TEXTUREMEMORY") {
+			scene_->textureMemory = parseNumber(tokenBlock);
+		} else if (token == "RENDERTHREADS") {
+			scene_->renderThreads = int(parseNumber(tokenBlock));
+		} else if (token == "STATISTICS") {
+			scene_->statistics = parseNumber(tokenBlock) != 0;
+		} else if (token == "INTEGRATOR") {
+			scene_->integrator = parseIntegrator(tokenBlock.front());
+			tokenBlock.pop();
+		} else if (token == "PIXELSAMPLES") {
+			scene_->pixelSamples = int(parseNumber(tokenBlock));
+		} else if (token == "OCCLUSIONSAMPLES") {
+			scene_->occlusionSamples = int(parseNumber(tokenBlock));
+		} else if (token == "OCCLUSIONDISTANCE") {
+			scene_->occlusionDistance = parseNumber(tokenBlock);
+		} else if (token == "OCCLUSIONBAKE") {
+			scene_->occlusionBake = parseNumber(tokenBlock);
+			// Keep the baked occlusion next to the scene file, unless told otherwise
+			if (scene_->occlusionFile.empty()) {
+				size_t dot = filename_.find_last_of('.');
+				size_t slash = filename_.find_last_of("/\\");
+				if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+					dot = filename_.size();
+				}
+				scene_->occlusionFile = filename_.substr(0, dot) + ".ao";
+			}
+		} else if (token == "OCCLUSIONFILE") {
+			scene_->occlusionFile = parseFileName(tokenBlock);
+		} else if (token == "DEPTHRANGE") {
+			scene_->depthRange = parseNumber(tokenBlock);
+		} else if (token == "IRRADIANCESAMPLES") {
+			scene_->irradianceSamples = int(parseNumber(tokenBlock));
+		} else if (token == "IRRADIANCEERROR") {
+			scene_->irradianceError = parseNumber(tokenBlock);
+		} else if (token == "IRRADIANCEFILE") {
+			scene_->irradianceFile = parseFileName(tokenBlock);
+		} else if (token == "CAUSTICPHOTONS") {
+			scene_->causticPhotons = int(parseNumber(tokenBlock));
+		} else if (token == "CAUSTICNEIGHBOURS") {
+			scene_->causticNeighbours = int(parseNumber(tokenBlock));
+		} else if (token == "CAUSTICRADIUS") {
+			scene_->causticRadius = parseNumber(tokenBlock);
 		} else {
 			std::cerr << "Unexpected token '" << token << "' in block starting on line " << startLine_ << std::endl;
 			exit(-1);
@@ -124,6 +226,63 @@ void SceneReader::parseSceneBlock(std::queue<std::string>& tokenBlock)  {
 	}
 }
 
+// Check that a CSG tree is only unions, with parts that all share one Material
+static bool isGroupingUnion(const std::shared_ptr<Object>& object, const Material& material) {
+	std::shared_ptr<CSG> csg = std::dynamic_pointer_cast<CSG>(object);
+	if (csg && csg->operation() == CSG_UNION) {
+		return isGroupingUnion(csg->left, material) && isGroupingUnion(csg->right, material);
+	}
+	return object->material == material;
+}
+
+// Collect the parts of a union, moving the transforms of the union nodes onto them
+static void collectUnion(const std::shared_ptr<Object>& object, std::vector<const Transform*>& transforms, std::vector<std::shared_ptr<Object>>& parts) {
+	std::shared_ptr<CSG> csg = std::dynamic_pointer_cast<CSG>(object);
+	if (csg && csg->operation() == CSG_UNION) {
+		transforms.push_back(&csg->transform);
+		collectUnion(csg->left, transforms, parts);
+		collectUnion(csg->right, transforms, parts);
+		transforms.pop_back();
+		return;
+	}
+	for (auto transform = transforms.rbegin(); transform != transforms.rend(); ++transform) {
+		object->transform.compose(**transform);
+	}
+	if (csg) {
+		csg->compile();
+	}
+	// A Group only needs the first hit on each of its parts
+	std::shared_ptr<DistanceField> field = std::dynamic_pointer_cast<DistanceField>(object);
+	if (field) {
+		field->allHits = false;
+	}
+	parts.push_back(object);
+}
+
+std::shared_ptr<Group> SceneReader::groupUnion(const std::shared_ptr<CSG>& csg) {
+	std::shared_ptr<Group> group;
+	if (csg->operation() != CSG_UNION) {
+		return group;
+	}
+	// Find a part to take the Material from
+	std::shared_ptr<Object> part = csg;
+	while (std::dynamic_pointer_cast<CSG>(part) && std::static_pointer_cast<CSG>(part)->operation() == CSG_UNION) {
+		part = std::static_pointer_cast<CSG>(part)->left;
+	}
+	if (!isGroupingUnion(csg, part->material)) {
+		return group;
+	}
+
+	group = std::shared_ptr<Group>(new Group());
+	group->transform = csg->transform;
+	group->material = part->material;
+	std::vector<const Transform*> transforms;
+	collectUnion(csg->left, transforms, group->children);
+	collectUnion(csg->right, transforms, group->children);
+	group->build();
+	return group;
+}
+
 double SceneReader::parseNumber(std::queue<std::string>& tokenBlock) {
 	std::string token = tokenBlock.front();
 	tokenBlock.pop();
@@ -136,6 +295,60 @@ double SceneReader::parseNumber(std::queue<std::string>& tokenBlock) {
 	return result;
 }
 
+std::string SceneReader::parseFileName(std::queue<std::string>& tokenBlock) {
+	std::string token = tokenBlock.front();
+	tokenBlock.pop();
+	auto found = spellings_.find(token);
+	if (found != spellings_.end()) {
+		return found->second;
+	}
+	return token;
+}
+
+const Texture* SceneReader::parseTexture(std::queue<std::string>& tokenBlock) {
+	std::string fname = parseFileName(tokenBlock);
+	size_t width = size_t(parseNumber(tokenBlock));
+	size_t height = size_t(parseNumber(tokenBlock));
+	auto found = textures_.find(fname);
+	if (found != textures_.end()) {
+		return found->second;
+	}
+	std::shared_ptr<Texture> texture(new Texture());
+	texture->load(fname, width, height, scene_->textureCache_);
+	scene_->textures_.push_back(texture);
+	textures_[fname] = texture.get();
+	return texture.get();
+}
+
+const Pattern* SceneReader::parsePattern(std::queue<std::string>& tokenBlock) {
+	std::string type = tokenBlock.front();
+	tokenBlock.pop();
+	double scale = parseNumber(tokenBlock);
+	Colour colour0 = parseColour(tokenBlock);
+	Colour colour1 = parseColour(tokenBlock);
+	if (scale <= 0) {
+		std::cerr << "Pattern scale must be positive in block starting on line " << startLine_ << std::endl;
+		exit(-1);
+	}
+	std::shared_ptr<const Pattern> pattern;
+	if (type == "NOISE") {
+		pattern = std::make_shared<NoisePattern>(colour0, colour1, scale);
+	} else if (type == "FBM") {
+		pattern = std::make_shared<FbmPattern>(colour0, colour1, scale);
+	} else if (type == "CHECKER") {
+		pattern = std::make_shared<CheckerPattern>(colour0, colour1, scale);
+	} else if (type == "MARBLE") {
+		pattern = std::make_shared<MarblePattern>(colour0, colour1, scale);
+	} else if (type == "WOOD") {
+		pattern = std::make_shared<WoodPattern>(colour0, colour1, scale);
+	} else {
+		std::cerr << "Unknown pattern type '" << type << "' in block starting on line " << startLine_ << std::endl;
+		exit(-1);
+	}
+	scene_->patterns_.push_back(pattern);
+	return pattern.get();
+}
+
 Colour SceneReader::parseColour(std::queue<std::string>& tokenBlock) {
 	Colour result;
 	result.red = parseNumber(tokenBlock);
@@ -204,11 +417,39 @@ void SceneReader::parseLightBlock(std::queue<std::string>& tokenBlock) {
 	std::shared_ptr<LightSource> light;
 	if (lightType == "POINTLIGHT") {
 		light = scene_->newLight<PointLightSource>();
+	} else if (lightType == "SPOTLIGHT") {
+		Direction direction;
+		for (int i = 0; i < 3; ++i) {
+			direction(i) = parseNumber(tokenBlock);
+		}
+		double angle = parseNumber(tokenBlock);
+		light = scene_->newLight<SpotLightSource>(direction, angle);
+	} else if (lightType == "DIRECTIONALLIGHT") {
+		light = scene_->newLight<DirectionalLightSource>();
+	} else if (lightType == "RECTLIGHT") {
+		light = scene_->newLight<RectLightSource>();
+	} else if (lightType == "DISCLIGHT") {
+		light = scene_->newLight<DiscLightSource>();
+	} else if (lightType == "SPHERELIGHT") {
+		light = scene_->newLight<SphereLightSource>();
+	} else if (lightType == "ENVIRONMENT") {
+		if (scene_->environment_) {
+			std::cerr << "Warning: more than one environment found in block starting on line " << startLine_ << ", using the last" << std::endl;
+		}
+		scene_->environment_ = scene_->newLight<EnvironmentLightSource>();
+		light = scene_->environment_;
 	} else {
 		std::cerr << "Unexpected light type '" << lightType << "' in block starting on line " << startLine_ << std::endl;
 		exit(-1);
 	}
 
+	std::shared_ptr<DirectionalLightSource> sun = std::dynamic_pointer_cast<DirectionalLightSource>(light);
+	std::shared_ptr<AreaLightSource> area = std::dynamic_pointer_cast<AreaLightSource>(light);
+	std::shared_ptr<RectLightSource> rect = std::dynamic_pointer_cast<RectLightSource>(light);
+	std::shared_ptr<DiscLightSource> disc = std::dynamic_pointer_cast<DiscLightSource>(light);
+	std::shared_ptr<SphereLightSource> ball = std::dynamic_pointer_cast<SphereLightSource>(light);
+	std::shared_ptr<EnvironmentLightSource> sky = std::dynamic_pointer_cast<EnvironmentLightSource>(light);
+
 	while (tokenBlock.size() > 0) {
 		std::string token = tokenBlock.front();
 		tokenBlock.pop();
@@ -218,6 +459,34 @@ void SceneReader::parseLightBlock(std::queue<std::string>& tokenBlock) {
 			light->location(2) = parseNumber(tokenBlock);
 		} else if (token == "COLOUR") {
 			light->colour = parseColour(tokenBlock);
+		} else if (token == "DIRECTION" && sun) {
+			for (int i = 0; i < 3; ++i) {
+				sun->direction(i) = parseNumber(tokenBlock);
+			}
+		} else if (token == "SAMPLES" && area) {
+			area->samples = int(parseNumber(tokenBlock));
+		} else if (token == "EDGES" && rect) {
+			for (int i = 0; i < 3; ++i) {
+				rect->edge1(i) = parseNumber(tokenBlock);
+			}
+			for (int i = 0; i < 3; ++i) {
+				rect->edge2(i) = parseNumber(tokenBlock);
+			}
+		} else if (token == "NORMAL" && disc) {
+			for (int i = 0; i < 3; ++i) {
+				disc->normal(i) = parseNumber(tokenBlock);
+			}
+		} else if (token == "RADIUS" && disc) {
+			disc->radius = parseNumber(tokenBlock);
+		} else if (token == "RADIUS" && ball) {
+			ball->radius = parseNumber(tokenBlock);
+		} else if (token == "SAMPLES" && sky) {
+			sky->samples = int(parseNumber(tokenBlock));
+		} else if (token == "FILE" && sky) {
+			std::string fname = parseFileName(tokenBlock);
+			size_t width = size_t(parseNumber(tokenBlock));
+			size_t height = size_t(parseNumber(tokenBlock));
+			sky->load(fname, width, height);
 		} else {
 			std::cerr << "Unexpected token '" << token << "' in block starting on line " << startLine_ << std::endl;
 			exit(-1);
@@ -234,6 +503,16 @@ void SceneReader::parseObjectBlock(std::queue<std::string>& tokenBlock) {
 		object = scene_->newObject<Sphere>();
 	} else if (objectType == "CONE") {
 		object = scene_->newObject<Cone>();
+	} else if (objectType == "PLANE") {
+		object = scene_->newObject<Plane>();
+	} else if (objectType == "DISC") {
+		object = scene_->newObject<Disc>();
+	} else if (objectType == "DISTANCEFIELD") {
+		object = scene_->newObject<DistanceField>();
+	} else if (objectType == "HEIGHTFIELD") {
+		object = scene_->newObject<Heightfield>();
+	} else if (objectType == "VOLUME") {
+		object = scene_->newObject<VoxelVolume>();
 	} else if (objectType == "CSG") {
 		std::string csgType = tokenBlock.front();
 		tokenBlock.pop();
@@ -299,6 +578,14 @@ void SceneReader::parseObjectBlock(std::queue<std::string>& tokenBlock) {
 		std::shared_ptr<Object> right = scene_->objects_.back();
 		scene_->objects_.pop_back();
 
+		// A CSG node needs every hit on a DistanceField, not just the first
+		for (const std::shared_ptr<Object>& child : {left, right}) {
+			std::shared_ptr<DistanceField> childField = std::dynamic_pointer_cast<DistanceField>(child);
+			if (childField) {
+				childField->allHits = true;
+			}
+		}
+
 		object = scene_->newObject<CSG>();
 		std::shared_ptr<CSG> csgNode = std::static_pointer_cast<CSG>(object);
 		csgNode->left = left;
@@ -309,6 +596,19 @@ void SceneReader::parseObjectBlock(std::queue<std::string>& tokenBlock) {
 		exit(-1);
 	}
 
+	// Shapes making up a DistanceField, and how to blend them
+	std::shared_ptr<DistanceField> field = std::dynamic_pointer_cast<DistanceField>(object);
+	std::shared_ptr<const DistanceFunction> shape;
+	double blendRadius = 0;
+
+	std::shared_ptr<Heightfield> terrain = std::dynamic_pointer_cast<Heightfield>(object);
+	std::shared_ptr<VoxelVolume> volume = std::dynamic_pointer_cast<VoxelVolume>(object);
+	// The threshold decides which parts of a VoxelVolume's file are kept, so the file is loaded at the end of the block
+	std::string volumeFile;
+	size_t volumeSize[3] = {0, 0, 0};
+	voxel_format volumeFormat = VOXEL_UINT8;
+	double volumeThreshold = 0.5;
+
 	// Parse object details
 	while (tokenBlock.size() > 0) {
 		std::string token = tokenBlock.front();
@@ -363,12 +663,93 @@ void SceneReader::parseObjectBlock(std::queue<std::string>& tokenBlock) {
 			object->material.specularExponent = parseNumber(tokenBlock);
 		} else if (token == "MIRROR") {
 			object->material.mirrorColour = parseColour(tokenBlock);
+		} else if (token == "DIFFUSETEXTURE") {
+			object->material.diffuseTexture = parseTexture(tokenBlock);
+		} else if (token == "SPECULARTEXTURE") {
+			object->material.specularTexture = parseTexture(tokenBlock);
+		} else if (token == "MIRRORTEXTURE") {
+			object->material.mirrorTexture = parseTexture(tokenBlock);
+		} else if (token == "DIFFUSEPATTERN") {
+			object->material.diffusePattern = parsePattern(tokenBlock);
+		} else if (token == "SPECULARPATTERN") {
+			object->material.specularPattern = parsePattern(tokenBlock);
+		} else if (token == "MIRRORPATTERN") {
+			object->material.mirrorPattern = parsePattern(tokenBlock);
+		} else if (field && (token == "SPHERE" || token == "BOX" || token == "TORUS")) {
+			Point centre;
+			centre(0) = parseNumber(tokenBlock);
+			centre(1) = parseNumber(tokenBlock);
+			centre(2) = parseNumber(tokenBlock);
+			std::shared_ptr<const DistanceFunction> newShape;
+			if (token == "SPHERE") {
+				double radius = parseNumber(tokenBlock);
+				newShape = std::shared_ptr<const DistanceFunction>(new SphereDistance(centre, radius));
+			} else if (token == "BOX") {
+				Vector halfSize(3);
+				halfSize(0) = parseNumber(tokenBlock);
+				halfSize(1) = parseNumber(tokenBlock);
+				halfSize(2) = parseNumber(tokenBlock);
+				newShape = std::shared_ptr<const DistanceFunction>(new BoxDistance(centre, halfSize));
+			} else {
+				double majorRadius = parseNumber(tokenBlock);
+				double minorRadius = parseNumber(tokenBlock);
+				newShape = std::shared_ptr<const DistanceFunction>(new TorusDistance(centre, majorRadius, minorRadius));
+			}
+			if (shape) {
+				shape = std::shared_ptr<const DistanceFunction>(new BlendDistance(shape, newShape, BLEND_UNION, blendRadius));
+			} else {
+				shape = newShape;
+			}
+		} else if (field && token == "BLEND") {
+			blendRadius = parseNumber(tokenBlock);
+		} else if (field && token == "STEPS") {
+			field->maxSteps = int(parseNumber(tokenBlock));
+		} else if (terrain && token == "FILE") {
+			std::string fname = parseFileName(tokenBlock);
+			size_t width = size_t(parseNumber(tokenBlock));
+			size_t depth = size_t(parseNumber(tokenBlock));
+			std::string format = tokenBlock.front();
+			tokenBlock.pop();
+			if (format == "UINT16") {
+				terrain->load(fname, width, depth, HEIGHTFIELD_UINT16);
+			} else if (format == "FLOAT") {
+				terrain->load(fname, width, depth, HEIGHTFIELD_FLOAT);
+			} else {
+				std::cerr << "Unexpected heightfield format '" << format << "' in block starting on line " << startLine_ << std::endl;
+				exit(-1);
+			}
+		} else if (volume && token == "FILE") {
+			volumeFile = parseFileName(tokenBlock);
+			for (int a = 0; a < 3; ++a) {
+				volumeSize[a] = size_t(parseNumber(tokenBlock));
+			}
+			std::string format = tokenBlock.front();
+			tokenBlock.pop();
+			if (format == "UINT8") {
+				volumeFormat = VOXEL_UINT8;
+			} else if (format == "UINT16") {
+				volumeFormat = VOXEL_UINT16;
+			} else if (format == "FLOAT") {
+				volumeFormat = VOXEL_FLOAT;
+			} else {
+				std::cerr << "Unexpected voxel format '" << format << "' in block starting on line " << startLine_ << std::endl;
+				exit(-1);
+			}
+		} else if (volume && token == "THRESHOLD") {
+			volumeThreshold = parseNumber(tokenBlock);
 		} else {
 			std::cerr << "Unexpected token '" << token << "' in block starting on line " << startLine_ << std::endl;
 			exit(-1);
 		}
 
 	}
+
+	if (shape) {
+		field->function = shape;
+	}
+	if (!volumeFile.empty()) {
+		volume->load(volumeFile, volumeSize[0], volumeSize[1], volumeSize[2], volumeFormat, volumeThreshold);
+	}
 }
 
 void SceneReader::parseMaterialBlock(std::queue<std::string>& tokenBlock) {
@@ -397,6 +778,18 @@ void SceneReader::parseMaterialBlock(std::queue<std::string>& tokenBlock) {
 			material.specularExponent = parseNumber(tokenBlock);
 		} else if (token == "MIRROR") {
 			material.mirrorColour = parseColour(tokenBlock);
+		} else if (token == "DIFFUSETEXTURE") {
+			material.diffuseTexture = parseTexture(tokenBlock);
+		} else if (token == "SPECULARTEXTURE") {
+			material.specularTexture = parseTexture(tokenBlock);
+		} else if (token == "MIRRORTEXTURE") {
+			material.mirrorTexture = parseTexture(tokenBlock);
+		} else if (token == "DIFFUSEPATTERN") {
+			material.diffusePattern = parsePattern(tokenBlock);
+		} else if (token == "SPECULARPATTERN") {
+			material.specularPattern = parsePattern(tokenBlock);
+		} else if (token == "MIRRORPATTERN") {
+			material.mirrorPattern = parsePattern(tokenBlock);
 		} else {
 			std::cerr << "Unexpected token '" << token << "' in block starting on line " << startLine_ << std::endl;
 			exit(-1);
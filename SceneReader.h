@@ -6,9 +6,14 @@
 
 #include "NonCopyable.h"
 
+#include "CSG.h"
+#include "Group.h"
+
 #include "Colour.h"
 #include "Material.h"
 #include "Scene.h"
+#include "Pattern.h"
+#include "Texture.h"
 
 #include <map>
 #include <queue>
@@ -24,7 +29,8 @@
  * This class implements a simple parser for Scene description files.
  * A SceneReader is linked to a Scene object, and can then read one or more
  * text files describing Scene properties, Cameras, LightSources, and Objects.
- * These files are defined in blocks, and are case-insensitive. 
+ * These files are defined in blocks, and are case-insensitive, except for
+ * the names of files, which keep the case they are written in.
  * Whitespace is contracted, so new lines, spaces, and tabs are all just token separators.
  * Comments are introduced with \c #, and continue to the end of the line.
  *
@@ -56,6 +62,26 @@
  * - <tt>backgroundColour [red] [green] [blue]</tt>: Set the Scene's \c backgroundColour property to the given Colour.
  * - <tt>filename [file]</tt>: Set the Scene's \c filename property to the given value.
  * - <tt>rayDepth [number]</tt>: Set the Scene's \c rayDepth property to the given value.
+ * - <tt>minThroughput [value]</tt>: Set the Scene's \c minThroughput property, so that reflections dimmer than the given value are not traced.
+ * - <tt>russianRoulette [0|1]</tt>: Set the Scene's \c russianRoulette property, so that dim reflections are continued at random rather than cut off.
+ * - <tt>lightThreshold [value]</tt>: Set the Scene's \c lightThreshold property, so that lights are ignored where they are dimmer than the given value.
+ * - <tt>textureMemory [megabytes]</tt>: Set the Scene's \c textureMemory property, the most memory to use for Texture tiles.
+ * - <tt>renderThreads [number]</tt>: Set the Scene's \c renderThreads property, the number of threads to render with, or 0 for one per core.
+ * - <tt>statistics [0|1]</tt>: Set the Scene's \c statistics property, so that statistics about the render are printed once it is done.
+ * - <tt>lightSamples [number]</tt>: Set the Scene's \c lightSamples property, so that each point is lit by the given number of lights picked at random.
+ * - <tt>integrator [Whitted|Path|Irradiance|Occlusion|Normals|Depth]</tt>: Set the Scene's \c integrator property, to ray trace or path trace the image, or show one of the debug views.
+ * - <tt>pixelSamples [number]</tt>: Set the Scene's \c pixelSamples property, the number of paths traced through each pixel when path tracing.
+ * - <tt>occlusionSamples [number]</tt>: Set the Scene's \c occlusionSamples property, the number of Rays cast from each point for ambient occlusion.
+ * - <tt>occlusionDistance [value]</tt>: Set the Scene's \c occlusionDistance property, how far away an Object can occlude a point.
+ * - <tt>occlusionBake [size]</tt>: Set the Scene's \c occlusionBake property, to bake ambient occlusion into cells of the given size. Unless an \c occlusionFile has been given, the baked occlusion is kept in a file next to the scene file, with the extension <tt>.ao</tt>.
+ * - <tt>occlusionFile [file]</tt>: Set the Scene's \c occlusionFile property, to keep the baked ambient occlusion in the given file.
+ * - <tt>depthRange [value]</tt>: Set the Scene's \c depthRange property, the distance shown as black in the depth view.
+ * - <tt>irradianceSamples [number]</tt>: Set the Scene's \c irradianceSamples property, the number of Rays cast to gather each record of the irradiance cache.
+ * - <tt>irradianceError [value]</tt>: Set the Scene's \c irradianceError property, the largest error allowed when reusing a record.
+ * - <tt>irradianceFile [file]</tt>: Set the Scene's \c irradianceFile property, to keep the irradiance cache from one render to the next.
+ * - <tt>causticPhotons [number]</tt>: Set the Scene's \c causticPhotons property, the number of photons to store for caustics from mirrors.
+ * - <tt>causticNeighbours [number]</tt>: Set the Scene's \c causticNeighbours property, the number of photons used to find the light of a caustic at each point.
+ * - <tt>causticRadius [value]</tt>: Set the Scene's \c causticRadius property, the furthest from a point that photons are gathered.
  *
  * <b>Camera Blocks</b>
  *
@@ -88,6 +114,23 @@ Light SpotLight 0 1 0 15
   Location 0 -5 0
   Colour 10 10 10
 End
+
+Light DirectionalLight
+  Direction 1 2 1
+  Colour 0.8 0.8 0.8
+End
+
+Light RectLight
+  Location 0 -5 0
+  Colour 10 10 10
+  Edges 2 0 0 0 0 1
+  Samples 6
+End
+
+Light Environment
+  File sky.raw 2048 1024
+  Samples 4
+End
 \endverbatim
  *
  * A Light block starts with a line giving the type of Light.
@@ -98,6 +141,20 @@ End
  * - <tt>Location [x] [y] [z]</tt>: Set the Light's \c location property to the given co-ordinates.
  * - <tt>Colour [red] [green] [blue]</tt>: Set the Light's \c colour property to the given Colour.
  *
+ * A DirectionalLight also allows:
+ * - <tt>Direction [x] [y] [z]</tt>: Set the Direction the light travels in. Its location is not used.
+ *
+ * The area lights, RectLight, DiscLight, and SphereLight, give soft shadows. They also allow:
+ * - <tt>Samples [number]</tt>: Set the Light's \c samples property, the size of the grid of shadow samples (all lights).
+ * - <tt>Edges [x1] [y1] [z1] [x2] [y2] [z2]</tt>: Set the sides of the rectangle, \c edge1 and \c edge2, which light the side towards \c edge2 &times; \c edge1 (RectLight only).
+ * - <tt>Normal [x] [y] [z]</tt>: Set the Direction the disc faces (DiscLight only).
+ * - <tt>Radius [r]</tt>: Set the radius of the disc or ball (DiscLight and SphereLight only).
+ *
+ * An Environment surrounds the Scene with an image of the sky, which is both the background
+ * and a light (see EnvironmentLightSource). Its Colour scales the image. It also allows:
+ * - <tt>File [file] [width] [height]</tt>: Load the image from a raw file of 32-bit floating point RGB values.
+ * - <tt>Samples [number]</tt>: Set the size of the grid of samples, as for the area lights.
+ *
  * <b> Material Blocks </b>
  *
  * Example:
@@ -117,6 +174,13 @@ End
  * - <tt>Colour [red] [green] [blue]</tt>: Set the Material's \c ambientColour and \c diffuseColour properties to the given Colour.
  * - <tt>Specular [red] [green] [blue] [exponent]</tt>: Set the Material's \c specularColour property to the given Colour, and its \c specularExponent to the given value.
  * - <tt>Mirror [red] [green] [blue]</tt>: Set the Material's \c diffuseColour property to the given Colour.
+ * - <tt>DiffuseTexture [file] [width] [height]</tt>: Set the Material's \c diffuseTexture to the raw RGB image in the given file (see Texture).
+ * - <tt>SpecularTexture [file] [width] [height]</tt>: Set the Material's \c specularTexture to the raw RGB image in the given file.
+ * - <tt>MirrorTexture [file] [width] [height]</tt>: Set the Material's \c mirrorTexture to the raw RGB image in the given file.
+ * - <tt>DiffusePattern [type] [scale] [red0] [green0] [blue0] [red1] [green1] [blue1]</tt>: Set the Material's \c diffusePattern
+ *   to a procedural Pattern blending between two Colours. The type is one of Noise, Fbm, Checker, Marble, or Wood,
+ *   and the scale is the size of its features.
+ * - <tt>SpecularPattern</tt>, <tt>MirrorPattern</tt>: Set the Material's \c specularPattern or \c mirrorPattern, in the same way.
  *
  * <b> Object Blocks </b>
  *
@@ -132,7 +196,9 @@ Object Sphere
  *
  * An Object block starts with a line giving the type of Object to
  * create (a sphere in this case - CSG Objects have some additional
- * description, below).
+ * description, below). The other basic types are Cone, Plane (the
+ * infinite plane y = 0, which makes a good floor), and Disc (a disc of
+ * radius 1 in the plane y = 0).
  *
  * Allowed elements within an Object block are:
  * - <tt>Rotate [axis] [angle]</tt>: Apply a rotation of angle degrees about the specified axis (one of X, Y, or Z) to the Object.
@@ -145,6 +211,67 @@ Object Sphere
  * - <tt>Colour [red] [green] [blue]</tt>: Set the \c ambientColour and \c diffuseColour properties of the Object's Material to the given Colour.
  * - <tt>Specular [red] [green] [blue] [exponent]</tt>: Set the\c specularColour property to the given Colour, and its \c specularExponent to the given value.
  * - <tt>Mirror [red] [green] [blue]</tt>: Set the \c diffuseColour property of the Object's Material to the given Colour.
+ * - <tt>DiffuseTexture</tt>, <tt>SpecularTexture</tt>, <tt>MirrorTexture [file] [width] [height]</tt>: Set a Texture of the Object's Material, as for Material blocks.
+ * - <tt>DiffusePattern</tt>, <tt>SpecularPattern</tt>, <tt>MirrorPattern [type] [scale] [colour0] [colour1]</tt>: Set a Pattern of the Object's Material, as for Material blocks.
+ *
+ * <b> Object DistanceField blocks </b>
+ *
+ * Example:
+\verbatim
+Object DistanceField
+  Colour 0.8 0.3 0.3
+  Blend 0.5
+  Sphere 0 0 0 1
+  Sphere 1.2 0 0 0.7
+  Torus 0 0.5 0 1.5 0.2
+  Steps 128
+End
+\endverbatim
+ *
+ * A DistanceField is made from the union of a number of simple shapes, 
+ * which may be smoothly blended together. As well as the elements allowed
+ * in any Object block, a DistanceField block may contain:
+ * - <tt>Sphere [x] [y] [z] [radius]</tt>: Add a sphere with the given centre and radius.
+ * - <tt>Box [x] [y] [z] [hx] [hy] [hz]</tt>: Add an axis-aligned box with the given centre and half-sizes.
+ * - <tt>Torus [x] [y] [z] [major] [minor]</tt>: Add a torus in the X-Z plane with the given centre and radii.
+ * - <tt>Blend [radius]</tt>: Blend shapes added after this over the given radius (0, the default, gives sharp creases).
+ * - <tt>Steps [number]</tt>: Set the most sphere tracing steps to take along each Ray.
+ * If no shapes are given the DistanceField is a unit sphere.
+ *
+ * <b> Object Heightfield blocks </b>
+ *
+ * Example:
+\verbatim
+Object Heightfield
+  Colour 0.4 0.6 0.3
+  File terrain.raw 1024 1024 uint16
+  Scale3 10 1 10
+End
+\endverbatim
+ *
+ * A Heightfield is a terrain over the unit square in the X-Z plane, with
+ * heights given by a grid of samples read from a file. As well as the 
+ * elements allowed in any Object block, a Heightfield block may contain:
+ * - <tt>File [filename] [width] [depth] [format]</tt>: Read a raw grid of width x depth samples from the file, where the format is \c uint16 (scaled so that 65535 is a height of 1) or \c float.
+ *
+ *
+ * <b> Object Volume blocks </b>
+ *
+ * Example:
+\verbatim
+Object Volume
+  Colour 0.9 0.9 0.8
+  File scan.raw 512 512 256 uint16
+  Threshold 0.3
+  Translate -0.5 -0.5 -0.5
+End
+\endverbatim
+ *
+ * A Volume is a VoxelVolume filling the unit cube, whose surface is where
+ * the values of a grid of samples cross a threshold. As well as the elements
+ * allowed in any Object block, a Volume block may contain:
+ * - <tt>File [filename] [x] [y] [z] [format]</tt>: Read a raw grid of x by y by z samples from the file, where the format is \c uint8, \c uint16, or \c float (integers are scaled so that their largest value is 1).
+ * - <tt>Threshold [value]</tt>: Set the value at the surface (0.5 by default). This applies to the File wherever it appears in the block.
  *
  * <b> Object CSG blocks </b>
  * 
@@ -174,7 +301,14 @@ End
  *
  * Note that since the inner Object blocks are recursively parsed, it
  * is possible to include Object CSG nodes as the children of an
- * Object CSG node.
+ * Object CSG node. Once a top-level CSG tree has been read it is 
+ * compiled into a CSGProgram for faster tracing.
+ *
+ * Large assemblies are often described as nested CSG unions of parts
+ * which share a Material. When a top-level CSG tree consists only of
+ * union nodes, and all of its parts have the same Material, it is 
+ * replaced by a Group of the parts. This renders the same, but a Group
+ * only needs the nearest hit, and keeps its parts in a BVH.
  */
 class SceneReader : private NonCopyable {
 
@@ -200,6 +334,17 @@ public:
 	 */
 	void read(const std::string& filename);
 
+	/** \brief Find the integrator with a given name.
+	 *
+	 * This is used for the \c integrator element of Scene blocks, and for
+	 * choosing the integrator on the command line. Case is ignored.
+	 * If the name is not known, the program is terminated.
+	 *
+	 * \param name The name of the integrator: \c Whitted, \c Path, \c Irradiance, \c Occlusion, \c Normals, or \c Depth.
+	 * \return The integrator.
+	 */
+	static integrator_type parseIntegrator(const std::string& name);
+
 private:
 
 	/** \brief Parse a block of tokens. 
@@ -237,6 +382,37 @@ private:
 	 */
 	double parseNumber(std::queue<std::string>& tokenBlock);
 
+	/** \brief Read a file name from a block of tokens.
+	 *
+	 * The tokens are all in upper case, so the file name is given as it was
+	 * written in the file, for the sake of case-sensitive file systems. The
+	 * token is removed from the block.
+	 *
+	 * \param tokenBlock A sequence of tokens to read the file name from.
+	 * \return The file name, in its original case.
+	 */
+	std::string parseFileName(std::queue<std::string>& tokenBlock);
+
+	/** \brief Read a Texture from a block of tokens.
+	 *
+	 * This takes a file name, a width, and a height from the block, and
+	 * loads the Texture (see Texture::load()). Each file is only loaded once,
+	 * however many Materials use it.
+	 *
+	 * \param tokenBlock A sequence of tokens to read the Texture from.
+	 * \return The Texture read from the block of tokens, which belongs to the Scene.
+	 */
+	const Texture* parseTexture(std::queue<std::string>& tokenBlock);
+
+	/** \brief Read a Pattern from a block of tokens.
+	 *
+	 * This takes the type of Pattern, its scale, and its two Colours from the block.
+	 *
+	 * \param tokenBlock A sequence of tokens to read the Pattern from.
+	 * \return The Pattern read from the block of tokens, which belongs to the Scene.
+	 */
+	const Pattern* parsePattern(std::queue<std::string>& tokenBlock);
+
 	/** \brief Parse a block of tokens representing a Scene. 
 	 *
 	 * This method reads Scene information from a block of tokens.
@@ -287,10 +463,25 @@ private:
 	 */
 	void parseMaterialBlock(std::queue<std::string>& tokenBlock);
 
+	/** \brief Replace a CSG union used for grouping with a Group.
+	 *
+	 * If the CSG tree is made only of union nodes, and its parts all share
+	 * a Material, a Group is made of the parts. The transforms of the union
+	 * nodes below the root are moved onto the parts, and the Group takes the
+	 * transform of the root.
+	 *
+	 * \param csg The root of the CSG tree.
+	 * \return The new Group, or an empty pointer if the tree is not suitable.
+	 */
+	std::shared_ptr<Group> groupUnion(const std::shared_ptr<CSG>& csg);
+
 
 	Scene* scene_; //!< The Scene which information is read to.
 	int startLine_; //!< The first line of the current block being parsed, for error reporting.
+	std::string filename_; //!< The name of the file being read.
 	std::map<std::string, Material> materials_; //!< A dictionary of Material types that have been read, and which can be used for subsequent Object properties.
+	std::map<std::string, const Texture*> textures_; //!< The Textures loaded so far, by file name, which belong to the Scene.
+	std::map<std::string, std::string> spellings_;   //!< The original case of each token read which is not all upper case, by its upper case form.
 };
 
 #endif
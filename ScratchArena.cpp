@@ -0,0 +1,123 @@
+/* $Rev: 250 $ */
+#include "ScratchArena.h"
+
+#include <atomic>
+#include <vector>
+
+const size_t ScratchArena::chunkSize;
+const size_t ScratchArena::maxBlock;
+
+// Every block is a multiple of this, so that each one is aligned for any type
+static const size_t alignment = 16;
+
+/** \brief The memory belonging to one thread. */
+struct Arena {
+	std::vector<char*> chunks;     //!< Every chunk taken from the system, in the order they are used.
+	size_t numUsed;                //!< The number of chunks in use since the last reset, the last being the current one.
+	char* next;                    //!< The start of the unused part of the current chunk.
+	char* end;                     //!< The end of the current chunk.
+};
+
+static std::atomic<size_t> peakUsed(0);
+static std::atomic<size_t> numLarge(0);
+
+static thread_local Arena* current = nullptr;
+static thread_local bool finished = false;
+
+/** \brief Gives the thread's chunks back to the system when the thread ends. */
+struct ArenaOwner {
+	~ArenaOwner() {
+		for (char* chunk : current->chunks) {
+			::operator delete(chunk);
+		}
+		delete current;
+		current = nullptr;
+		finished = true;
+	}
+};
+
+// Make the thread's arena, which starts with no chunks
+static Arena* claimArena() {
+	static thread_local ArenaOwner owner;
+	(void)owner;
+	Arena* arena = new Arena();
+	arena->numUsed = 0;
+	arena->next = nullptr;
+	arena->end = nullptr;
+	return arena;
+}
+
+// Move on to the arena's next chunk, taking a new one from the system if they are all in use
+static void nextChunk(Arena* arena) {
+	if (arena->numUsed == arena->chunks.size()) {
+		arena->chunks.push_back(static_cast<char*>(::operator new(ScratchArena::chunkSize)));
+	}
+	arena->next = arena->chunks[arena->numUsed++];
+	arena->end = arena->next + ScratchArena::chunkSize;
+}
+
+void* ScratchArena::allocate(size_t bytes) {
+	size_t size = (bytes + alignment - 1) & ~(alignment - 1);
+	if (size > maxBlock) {
+		numLarge.fetch_add(1, std::memory_order_relaxed);
+		return ::operator new(bytes);
+	}
+	if (!current) {
+		// A list made while the thread ends cannot be put in its arena
+		if (finished) {
+			return ::operator new(size);
+		}
+		current = claimArena();
+	}
+	if (size_t(current->end - current->next) < size) {
+		// Whatever is left of the old chunk is too small for this block, and waits for the next reset
+		nextChunk(current);
+	}
+	void* block = current->next;
+	current->next += size;
+	return block;
+}
+
+void ScratchArena::deallocate(void* block, size_t bytes) {
+	size_t size = (bytes + alignment - 1) & ~(alignment - 1);
+	if (size > maxBlock) {
+		::operator delete(block);
+		return;
+	}
+	// A block freed as the thread ends, from its arena or not, is lost
+	if (!current || current->numUsed == 0) {
+		return;
+	}
+	// Only the latest block in the current chunk can be handed out again
+	char* start = static_cast<char*>(block);
+	if (start + size == current->next && start >= current->chunks[current->numUsed - 1]) {
+		current->next = start;
+	}
+}
+
+void ScratchArena::reset() {
+	if (!current || current->numUsed == 0) {
+		return;
+	}
+	size_t used = (current->numUsed - 1)*chunkSize + size_t(current->next - current->chunks[current->numUsed - 1]);
+	size_t peak = peakUsed.load(std::memory_order_relaxed);
+	while (used > peak && !peakUsed.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {
+		// peak is reloaded, as another thread has raised it
+	}
+	current->numUsed = 0;
+	current->next = nullptr;
+	current->end = nullptr;
+}
+
+void ScratchArena::resetStatistics() {
+	peakUsed = 0;
+	numLarge = 0;
+}
+
+size_t ScratchArena::peak() {
+	return peakUsed;
+}
+
+size_t ScratchArena::largeBlocks() {
+	return numLarge;
+}
@@ -0,0 +1,147 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef SCRATCH_ARENA_H_INCLUDED
+#define SCRATCH_ARENA_H_INCLUDED
+
+#include <cstddef>
+
+/**
+ * \file
+ * \brief ScratchArena class header file.
+ */
+
+/**
+ * \brief Per-thread memory for the lists of hits made while tracing Rays.
+ *
+ * Each Object::intersect() returns its hits in a new list, and CSG nodes
+ * and Groups make more of them while merging their children's hits, so
+ * tracing a single Ray allocates and frees many small blocks. Through the
+ * global allocator, the render threads contend for its locks. Instead, each
+ * thread has its own arena, which hands out blocks by bumping a pointer
+ * through large chunks of memory. Freeing the most recent block winds the
+ * pointer back, so that a list which grows reuses its old space. Any other
+ * freed block is simply left until the arena is reset.
+ *
+ * reset() is called by each thread when it has finished a tile (or a batch
+ * of photons, or baking a point), which makes all of its chunks free again.
+ * So a block must never outlive the tile it was made for, or be kept by a
+ * thread other than the one which made it. Only RayIntersectionLists use
+ * the arena, and these are only ever local to one intersection or shading
+ * computation. Chunks are kept from one tile to the next, and given back to
+ * the system when the thread ends.
+ *
+ * Blocks larger than maxBlock come from the global allocator as usual.
+ */
+class ScratchArena {
+
+public:
+
+	/** \brief Get a block of memory from this thread's arena.
+	 *
+	 * \param bytes The size of the block.
+	 * \return The block, aligned for any type.
+	 */
+	static void* allocate(size_t bytes);
+
+	/** \brief Give a block back to this thread's arena.
+	 *
+	 * Only the most recently allocated block can be reused before the next
+	 * reset(), so others are left where they are.
+	 *
+	 * \param block A block from allocate() on this thread.
+	 * \param bytes The size it was allocated with.
+	 */
+	static void deallocate(void* block, size_t bytes);
+
+	/** \brief Make all of this thread's arena free again.
+	 *
+	 * No block from this thread's arena may be used after this is called.
+	 */
+	static void reset();
+
+	/** \brief Start counting the statistics afresh, such as at the start of a render.
+	 *
+	 * This should only be called while no other threads are using their arenas.
+	 */
+	static void resetStatistics();
+
+	/** \brief The most memory any one arena has used between resets, since resetStatistics().
+	 *
+	 * This should only be called while no other threads are using their
+	 * arenas, such as after a render.
+	 *
+	 * \return The largest amount used by one arena, in bytes.
+	 */
+	static size_t peak();
+
+	/** \brief The number of blocks too large for the arenas, since resetStatistics().
+	 *
+	 * \return The number of blocks that came from the global allocator instead.
+	 */
+	static size_t largeBlocks();
+
+	static const size_t chunkSize = 65536;     //!< Size of the chunks the arenas hand blocks out from.
+	static const size_t maxBlock = chunkSize/4; //!< Largest block taken from the arenas.
+
+};
+
+/**
+ * \brief A standard allocator which takes its memory from the ScratchArena.
+ *
+ * This lets containers, such as a list of RayIntersections, use the
+ * calling thread's arena. All ScratchAllocators are interchangeable, as
+ * they share the thread's arena.
+ *
+ * \tparam T The type of the elements to allocate.
+ */
+template<typename T>
+class ScratchAllocator {
+
+public:
+
+	typedef T value_type; //!< The type of the elements to allocate.
+
+	/** \brief ScratchAllocator default constructor. */
+	ScratchAllocator() {}
+
+	/** \brief ScratchAllocator converting constructor, for another type of element.
+	 *
+	 * \param allocator The ScratchAllocator to copy.
+	 */
+	template<typename U>
+	ScratchAllocator(const ScratchAllocator<U>& allocator) {}
+
+	/** \brief Allocate storage for some elements.
+	 *
+	 * \param n The number of elements.
+	 * \return The uninitialised storage.
+	 */
+	T* allocate(size_t n) {
+		return static_cast<T*>(ScratchArena::allocate(n*sizeof(T)));
+	}
+
+	/** \brief Free storage from allocate().
+	 *
+	 * \param p The storage.
+	 * \param n The number of elements it was allocated for.
+	 */
+	void deallocate(T* p, size_t n) {
+		ScratchArena::deallocate(p, n*sizeof(T));
+	}
+
+};
+
+/** \brief All ScratchAllocators share the same arenas, so are equal. */
+template<typename T, typename U>
+bool operator==(const ScratchAllocator<T>&, const ScratchAllocator<U>&) {
+	return true;
+}
+
+/** \brief All ScratchAllocators share the same arenas, so are never unequal. */
+template<typename T, typename U>
+bool operator!=(const ScratchAllocator<T>&, const ScratchAllocator<U>&) {
+	return false;
+}
+
+#endif // SCRATCH_ARENA_H_INCLUDED
@@ -3,6 +3,9 @@
 
 #include "utility.h"
 
+#include <algorithm>
+#include <cmath>
+
 Sphere::Sphere() : Object() {
 
 }
@@ -22,9 +25,17 @@ const Sphere& Sphere::operator=(const Sphere& sphere) {
 	return *this;
 }
 
-std::vector<RayIntersection> Sphere::intersect(const Ray& ray) const {
+BoundingBox Sphere::getBounds() const {
+	return BoundingBox(Point(-1,-1,-1), Point(1,1,1)).transformed(transform);
+}
+
+RayIntersectionList Sphere::intersect(const Ray& ray) const {
+	RayIntersectionList result(2);
+	result.resize(intersectInto(ray, result.data(), result.size()));
+	return result;
+}
 
-	std::vector<RayIntersection> result;
+size_t Sphere::intersectInto(const Ray& ray, RayIntersection* hits, size_t maxHits) const {
 
 	Ray inverseRay = transform.applyInverse(ray);
 
@@ -34,61 +45,69 @@ std::vector<RayIntersection> Sphere::intersect(const Ray& ray) const {
 	double b = 2*inverseRay.direction.dot(inverseRay.point);
 	double c = inverseRay.point.squaredNorm() - 1;
 
-	RayIntersection hit;
-	hit.material = material;
+	// Distances in the Sphere's frame, per unit distance in the Ray's frame
+	double localScale = inverseRay.direction.norm()/ray.direction.norm();
 
 	double b2_4ac = b*b - 4*a*c;
-	double d;
+	double roots[2];
+	size_t numRoots = 0;
 	switch (sign(b2_4ac)) {
 	case -1:
 		// No intersections
 		break;
 	case 0:
 		// One intersection
-		d = -b/(2*a);
-		if (d > 0) {
-			// Intersection is in front of the ray's start point
-			hit.point = transform.apply(Point(inverseRay.point + d*inverseRay.direction));
-			hit.normal = transform.apply(Normal(inverseRay.point + d*inverseRay.direction));
-			if (hit.normal.dot(ray.direction) > 0) {
-				hit.normal = -hit.normal;
-			}
-			hit.distance = (hit.point - ray.point).norm() * sign(d);
-			result.push_back(hit);
-		}
+		roots[numRoots++] = -b/(2*a);
 		break;
 	case 1:
-		// Two intersections
-		d = (-b + sqrt(b*b - 4*a*c))/(2*a);
+		// Two intersections, nearest first
+		roots[numRoots++] = (-b - sqrt(b*b - 4*a*c))/(2*a);
+		roots[numRoots++] = (-b + sqrt(b*b - 4*a*c))/(2*a);
+		break;
+	default:
+		// Shouldn't be possible, but just in case
+		std::cerr << "Something's wrong - sign(x) should be -1, +1 or 0" << std::endl;
+		exit(-1);
+		break;
+	}
+
+	size_t numHits = 0;
+	for (size_t i = 0; i < numRoots; ++i) {
+		double d = roots[i];
 		if (d > 0) {
 			// Intersection is in front of the ray's start point
-			hit.point = transform.apply(Point(inverseRay.point + d*inverseRay.direction));
-			hit.normal = transform.apply(Normal(inverseRay.point + d*inverseRay.direction));
-			if (hit.normal.dot(ray.direction) > 0) {
-				hit.normal = -hit.normal;
+			if (numHits == maxHits) {
+				return numHits + 1;
 			}
-			hit.distance = (hit.point - ray.point).norm() * sign(d);
-			result.push_back(hit);
-		}
-	
-		d = (-b - sqrt(b*b - 4*a*c))/(2*a);
-		if (d > 0) {
-			// Intersection is in front of the ray's start point
+			RayIntersection& hit = hits[numHits++];
+			hit.material = material;
 			hit.point = transform.apply(Point(inverseRay.point + d*inverseRay.direction));
 			hit.normal = transform.apply(Normal(inverseRay.point + d*inverseRay.direction));
+			// Texture co-ordinates are deferred to textureCoordinates()
+			hit.u = inverseRay.point(0) + d*inverseRay.direction(0);
+			hit.v = inverseRay.point(1) + d*inverseRay.direction(1);
+			hit.w = inverseRay.point(2) + d*inverseRay.direction(2);
+			hit.textureScale = localScale/M_PI;
+			hit.spherical = true;
 			if (hit.normal.dot(ray.direction) > 0) {
 				hit.normal = -hit.normal;
 			}
 			hit.distance = (hit.point - ray.point).norm() * sign(d);
-			result.push_back(hit);
-		}		
-		break;
-	default:
-		// Shouldn't be possible, but just in case
-		std::cerr << "Something's wrong - sign(x) should be -1, +1 or 0" << std::endl;
-		exit(-1);
-		break;
+		}
 	}
 
-	return result;
+	return numHits;
+}
+
+void Sphere::textureCoordinates(RayIntersection& hit) {
+	if (!hit.spherical) {
+		return;
+	}
+	// Longitude around the y axis, and latitude from the top (-y) down
+	double x = hit.u;
+	double y = hit.v;
+	double z = hit.w;
+	hit.u = 0.5 + std::atan2(z, x)/(2*M_PI);
+	hit.v = std::acos(std::max(-1.0, std::min(1.0, -y)))/M_PI;
+	hit.spherical = false;
 }
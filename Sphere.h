@@ -57,10 +57,44 @@ public:
 	 * two intersection (entering and then leaving the Sphere). Finally, if \f$b^2-4ac = 0\f$ then
 	 * there is a single grazing hit with the Sphere.
 	 *
+	 * When there are two intersections, the nearer one is returned first.
+	 *
 	 * \param ray The Ray to intersect with this Sphere.
-	 * \return A list (std::vector) of intersections, which may be empty.
+	 * \return A list of intersections, which may be empty.
+	 */
+	RayIntersectionList intersect(const Ray& ray) const;
+
+	/** \brief Sphere-Ray intersection computation, into storage given by the caller.
+	 *
+	 * This is the same as intersect(), but writes the hits over \c hits, so
+	 * that a Sphere in a CSG tree does not make a list (see Object::intersectInto()).
+	 *
+	 * \param ray The Ray to intersect with this Sphere.
+	 * \param hits Where to write the intersections.
+	 * \param maxHits The number of RayIntersections in \c hits.
+	 * \return The number of intersections, or more than \c maxHits if they do not fit.
+	 */
+	size_t intersectInto(const Ray& ray, RayIntersection* hits, size_t maxHits) const;
+
+	/** \brief Bounds of the Sphere.
+	 *
+	 * The unit cube around the origin, transformed by the Sphere's transform.
+	 *
+	 * \return A BoundingBox containing the Sphere.
+	 */
+	BoundingBox getBounds() const;
+
+	/** \brief Texture co-ordinates on a Sphere.
+	 *
+	 * These are longitude, \c u, around the y axis, and latitude, \c v, from 
+	 * 0 at the top (-y) to 1 at the bottom, like a map of the world.
+	 * The trigonometry is only worth doing for a hit that is shaded with a Texture,
+	 * so intersectInto() leaves the local Point of the hit in \c u, \c v, and \c w,
+	 * and sets \c spherical, for this to be called on that hit alone.
+	 *
+	 * \param hit Its \c u and \c v are set, and \c spherical is cleared, if \c spherical was set.
 	 */
-	std::vector<RayIntersection> intersect(const Ray& ray) const;
+	static void textureCoordinates(RayIntersection& hit);
 
 };
 
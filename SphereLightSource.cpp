@@ -0,0 +1,82 @@
+/* $Rev: 250 $ */
+#include "SphereLightSource.h"
+
+#include "utility.h"
+
+#include <algorithm>
+#include <cmath>
+
+SphereLightSource::SphereLightSource() : AreaLightSource(), radius(1) {
+
+}
+
+SphereLightSource::SphereLightSource(const SphereLightSource& lightSource) : AreaLightSource(lightSource),
+radius(lightSource.radius) {
+
+}
+
+SphereLightSource::~SphereLightSource() {
+
+}
+
+const SphereLightSource& SphereLightSource::operator=(const SphereLightSource& lightSource) {
+	if (this != &lightSource) {
+		AreaLightSource::operator=(lightSource);
+		radius = lightSource.radius;
+	}
+	return *this;
+}
+
+Point SphereLightSource::pointOn(const Point& point, double u, double v) const {
+	Vector toPoint = point - location;
+	double distance = toPoint.norm();
+	if (distance < epsilon) {
+		return location;
+	}
+	Vector a, b;
+	perpendicularAxes(toPoint/distance, a, b);
+	double x, y;
+	concentricDisc(u, v, x, y);
+	return location + radius*(x*a + y*b);
+}
+
+LightSample SphereLightSource::sampleAt(const Point& point, double u, double v) const {
+	LightSample result;
+	Vector toCentre = location - point;
+	double distance = toCentre.norm();
+	if (distance < epsilon) {
+		// At the centre, so light arrives from all around
+		result.direction = Direction(0, 1, 0);
+		result.distance = radius;
+		result.intensity = colour*(2/(radius*radius));
+		return result;
+	}
+	Vector axis = toCentre/distance;
+
+	// The cone the ball fills, which is a hemisphere from on or inside it
+	double sinMax2 = std::min(1.0, radius*radius/(distance*distance));
+	double cosMax = std::sqrt(1 - sinMax2);
+	// 1 - cosMax, without losing precision far from the ball
+	double spread = sinMax2/(1 + cosMax);
+	double cosTheta = 1 - u*spread;
+	double sinTheta = std::sqrt(std::max(0.0, 1 - cosTheta*cosTheta));
+	double phi = 2*M_PI*v;
+	Vector a, b;
+	perpendicularAxes(axis, a, b);
+	Vector direction = cosTheta*axis + sinTheta*(std::cos(phi)*a + std::sin(phi)*b);
+
+	// The nearest point of the surface along the Direction, or the far one from inside
+	double along = distance*cosTheta;
+	double across2 = std::max(0.0, radius*radius - distance*distance*sinTheta*sinTheta);
+	double nearest = distance > radius ? along - std::sqrt(across2) : along + std::sqrt(across2);
+	result.distance = std::max(nearest, epsilon);
+	result.direction = Direction(direction);
+
+	// Brightness colour/(pi r^2) over a solid angle of 2 pi (1 - cosMax)
+	result.intensity = colour*(2*spread/(radius*radius));
+	return result;
+}
+
+double SphereLightSource::extent() const {
+	return radius;
+}
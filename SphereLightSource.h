@@ -0,0 +1,84 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef SPHERE_LIGHT_SOURCE_H_INCLUDED
+#define SPHERE_LIGHT_SOURCE_H_INCLUDED
+
+#include "AreaLightSource.h"
+
+/**
+ * \file
+ * \brief SphereLightSource class header file.
+ */
+
+/**
+ * \brief Light given off by a ball.
+ *
+ * The ball is centred on the location, and its surface is equally bright
+ * everywhere. From any Point outside it, the ball fills a cone of
+ * Directions, which sampleAt() spreads its samples evenly over, so the light
+ * is right however close the Point is. Photons (see emit()) start from a
+ * disc of the same radius facing where they are sent, which is only exact
+ * from far away.
+ */
+class SphereLightSource : public AreaLightSource {
+
+public:
+
+	/** \brief SphereLightSource default constructor.
+	 *
+	 * This creates a white light at the origin, of radius 1.
+	 */
+	SphereLightSource();
+
+	/** \brief SphereLightSource copy constructor.
+	 *
+	 * \param lightSource The SphereLightSource to copy to \c this.
+	 */
+	SphereLightSource(const SphereLightSource& lightSource);
+
+	/** \brief SphereLightSource destructor. */
+	~SphereLightSource();
+
+	/** \brief SphereLightSource assignment operator.
+	 *
+	 * \param lightSource The SphereLightSource to copy to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	const SphereLightSource& operator=(const SphereLightSource& lightSource);
+
+	/** \brief Find a point on the ball, as seen from a Point.
+	 *
+	 * \param point The Point being lit.
+	 * \param u The first co-ordinate, in [0,1).
+	 * \param v The second co-ordinate, in [0,1).
+	 * \return A point on the disc through the centre of the ball, facing \c point.
+	 */
+	Point pointOn(const Point& point, double u, double v) const;
+
+	/** \brief Determine the light arriving at a Point from one part of the ball.
+	 *
+	 * The co-ordinates pick a Direction in the cone the ball fills, as seen
+	 * from \c point, with equal areas of the unit square giving equal solid
+	 * angles. The light arriving is the brightness of the surface times the
+	 * solid angle of the cone, which falls off as \f$1/d^2\f$ far from the
+	 * ball, like a PointLightSource of the same colour.
+	 *
+	 * \param point The Point at which light is measured.
+	 * \param u Picks the angle from the centre of the cone, in [0,1).
+	 * \param v Picks the angle around the centre of the cone, in [0,1).
+	 * \return The Direction, distance, and amount of light arriving at the Point from the ball's surface.
+	 */
+	LightSample sampleAt(const Point& point, double u, double v) const;
+
+	/** \brief The size of the ball.
+	 *
+	 * \return The radius.
+	 */
+	double extent() const;
+
+	double radius; //!< Radius of the ball.
+
+};
+
+#endif // SPHERE_LIGHT_SOURCE_H_INCLUDED
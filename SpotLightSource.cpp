@@ -0,0 +1,55 @@
+/* $Rev: 250 $ */
+#include "SpotLightSource.h"
+
+#include "utility.h"
+
+#include <cmath>
+
+SpotLightSource::SpotLightSource() : PointLightSource(), direction(0,1,0), angle(45) {
+
+}
+
+SpotLightSource::SpotLightSource(const Direction& direction, double angle) : PointLightSource(),
+direction(direction), angle(angle) {
+
+}
+
+SpotLightSource::SpotLightSource(const SpotLightSource& lightSource) : PointLightSource(lightSource),
+direction(lightSource.direction), angle(lightSource.angle) {
+
+}
+
+SpotLightSource::~SpotLightSource() {
+
+}
+
+const SpotLightSource& SpotLightSource::operator=(const SpotLightSource& lightSource) {
+	if (this != &lightSource) {
+		PointLightSource::operator=(lightSource);
+		direction = lightSource.direction;
+		angle = lightSource.angle;
+	}
+	return *this;
+}
+
+double SpotLightSource::getIntensityAt(const Point& point) const {
+	// Inside the cone when the angle to the Point is small enough,
+	// compared through cosines to avoid an acos
+	Vector toPoint = point - location;
+	double along = toPoint.dot(direction);
+	if (along < std::cos(deg2rad(angle))*std::sqrt(toPoint.squaredNorm()*direction.squaredNorm())) {
+		return 0;
+	}
+	return PointLightSource::getIntensityAt(point);
+}
+
+Colour SpotLightSource::emit(const Point& centre, double radius, double, double, double s, double t, Ray& ray) const {
+	double edge = std::cos(deg2rad(angle));
+	double spotAngle = 2*M_PI*(1 - edge);
+	double solidAngle = towards(location, centre, radius, s, t, ray);
+	if (solidAngle <= spotAngle) {
+		return solidAngle*colour*getIntensityAt(location + ray.direction);
+	}
+	ray.direction = Direction(coneDirection(direction/direction.norm(), edge, s, t));
+	return spotAngle*colour*PointLightSource::getIntensityAt(location + ray.direction);
+}
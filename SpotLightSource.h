@@ -0,0 +1,88 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef SPOT_LIGHT_SOURCE_H_INCLUDED
+#define SPOT_LIGHT_SOURCE_H_INCLUDED
+
+#include "Direction.h"
+#include "PointLightSource.h"
+
+/**
+ * \file
+ * \brief SpotLightSource class header file.
+ */
+
+/**
+ * \brief Light emitted from a Point in a cone.
+ *
+ * A SpotLightSource is a PointLightSource which only lights Points inside a
+ * cone around its direction. Within the cone, the light falls off as 
+ * \f$1/r^2\f$. Outside the cone there is no light at all, so shading can 
+ * stop before a shadow Ray is cast.
+ */
+class SpotLightSource : public PointLightSource {
+
+public:
+
+	/** \brief SpotLightSource default constructor.
+	 *
+	 * This creates a white light source at the origin, pointing along +y, 
+	 * with a cone 45 degrees either side of that direction.
+	 */
+	SpotLightSource();
+
+	/** \brief SpotLightSource constructor with a direction and angle.
+	 *
+	 * \param direction The Direction the SpotLightSource points in.
+	 * \param angle The angle, in degrees, between the direction and the edge of the cone.
+	 */
+	SpotLightSource(const Direction& direction, double angle);
+
+	/** \brief SpotLightSource copy constructor.
+	 *
+	 * \param lightSource The SpotLightSource to copy to \c this.
+	 */
+	SpotLightSource(const SpotLightSource& lightSource);
+
+	/** \brief SpotLightSource destructor */
+	~SpotLightSource();
+
+	/** \brief SpotLightSource assignment operator.
+	 *
+	 * \param lightSource The SpotLightSource to copy to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	const SpotLightSource& operator=(const SpotLightSource& lightSource);
+
+	/** \brief Determine how much light reaches a Point.
+	 *
+	 * This is the same as for a PointLightSource inside the cone, and zero
+	 * outside it.
+	 *
+	 * \param point The Point at which light is measured.
+	 * \return The proportion of the base illumination that reaches the Point.
+	 */
+	double getIntensityAt(const Point& point) const;
+
+	/** \brief Send out a photon from the SpotLightSource.
+	 *
+	 * Photons are spread evenly over the SpotLightSource's cone, or the cone
+	 * of Directions towards the sphere, whichever is narrower.
+	 *
+	 * \param centre The middle of the sphere to send photons towards.
+	 * \param radius The radius of the sphere to send photons towards.
+	 * \param u Not used, as the light comes from a single point.
+	 * \param v Not used, as the light comes from a single point.
+	 * \param s The first co-ordinate of the Direction of the photon, towards the edge of the cone.
+	 * \param t The second co-ordinate of the Direction of the photon, around the cone.
+	 * \param ray Set to the location, and the unit Direction of the photon.
+	 * \return The power of the photon.
+	 */
+	Colour emit(const Point& centre, double radius, double u, double v, double s, double t, Ray& ray) const;
+
+	Direction direction; //!< The Direction the SpotLightSource points in. It need not be a unit Vector.
+	double angle;        //!< The angle, in degrees, between the direction and the edge of the cone.
+
+};
+
+#endif // SPOT_LIGHT_SOURCE_H_INCLUDED
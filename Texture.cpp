@@ -0,0 +1,277 @@
+/* $Rev: 250 $ */
+#include "Texture.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+
+const size_t Texture::tileSize;
+const size_t Texture::tileBytes;
+const size_t Texture::headerBytes;
+
+// Identifiers for the TextureCache, so that tiles of different Textures are kept apart
+static std::atomic<unsigned int> nextTextureId(0);
+
+// The .mip files each thread has read tiles from, by Texture identifier, kept open until the thread ends
+static thread_local std::unordered_map<unsigned int, std::ifstream> openFiles;
+
+// Marks a .mip file, and the tile size it was built with
+static const char mipMagic[8] = {'R', 'T', 'M', 'I', 'P', '0', '6', '4'};
+
+Texture::Texture() : mipFile_(), id_(0), widths_(), heights_(), tilesX_(), firstTiles_(), cache_() {
+
+}
+
+Texture::Texture(const Texture& texture) : mipFile_(texture.mipFile_), id_(texture.id_), widths_(texture.widths_),
+heights_(texture.heights_), tilesX_(texture.tilesX_), firstTiles_(texture.firstTiles_), cache_(texture.cache_) {
+
+}
+
+Texture::~Texture() {
+
+}
+
+Texture& Texture::operator=(const Texture& texture) {
+	if (this != &texture) {
+		mipFile_ = texture.mipFile_;
+		id_ = texture.id_;
+		widths_ = texture.widths_;
+		heights_ = texture.heights_;
+		tilesX_ = texture.tilesX_;
+		firstTiles_ = texture.firstTiles_;
+		cache_ = texture.cache_;
+	}
+	return *this;
+}
+
+void Texture::load(const std::string& filename, size_t width, size_t height, const std::shared_ptr<TextureCache>& cache) {
+	if (width == 0 || height == 0) {
+		std::cerr << "Texture file '" << filename << "' has no texels" << std::endl;
+		exit(-1);
+	}
+
+	mipFile_ = filename + ".mip";
+	id_ = nextTextureId++;
+	cache_ = cache;
+
+	// Each level is half the size of the one before, rounding up, down to a single texel
+	widths_.clear();
+	heights_.clear();
+	tilesX_.clear();
+	firstTiles_.clear();
+	size_t tiles = 0;
+	while (true) {
+		widths_.push_back(width);
+		heights_.push_back(height);
+		tilesX_.push_back((width + tileSize - 1)/tileSize);
+		firstTiles_.push_back(tiles);
+		tiles += tilesX_.back()*((height + tileSize - 1)/tileSize);
+		if (width == 1 && height == 1) {
+			break;
+		}
+		width = (width + 1)/2;
+		height = (height + 1)/2;
+	}
+
+	// Reuse the pyramid from an earlier run if it matches
+	std::ifstream mip(mipFile_, std::ios::binary | std::ios::ate);
+	if (mip && size_t(mip.tellg()) == headerBytes + tiles*tileBytes) {
+		char header[headerBytes];
+		mip.seekg(0);
+		mip.read(header, headerBytes);
+		uint64_t size[2];
+		std::memcpy(size, header + 8, sizeof(size));
+		if (mip && std::memcmp(header, mipMagic, 8) == 0 && size[0] == widths_[0] && size[1] == heights_[0]) {
+			return;
+		}
+	}
+	mip.close();
+
+	std::cout << "Building mip pyramid for " << filename << std::endl;
+	buildPyramid(filename);
+}
+
+void Texture::buildPyramid(const std::string& rawFile) const {
+	std::ifstream raw(rawFile, std::ios::binary);
+	if (!raw) {
+		std::cerr << "Could not read texture file '" << rawFile << "'" << std::endl;
+		exit(-1);
+	}
+	// Written under another name, so that an interrupted build is not mistaken for a finished one
+	std::string tempFile = mipFile_ + ".tmp";
+	std::fstream out(tempFile, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out) {
+		std::cerr << "Could not write mip file '" << tempFile << "'" << std::endl;
+		exit(-1);
+	}
+
+	char header[headerBytes];
+	uint64_t size[2] = {widths_[0], heights_[0]};
+	std::memcpy(header, mipMagic, 8);
+	std::memcpy(header + 8, size, sizeof(size));
+	out.write(header, headerBytes);
+
+	const size_t side = tileSize + 1;
+	std::vector<unsigned char> band;
+	std::vector<unsigned char> tile(tileBytes);
+
+	// Rows of the previous level, read back a row of tiles at a time
+	std::map<size_t, std::vector<unsigned char>> previousTiles;
+	auto previousRow = [&](unsigned int level, size_t y) -> const unsigned char* {
+		size_t width = widths_[level];
+		size_t tileRow = y/tileSize;
+		auto found = previousTiles.find(tileRow);
+		if (found == previousTiles.end()) {
+			if (previousTiles.size() >= 4) {
+				previousTiles.erase(previousTiles.begin());
+			}
+			std::vector<unsigned char>& rows = previousTiles[tileRow];
+			rows.resize(tileSize*width*3);
+			for (size_t tileX = 0; tileX < tilesX_[level]; ++tileX) {
+				out.seekg(tileOffset(level, tileX, tileRow));
+				out.read(reinterpret_cast<char*>(tile.data()), tileBytes);
+				size_t columns = std::min(tileSize, width - tileX*tileSize);
+				for (size_t j = 0; j < tileSize; ++j) {
+					std::memcpy(&rows[(j*width + tileX*tileSize)*3], &tile[j*side*3], columns*3);
+				}
+			}
+			found = previousTiles.find(tileRow);
+		}
+		return &found->second[(y % tileSize)*width*3];
+	};
+
+	for (unsigned int level = 0; level < widths_.size(); ++level) {
+		size_t width = widths_[level];
+		size_t height = heights_[level];
+		size_t tilesY = (height + tileSize - 1)/tileSize;
+		band.assign(side*width*3, 0);
+		for (size_t tileY = 0; tileY < tilesY; ++tileY) {
+			// The rows covered by this row of tiles, and the extra row, wrapping at the bottom
+			for (size_t j = 0; j < side; ++j) {
+				size_t y = (tileY*tileSize + j) % height;
+				unsigned char* row = &band[j*width*3];
+				if (level == 0) {
+					raw.seekg(y*width*3);
+					raw.read(reinterpret_cast<char*>(row), width*3);
+					if (!raw) {
+						std::cerr << "Texture file '" << rawFile << "' is too short" << std::endl;
+						exit(-1);
+					}
+					continue;
+				}
+				// Average 2x2 blocks of the previous level
+				size_t previousWidth = widths_[level - 1];
+				size_t previousHeight = heights_[level - 1];
+				std::vector<unsigned char> above(previousRow(level - 1, (2*y) % previousHeight),
+					previousRow(level - 1, (2*y) % previousHeight) + previousWidth*3);
+				const unsigned char* below = previousRow(level - 1, (2*y + 1) % previousHeight);
+				for (size_t x = 0; x < width; ++x) {
+					size_t x0 = ((2*x) % previousWidth)*3;
+					size_t x1 = ((2*x + 1) % previousWidth)*3;
+					for (int c = 0; c < 3; ++c) {
+						row[x*3 + c] = (unsigned char)((above[x0 + c] + above[x1 + c] + below[x0 + c] + below[x1 + c] + 2)/4);
+					}
+				}
+			}
+			// Cut the band into tiles, with the extra column wrapping at the right
+			for (size_t tileX = 0; tileX < tilesX_[level]; ++tileX) {
+				for (size_t j = 0; j < side; ++j) {
+					for (size_t i = 0; i < side; ++i) {
+						size_t x = (tileX*tileSize + i) % width;
+						std::memcpy(&tile[(j*side + i)*3], &band[(j*width + x)*3], 3);
+					}
+				}
+				out.seekp(tileOffset(level, tileX, tileY));
+				out.write(reinterpret_cast<const char*>(tile.data()), tileBytes);
+			}
+		}
+		previousTiles.clear();
+	}
+
+	out.close();
+	if (!out || std::rename(tempFile.c_str(), mipFile_.c_str()) != 0) {
+		std::cerr << "Could not write mip file '" << mipFile_ << "'" << std::endl;
+		exit(-1);
+	}
+}
+
+size_t Texture::tileOffset(unsigned int level, size_t tileX, size_t tileY) const {
+	return headerBytes + (firstTiles_[level] + tileY*tilesX_[level] + tileX)*tileBytes;
+}
+
+void Texture::readTile(unsigned int level, size_t tileX, size_t tileY, unsigned char* texels) const {
+	// Each thread has its own stream for each file, so that any number of threads can read at once
+	std::ifstream& mip = openFiles[id_];
+	if (!mip.is_open()) {
+		mip.open(mipFile_, std::ios::binary);
+	}
+	mip.seekg(tileOffset(level, tileX, tileY));
+	mip.read(reinterpret_cast<char*>(texels), tileBytes);
+	if (!mip) {
+		std::cerr << "Could not read from mip file '" << mipFile_ << "'" << std::endl;
+		exit(-1);
+	}
+}
+
+unsigned int Texture::getId() const {
+	return id_;
+}
+
+unsigned int Texture::getLevels() const {
+	return (unsigned int)widths_.size();
+}
+
+Colour Texture::sample(double u, double v, double footprint) const {
+	if (widths_.empty()) {
+		return Colour(1,1,1);
+	}
+
+	// Each level up halves the number of texels across the footprint
+	double texels = footprint*std::max(widths_[0], heights_[0]);
+	double level = texels > 1 ? std::log2(texels) : 0;
+	unsigned int last = getLevels() - 1;
+	if (level >= last) {
+		return bilinear(last, u, v);
+	}
+	unsigned int lower = (unsigned int)level;
+	double blend = level - lower;
+	Colour colour = bilinear(lower, u, v);
+	if (blend > 0) {
+		colour = (1 - blend)*colour + blend*bilinear(lower + 1, u, v);
+	}
+	return colour;
+}
+
+Colour Texture::bilinear(unsigned int level, double u, double v) const {
+	long long width = (long long)widths_[level];
+	long long height = (long long)heights_[level];
+
+	// Texel centres are at half-integer positions
+	double x = (u - std::floor(u))*width - 0.5;
+	double y = (v - std::floor(v))*height - 0.5;
+	double fx = std::floor(x);
+	double fy = std::floor(y);
+	double ax = x - fx;
+	double ay = y - fy;
+	size_t ix = size_t((((long long)fx % width) + width) % width);
+	size_t iy = size_t((((long long)fy % height) + height) % height);
+
+	const unsigned char* tile = cache_->texels(*this, level, ix/tileSize, iy/tileSize);
+	const size_t side = tileSize + 1;
+	const unsigned char* t00 = tile + ((iy % tileSize)*side + ix % tileSize)*3;
+	const unsigned char* t01 = t00 + side*3;
+
+	double value[3];
+	for (int c = 0; c < 3; ++c) {
+		double top = (1 - ax)*t00[c] + ax*t00[c + 3];
+		double bottom = (1 - ax)*t01[c] + ax*t01[c + 3];
+		value[c] = ((1 - ay)*top + ay*bottom)/255;
+	}
+	return Colour(value[0], value[1], value[2]);
+}
@@ -0,0 +1,159 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef TEXTURE_H_INCLUDED
+#define TEXTURE_H_INCLUDED
+
+#include "Colour.h"
+#include "TextureCache.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * \file
+ * \brief Texture class header file.
+ */
+
+/**
+ * \brief An image which varies a Material's Colours across a surface.
+ *
+ * A Texture is looked up with texture co-ordinates \f$(u,v)\f$, which Objects
+ * give for each RayIntersection. The image covers \f$0 \le u,v < 1\f$, with
+ * \f$v = 0\f$ along its first row, and repeats outside that range.
+ *
+ * Textures are read from raw files of 8-bit RGB texels, a row at a time,
+ * which may be much larger than memory. The first time a file is used, it
+ * is converted to a mip pyramid, a series of levels each half the size of
+ * the one before, and saved alongside it with the extension <tt>.mip</tt>.
+ * Each level is cut into square tiles, and tiles are read from the
+ * <tt>.mip</tt> file only when they are needed, through a TextureCache
+ * which limits the memory they use. Distant or sharply sloping surfaces
+ * cover many texels in each pixel, and use the smaller levels, so that
+ * they do not read in (or alias on) the full-sized image.
+ *
+ * Each thread keeps the <tt>.mip</tt> files it reads tiles from open until
+ * it ends, so a tile which is not in the TextureCache costs a seek and a
+ * read, rather than opening the file again.
+ */
+class Texture {
+
+public:
+
+	/** \brief Texture default constructor.
+	 *
+	 * A newly constructed Texture has no image, and is white everywhere.
+	 */
+	Texture();
+
+	/** \brief Texture copy constructor.
+	 *
+	 * \param texture The Texture to copy.
+	 */
+	Texture(const Texture& texture);
+
+	/** \brief Texture destructor. */
+	~Texture();
+
+	/** \brief Texture assignment operator.
+	 *
+	 * \param texture The Texture to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	Texture& operator=(const Texture& texture);
+
+	/** \brief Set up the Texture from a raw image file.
+	 *
+	 * The mip pyramid is built if there is not already a matching <tt>.mip</tt>
+	 * file. This reads the whole image once, but only a few rows of it are
+	 * held in memory at a time.
+	 *
+	 * \param filename The name of the file of RGB texels.
+	 * \param width The number of texels in each row.
+	 * \param height The number of rows.
+	 * \param cache The TextureCache to read tiles through.
+	 */
+	void load(const std::string& filename, size_t width, size_t height, const std::shared_ptr<TextureCache>& cache);
+
+	/** \brief Look up the Colour of the Texture.
+	 *
+	 * The Colour is filtered over about \c footprint in texture co-ordinates,
+	 * by blending between the two nearest mip levels, with bilinear filtering
+	 * within each level. A footprint of zero gives the full-sized image.
+	 *
+	 * \param u The first texture co-ordinate.
+	 * \param v The second texture co-ordinate.
+	 * \param footprint The width of the area to filter over.
+	 * \return The Colour of the Texture, with each component in [0,1].
+	 */
+	Colour sample(double u, double v, double footprint) const;
+
+	/** \brief Read a tile from the <tt>.mip</tt> file.
+	 *
+	 * A tile has tileSize texels on each side, plus an extra column and row
+	 * copied from the next tiles along, so that bilinear filtering never needs
+	 * more than one tile. Texels past the edge of the level wrap around to the
+	 * other side. There are 3 bytes (red, green, blue) per texel, a row at a time.
+	 *
+	 * \param level The mip level of the tile.
+	 * \param tileX The column of the tile within its level.
+	 * \param tileY The row of the tile within its level.
+	 * \param texels Set to the tileBytes bytes of the tile.
+	 */
+	void readTile(unsigned int level, size_t tileX, size_t tileY, unsigned char* texels) const;
+
+	/** \brief A number which is different for each Texture loaded.
+	 *
+	 * \return The Texture's identifier, used by the TextureCache.
+	 */
+	unsigned int getId() const;
+
+	/** \brief The number of mip levels.
+	 *
+	 * \return The number of levels, down to a single texel, or zero if nothing is loaded.
+	 */
+	unsigned int getLevels() const;
+
+	static const size_t tileSize = 64;                                //!< Texels along each side of a tile, not counting the extra column and row.
+	static const size_t tileBytes = (tileSize + 1)*(tileSize + 1)*3; //!< Bytes in each tile.
+
+private:
+
+	/** \brief Build the mip pyramid file.
+	 *
+	 * \param rawFile The name of the file of RGB texels.
+	 */
+	void buildPyramid(const std::string& rawFile) const;
+
+	/** \brief Where a tile is in the <tt>.mip</tt> file.
+	 *
+	 * \param level The mip level of the tile.
+	 * \param tileX The column of the tile within its level.
+	 * \param tileY The row of the tile within its level.
+	 * \return The offset of the tile from the start of the file, in bytes.
+	 */
+	size_t tileOffset(unsigned int level, size_t tileX, size_t tileY) const;
+
+	/** \brief Bilinearly filtered Colour from one mip level.
+	 *
+	 * \param level The mip level.
+	 * \param u The first texture co-ordinate.
+	 * \param v The second texture co-ordinate.
+	 * \return The Colour of the Texture.
+	 */
+	Colour bilinear(unsigned int level, double u, double v) const;
+
+	std::string mipFile_;                 //!< The name of the <tt>.mip</tt> file.
+	unsigned int id_;                     //!< Identifier for the TextureCache.
+	std::vector<size_t> widths_;          //!< Width of each level, in texels.
+	std::vector<size_t> heights_;         //!< Height of each level, in texels.
+	std::vector<size_t> tilesX_;          //!< Number of columns of tiles in each level.
+	std::vector<size_t> firstTiles_;      //!< Number of tiles in the file before each level.
+	std::shared_ptr<TextureCache> cache_; //!< The TextureCache which holds the tiles.
+
+	static const size_t headerBytes = 24; //!< Size of the header at the start of the <tt>.mip</tt> file.
+
+};
+
+#endif // TEXTURE_H_INCLUDED
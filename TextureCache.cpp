@@ -0,0 +1,132 @@
+/* $Rev: 250 $ */
+#include "TextureCache.h"
+
+#include "Texture.h"
+
+const size_t TextureCache::numShards;
+const size_t TextureCache::numRecent;
+
+// Serial numbers for TextureCaches, so that a thread's handles for one are not mistaken for another's
+static std::atomic<uint64_t> nextSerial(1);
+
+/** \brief Handles to the tiles a thread has used lately, each kept in a slot chosen by a hash of the tile. */
+struct RecentTiles {
+	uint64_t serials[TextureCache::numRecent]; //!< The serial number of the TextureCache each tile came from, or 0 for an empty slot.
+	uint64_t keys[TextureCache::numRecent];    //!< The key of each tile.
+	TextureCache::Tile tiles[TextureCache::numRecent]; //!< The tiles.
+};
+
+static thread_local RecentTiles recentTiles = {};
+
+TextureCache::TextureCache(size_t capacity) : capacity_(capacity), serial_(nextSerial++) {
+	for (Shard& shard : shards_) {
+		shard.size = 0;
+	}
+}
+
+TextureCache::TextureCache(const TextureCache& cache) : capacity_(cache.getCapacity()), serial_(nextSerial++) {
+	for (Shard& shard : shards_) {
+		shard.size = 0;
+	}
+}
+
+TextureCache::~TextureCache() {
+
+}
+
+TextureCache& TextureCache::operator=(const TextureCache& cache) {
+	if (this != &cache) {
+		setCapacity(cache.getCapacity());
+		clear();
+	}
+	return *this;
+}
+
+void TextureCache::setCapacity(size_t capacity) {
+	capacity_ = capacity;
+}
+
+size_t TextureCache::getCapacity() const {
+	return capacity_;
+}
+
+size_t TextureCache::getSize() const {
+	size_t size = 0;
+	for (const Shard& shard : shards_) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		size += shard.size;
+	}
+	return size;
+}
+
+void TextureCache::clear() {
+	// Handles kept by threads are not used again
+	serial_ = nextSerial++;
+	for (Shard& shard : shards_) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.recent.clear();
+		shard.index.clear();
+		shard.size = 0;
+	}
+}
+
+const unsigned char* TextureCache::texels(const Texture& texture, unsigned int level, size_t tileX, size_t tileY) {
+	uint64_t key = tileKey(texture, level, tileX, tileY);
+	uint64_t serial = serial_.load(std::memory_order_relaxed);
+	size_t slot = (hash(key) >> 48) % numRecent;
+	if (recentTiles.serials[slot] != serial || recentTiles.keys[slot] != key) {
+		recentTiles.tiles[slot] = tile(texture, level, tileX, tileY);
+		recentTiles.serials[slot] = serial;
+		recentTiles.keys[slot] = key;
+	}
+	return recentTiles.tiles[slot]->data();
+}
+
+TextureCache::Tile TextureCache::tile(const Texture& texture, unsigned int level, size_t tileX, size_t tileY) {
+	uint64_t key = tileKey(texture, level, tileX, tileY);
+	Shard& shard = shards_[(hash(key) >> 32) % numShards];
+
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto found = shard.index.find(key);
+		if (found != shard.index.end()) {
+			shard.recent.splice(shard.recent.begin(), shard.recent, found->second);
+			return found->second->second;
+		}
+	}
+
+	// Read without holding the lock, so other threads are not held up by the disk.
+	// Two threads may both read the same tile, in which case the first one in is kept.
+	std::shared_ptr<std::vector<unsigned char>> texels(new std::vector<unsigned char>(Texture::tileBytes));
+	texture.readTile(level, tileX, tileY, texels->data());
+
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto found = shard.index.find(key);
+	if (found != shard.index.end()) {
+		shard.recent.splice(shard.recent.begin(), shard.recent, found->second);
+		return found->second->second;
+	}
+	shard.recent.push_front(std::make_pair(key, Tile(texels)));
+	shard.index[key] = shard.recent.begin();
+	shard.size += texels->size();
+	trim(shard);
+	return shard.recent.front().second;
+}
+
+void TextureCache::trim(Shard& shard) {
+	size_t limit = capacity_/numShards;
+	while (shard.size > limit && shard.recent.size() > 1) {
+		shard.size -= shard.recent.back().second->size();
+		shard.index.erase(shard.recent.back().first);
+		shard.recent.pop_back();
+	}
+}
+
+uint64_t TextureCache::tileKey(const Texture& texture, unsigned int level, size_t tileX, size_t tileY) {
+	return (uint64_t(texture.getId() & 0xFFFF) << 48) | (uint64_t(level & 0x3F) << 42) |
+		(uint64_t(tileX & 0x1FFFFF) << 21) | uint64_t(tileY & 0x1FFFFF);
+}
+
+uint64_t TextureCache::hash(uint64_t key) {
+	return key*0x9E3779B97F4A7C15ull;
+}
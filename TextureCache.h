@@ -0,0 +1,169 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef TEXTURE_CACHE_H_INCLUDED
+#define TEXTURE_CACHE_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class Texture;
+
+/**
+ * \file
+ * \brief TextureCache class header file.
+ */
+
+/**
+ * \brief A bounded store of Texture tiles, shared by all the Textures in a Scene.
+ *
+ * Textures can be far too large to hold in memory, so they are kept on disk
+ * as tiles (see Texture), and only the tiles which are actually used are
+ * read in. The TextureCache holds the tiles read so far, up to a limit on
+ * their total size. When it is full, the tiles used least recently are
+ * dropped to make room, and are read again if they are needed later.
+ *
+ * Tiles are handed out as \c std::shared_ptr, so a tile which is dropped
+ * while it is still being used stays valid until it is released.
+ *
+ * The TextureCache may be used from several threads at once. To keep them
+ * from waiting on each other, the tiles are split between a number of
+ * shards, each with its own lock and its own share of the limit, and no
+ * lock is held while a tile is read from disk.
+ *
+ * Filtering a Texture reads several texels from the same tile, and
+ * neighbouring pixels use the same tiles again, so each thread also keeps
+ * handles to the last few tiles it used, in front of the shards. texels()
+ * finds a tile there without taking a lock or touching a reference count,
+ * and only goes to the shards when the thread has not used it lately.
+ * These handles keep their tiles in memory even if the shards drop them,
+ * so the memory used may go over the limit by a few tiles per thread.
+ */
+class TextureCache {
+
+public:
+
+	typedef std::shared_ptr<const std::vector<unsigned char>> Tile; //!< The texels of a tile, shared with the TextureCache.
+
+	/** \brief TextureCache constructor.
+	 *
+	 * \param capacity The largest total size of the tiles held, in bytes.
+	 */
+	explicit TextureCache(size_t capacity = 256*1024*1024);
+
+	/** \brief TextureCache copy constructor.
+	 *
+	 * Only the capacity is copied. The new TextureCache starts out empty.
+	 *
+	 * \param cache The TextureCache to copy.
+	 */
+	TextureCache(const TextureCache& cache);
+
+	/** \brief TextureCache destructor. */
+	~TextureCache();
+
+	/** \brief TextureCache assignment operator.
+	 *
+	 * Only the capacity is copied, and any tiles held by \c this are dropped.
+	 *
+	 * \param cache The TextureCache to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	TextureCache& operator=(const TextureCache& cache);
+
+	/** \brief Set the largest total size of the tiles held.
+	 *
+	 * If the tiles already held are too large, they are dropped as more are read.
+	 *
+	 * \param capacity The limit, in bytes.
+	 */
+	void setCapacity(size_t capacity);
+
+	/** \brief The largest total size of the tiles held.
+	 *
+	 * \return The limit, in bytes.
+	 */
+	size_t getCapacity() const;
+
+	/** \brief The total size of the tiles held.
+	 *
+	 * \return The size, in bytes.
+	 */
+	size_t getSize() const;
+
+	/** \brief Drop all of the tiles held. */
+	void clear();
+
+	/** \brief Find a tile of a Texture, reading it from disk if it is not held.
+	 *
+	 * \param texture The Texture.
+	 * \param level The mip level of the tile.
+	 * \param tileX The column of the tile within its level.
+	 * \param tileY The row of the tile within its level.
+	 * \return The texels of the tile, laid out as described by Texture::readTile().
+	 */
+	Tile tile(const Texture& texture, unsigned int level, size_t tileX, size_t tileY);
+
+	/** \brief Find the texels of a tile of a Texture, looking first in the tiles this thread has used lately.
+	 *
+	 * \param texture The Texture.
+	 * \param level The mip level of the tile.
+	 * \param tileX The column of the tile within its level.
+	 * \param tileY The row of the tile within its level.
+	 * \return The texels of the tile, laid out as described by Texture::readTile(). They are
+	 *         only certain to stay valid until this thread next calls texels().
+	 */
+	const unsigned char* texels(const Texture& texture, unsigned int level, size_t tileX, size_t tileY);
+
+	static const size_t numRecent = 32; //!< The number of tiles each thread keeps handles to.
+
+private:
+
+	/** \brief A part of the TextureCache with its own lock. */
+	struct Shard {
+		mutable std::mutex mutex;                                  //!< Lock for the rest of the Shard.
+		std::list<std::pair<uint64_t, Tile>> recent;               //!< The tiles held, most recently used first.
+		std::unordered_map<uint64_t, std::list<std::pair<uint64_t, Tile>>::iterator> index; //!< Where each tile is in \c recent.
+		size_t size;                                               //!< Total size of the tiles held, in bytes.
+	};
+
+	/** \brief Drop tiles from a Shard, least recently used first, until it is within its limit.
+	 *
+	 * The most recently used tile is always kept. The Shard must be locked.
+	 *
+	 * \param shard The Shard.
+	 */
+	void trim(Shard& shard);
+
+	/** \brief Identify a tile.
+	 *
+	 * \param texture The Texture.
+	 * \param level The mip level of the tile.
+	 * \param tileX The column of the tile within its level.
+	 * \param tileY The row of the tile within its level.
+	 * \return The key for the tile, which is different for each tile of each Texture.
+	 */
+	static uint64_t tileKey(const Texture& texture, unsigned int level, size_t tileX, size_t tileY);
+
+	/** \brief Spread the bits of a key, to choose a Shard or a thread's handle.
+	 *
+	 * \param key The key for a tile.
+	 * \return The hash of the key.
+	 */
+	static uint64_t hash(uint64_t key);
+
+	static const size_t numShards = 16; //!< The number of Shards.
+
+	std::atomic<size_t> capacity_;   //!< The largest total size of the tiles held, in bytes.
+	std::atomic<uint64_t> serial_;   //!< Tells the handles kept by threads for this TextureCache from others, and is changed by clear().
+	Shard shards_[numShards];        //!< The Shards, chosen by a hash of the tile.
+
+};
+
+#endif // TEXTURE_CACHE_H_INCLUDED
@@ -0,0 +1,88 @@
+/* $Rev: 250 $ */
+#include "TileScheduler.h"
+
+TileScheduler::TileScheduler(uint32_t tiles, unsigned int workers) : tiles_(tiles), workers_(workers), runs_(new Run[workers]), completed_(0), order_(new std::atomic<uint32_t>[tiles]) {
+	for (uint32_t i = 0; i < tiles_; ++i) {
+		order_[i].store(0, std::memory_order_relaxed);
+	}
+	for (unsigned int i = 0; i < workers_; ++i) {
+		uint32_t first = uint32_t(uint64_t(tiles)*i/workers_);
+		uint32_t last = uint32_t(uint64_t(tiles)*(i + 1)/workers_);
+		runs_[i].span.store(pack(first, last), std::memory_order_relaxed);
+	}
+}
+
+TileScheduler::~TileScheduler() {
+
+}
+
+bool TileScheduler::next(unsigned int worker, uint32_t& tile) {
+	std::atomic<uint64_t>& span = runs_[worker].span;
+	uint64_t run = span.load(std::memory_order_relaxed);
+	while (uint32_t(run) < uint32_t(run >> 32)) {
+		// On failure, run is reloaded, as a thief has shortened it
+		if (span.compare_exchange_weak(run, run + 1, std::memory_order_relaxed)) {
+			tile = uint32_t(run);
+			return true;
+		}
+	}
+	return steal(worker, tile);
+}
+
+bool TileScheduler::steal(unsigned int worker, uint32_t& tile) {
+	for (;;) {
+		// Rob whoever has the most left, as they will otherwise finish last
+		unsigned int victim = workers_;
+		uint64_t victimRun = 0;
+		uint32_t most = 0;
+		for (unsigned int i = 0; i < workers_; ++i) {
+			uint64_t run = runs_[i].span.load(std::memory_order_relaxed);
+			uint32_t first = uint32_t(run);
+			uint32_t last = uint32_t(run >> 32);
+			if (first < last && last - first > most) {
+				victim = i;
+				victimRun = run;
+				most = last - first;
+			}
+		}
+		if (victim == workers_) {
+			return false;
+		}
+
+		uint32_t first = uint32_t(victimRun);
+		uint32_t last = uint32_t(victimRun >> 32);
+		uint32_t middle = first + (last - first)/2;
+		if (runs_[victim].span.compare_exchange_strong(victimRun, pack(first, middle), std::memory_order_relaxed)) {
+			// No one else changes an empty run, so the worker's own can simply be replaced
+			tile = middle;
+			runs_[worker].span.store(pack(middle + 1, last), std::memory_order_relaxed);
+			return true;
+		}
+	}
+}
+
+void TileScheduler::finished(uint32_t tile) {
+	// Claim the next place in the order, then publish the tile there
+	uint32_t index = completed_.fetch_add(1, std::memory_order_relaxed);
+	order_[index].store(tile + 1, std::memory_order_release);
+}
+
+bool TileScheduler::finishedTile(uint32_t index, uint32_t& tile) const {
+	if (index >= tiles_) {
+		return false;
+	}
+	uint32_t recorded = order_[index].load(std::memory_order_acquire);
+	if (recorded == 0) {
+		return false;
+	}
+	tile = recorded - 1;
+	return true;
+}
+
+uint32_t TileScheduler::tiles() const {
+	return tiles_;
+}
+
+uint64_t TileScheduler::pack(uint32_t first, uint32_t last) {
+	return uint64_t(first) | (uint64_t(last) << 32);
+}
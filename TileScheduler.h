@@ -0,0 +1,122 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef TILE_SCHEDULER_H_INCLUDED
+#define TILE_SCHEDULER_H_INCLUDED
+
+#include "NonCopyable.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+ * \file
+ * \brief TileScheduler class header file.
+ */
+
+/**
+ * \brief Hands out the tiles of an image to a fixed set of worker threads, letting idle workers steal.
+ *
+ * The tiles are numbered, and at the start each worker is given an equal run
+ * of consecutive tiles, so that the tiles it works on are close together in
+ * the image, and share much of the Scene they see. Some parts of an image take
+ * far longer than others (mirrors, caustics, many lights), so a worker which
+ * runs out of tiles steals the later half of the run of whichever worker has
+ * the most left, and carries on from there.
+ *
+ * Each run is kept as a single 64-bit atomic, holding its first and last
+ * tile, so taking a tile and stealing are both one compare-and-swap, and no
+ * locks are needed. A worker takes tiles from the start of its own run, and
+ * thieves take them from the end, so they only contend when a run is nearly
+ * used up. The runs are kept on separate cache lines so that workers taking
+ * their own tiles do not slow each other down.
+ *
+ * Every tile is handed out exactly once. The tiles are independent, so the
+ * order in which they are handed out does not change the image. Workers
+ * report each tile they finish, and the finished tiles are recorded in the
+ * order they are reported, so that the thread showing the image can find
+ * the tiles it has not yet shown, and safely read their pixels.
+ */
+class TileScheduler : private NonCopyable {
+
+public:
+
+	/** \brief TileScheduler constructor.
+	 *
+	 * \param tiles The number of tiles to hand out.
+	 * \param workers The number of worker threads, which must be at least one.
+	 */
+	TileScheduler(uint32_t tiles, unsigned int workers);
+
+	/** \brief TileScheduler destructor. */
+	~TileScheduler();
+
+	/** \brief Get the next tile for a worker to render.
+	 *
+	 * This may be called by each worker thread, with its own \c worker, at the
+	 * same time as the others.
+	 *
+	 * \param worker The index of the worker asking, from 0 up to the number of workers.
+	 * \param tile Set to the tile to render, if there is one.
+	 * \return true if there was a tile, false if every tile has been handed out.
+	 */
+	bool next(unsigned int worker, uint32_t& tile);
+
+	/** \brief Record that a worker has finished rendering a tile.
+	 *
+	 * This may be called by any worker, at the same time as the others. The
+	 * worker's writes to the tile before the call are seen by a thread which
+	 * then gets the tile from finishedTile().
+	 *
+	 * \param tile The tile which is finished.
+	 */
+	void finished(uint32_t tile);
+
+	/** \brief Find a finished tile, in the order they were finished.
+	 *
+	 * \param index How many tiles were finished before the one wanted.
+	 * \param tile Set to the tile, if it has been recorded.
+	 * \return true if the tile was found, false if fewer tiles have been recorded as finished.
+	 */
+	bool finishedTile(uint32_t index, uint32_t& tile) const;
+
+	/** \brief The number of tiles to hand out.
+	 *
+	 * \return The number of tiles the TileScheduler was made with.
+	 */
+	uint32_t tiles() const;
+
+private:
+
+	/** \brief A run of tiles belonging to one worker. */
+	struct Run {
+		std::atomic<uint64_t> span; //!< The first tile in the low 32 bits, and one past the last in the high 32 bits.
+		char padding[64 - sizeof(std::atomic<uint64_t>)]; //!< Keeps the spans of neighbouring Runs on separate cache lines.
+	};
+
+	/** \brief Take a run of tiles from the worker with the most left.
+	 *
+	 * \param worker The index of the worker stealing, whose own run must be empty.
+	 * \param tile Set to the first of the stolen tiles, the rest of which become the worker's run.
+	 * \return true if any tiles were stolen, false if there were none left to steal.
+	 */
+	bool steal(unsigned int worker, uint32_t& tile);
+
+	/** \brief Put the ends of a run together.
+	 *
+	 * \param first The first tile in the run.
+	 * \param last One past the last tile in the run.
+	 * \return The run, as stored in a Run.
+	 */
+	static uint64_t pack(uint32_t first, uint32_t last);
+
+	uint32_t tiles_;                  //!< The number of tiles.
+	unsigned int workers_;            //!< The number of workers.
+	std::unique_ptr<Run[]> runs_;     //!< The tiles left for each worker.
+	std::atomic<uint32_t> completed_; //!< The number of tiles finished.
+	std::unique_ptr<std::atomic<uint32_t>[]> order_; //!< One more than each finished tile, in the order they finished, or 0 for those still to come.
+
+};
+
+#endif // TILE_SCHEDULER_H_INCLUDED
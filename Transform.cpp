@@ -206,3 +206,17 @@ void Transform::translate(double tx, double ty, double tz) {
 void Transform::translate(const Direction& direction) {
 	translate(direction(0), direction(1), direction(2));
 }
+
+void Transform::compose(const Transform& transform) {
+	T_ = transform.T_*T_;
+	Tinv_ = Tinv_*transform.Tinv_;
+}
+
+void Transform::rows(double forward[3][4], double inverse[3][4]) const {
+	for (size_t r = 0; r < 3; ++r) {
+		for (size_t c = 0; c < 4; ++c) {
+			forward[r][c] = T_(r,c);
+			inverse[r][c] = Tinv_(r,c);
+		}
+	}
+}
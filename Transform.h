@@ -94,6 +94,7 @@ public:
 	/** \brief Apply a transformation to a Ray.
 	 *
 	 * A Ray is a Point and a Direction, and both need to be transformed appropriately.
+	 * Any RayDifferential is left behind, as it is only tracked in the world frame.
 	 * 
 	 * \param ray The Ray to Transform.
 	 * \return The transformed Ray.
@@ -202,6 +203,26 @@ public:
 	 */
 	void translate(const Direction& direction);
 
+	/** \brief Follow this Transform with another.
+	 *
+	 * After this, applying \c this has the same effect as applying
+	 * the original Transform and then \c transform.
+	 *
+	 * \param transform The Transform to apply after \c this.
+	 */
+	void compose(const Transform& transform);
+
+	/** \brief Copy out the top three rows of the matrix and of its inverse.
+	 *
+	 * The bottom row of both is always (0, 0, 0, 1). Code which applies the
+	 * same Transform very many times can keep these plain arrays and avoid
+	 * the allocations that Matrix arithmetic makes (see CSGProgram).
+	 *
+	 * \param forward Set to the transformation matrix, by row.
+	 * \param inverse Set to the inverse transformation matrix, by row.
+	 */
+	void rows(double forward[3][4], double inverse[3][4]) const;
+
 private:
 
 	Matrix T_;    //!< The 4x4 homogeneous transformation matrix.
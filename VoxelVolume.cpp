@@ -0,0 +1,466 @@
+/* $Rev: 250 $ */
+#include "VoxelVolume.h"
+
+#include "utility.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+const size_t VoxelVolume::brickSize;
+const uint32_t VoxelVolume::noBrick;
+
+/** \brief State of a 3D DDA stepping a Ray through the cells of a grid. */
+struct GridWalk {
+	size_t cell[3];   //!< The current cell.
+	size_t lo[3];     //!< The lowest cell to visit on each axis.
+	size_t hi[3];     //!< One past the highest cell to visit on each axis.
+	bool positive[3]; //!< Whether the Ray moves up each axis.
+	double tMax[3];   //!< Distance along the Ray to the next cell boundary on each axis.
+	double tDelta[3]; //!< Distance along the Ray between cell boundaries on each axis.
+};
+
+// Start a walk at distance t along the Ray, through cells of the given size
+static void startWalk(GridWalk& walk, const double origin[3], const double direction[3], double t,
+                      double cellSize, const size_t lo[3], const size_t hi[3]) {
+	for (int a = 0; a < 3; ++a) {
+		walk.lo[a] = lo[a];
+		walk.hi[a] = hi[a];
+		double p = (origin[a] + t*direction[a])/cellSize;
+		walk.cell[a] = size_t(std::min(std::max(std::floor(p), double(lo[a])), double(hi[a] - 1)));
+		walk.positive[a] = direction[a] > 0;
+		if (direction[a] != 0) {
+			double boundary = (walk.positive[a] ? walk.cell[a] + 1 : walk.cell[a])*cellSize;
+			walk.tMax[a] = (boundary - origin[a])/direction[a];
+			walk.tDelta[a] = std::abs(cellSize/direction[a]);
+		} else {
+			walk.tMax[a] = infinity;
+			walk.tDelta[a] = infinity;
+		}
+	}
+}
+
+// Distance along the Ray at which it leaves the current cell
+static double exitDistance(const GridWalk& walk) {
+	return std::min(walk.tMax[0], std::min(walk.tMax[1], walk.tMax[2]));
+}
+
+// Move to the next cell, returning false if the Ray leaves the cells to visit
+static bool stepWalk(GridWalk& walk) {
+	int a = 0;
+	if (walk.tMax[1] < walk.tMax[a]) a = 1;
+	if (walk.tMax[2] < walk.tMax[a]) a = 2;
+	if (walk.positive[a] ? walk.cell[a] + 1 >= walk.hi[a] : walk.cell[a] == walk.lo[a]) {
+		return false;
+	}
+	walk.cell[a] = walk.positive[a] ? walk.cell[a] + 1 : walk.cell[a] - 1;
+	walk.tMax[a] += walk.tDelta[a];
+	return true;
+}
+
+// Number of bytes in each sample of the given format
+static size_t sampleBytes(voxel_format format) {
+	if (format == VOXEL_FLOAT) {
+		return sizeof(float);
+	} else if (format == VOXEL_UINT16) {
+		return sizeof(uint16_t);
+	}
+	return sizeof(uint8_t);
+}
+
+// Convert a sample, as it is stored, to a floating point value
+static float decode(const unsigned char* raw, voxel_format format) {
+	if (format == VOXEL_FLOAT) {
+		float value;
+		std::memcpy(&value, raw, sizeof(float));
+		return value;
+	} else if (format == VOXEL_UINT16) {
+		uint16_t value;
+		std::memcpy(&value, raw, sizeof(uint16_t));
+		return value/65535.0f;
+	}
+	return raw[0]/255.0f;
+}
+
+VoxelVolume::VoxelVolume() : Object(), threshold_(0.5), format_(VOXEL_FLOAT), size_(), regions_(),
+brickIndex_(), ranges_(), bricks_() {
+
+}
+
+VoxelVolume::VoxelVolume(const VoxelVolume& volume) : Object(volume), threshold_(volume.threshold_), format_(volume.format_),
+brickIndex_(volume.brickIndex_), ranges_(volume.ranges_), bricks_(volume.bricks_) {
+	std::copy(volume.size_, volume.size_ + 3, size_);
+	std::copy(volume.regions_, volume.regions_ + 3, regions_);
+}
+
+VoxelVolume::~VoxelVolume() {
+
+}
+
+const VoxelVolume& VoxelVolume::operator=(const VoxelVolume& volume) {
+	if (this != &volume) {
+		Object::operator=(volume);
+		threshold_ = volume.threshold_;
+		format_ = volume.format_;
+		std::copy(volume.size_, volume.size_ + 3, size_);
+		std::copy(volume.regions_, volume.regions_ + 3, regions_);
+		brickIndex_ = volume.brickIndex_;
+		ranges_ = volume.ranges_;
+		bricks_ = volume.bricks_;
+	}
+	return *this;
+}
+
+void VoxelVolume::load(const std::string& filename, size_t sizeX, size_t sizeY, size_t sizeZ, voxel_format format, double threshold) {
+	if (sizeX < 2 || sizeY < 2 || sizeZ < 2) {
+		std::cerr << "Voxel volume '" << filename << "' needs at least 2x2x2 samples" << std::endl;
+		exit(-1);
+	}
+	std::ifstream fin(filename, std::ios::binary);
+	if (!fin) {
+		std::cerr << "Cannot open voxel file '" << filename << "'" << std::endl;
+		exit(-1);
+	}
+
+	reset(sizeX, sizeY, sizeZ, format, threshold);
+	size_t sliceBytes = sizeX*sizeY*sampleBytes(format);
+	std::vector<unsigned char> slices(brickSize*sliceBytes);
+	for (int pass = 0; pass < 2; ++pass) {
+		for (size_t layer = 0; layer < regions_[2]; ++layer) {
+			size_t count = std::min(brickSize, sizeZ - layer*brickSize);
+			fin.read(reinterpret_cast<char*>(slices.data()), count*sliceBytes);
+			if (!fin) {
+				std::cerr << "Voxel file '" << filename << "' is too short for " << sizeX << "x" << sizeY << "x" << sizeZ << " samples" << std::endl;
+				exit(-1);
+			}
+			if (pass == 0) {
+				measureLayer(layer, slices.data());
+			} else {
+				storeLayer(layer, slices.data());
+			}
+		}
+		if (pass == 0) {
+			finishRanges();
+			fin.seekg(0);
+		}
+	}
+}
+
+void VoxelVolume::setSamples(size_t sizeX, size_t sizeY, size_t sizeZ, const std::vector<float>& samples, double threshold) {
+	if (sizeX < 2 || sizeY < 2 || sizeZ < 2 || samples.size() != sizeX*sizeY*sizeZ) {
+		std::cerr << "Voxel volume needs at least 2x2x2 samples, and sizeX x sizeY x sizeZ of them" << std::endl;
+		exit(-1);
+	}
+	reset(sizeX, sizeY, sizeZ, VOXEL_FLOAT, threshold);
+	const unsigned char* raw = reinterpret_cast<const unsigned char*>(samples.data());
+	size_t layerBytes = brickSize*sizeX*sizeY*sizeof(float);
+	for (size_t layer = 0; layer < regions_[2]; ++layer) {
+		measureLayer(layer, raw + layer*layerBytes);
+	}
+	finishRanges();
+	for (size_t layer = 0; layer < regions_[2]; ++layer) {
+		storeLayer(layer, raw + layer*layerBytes);
+	}
+}
+
+double VoxelVolume::getThreshold() const {
+	return threshold_;
+}
+
+void VoxelVolume::reset(size_t sizeX, size_t sizeY, size_t sizeZ, voxel_format format, double threshold) {
+	threshold_ = threshold;
+	format_ = format;
+	size_[0] = sizeX;
+	size_[1] = sizeY;
+	size_[2] = sizeZ;
+	for (int a = 0; a < 3; ++a) {
+		regions_[a] = (size_[a] + brickSize - 1)/brickSize;
+	}
+	size_t regionCount = regions_[0]*regions_[1]*regions_[2];
+	brickIndex_.assign(regionCount, noBrick);
+	ranges_.assign(regionCount, Range{0, 0});
+	bricks_.clear();
+}
+
+void VoxelVolume::measureLayer(size_t layer, const unsigned char* slices) {
+	size_t bytes = sampleBytes(format_);
+	size_t sliceSize = size_[0]*size_[1];
+	for (size_t rj = 0; rj < regions_[1]; ++rj) {
+		for (size_t ri = 0; ri < regions_[0]; ++ri) {
+			// Only the samples inside the volume count, as no cell reaches past its edge
+			Range range{std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()};
+			for (size_t z = layer*brickSize; z < std::min((layer + 1)*brickSize, size_[2]); ++z) {
+				for (size_t y = rj*brickSize; y < std::min((rj + 1)*brickSize, size_[1]); ++y) {
+					for (size_t x = ri*brickSize; x < std::min((ri + 1)*brickSize, size_[0]); ++x) {
+						float value = decode(slices + ((z - layer*brickSize)*sliceSize + y*size_[0] + x)*bytes, format_);
+						range.min = std::min(range.min, value);
+						range.max = std::max(range.max, value);
+					}
+				}
+			}
+			ranges_[(layer*regions_[1] + rj)*regions_[0] + ri] = range;
+		}
+	}
+}
+
+void VoxelVolume::finishRanges() {
+	// The cells of a region also use samples from the bricks above it on
+	// each axis, so their ranges are included too
+	std::vector<Range> ranges(ranges_);
+	for (size_t rk = 0; rk < regions_[2]; ++rk) {
+		for (size_t rj = 0; rj < regions_[1]; ++rj) {
+			for (size_t ri = 0; ri < regions_[0]; ++ri) {
+				Range& range = ranges[(rk*regions_[1] + rj)*regions_[0] + ri];
+				for (size_t nk = rk; nk <= std::min(rk + 1, regions_[2] - 1); ++nk) {
+					for (size_t nj = rj; nj <= std::min(rj + 1, regions_[1] - 1); ++nj) {
+						for (size_t ni = ri; ni <= std::min(ri + 1, regions_[0] - 1); ++ni) {
+							const Range& next = ranges_[(nk*regions_[1] + nj)*regions_[0] + ni];
+							range.min = std::min(range.min, next.min);
+							range.max = std::max(range.max, next.max);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Only the regions whose cells include the threshold are stepped through,
+	// and their cells and gradients read the samples up to one region away on
+	// each axis. Bricks of zeros are never needed, as missing samples are zero.
+	for (size_t rk = 0; rk < regions_[2]; ++rk) {
+		for (size_t rj = 0; rj < regions_[1]; ++rj) {
+			for (size_t ri = 0; ri < regions_[0]; ++ri) {
+				size_t region = (rk*regions_[1] + rj)*regions_[0] + ri;
+				const Range& own = ranges_[region];
+				bool needed = false;
+				if (own.min != 0 || own.max != 0) {
+					for (size_t nk = (rk > 0 ? rk - 1 : 0); nk <= std::min(rk + 1, regions_[2] - 1) && !needed; ++nk) {
+						for (size_t nj = (rj > 0 ? rj - 1 : 0); nj <= std::min(rj + 1, regions_[1] - 1) && !needed; ++nj) {
+							for (size_t ni = (ri > 0 ? ri - 1 : 0); ni <= std::min(ri + 1, regions_[0] - 1) && !needed; ++ni) {
+								const Range& range = ranges[(nk*regions_[1] + nj)*regions_[0] + ni];
+								needed = range.min <= threshold_ && range.max >= threshold_;
+							}
+						}
+					}
+				}
+				// The bricks are numbered as they are stored
+				brickIndex_[region] = needed ? 0 : noBrick;
+			}
+		}
+	}
+	ranges_.swap(ranges);
+}
+
+void VoxelVolume::storeLayer(size_t layer, const unsigned char* slices) {
+	size_t bytes = sampleBytes(format_);
+	size_t sliceSize = size_[0]*size_[1];
+	size_t brickBytes = brickSize*brickSize*brickSize*bytes;
+	for (size_t rj = 0; rj < regions_[1]; ++rj) {
+		for (size_t ri = 0; ri < regions_[0]; ++ri) {
+			size_t region = (layer*regions_[1] + rj)*regions_[0] + ri;
+			if (brickIndex_[region] == noBrick) {
+				continue;
+			}
+			brickIndex_[region] = uint32_t(bricks_.size()/brickBytes);
+			// Samples past the edge of the volume are left as zeros, and never read
+			bricks_.resize(bricks_.size() + brickBytes, 0);
+			unsigned char* brick = &bricks_[bricks_.size() - brickBytes];
+			for (size_t k = 0; k < brickSize && layer*brickSize + k < size_[2]; ++k) {
+				for (size_t j = 0; j < brickSize && rj*brickSize + j < size_[1]; ++j) {
+					size_t x = ri*brickSize;
+					size_t count = std::min(brickSize, size_[0] - x);
+					const unsigned char* row = slices + (k*sliceSize + (rj*brickSize + j)*size_[0] + x)*bytes;
+					std::copy(row, row + count*bytes, brick + (k*brickSize + j)*brickSize*bytes);
+				}
+			}
+		}
+	}
+}
+
+float VoxelVolume::sample(size_t i, size_t j, size_t k) const {
+	size_t region = ((k/brickSize)*regions_[1] + j/brickSize)*regions_[0] + i/brickSize;
+	uint32_t brick = brickIndex_[region];
+	if (brick == noBrick) {
+		return 0;
+	}
+	size_t index = ((size_t(brick)*brickSize + k%brickSize)*brickSize + j%brickSize)*brickSize + i%brickSize;
+	return decode(&bricks_[index*sampleBytes(format_)], format_);
+}
+
+void VoxelVolume::sampleGradient(size_t i, size_t j, size_t k, double gradient[3]) const {
+	size_t index[3] = {i, j, k};
+	for (int a = 0; a < 3; ++a) {
+		size_t lo[3] = {i, j, k};
+		size_t hi[3] = {i, j, k};
+		if (index[a] > 0) --lo[a];
+		if (index[a] + 1 < size_[a]) ++hi[a];
+		gradient[a] = (sample(hi[0], hi[1], hi[2]) - sample(lo[0], lo[1], lo[2]))/double(hi[a] - lo[a]);
+	}
+}
+
+BoundingBox VoxelVolume::getBounds() const {
+	if (brickIndex_.empty()) {
+		return BoundingBox();
+	}
+	return BoundingBox(Point(0, 0, 0), Point(1, 1, 1)).transformed(transform);
+}
+
+bool VoxelVolume::intersectRegion(const double origin[3], const double direction[3], const size_t region[3],
+                                  double tNear, double tFar, double minT, double& t, double normal[3]) const {
+	size_t lo[3], hi[3];
+	for (int a = 0; a < 3; ++a) {
+		lo[a] = region[a]*brickSize;
+		hi[a] = std::min(lo[a] + brickSize, size_[a] - 1);
+	}
+	GridWalk walk;
+	startWalk(walk, origin, direction, tNear, 1, lo, hi);
+
+	double tEnter = tNear;
+	while (true) {
+		double tExit = std::min(exitDistance(walk), tFar);
+		const size_t* c = walk.cell;
+
+		// Values at the corners of the cell, indexed by (dx + 2*dy + 4*dz)
+		float corner[8];
+		float cornerMin = std::numeric_limits<float>::max();
+		float cornerMax = -std::numeric_limits<float>::max();
+		for (int n = 0; n < 8; ++n) {
+			corner[n] = sample(c[0] + (n & 1), c[1] + ((n >> 1) & 1), c[2] + ((n >> 2) & 1));
+			cornerMin = std::min(cornerMin, corner[n]);
+			cornerMax = std::max(cornerMax, corner[n]);
+		}
+
+		double start = std::max(tEnter, minT);
+		if (cornerMin <= threshold_ && cornerMax >= threshold_ && start < tExit) {
+			// Trilinear interpolation of the values in the cell, less the threshold
+			auto value = [&](double s, double f[3]) {
+				for (int a = 0; a < 3; ++a) {
+					f[a] = std::min(std::max(origin[a] + s*direction[a] - c[a], 0.0), 1.0);
+				}
+				double x00 = corner[0] + f[0]*(corner[1] - corner[0]);
+				double x10 = corner[2] + f[0]*(corner[3] - corner[2]);
+				double x01 = corner[4] + f[0]*(corner[5] - corner[4]);
+				double x11 = corner[6] + f[0]*(corner[7] - corner[6]);
+				double y0 = x00 + f[1]*(x10 - x00);
+				double y1 = x01 + f[1]*(x11 - x01);
+				return y0 + f[2]*(y1 - y0) - threshold_;
+			};
+
+			// The value is cubic along the Ray, so it can cross the threshold more
+			// than once in a cell. A few sub-steps catch most of these, and the
+			// first crossing is then refined by bisection.
+			const int subSteps = 4;
+			const int refinements = 16;
+			double f[3];
+			double a = start;
+			double valueA = value(a, f);
+			for (int step = 1; step <= subSteps; ++step) {
+				double b = start + (tExit - start)*step/subSteps;
+				double valueB = value(b, f);
+				if ((valueA >= 0) != (valueB >= 0)) {
+					for (int r = 0; r < refinements; ++r) {
+						double m = 0.5*(a + b);
+						double valueM = value(m, f);
+						if ((valueA >= 0) == (valueM >= 0)) {
+							a = m;
+							valueA = valueM;
+						} else {
+							b = m;
+						}
+					}
+					t = 0.5*(a + b);
+					value(t, f);
+
+					// Interpolate the gradients at the corners, pointing from high values to low
+					for (int axis = 0; axis < 3; ++axis) {
+						normal[axis] = 0;
+					}
+					for (int n = 0; n < 8; ++n) {
+						double weight = ((n & 1) ? f[0] : 1 - f[0])*((n & 2) ? f[1] : 1 - f[1])*((n & 4) ? f[2] : 1 - f[2]);
+						double gradient[3];
+						sampleGradient(c[0] + (n & 1), c[1] + ((n >> 1) & 1), c[2] + ((n >> 2) & 1), gradient);
+						for (int axis = 0; axis < 3; ++axis) {
+							normal[axis] -= weight*gradient[axis];
+						}
+					}
+					return true;
+				}
+				a = b;
+				valueA = valueB;
+			}
+		}
+
+		if (tExit >= tFar || !stepWalk(walk)) {
+			break;
+		}
+		tEnter = tExit;
+	}
+	return false;
+}
+
+RayIntersectionList VoxelVolume::intersect(const Ray& ray) const {
+	RayIntersectionList result;
+	if (brickIndex_.empty()) {
+		return result;
+	}
+
+	Ray inverseRay = transform.applyInverse(ray);
+
+	// Distances along the Ray are in units of its direction in every frame
+	double tNear, tFar;
+	if (!BoundingBox(Point(0, 0, 0), Point(1, 1, 1)).intersect(inverseRay, tNear, tFar)) {
+		return result;
+	}
+	double minT = epsilon/ray.direction.norm();
+
+	// The Ray in grid units, where each cell is 1x1x1
+	double cells[3] = {double(size_[0] - 1), double(size_[1] - 1), double(size_[2] - 1)};
+	double origin[3], direction[3];
+	for (int a = 0; a < 3; ++a) {
+		origin[a] = inverseRay.point(a)*cells[a];
+		direction[a] = inverseRay.direction(a)*cells[a];
+	}
+
+	// Step through the regions of the coarse grid which cover the cells
+	size_t lo[3] = {0, 0, 0};
+	size_t hi[3];
+	for (int a = 0; a < 3; ++a) {
+		hi[a] = (size_[a] - 1 + brickSize - 1)/brickSize;
+	}
+	GridWalk walk;
+	startWalk(walk, origin, direction, tNear, brickSize, lo, hi);
+
+	double t;
+	double normal[3];
+	bool found = false;
+	double tEnter = tNear;
+	while (true) {
+		double tExit = std::min(exitDistance(walk), tFar);
+		const Range& range = ranges_[(walk.cell[2]*regions_[1] + walk.cell[1])*regions_[0] + walk.cell[0]];
+		if (tExit > minT && range.min <= threshold_ && range.max >= threshold_) {
+			found = intersectRegion(origin, direction, walk.cell, tEnter, tExit, minT, t, normal);
+		}
+		if (found || tExit >= tFar || !stepWalk(walk)) {
+			break;
+		}
+		tEnter = tExit;
+	}
+
+	if (found) {
+		RayIntersection hit;
+		hit.material = material;
+		Point local(inverseRay.point + t*inverseRay.direction);
+		Normal localNormal(normal[0]*cells[0], normal[1]*cells[1], normal[2]*cells[2]);
+		hit.point = transform.apply(local);
+		hit.normal = transform.apply(localNormal);
+		boxTextureCoordinates(local, localNormal, hit);
+		hit.textureScale = inverseRay.direction.norm()/ray.direction.norm();
+		if (hit.normal.dot(ray.direction) > 0) {
+			hit.normal = -hit.normal;
+		}
+		hit.distance = (hit.point - ray.point).norm();
+		result.push_back(hit);
+	}
+	return result;
+}
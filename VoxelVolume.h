@@ -0,0 +1,223 @@
+/* $Rev: 250 $ */
+#pragma once
+
+#ifndef VOXELVOLUME_H_INCLUDED
+#define VOXELVOLUME_H_INCLUDED
+
+#include "Object.h"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * \file
+ * \brief VoxelVolume class header file.
+ */
+
+/**
+ * \brief Formats of voxel data which can be loaded into a VoxelVolume.
+ *
+ * All formats are raw arrays of samples in the machine's byte order, with
+ * no header, stored a row (along x) at a time, then a slice (along y) at
+ * a time.
+ */
+enum voxel_format {
+	VOXEL_UINT8,  //!< Unsigned 8 bit integers, scaled so that 255 is a value of 1.
+	VOXEL_UINT16, //!< Unsigned 16 bit integers, scaled so that 65535 is a value of 1.
+	VOXEL_FLOAT   //!< 32 bit floating point values.
+};
+
+/**
+ * \brief Class for VoxelVolume objects.
+ *
+ * A VoxelVolume is a grid of samples, such as a CT scan or the output of
+ * a simulation, filling the unit cube \f$0 \le x,y,z \le 1\f$. The values
+ * between samples are found by trilinear interpolation, and the surface
+ * seen is where they cross the threshold value. Points with values at or
+ * above the threshold are inside the surface. Normals come from the
+ * gradient of the sample values. As with other Objects, the VoxelVolume
+ * can be moved, rotated, and scaled through its transform member.
+ *
+ * Large volumes are usually mostly empty, or mostly solid, so the samples
+ * are stored in bricks of 8x8x8, and a coarse grid records which brick (if
+ * any) holds the samples for each region, and the range of values in each
+ * region. Rays step through this coarse grid with a 3D DDA (digital
+ * differential analyser), skipping regions whose range does not include
+ * the threshold, and then step through the cells of the regions that remain
+ * with a second, finer, 3D DDA. Only the bricks whose samples are read
+ * while doing so (those of the regions that include the threshold, and of
+ * their neighbours, for the gradients) are stored, so the threshold is
+ * fixed when the samples are given. The samples are kept in the format
+ * they were given in, so 8 and 16 bit volumes take a quarter and a half of
+ * the memory of floating point ones.
+ *
+ * Like a Group, a VoxelVolume only reports the nearest hit, so it should
+ * not be used as a child of a CSG node.
+ */
+class VoxelVolume : public Object {
+
+public:
+
+	/** \brief VoxelVolume default constructor.
+	 *
+	 * A newly constructed VoxelVolume has no samples, and so cannot be
+	 * seen until some are provided by load() or setSamples().
+	 */
+	VoxelVolume();
+
+	/** \brief VoxelVolume copy constructor.
+	 *
+	 * \param volume The VoxelVolume to copy.
+	 */
+	VoxelVolume(const VoxelVolume& volume);
+
+	/** \brief VoxelVolume destructor. */
+	~VoxelVolume();
+
+	/** \brief VoxelVolume assignment operator.
+	 *
+	 * \param volume The VoxelVolume to assign to \c this.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	const VoxelVolume& operator=(const VoxelVolume& volume);
+
+	/** \brief Load samples from a file.
+	 *
+	 * The file is read eight slices at a time, once to find the range of
+	 * each region and again to keep the bricks which are needed, so only
+	 * those need to fit in memory. If the file cannot be read the program
+	 * exits with an error.
+	 *
+	 * \param filename The file to read.
+	 * \param sizeX The number of samples along the x axis, at least 2.
+	 * \param sizeY The number of samples along the y axis, at least 2.
+	 * \param sizeZ The number of samples along the z axis, at least 2.
+	 * \param format The format of the samples.
+	 * \param threshold The value of the samples at the surface.
+	 */
+	void load(const std::string& filename, size_t sizeX, size_t sizeY, size_t sizeZ, voxel_format format, double threshold = 0.5);
+
+	/** \brief Set the samples directly.
+	 *
+	 * \param sizeX The number of samples along the x axis, at least 2.
+	 * \param sizeY The number of samples along the y axis, at least 2.
+	 * \param sizeZ The number of samples along the z axis, at least 2.
+	 * \param samples The sizeX x sizeY x sizeZ samples, in the same order as in a file.
+	 * \param threshold The value of the samples at the surface.
+	 */
+	void setSamples(size_t sizeX, size_t sizeY, size_t sizeZ, const std::vector<float>& samples, double threshold = 0.5);
+
+	/** \brief Value of the samples at the surface.
+	 *
+	 * \return The threshold given to load() or setSamples().
+	 */
+	double getThreshold() const;
+
+	/** \brief VoxelVolume-Ray intersection computation.
+	 *
+	 * The Ray is traced through the grid, and the nearest point at which
+	 * the interpolated value crosses the threshold is returned. Hits closer
+	 * to the start of the Ray than \c epsilon are ignored, as they are in
+	 * Scene::intersect().
+	 *
+	 * \param ray The Ray to intersect with this VoxelVolume.
+	 * \return A list (std::vector) containing the nearest intersection, or empty if there is none.
+	 */
+	RayIntersectionList intersect(const Ray& ray) const;
+
+	/** \brief Bounds of the VoxelVolume.
+	 *
+	 * \return A BoundingBox containing the VoxelVolume.
+	 */
+	BoundingBox getBounds() const;
+
+private:
+
+	/** \brief The lowest and highest values in a region of the coarse grid. */
+	struct Range {
+		float min; //!< Lowest value.
+		float max; //!< Highest value.
+	};
+
+	/** \brief Prepare to receive samples.
+	 *
+	 * \param sizeX The number of samples along the x axis.
+	 * \param sizeY The number of samples along the y axis.
+	 * \param sizeZ The number of samples along the z axis.
+	 * \param format The format of the samples.
+	 * \param threshold The value of the samples at the surface.
+	 */
+	void reset(size_t sizeX, size_t sizeY, size_t sizeZ, voxel_format format, double threshold);
+
+	/** \brief Find the range of the samples in each region of one layer of the coarse grid.
+	 *
+	 * \param layer The index of the layer along the z axis.
+	 * \param slices Up to eight slices of samples, a slice at a time, in the volume's format.
+	 */
+	void measureLayer(size_t layer, const unsigned char* slices);
+
+	/** \brief Choose the bricks to keep, and widen the range of each region to include the samples its cells share with the next regions.
+	 *
+	 * This must be called once every layer has been measured, and before
+	 * any are stored.
+	 */
+	void finishRanges();
+
+	/** \brief Store the bricks chosen by finishRanges() for one layer of the coarse grid.
+	 *
+	 * \param layer The index of the layer along the z axis.
+	 * \param slices Up to eight slices of samples, a slice at a time, in the volume's format.
+	 */
+	void storeLayer(size_t layer, const unsigned char* slices);
+
+	/** \brief Value of a sample.
+	 *
+	 * \param i Index of the sample along the x axis.
+	 * \param j Index of the sample along the y axis.
+	 * \param k Index of the sample along the z axis.
+	 * \return The value of the sample, which is 0 if its brick is not stored.
+	 */
+	float sample(size_t i, size_t j, size_t k) const;
+
+	/** \brief Gradient of the values at a sample, in grid units.
+	 *
+	 * \param i Index of the sample along the x axis.
+	 * \param j Index of the sample along the y axis.
+	 * \param k Index of the sample along the z axis.
+	 * \param gradient Set to the gradient, estimated from the neighbouring samples.
+	 */
+	void sampleGradient(size_t i, size_t j, size_t k, double gradient[3]) const;
+
+	/** \brief Intersect a Ray with the cells of one region of the coarse grid.
+	 *
+	 * The Ray is given in grid units, where cell \f$(i,j,k)\f$ is the unit
+	 * cube with sample \f$(i,j,k)\f$ at its lowest corner.
+	 *
+	 * \param origin Start point of the Ray.
+	 * \param direction Direction of the Ray.
+	 * \param region Index of the region along each axis.
+	 * \param tNear Distance along the Ray at which it enters the region.
+	 * \param tFar Distance along the Ray at which it leaves the region.
+	 * \param minT Hits at or before this distance along the Ray are ignored.
+	 * \param t Set to the distance along the Ray of the nearest hit in the region, if there is one.
+	 * \param normal Set to the (unnormalised) outward normal at the hit, in grid units.
+	 * \return true if the Ray hits the surface in this region, false otherwise.
+	 */
+	bool intersectRegion(const double origin[3], const double direction[3], const size_t region[3],
+	                     double tNear, double tFar, double minT, double& t, double normal[3]) const;
+
+	double threshold_;     //!< Value of the samples at the surface.
+	voxel_format format_;  //!< Format of the stored samples.
+	size_t size_[3];       //!< Number of samples along each axis.
+	size_t regions_[3];    //!< Number of regions of the coarse grid along each axis.
+
+	std::vector<uint32_t> brickIndex_;  //!< Brick holding the samples of each region, or \c noBrick.
+	std::vector<Range> ranges_;         //!< Range of values in the cells of each region.
+	std::vector<unsigned char> bricks_; //!< Samples of the stored bricks, a brick at a time, in \c format_.
+
+	static const size_t brickSize = 8;          //!< Number of samples along each side of a brick.
+	static const uint32_t noBrick = 0xFFFFFFFF; //!< Brick index for regions whose samples are never read, or are all zero.
+
+};
+
+#endif // VOXELVOLUME_H_INCLUDED
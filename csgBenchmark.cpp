@@ -0,0 +1,121 @@
+/* $Rev: 250 $ */
+#include "CSG.h"
+#include "Random.h"
+#include "ScratchArena.h"
+#include "Sphere.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** \file
+ * \brief Benchmark comparing compiled and recursive CSG evaluation.
+ */
+
+// Build a random CSG tree of Spheres, of the given depth, within about a unit of the origin
+static std::shared_ptr<Object> randomTree(unsigned int depth, Random& random) {
+	std::shared_ptr<Object> object;
+	if (depth == 0) {
+		object = std::shared_ptr<Sphere>(new Sphere());
+		object->transform.scale(0.5 + 0.4*random.uniform());
+	} else {
+		std::shared_ptr<CSG> csg(new CSG());
+		csg->left = randomTree(depth - 1, random);
+		csg->right = randomTree(depth - 1, random);
+		// Mostly unions, so that deep trees are not whittled away to nothing
+		static const char* operations[4] = {"UNION", "UNION", "INTERSECTION", "DIFFERENCE"};
+		csg->setupCSG(operations[random.next() % 4]);
+		object = csg;
+	}
+	object->transform.rotateY(360*random.uniform());
+	object->transform.translate(0.6*random.uniform() - 0.3, 0.6*random.uniform() - 0.3, 0.6*random.uniform() - 0.3);
+	return object;
+}
+
+// Check that two lists of hits are exactly the same
+static bool sameHits(const RayIntersectionList& lhs, const RayIntersectionList& rhs) {
+	if (lhs.size() != rhs.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < lhs.size(); ++i) {
+		if (lhs[i].distance != rhs[i].distance) {
+			return false;
+		}
+		for (int a = 0; a < 3; ++a) {
+			if (lhs[i].point(a) != rhs[i].point(a) || lhs[i].normal(a) != rhs[i].normal(a)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/** \brief Compare CSGProgram::evaluate() with CSG::intersectTree() on random trees and Rays.
+ *
+ * For each depth of tree, a random tree is built and compiled, and the
+ * same random Rays are traced through it recursively and with the
+ * CSGProgram. The hits must be exactly the same. The time taken by each
+ * is printed. The number of Rays per tree can be given on the command line.
+ *
+ * \return 0 if the hits all agree, 1 otherwise.
+ */
+int main(int argc, char* argv[]) {
+	unsigned int numRays = 100000;
+	if (argc > 1) {
+		numRays = (unsigned int)atoi(argv[1]);
+	}
+
+	bool agree = true;
+	for (unsigned int depth = 1; depth <= 8; ++depth) {
+		Random random(depth);
+		std::shared_ptr<Object> tree = randomTree(depth, random);
+		std::shared_ptr<CSG> root = std::dynamic_pointer_cast<CSG>(tree);
+		root->compile();
+
+		std::vector<Ray> rays(numRays);
+		for (Ray& ray : rays) {
+			ray.point = Point(3*random.uniform() - 1.5, 3*random.uniform() - 1.5, -5);
+			ray.direction = Direction(0.2*random.uniform() - 0.1, 0.2*random.uniform() - 0.1, 1);
+		}
+
+		size_t recursiveHits = 0;
+		size_t compiledHits = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (const Ray& ray : rays) {
+			recursiveHits += root->intersectTree(ray).size();
+			ScratchArena::reset();
+		}
+		auto middle = std::chrono::steady_clock::now();
+		for (const Ray& ray : rays) {
+			compiledHits += root->intersect(ray).size();
+			ScratchArena::reset();
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		size_t mismatches = 0;
+		for (const Ray& ray : rays) {
+			if (!sameHits(root->intersectTree(ray), root->intersect(ray))) {
+				++mismatches;
+			}
+			ScratchArena::reset();
+		}
+		if (recursiveHits != compiledHits || mismatches > 0) {
+			agree = false;
+		}
+
+		double recursive = std::chrono::duration<double>(middle - start).count();
+		double compiled = std::chrono::duration<double>(end - middle).count();
+		std::cout << "Depth " << depth << ": recursive " << 1e9*recursive/numRays << " ns/ray, compiled "
+			<< 1e9*compiled/numRays << " ns/ray, " << double(compiledHits)/numRays << " hits/ray, "
+			<< mismatches << " mismatched rays" << std::endl;
+	}
+
+	if (!agree) {
+		std::cerr << "Compiled and recursive CSG evaluation disagree" << std::endl;
+		return 1;
+	}
+	return 0;
+}
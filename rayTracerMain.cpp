@@ -1,8 +1,10 @@
 /* $Rev: 250 $ */
 #include "SceneReader.h"
 
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <string>
 #include <vector>
 
 /** \file
@@ -16,6 +18,11 @@
  * arguments. Multiple scene files can be specified, and they are read
  * in the order provided.
  *
+ * The integrator can also be chosen with options, which override the
+ * scene files wherever they appear among them:
+ * - <tt>-integrator [whitted|path|irradiance|occlusion|normals|depth]</tt>: Ray trace or path trace the image, or show one of the debug views.
+ * - <tt>-samples [number]</tt>: The number of paths to trace through each pixel when path tracing.
+ *
  * The scene is then rendered and saved to file, as long as there
  * is a Camera specified.
  * 
@@ -26,8 +33,33 @@ int main (int argc, char *argv[]) {
 	
 	SceneReader reader(&scene);
 	
+	bool integratorSet = false;
+	integrator_type integrator = INTEGRATOR_WHITTED;
+	int pixelSamples = -1;
 	for (int i = 1; i < argc; ++i) {
-		reader.read(argv[i]);
+		std::string arg = argv[i];
+		if ((arg == "-integrator" || arg == "-samples") && i + 1 == argc) {
+			std::cerr << "Option " << arg << " needs a value" << std::endl;
+			exit(-1);
+		}
+		if (arg == "-integrator") {
+			integrator = SceneReader::parseIntegrator(argv[++i]);
+			integratorSet = true;
+		} else if (arg == "-samples") {
+			pixelSamples = std::atoi(argv[++i]);
+			if (pixelSamples < 1) {
+				std::cerr << "Option -samples needs a positive number" << std::endl;
+				exit(-1);
+			}
+		} else {
+			reader.read(arg);
+		}
+	}
+	if (integratorSet) {
+		scene.integrator = integrator;
+	}
+	if (pixelSamples > 0) {
+		scene.pixelSamples = (unsigned int)pixelSamples;
 	}
 
 	if (scene.hasCamera()) {